@@ -43,6 +43,7 @@
 
 #include "keyvi/dictionary/dictionary_types.h"
 #include "keyvi/dictionary/fsa/internal/constants.h"
+#include "keyvi/index/internal/key_filter.h"
 #include "keyvi/util/configuration.h"
 
 /** Extracts the parameters. */
@@ -70,6 +71,8 @@ int main(int argc, char** argv) {
 
   description.add_options()("input-file,i", boost::program_options::value<std::vector<std::string>>(), "input file");
   description.add_options()("output-file,o", boost::program_options::value<std::string>(), "output file");
+  description.add_options()("key-filter,f", boost::program_options::value<std::string>(),
+                            "write a filter over the merged keys to this file");
   description.add_options()("memory-limit,m", boost::program_options::value<std::string>(),
                             "amount of main memory to use");
   description.add_options()("parameter,p",
@@ -123,8 +126,17 @@ int main(int argc, char** argv) {
       jsonDictionaryMerger.Add(f);
     }
 
+    keyvi::index::internal::KeyFilterBuilder key_filter;
+    if (vm.count("key-filter") != 0U) {
+      jsonDictionaryMerger.SetKeyCallback([&key_filter](const std::string& key) { key_filter.Add(key); });
+    }
+
     jsonDictionaryMerger.Merge(output_file);
 
+    if (vm.count("key-filter") != 0U) {
+      key_filter.WriteToFile(vm["key-filter"].as<std::string>());
+    }
+
   } else {
     std::cout << "ERROR: arguments wrong or missing." << '\n' << '\n';
     std::cout << description;
@@ -26,6 +26,8 @@ enum CompressionAlgorithm {
   ZLIB_COMPRESSION = 1,
   SNAPPY_COMPRESSION = 2,
   ZSTD_COMPRESSION = 3,
+  ZSTD_DICTIONARY_COMPRESSION = 4,
+  PREDICTIVE_COMPRESSION = 5,
 };
 
 } /* namespace compression */
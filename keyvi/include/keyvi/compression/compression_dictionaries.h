@@ -0,0 +1,202 @@
+/* * keyvi - A key value store.
+ *
+ * Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * compression_dictionaries.h
+ */
+
+#ifndef KEYVI_COMPRESSION_COMPRESSION_DICTIONARIES_H_
+#define KEYVI_COMPRESSION_COMPRESSION_DICTIONARIES_H_
+
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+
+#include "keyvi/compression/compression_algorithm.h"
+#include "keyvi/compression/predictive_compression.h"
+#include "keyvi/compression/zstd_dictionary_compression_strategy.h"
+#include "msgpack.hpp"
+
+// #define ENABLE_TRACING
+#include "keyvi/dictionary/util/trace.h"
+
+namespace keyvi {
+namespace compression {
+
+/**
+ * The dictionaries of the codecs values of a value store have been compressed with, values are not decodable without.
+ *
+ * Every dictionary starts with the code of the compression algorithm it belongs to, they are persisted as msgpack
+ * array. Besides zstd dictionaries this holds the model of predictive compression, at most one per value store.
+ */
+class CompressionDictionaries final {
+ public:
+  CompressionDictionaries() = default;
+
+  CompressionDictionaries& operator=(CompressionDictionaries const&) = delete;
+  CompressionDictionaries(const CompressionDictionaries& that) = delete;
+
+  /**
+   * Load persisted dictionaries.
+   *
+   * @param packed_dictionaries the msgpack'ed dictionaries
+   * @param size size of the packed dictionaries
+   */
+  CompressionDictionaries(const char* packed_dictionaries, size_t size) {
+    for (const std::string& dictionary : Unpack(packed_dictionaries, size)) {
+      Add(dictionary);
+    }
+  }
+
+  void Add(const std::string& dictionary) {
+    switch (GetAlgorithm(dictionary)) {
+      case ZSTD_DICTIONARY_COMPRESSION:
+        zstd_dictionaries_.Add(dictionary.data() + 1, dictionary.size() - 1);
+        break;
+      case PREDICTIVE_COMPRESSION: {
+        if (predictive_compression_model_) {
+          throw std::invalid_argument("more than one predictive compression model");
+        }
+        std::istringstream model_stream(dictionary.substr(1));
+        predictive_compression_model_ = std::make_shared<PredictiveCompression>(model_stream);
+        break;
+      }
+      default:
+        throw std::invalid_argument("Invalid compression algorithm for a dictionary " +
+                                    boost::lexical_cast<std::string>(static_cast<int>(dictionary[0])));
+    }
+  }
+
+  /**
+   * Decompress a value compressed with one of the dictionaries.
+   *
+   * @param compressed the value including the leading compression code
+   * @param compressed_size size of the value
+   * @param output the uncompressed value
+   */
+  void Decompress(const char* compressed, size_t compressed_size, std::string* output) const {
+    switch (static_cast<CompressionAlgorithm>(compressed[0])) {
+      case ZSTD_DICTIONARY_COMPRESSION:
+        zstd_dictionaries_.Decompress(compressed, compressed_size, output);
+        break;
+      case PREDICTIVE_COMPRESSION:
+        if (!predictive_compression_model_) {
+          throw std::invalid_argument("predictive compression model not found");
+        }
+        output->clear();
+        predictive_compression_model_->Uncompress(compressed + 1, compressed_size - 1, output);
+        break;
+      default:
+        throw std::invalid_argument("Invalid compression algorithm " +
+                                    boost::lexical_cast<std::string>(static_cast<int>(compressed[0])));
+    }
+  }
+
+  std::shared_ptr<const PredictiveCompression> GetPredictiveCompressionModel() const {
+    return predictive_compression_model_;
+  }
+
+  static CompressionAlgorithm GetAlgorithm(const std::string& dictionary) {
+    return static_cast<CompressionAlgorithm>(dictionary[0]);
+  }
+
+  /** Whether values compressed with the given algorithm can only be decompressed with a dictionary. */
+  static bool RequiresDictionary(CompressionAlgorithm algorithm) {
+    return algorithm == ZSTD_DICTIONARY_COMPRESSION || algorithm == PREDICTIVE_COMPRESSION;
+  }
+
+  /**
+   * Add a dictionary to a list of dictionaries, if not already known.
+   *
+   * @param dictionary the dictionary including the leading compression code
+   * @param dictionaries the dictionaries
+   */
+  static void AddUnique(const std::string& dictionary, std::vector<std::string>* dictionaries) {
+    for (const std::string& known_dictionary : *dictionaries) {
+      if (known_dictionary == dictionary) {
+        return;
+      }
+
+      // values do not refer to a model, only one can be used
+      if (GetAlgorithm(dictionary) == PREDICTIVE_COMPRESSION &&
+          GetAlgorithm(known_dictionary) == PREDICTIVE_COMPRESSION) {
+        throw std::invalid_argument("different predictive compression models");
+      }
+
+      // values only refer to the id of a zstd dictionary, it must be unique
+      if (GetAlgorithm(dictionary) != ZSTD_DICTIONARY_COMPRESSION ||
+          GetAlgorithm(known_dictionary) != ZSTD_DICTIONARY_COMPRESSION) {
+        continue;
+      }
+
+      const uint32_t id = GetZstdDictionaryId(dictionary.substr(1));
+      if (id == GetZstdDictionaryId(known_dictionary.substr(1))) {
+        throw std::invalid_argument("different zstd dictionaries with the same id " + std::to_string(id));
+      }
+    }
+
+    dictionaries->push_back(dictionary);
+  }
+
+  static std::string Pack(const std::vector<std::string>& dictionaries) {
+    if (dictionaries.empty()) {
+      return std::string();
+    }
+
+    msgpack::sbuffer packed_dictionaries;
+    msgpack::pack(packed_dictionaries, dictionaries);
+    return std::string(packed_dictionaries.data(), packed_dictionaries.size());
+  }
+
+  static std::vector<std::string> Unpack(const char* packed_dictionaries, size_t size) {
+    const msgpack::object_handle dictionaries = msgpack::unpack(packed_dictionaries, size);
+    return dictionaries.get().as<std::vector<std::string>>();
+  }
+
+  /**
+   * Read the packed dictionaries from a file.
+   *
+   * @param file_name the file
+   * @param offset position of the packed dictionaries in the file
+   * @param size size of the packed dictionaries
+   */
+  static std::vector<std::string> ReadFromFile(const std::string& file_name, size_t offset, size_t size) {
+    if (size == 0) {
+      return std::vector<std::string>();
+    }
+
+    std::string packed_dictionaries(size, '\0');
+    std::ifstream in_stream(file_name, std::ios::binary);
+    in_stream.seekg(offset);
+    in_stream.read(&packed_dictionaries[0], packed_dictionaries.size());
+    return Unpack(packed_dictionaries.data(), packed_dictionaries.size());
+  }
+
+ private:
+  ZstdDictionaryDecompressor zstd_dictionaries_;
+  std::shared_ptr<const PredictiveCompression> predictive_compression_model_;
+};
+
+} /* namespace compression */
+} /* namespace keyvi */
+
+#endif  // KEYVI_COMPRESSION_COMPRESSION_DICTIONARIES_H_
@@ -27,11 +27,13 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
 
 #include "keyvi/compression/compression_algorithm.h"
+#include "keyvi/compression/compression_dictionaries.h"
 #include "keyvi/compression/compression_strategy.h"
 #include "keyvi/compression/snappy_compression_strategy.h"
 #include "keyvi/compression/zlib_compression_strategy.h"
@@ -90,6 +92,57 @@ inline decompress_func_t decompressor_from_string(const std::string& s) {
   return decompressor_by_code(static_cast<CompressionAlgorithm>(s[0]));
 }
 
+typedef void (*decompress_into_func_t)(const char*, size_t, std::string*);
+
+/** Returns a decompressor that writes into a caller supplied buffer. */
+inline decompress_into_func_t decompressor_into_by_code(const CompressionAlgorithm algorithm) {
+  switch (algorithm) {
+    case NO_COMPRESSION:
+      return RawCompressionStrategy::DoDecompress;
+    case ZLIB_COMPRESSION:
+      return ZlibCompressionStrategy::DoDecompress;
+    case SNAPPY_COMPRESSION:
+      return SnappyCompressionStrategy::DoDecompress;
+    case ZSTD_COMPRESSION:
+      return ZstdCompressionStrategy::DoDecompress;
+    default:
+      throw std::invalid_argument("Invalid compression algorithm " +
+                                  boost::lexical_cast<std::string>(static_cast<int>(algorithm)));
+  }
+}
+
+/**
+ * Decompress a value, uncompressed values are returned in place without copying.
+ *
+ * @param compressed the value including the leading compression code
+ * @param compressed_size size of the value
+ * @param buffer buffer for the decompressed value, only used if the value is compressed
+ * @param dictionaries the compression dictionaries of the value store, if any
+ * @return view on the uncompressed value, valid as long as compressed and buffer are
+ */
+inline std::string_view DecompressToView(const char* compressed, size_t compressed_size, std::string* buffer,
+                                         const CompressionDictionaries* dictionaries = nullptr) {
+  if (compressed_size == 0) {
+    return std::string_view();
+  }
+
+  const CompressionAlgorithm algorithm = static_cast<CompressionAlgorithm>(compressed[0]);
+  if (algorithm == NO_COMPRESSION) {
+    return std::string_view(compressed + 1, compressed_size - 1);
+  }
+
+  if (CompressionDictionaries::RequiresDictionary(algorithm)) {
+    if (dictionaries == nullptr) {
+      throw std::invalid_argument("value requires a compression dictionary, but none is available");
+    }
+    dictionaries->Decompress(compressed, compressed_size, buffer);
+    return *buffer;
+  }
+
+  decompressor_into_by_code(algorithm)(compressed, compressed_size, buffer);
+  return *buffer;
+}
+
 /** Returns an instance of a compression strategy by enum. */
 inline compression_strategy_t compression_strategy_by_code(const CompressionAlgorithm algorithm) {
   switch (algorithm) {
@@ -97,6 +97,10 @@ struct RawCompressionStrategy final : public CompressionStrategy {
 
   static inline std::string DoDecompress(const std::string& compressed) { return compressed.substr(1); }
 
+  static inline void DoDecompress(const char* compressed, size_t compressed_size, std::string* output) {
+    output->assign(compressed + 1, compressed_size - 1);
+  }
+
   std::string name() const { return "raw"; }
 
   uint64_t GetFileVersionMin() const { return KEYVI_FILE_VERSION_MIN; }
@@ -26,11 +26,14 @@
 #define KEYVI_COMPRESSION_PREDICTIVE_COMPRESSION_H_
 
 #include <inttypes.h>
-#include <bitset>
+
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
-#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
 // #define ENABLE_TRACING
 #include "keyvi/dictionary/util/trace.h"
@@ -40,8 +43,15 @@ namespace compression {
 
 /**
  * Short string compression inspired by RFC 1978 (Predictor Compression Protocol)
+ *
+ * The model predicts up to 8 bytes following every bigram. The compressed string is a sequence of chunks, a flag byte
+ * followed by the literals of the chunk. Every bit of the flag byte, starting with the lowest, stands for a symbol, a
+ * set bit for a successful prediction, a cleared bit for a literal. The first 2 bytes are always literals, strings
+ * shorter than 2 bytes are not compressed.
  */
 class PredictiveCompression final {
+  struct Prediction;
+
  public:
   explicit PredictiveCompression(std::string file_name) {
     std::fstream infile(file_name, std::fstream::in | std::fstream::binary);
@@ -52,153 +62,321 @@ class PredictiveCompression final {
 
   explicit PredictiveCompression(std::istream& instream) { read_stream(instream); }
 
-  // highly inefficient for now
-  std::string LookupBigram(const unsigned char* bigram) {
-    // skip for null bytes
-    if (bigram[0] == 0 || bigram[1] == 0) {
-      return "";
-    } else {
-      return predictor_table_[(uint16_t(bigram[0]) << 8) + bigram[1]];
-    }
+  PredictiveCompression& operator=(PredictiveCompression const&) = delete;
+  PredictiveCompression(const PredictiveCompression& that) = delete;
+
+  std::string LookupBigram(const unsigned char* bigram) const {
+    const Prediction& prediction = predictions_[(uint16_t(bigram[0]) << 8) + bigram[1]];
+    return std::string(reinterpret_cast<const char*>(&prediction.bytes), prediction.length);
   }
 
-  std::string Compress(const std::string& input) {
-    std::ostringstream output_buffer;
+  /**
+   * Compresses a string in parts, the output of a part is appended as soon as it is complete.
+   */
+  class Encoder final {
+   public:
+    explicit Encoder(const PredictiveCompression& model) : predictions_(model.predictions_.data()) {}
+
+    template <typename OutputT>
+    void Write(const char* input, size_t input_size, OutputT* output) {
+      const unsigned char* data = reinterpret_cast<const unsigned char*>(input);
+      size_t offset = 0;
+
+      if (!pending_.empty()) {
+        // a prediction might span the bytes left over and the new input
+        const size_t pending_size = pending_.size();
+        const size_t appended = std::min(input_size, MAX_PREDICTION_LENGTH);
+        pending_.append(input, appended);
+        const size_t consumed = Encode(reinterpret_cast<const unsigned char*>(pending_.data()), pending_.size(),
+                                       false, output);
+        if (consumed < pending_size) {
+          pending_.erase(0, consumed);
+          return;
+        }
+        pending_.clear();
+        offset = consumed - pending_size;
+      }
 
-    size_t input_length = input.size();
-    size_t offset = 0;
-    std::bitset<8> current_bitset;
-    char uncompressed_buf[8];
-    unsigned char bigram[2];
-    size_t bitset_position = 0;
-    size_t uncompressed_position = 0;
+      offset += Encode(data + offset, input_size - offset, false, output);
+      pending_.assign(input + offset, input_size - offset);
+    }
 
-    TRACE("Compressing %s", input.c_str());
+    /**
+     * Compress the remaining input, the encoder can be used for the next string afterwards.
+     */
+    template <typename OutputT>
+    void Finish(OutputT* output) {
+      Encode(reinterpret_cast<const unsigned char*>(pending_.data()), pending_.size(), true, output);
+      pending_.clear();
+
+      if (number_of_symbols_ < 2) {
+        output->insert(output->end(), literals_, literals_ + number_of_literals_);
+      } else if (bit_ != 0) {
+        FlushChunk(output);
+      }
 
-    if (input_length < 2) {
-      return input;
+      flags_ = 0;
+      bit_ = 0;
+      number_of_literals_ = 0;
+      number_of_symbols_ = 0;
+      bigram_ = 0;
     }
 
-    // setup first character
-    bigram[0] = input[0];
-    bigram[1] = input[1];
-    bitset_position = 2;
-    uncompressed_buf[0] = input[0];
-    uncompressed_buf[1] = input[1];
-    uncompressed_position = 2;
-
-    offset = 2;
-    while (offset < input_length) {
-      std::string prediction = LookupBigram(bigram);
-      if (prediction.size() > 0 && prediction == input.substr(offset, prediction.size())) {
-        // prediction succeeded
-        TRACE("Prediction success: %s", prediction.c_str());
-        current_bitset.set(bitset_position++);
-        offset += prediction.size();
-
-        if (prediction.size() > 1) {
-          bigram[0] = prediction[prediction.size() - 2];
+   private:
+    const Prediction* predictions_;
+    std::string pending_;
+    char literals_[8];
+    size_t number_of_literals_ = 0;
+    size_t number_of_symbols_ = 0;
+    unsigned char flags_ = 0;
+    size_t bit_ = 0;
+    uint16_t bigram_ = 0;
+
+    /**
+     * @param last whether the input ends, otherwise predictions are only tested with a complete lookahead
+     * @return number of bytes consumed
+     */
+    template <typename OutputT>
+    size_t Encode(const unsigned char* data, size_t size, bool last, OutputT* output) {
+      size_t offset = 0;
+
+      while (number_of_symbols_ < 2 && offset < size) {
+        AddLiteral(data[offset++], output);
+      }
+
+      while (offset < size && (last || size - offset >= MAX_PREDICTION_LENGTH)) {
+        const Prediction& prediction = predictions_[bigram_];
+        if (prediction.length != 0 && Matches(prediction, data + offset, size - offset)) {
+          flags_ |= 1 << bit_;
+          offset += prediction.length;
+          bigram_ = prediction.next_bigram;
+          ++number_of_symbols_;
+          if (++bit_ == 8) {
+            FlushChunk(output);
+          }
         } else {
-          bigram[0] = bigram[1];
+          AddLiteral(data[offset++], output);
         }
+      }
 
-        bigram[1] = prediction[prediction.size() - 1];
+      return offset;
+    }
+
+    static bool Matches(const Prediction& prediction, const unsigned char* data, size_t size) {
+      if (size >= MAX_PREDICTION_LENGTH) {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        return ((word ^ prediction.bytes) & prediction.mask) == 0;
+      }
 
-      } else {
-        // prediction failed
-        TRACE("Prediction failed: %s", prediction.c_str());
+      return prediction.length <= size && std::memcmp(data, &prediction.bytes, prediction.length) == 0;
+    }
+
+    template <typename OutputT>
+    void AddLiteral(unsigned char literal, OutputT* output) {
+      literals_[number_of_literals_++] = static_cast<char>(literal);
+      bigram_ = static_cast<uint16_t>((bigram_ << 8) | literal);
+      ++number_of_symbols_;
+      if (++bit_ == 8) {
+        FlushChunk(output);
+      }
+    }
 
-        current_bitset.set(bitset_position++, 0);
-        uncompressed_buf[uncompressed_position++] = input[offset];
+    template <typename OutputT>
+    void FlushChunk(OutputT* output) {
+      output->push_back(static_cast<char>(flags_));
+      output->insert(output->end(), literals_, literals_ + number_of_literals_);
+      flags_ = 0;
+      bit_ = 0;
+      number_of_literals_ = 0;
+    }
+  };
 
-        bigram[0] = bigram[1];
-        bigram[1] = input[offset++];
+  /**
+   * Uncompresses a string in parts, the output of a part is appended immediately.
+   */
+  class Decoder final {
+   public:
+    explicit Decoder(const PredictiveCompression& model) : predictions_(model.predictions_.data()) {}
+
+    template <typename OutputT>
+    void Write(const char* input, size_t input_size, OutputT* output) {
+      if (input_size == 0) {
+        return;
       }
 
-      // check for flush
-      if (bitset_position == 8) {
-        TRACE("Flush bitset:%s data: '%s' ", current_bitset.to_string().c_str(),
-              std::string(uncompressed_buf, uncompressed_position).c_str());
+      const unsigned char* data = reinterpret_cast<const unsigned char*>(input);
+      size_t offset = 0;
+
+      // a single byte is not compressed, postpone until it is known whether more follow
+      if (!started_) {
+        if (!has_first_byte_) {
+          first_byte_ = data[offset++];
+          has_first_byte_ = true;
+          if (offset == input_size) {
+            return;
+          }
+        }
 
-        output_buffer.put(static_cast<unsigned char>(current_bitset.to_ulong()));
-        output_buffer.write(uncompressed_buf, uncompressed_position);
-        bitset_position = 0;
-        current_bitset.reset();
-        uncompressed_position = 0;
+        started_ = true;
+        flags_ = first_byte_;
+        bit_ = 0;
       }
+
+      Decode(data + offset, input_size - offset, output);
     }
 
-    // write remainder
-    if (bitset_position != 0) {
-      TRACE("Last chunk bitset:%s data: '%s' ", current_bitset.to_string().c_str(),
-            std::string(uncompressed_buf, uncompressed_position).c_str());
+    /**
+     * Finish the string, the decoder can be used for the next string afterwards.
+     */
+    template <typename OutputT>
+    void Finish(OutputT* output) {
+      if (has_first_byte_ && !started_) {
+        output->push_back(static_cast<char>(first_byte_));
+      }
 
-      output_buffer.put(static_cast<unsigned char>(current_bitset.to_ulong()));
-      output_buffer.write(uncompressed_buf, uncompressed_position);
+      has_first_byte_ = false;
+      started_ = false;
+      flags_ = 0;
+      bit_ = 8;
+      bigram_ = 0;
     }
 
-    TRACE("Compressed string: %s", output_buffer.str().c_str());
+   private:
+    const Prediction* predictions_;
+    bool has_first_byte_ = false;
+    bool started_ = false;
+    unsigned char first_byte_ = 0;
+    unsigned char flags_ = 0;
+    // 8: the next input byte is a flag byte
+    size_t bit_ = 8;
+    uint16_t bigram_ = 0;
+
+    template <typename OutputT>
+    void Decode(const unsigned char* data, size_t size, OutputT* output) {
+      size_t position = output->size();
+      size_t offset = 0;
+
+      // every symbol expands to at most 8 bytes, predictions are copied as a whole word
+      const auto reserve = [output, &position](size_t length) {
+        if (output->size() < position + length) {
+          output->resize(std::max(2 * output->size(), position + length));
+        }
+      };
+
+      for (;;) {
+        // predictions do not consume input, they follow directly
+        while (bit_ < 8 && (flags_ >> bit_) & 1) {
+          const Prediction& prediction = predictions_[bigram_];
+          reserve(MAX_PREDICTION_LENGTH);
+          std::memcpy(&(*output)[position], &prediction.bytes, MAX_PREDICTION_LENGTH);
+          position += prediction.length;
+          bigram_ = prediction.next_bigram;
+          ++bit_;
+        }
+
+        if (offset == size) {
+          break;
+        }
 
-    return output_buffer.str();
-  }
+        if (bit_ == 8) {
+          flags_ = data[offset++];
+          bit_ = 0;
+          continue;
+        }
 
-  std::string Uncompress(const std::string& input) {
-    if (input.size() < 2) {
-      return input;
-    }
+        // copy the run of literals up to the next prediction at once
+        const unsigned int remaining_flags = flags_ >> bit_;
+        size_t run = remaining_flags == 0 ? 8 - bit_ : __builtin_ctz(remaining_flags);
+        run = std::min(run, size - offset);
 
-    std::ostringstream output_buffer;
-
-    size_t input_length = input.size();
-    size_t offset = 0;
-    std::bitset<8> current_bitset;
-    // char uncompressed_buf[8];
-    unsigned char bigram[2];
-    size_t bitset_position = 0;
-
-    // setup first character
-    bigram[0] = input[1];
-    bigram[1] = input[2];
-    current_bitset = static_cast<std::bitset<8>>(input[0]);
-    bitset_position = 2;
-    output_buffer.put(input[1]);
-    output_buffer.put(input[2]);
-
-    offset = 3;
-
-    while (offset < input_length) {
-      if (current_bitset[bitset_position++]) {
-        TRACE("Bit is set, do lookup ");
-        std::string prediction = LookupBigram(bigram);
-        TRACE("write buffer %s", prediction.c_str());
-        output_buffer << prediction;
-        if (prediction.size() > 1) {
-          bigram[0] = prediction[prediction.size() - 2];
+        reserve(MAX_PREDICTION_LENGTH);
+        if (size - offset >= MAX_PREDICTION_LENGTH) {
+          std::memcpy(&(*output)[position], data + offset, MAX_PREDICTION_LENGTH);
         } else {
-          bigram[0] = bigram[1];
+          std::memcpy(&(*output)[position], data + offset, run);
         }
 
-        bigram[1] = prediction[prediction.size() - 1];
-      } else {
-        TRACE("Bit is not set, take raw buffer %c", input[offset]);
-        output_buffer.put(input[offset]);
-        bigram[0] = bigram[1];
-        bigram[1] = input[offset++];
+        bigram_ = run == 1 ? static_cast<uint16_t>((bigram_ << 8) | data[offset])
+                           : static_cast<uint16_t>((data[offset + run - 2] << 8) | data[offset + run - 1]);
+        position += run;
+        offset += run;
+        bit_ += run;
       }
 
-      if (bitset_position == 8) {
-        TRACE("Read next chunk");
+      output->resize(position);
+    }
+  };
+
+  std::string Compress(const std::string& input) const {
+    std::string output;
+    Compress(input.data(), input.size(), &output);
+    return output;
+  }
+
+  /**
+   * Compress a string.
+   *
+   * @param input the string
+   * @param input_size size of the string
+   * @param output the compressed string gets appended, a std::string or a buffer
+   */
+  template <typename OutputT>
+  void Compress(const char* input, size_t input_size, OutputT* output) const {
+    output->reserve(output->size() + input_size + input_size / 8 + 1);
+    Encoder encoder(*this);
+    encoder.Write(input, input_size, output);
+    encoder.Finish(output);
+  }
+
+  std::string Uncompress(const std::string& input) const {
+    std::string output;
+    Uncompress(input.data(), input.size(), &output);
+    return output;
+  }
+
+  /**
+   * Uncompress a string.
+   *
+   * @param input the compressed string
+   * @param input_size size of the compressed string
+   * @param output the string gets appended, a std::string or a buffer
+   */
+  template <typename OutputT>
+  void Uncompress(const char* input, size_t input_size, OutputT* output) const {
+    Decoder decoder(*this);
+    decoder.Write(input, input_size, output);
+    decoder.Finish(output);
+  }
 
-        current_bitset = static_cast<std::bitset<8>>(input[offset++]);
-        bitset_position = 0;
+  /**
+   * Write the model in the format it is read.
+   */
+  void Write(std::ostream& stream) const {
+    for (size_t index = 0; index < predictions_.size(); ++index) {
+      const Prediction& prediction = predictions_[index];
+      if (prediction.length != 0) {
+        stream.put(static_cast<char>(index >> 8));
+        stream.put(static_cast<char>(index & 0xFF));
+        stream.put(static_cast<char>(prediction.length));
+        stream.write(reinterpret_cast<const char*>(&prediction.bytes), prediction.length);
       }
     }
-
-    TRACE("Uncompressed string: %s", output_buffer.str().c_str());
-    return output_buffer.str();
   }
 
  private:
+  static const size_t MAX_PREDICTION_LENGTH = 8;
+
+  struct Prediction {
+    // the predicted bytes in memory order, padded with 0
+    uint64_t bytes = 0;
+    // covers the predicted bytes of a word in memory order
+    uint64_t mask = 0;
+    // the bigram after a successful prediction
+    uint16_t next_bigram = 0;
+    uint8_t length = 0;
+  };
+
   /**
    * Reads the input stream and builds up the prediction table.
    *
@@ -219,11 +397,24 @@ class PredictiveCompression final {
         throw std::invalid_argument(error);
       }
       if (!instream.read(buffer, length)) throw std::istream::failure("Incomplete model stream.");
-      predictor_table_[index] = std::string(buffer, length);
+
+      // no predictions for bigrams with null bytes
+      if ((index >> 8) == 0 || (index & 0xFF) == 0 || length == 0) {
+        predictions_[index] = Prediction();
+        continue;
+      }
+
+      Prediction& prediction = predictions_[index];
+      prediction = Prediction();
+      std::memcpy(&prediction.bytes, buffer, length);
+      std::memset(&prediction.mask, 0xFF, length);
+      prediction.length = length;
+      const unsigned char previous = length > 1 ? buffer[length - 2] : index & 0xFF;
+      prediction.next_bigram = static_cast<uint16_t>((previous << 8) | static_cast<unsigned char>(buffer[length - 1]));
     }
   }
 
-  std::string predictor_table_[65536];
+  std::vector<Prediction> predictions_ = std::vector<Prediction>(65536);
 };
 
 } /* namespace compression */
@@ -0,0 +1,94 @@
+/* * keyvi - A key value store.
+ *
+ * Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * predictive_compression_strategy.h
+ */
+
+#ifndef KEYVI_COMPRESSION_PREDICTIVE_COMPRESSION_STRATEGY_H_
+#define KEYVI_COMPRESSION_PREDICTIVE_COMPRESSION_STRATEGY_H_
+
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "keyvi/compression/compression_strategy.h"
+#include "keyvi/compression/predictive_compression.h"
+
+// #define ENABLE_TRACING
+#include "keyvi/dictionary/util/trace.h"
+
+namespace keyvi {
+namespace compression {
+
+/**
+ * Load a model for predictive compression.
+ *
+ * @param file_name the model file, see PredictiveCompression
+ */
+inline std::shared_ptr<const PredictiveCompression> LoadPredictiveCompressionModel(const std::string& file_name) {
+  if (file_name.empty()) {
+    throw std::invalid_argument("predictive compression requires a compression model");
+  }
+
+  return std::make_shared<const PredictiveCompression>(file_name);
+}
+
+/**
+ * A compression strategy for short strings based on a predictive compression model.
+ *
+ * Like a dictionary the model is not part of the compressed value, it must be stored separately.
+ */
+struct PredictiveCompressionStrategy final : public CompressionStrategy {
+  explicit PredictiveCompressionStrategy(std::shared_ptr<const PredictiveCompression> model)
+      : model_(std::move(model)) {}
+
+  inline void Compress(buffer_t* buffer, const char* raw, size_t raw_size) {
+    buffer->clear();
+    buffer->push_back(static_cast<char>(PREDICTIVE_COMPRESSION));
+    model_->Compress(raw, raw_size, buffer);
+  }
+
+  inline std::string Decompress(const std::string& compressed) {
+    std::string uncompressed;
+    model_->Uncompress(compressed.data() + 1, compressed.size() - 1, &uncompressed);
+    return uncompressed;
+  }
+
+  /** The serialized model, the way it is read by PredictiveCompression. */
+  std::string GetModel() const { return SerializeModel(*model_); }
+
+  static std::string SerializeModel(const PredictiveCompression& model) {
+    std::ostringstream stream;
+    model.Write(stream);
+    return stream.str();
+  }
+
+  std::string name() const { return "predictive"; }
+
+  uint64_t GetFileVersionMin() const { return KEYVI_FILE_VERSION_COMPRESSION_DICTIONARIES; }
+
+ private:
+  std::shared_ptr<const PredictiveCompression> model_;
+};
+
+} /* namespace compression */
+} /* namespace keyvi */
+
+#endif  // KEYVI_COMPRESSION_PREDICTIVE_COMPRESSION_STRATEGY_H_
@@ -51,10 +51,14 @@ struct SnappyCompressionStrategy final : public CompressionStrategy {
 
   static std::string DoDecompress(const std::string& compressed) {
     std::string uncompressed;
-    snappy::Uncompress(&compressed.data()[1], compressed.size() - 1, &uncompressed);
+    DoDecompress(compressed.data(), compressed.size(), &uncompressed);
     return uncompressed;
   }
 
+  static void DoDecompress(const char* compressed, size_t compressed_size, std::string* output) {
+    snappy::Uncompress(compressed + 1, compressed_size - 1, output);
+  }
+
   std::string name() const { return "snappy"; }
 
   uint64_t GetFileVersionMin() const { return KEYVI_FILE_VERSION_MIN; }
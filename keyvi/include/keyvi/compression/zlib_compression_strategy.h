@@ -95,17 +95,23 @@ struct ZlibCompressionStrategy final : public CompressionStrategy {
   inline std::string Decompress(const std::string& compressed) { return DoDecompress(compressed); }
 
   static std::string DoDecompress(const std::string& compressed) {
+    std::string uncompressed;
+    DoDecompress(compressed.data(), compressed.size(), &uncompressed);
+    return uncompressed;
+  }
+
+  static void DoDecompress(const char* compressed, size_t compressed_size, std::string* output) {
     z_stream zs;  // z_stream is zlib's control structure
     memset(&zs, 0, sizeof(zs));
 
     if (inflateInit(&zs) != Z_OK) throw(std::runtime_error("inflateInit failed while decompressing."));
 
-    zs.next_in = reinterpret_cast<z_const Bytef*>(compressed.data()) + 1;
-    zs.avail_in = compressed.size() - 1;
+    zs.next_in = reinterpret_cast<z_const Bytef*>(compressed) + 1;
+    zs.avail_in = compressed_size - 1;
 
     int ret;
     char outbuffer[32768];
-    std::string outstring;
+    output->clear();
 
     // get the decompressed bytes blockwise using repeated calls to inflate
     do {
@@ -114,8 +120,8 @@ struct ZlibCompressionStrategy final : public CompressionStrategy {
 
       ret = inflate(&zs, 0);
 
-      if (outstring.size() < zs.total_out) {
-        outstring.append(outbuffer, zs.total_out - outstring.size());
+      if (output->size() < zs.total_out) {
+        output->append(outbuffer, zs.total_out - output->size());
       }
     } while (ret == Z_OK);
 
@@ -126,8 +132,6 @@ struct ZlibCompressionStrategy final : public CompressionStrategy {
       oss << "Exception during zlib decompression: (" << ret << ") " << zs.msg;
       throw(std::runtime_error(oss.str()));
     }
-
-    return outstring;
   }
 
   std::string name() const { return "zlib"; }
@@ -65,14 +65,16 @@ struct ZstdCompressionStrategy final : public CompressionStrategy {
 
   static std::string DoDecompress(const std::string& compressed) {
     std::string uncompressed;
-
-    size_t dest_size = ZSTD_getFrameContentSize(&compressed.data()[1], compressed.size() - 1);
-    uncompressed.resize(dest_size);
-    ZSTD_decompress(&uncompressed[0], dest_size, &compressed.data()[1], compressed.size() - 1);
-
+    DoDecompress(compressed.data(), compressed.size(), &uncompressed);
     return uncompressed;
   }
 
+  static void DoDecompress(const char* compressed, size_t compressed_size, std::string* output) {
+    size_t dest_size = ZSTD_getFrameContentSize(compressed + 1, compressed_size - 1);
+    output->resize(dest_size);
+    ZSTD_decompress(&(*output)[0], dest_size, compressed + 1, compressed_size - 1);
+  }
+
   std::string name() const { return "zstd"; }
 
   uint64_t GetFileVersionMin() const { return 3; }
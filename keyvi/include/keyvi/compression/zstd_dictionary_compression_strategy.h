@@ -0,0 +1,207 @@
+/* * keyvi - A key value store.
+ *
+ * Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * zstd_dictionary_compression_strategy.h
+ */
+
+#ifndef KEYVI_COMPRESSION_ZSTD_DICTIONARY_COMPRESSION_STRATEGY_H_
+#define KEYVI_COMPRESSION_ZSTD_DICTIONARY_COMPRESSION_STRATEGY_H_
+
+#include <zdict.h>
+#include <zstd.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "keyvi/compression/compression_strategy.h"
+#include "keyvi/compression/zstd_compression_strategy.h"
+
+// #define ENABLE_TRACING
+#include "keyvi/dictionary/util/trace.h"
+
+namespace keyvi {
+namespace compression {
+
+/**
+ * Train a zstd dictionary.
+ *
+ * @param samples the samples, concatenated
+ * @param sample_sizes the sizes of the samples
+ * @param capacity maximum size of the dictionary
+ * @return the dictionary, empty if training failed, e.g. because of too few samples
+ */
+inline std::string TrainZstdDictionary(const std::string& samples, const std::vector<size_t>& sample_sizes,
+                                       size_t capacity) {
+  std::string dictionary(capacity, '\0');
+  const size_t dictionary_size = ZDICT_trainFromBuffer(&dictionary[0], capacity, samples.data(), sample_sizes.data(),
+                                                       static_cast<unsigned>(sample_sizes.size()));
+  if (ZDICT_isError(dictionary_size)) {
+    TRACE("dictionary training failed: %s", ZDICT_getErrorName(dictionary_size));
+    return std::string();
+  }
+
+  dictionary.resize(dictionary_size);
+  return dictionary;
+}
+
+/**
+ * Throw if the return value of a zstd function signals an error.
+ *
+ * @param result the return value
+ * @param operation the name of the operation, part of the error message
+ * @return the return value
+ */
+inline size_t CheckZstdResult(size_t result, const char* operation) {
+  if (ZSTD_isError(result)) {
+    throw std::runtime_error(std::string(operation) + " failed: " + ZSTD_getErrorName(result));
+  }
+  return result;
+}
+
+/**
+ * Get the uncompressed size of a zstd frame, throws if the frame is invalid or does not contain the size.
+ */
+inline size_t GetZstdFrameContentSize(const char* frame, size_t frame_size) {
+  const uint64_t content_size = ZSTD_getFrameContentSize(frame, frame_size);
+  if (content_size == ZSTD_CONTENTSIZE_ERROR || content_size == ZSTD_CONTENTSIZE_UNKNOWN) {
+    throw std::runtime_error("zstd decompression failed: invalid frame");
+  }
+  return static_cast<size_t>(content_size);
+}
+
+/** The id of a trained dictionary, frames compressed with the dictionary carry it. */
+inline uint32_t GetZstdDictionaryId(const std::string& dictionary) {
+  return ZSTD_getDictID_fromDict(dictionary.data(), dictionary.size());
+}
+
+/**
+ * A compression strategy that compresses with a trained zstd dictionary.
+ *
+ * The dictionary is not part of the compressed value, it must be stored separately and given to a
+ * ZstdDictionaryDecompressor for reading.
+ */
+struct ZstdDictionaryCompressionStrategy final : public CompressionStrategy {
+  explicit ZstdDictionaryCompressionStrategy(const std::string& dictionary,
+                                             int compression_level = ZSTD_DEFAULT_CLEVEL)
+      : dictionary_(dictionary),
+        compression_dictionary_(ZSTD_createCDict(dictionary.data(), dictionary.size(), compression_level),
+                                &ZSTD_freeCDict),
+        context_(ZSTD_createCCtx(), &ZSTD_freeCCtx) {}
+
+  /**
+   * Create another compressor for the same dictionary, e.g. for another thread, the digested dictionary is shared.
+   */
+  ZstdDictionaryCompressionStrategy(const ZstdDictionaryCompressionStrategy& other)
+      : dictionary_(other.dictionary_),
+        compression_dictionary_(other.compression_dictionary_),
+        context_(ZSTD_createCCtx(), &ZSTD_freeCCtx) {}
+
+  ZstdDictionaryCompressionStrategy& operator=(ZstdDictionaryCompressionStrategy const&) = delete;
+
+  inline void Compress(buffer_t* buffer, const char* raw, size_t raw_size) {
+    size_t output_length = ZSTD_compressBound(raw_size);
+    buffer->resize(output_length + 1);
+    buffer->data()[0] = static_cast<char>(ZSTD_DICTIONARY_COMPRESSION);
+
+    output_length =
+        CheckZstdResult(ZSTD_compress_usingCDict(context_.get(), buffer->data() + 1, output_length, raw, raw_size,
+                                                 compression_dictionary_.get()),
+                        "zstd compression");
+    buffer->resize(output_length + 1);
+  }
+
+  inline std::string Decompress(const std::string& compressed) {
+    std::string uncompressed(GetZstdFrameContentSize(compressed.data() + 1, compressed.size() - 1), '\0');
+    std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> context(ZSTD_createDCtx(), &ZSTD_freeDCtx);
+    CheckZstdResult(ZSTD_decompress_usingDict(context.get(), &uncompressed[0], uncompressed.size(),
+                                              compressed.data() + 1, compressed.size() - 1, dictionary_.data(),
+                                              dictionary_.size()),
+                    "zstd decompression");
+    return uncompressed;
+  }
+
+  const std::string& GetDictionary() const { return dictionary_; }
+
+  std::string name() const { return "zstd_dictionary"; }
+
+  uint64_t GetFileVersionMin() const { return KEYVI_FILE_VERSION_COMPRESSION_DICTIONARIES; }
+
+ private:
+  std::string dictionary_;
+  std::shared_ptr<ZSTD_CDict> compression_dictionary_;
+  std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> context_;
+};
+
+/**
+ * Decompresses values compressed with one of several zstd dictionaries.
+ *
+ * The dictionaries are digested once, the decompression context is kept per thread.
+ */
+class ZstdDictionaryDecompressor final {
+ public:
+  ZstdDictionaryDecompressor() = default;
+
+  ZstdDictionaryDecompressor& operator=(ZstdDictionaryDecompressor const&) = delete;
+  ZstdDictionaryDecompressor(const ZstdDictionaryDecompressor& that) = delete;
+
+  void Add(const char* dictionary, size_t dictionary_size) {
+    const uint32_t id = ZSTD_getDictID_fromDict(dictionary, dictionary_size);
+    decompression_dictionaries_.emplace(
+        id, std::unique_ptr<ZSTD_DDict, decltype(&ZSTD_freeDDict)>(ZSTD_createDDict(dictionary, dictionary_size),
+                                                                    &ZSTD_freeDDict));
+  }
+
+  size_t size() const { return decompression_dictionaries_.size(); }
+
+  /**
+   * Decompress a value.
+   *
+   * @param compressed the value including the leading compression code
+   * @param compressed_size size of the value
+   * @param output the uncompressed value
+   */
+  void Decompress(const char* compressed, size_t compressed_size, std::string* output) const {
+    const uint32_t id = ZSTD_getDictID_fromFrame(compressed + 1, compressed_size - 1);
+    const auto it = decompression_dictionaries_.find(id);
+    if (it == decompression_dictionaries_.end()) {
+      throw std::invalid_argument("zstd dictionary " + std::to_string(id) + " not found");
+    }
+
+    const size_t dest_size = GetZstdFrameContentSize(compressed + 1, compressed_size - 1);
+    output->resize(dest_size);
+    CheckZstdResult(ZSTD_decompress_usingDDict(GetContext(), &(*output)[0], dest_size, compressed + 1,
+                                               compressed_size - 1, it->second.get()),
+                    "zstd decompression");
+  }
+
+ private:
+  std::unordered_map<uint32_t, std::unique_ptr<ZSTD_DDict, decltype(&ZSTD_freeDDict)>> decompression_dictionaries_;
+
+  static ZSTD_DCtx* GetContext() {
+    thread_local std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> context(ZSTD_createDCtx(), &ZSTD_freeDCtx);
+    return context.get();
+  }
+};
+
+} /* namespace compression */
+} /* namespace keyvi */
+
+#endif  // KEYVI_COMPRESSION_ZSTD_DICTIONARY_COMPRESSION_STRATEGY_H_
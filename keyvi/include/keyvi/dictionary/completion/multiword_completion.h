@@ -36,6 +36,7 @@
 #include "keyvi/dictionary/fsa/codepoint_state_traverser.h"
 #include "keyvi/dictionary/fsa/traverser_types.h"
 #include "keyvi/dictionary/match_iterator.h"
+#include "keyvi/dictionary/match_pool.h"
 #include "keyvi/dictionary/util/transform.h"
 #include "keyvi/stringdistance/levenshtein.h"
 #include "utf8.h"
@@ -95,7 +96,7 @@ class MultiWordCompletion final {
         TRACE("prefix matched depth %d %s", query_length + data->traverser.GetDepth(),
               std::string(reinterpret_cast<char*>(&data->traversal_stack[0]), query_length + data->traverser.GetDepth())
                   .c_str());
-        first_match = std::make_shared<Match>(0, query_length, query, 0, fsa_, fsa_->GetStateValue(state));
+        first_match = MakeMatch(0, query_length, query, 0, fsa_, fsa_->GetStateValue(state));
       }
 
       auto tfunc = [data, query_length]() {
@@ -140,8 +141,8 @@ class MultiWordCompletion final {
                                             query_length + data->traverser.GetDepth());
               }
 
-              match_t m = std::make_shared<Match>(0, data->traverser.GetDepth() + query_length, matched_entry, 0,
-                                                  data->traverser.GetFsa(), data->traverser.GetStateValue());
+              match_t m = MakeMatch(0, data->traverser.GetDepth() + query_length, matched_entry, 0,
+                                    data->traverser.GetFsa(), data->traverser.GetStateValue());
 
               data->traverser++;
               data->traverser.TryReduceResultQueue();
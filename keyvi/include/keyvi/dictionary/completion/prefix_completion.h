@@ -38,6 +38,7 @@
 #include "keyvi/dictionary/fsa/codepoint_state_traverser.h"
 #include "keyvi/dictionary/fsa/traverser_types.h"
 #include "keyvi/dictionary/match_iterator.h"
+#include "keyvi/dictionary/match_pool.h"
 #include "keyvi/stringdistance/levenshtein.h"
 #include "utf8.h"
 
@@ -93,7 +94,7 @@ class PrefixCompletion final {
         TRACE("prefix matched depth %d %s", query_length + data->traverser.GetDepth(),
               std::string(reinterpret_cast<char*>(&data->traversal_stack[0]), query_length + data->traverser.GetDepth())
                   .c_str());
-        first_match = std::make_shared<Match>(0, query_length, query, 0, fsa_, fsa_->GetStateValue(state));
+        first_match = MakeMatch(0, query_length, query, 0, fsa_, fsa_->GetStateValue(state));
       }
 
       auto tfunc = [data, query_length]() {
@@ -108,8 +109,8 @@ class PrefixCompletion final {
               std::string match_str = std::string(reinterpret_cast<char*>(&data->traversal_stack[0]),
                                                   query_length + data->traverser.GetDepth());
               TRACE("found final state at depth %d %s", query_length + data->traverser.GetDepth(), match_str.c_str());
-              match_t m = std::make_shared<Match>(0, data->traverser.GetDepth() + query_length, match_str, 0,
-                                                  data->traverser.GetFsa(), data->traverser.GetStateValue());
+              match_t m = MakeMatch(0, data->traverser.GetDepth() + query_length, match_str, 0,
+                                    data->traverser.GetFsa(), data->traverser.GetStateValue());
 
               data->traverser++;
               // data->traverser.TryReduceResultQueue();
@@ -181,7 +182,7 @@ class PrefixCompletion final {
     if (depth == query_length && fsa_->IsFinalState(state)) {
       TRACE("prefix matched depth %d %s", query_length + data->traverser.GetDepth(),
             std::string(query, query_length).c_str());
-      first_match = std::make_shared<Match>(0, query_length, query, 0, fsa_, fsa_->GetStateValue(state));
+      first_match = MakeMatch(0, query_length, query, 0, fsa_, fsa_->GetStateValue(state));
     }
 
     auto tfunc = [data, query_length, max_edit_distance, exact_prefix]() {
@@ -206,8 +207,8 @@ class PrefixCompletion final {
           if (data->traverser.IsFinalState()) {
             if (query_length < depth || data->metric.GetScore() <= max_edit_distance) {
               TRACE("found final state at depth %d %s", depth, data->metric.GetCandidate().c_str());
-              match_t m = std::make_shared<Match>(0, depth, data->metric.GetCandidate(), data->metric.GetScore(),
-                                                  data->traverser.GetFsa(), data->traverser.GetStateValue());
+              match_t m = MakeMatch(0, depth, data->metric.GetCandidate(), data->metric.GetScore(),
+                                    data->traverser.GetFsa(), data->traverser.GetStateValue());
 
               data->traverser++;
               return m;
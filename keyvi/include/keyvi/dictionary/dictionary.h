@@ -25,6 +25,7 @@
 #ifndef KEYVI_DICTIONARY_DICTIONARY_H_
 #define KEYVI_DICTIONARY_DICTIONARY_H_
 
+#include <algorithm>
 #include <memory>
 #include <queue>
 #include <string>
@@ -35,12 +36,15 @@
 #include "keyvi/dictionary/fsa/state_traverser.h"
 #include "keyvi/dictionary/fsa/traverser_types.h"
 #include "keyvi/dictionary/match.h"
+#include "keyvi/dictionary/match_pool.h"
 #include "keyvi/dictionary/match_iterator.h"
 #include "keyvi/dictionary/matching/fuzzy_matching.h"
 #include "keyvi/dictionary/matching/fuzzy_multiword_completion_matching.h"
 #include "keyvi/dictionary/matching/multiword_completion_matching.h"
 #include "keyvi/dictionary/matching/near_matching.h"
+#include "keyvi/dictionary/matching/nearest_neighbor_matching.h"
 #include "keyvi/dictionary/matching/prefix_completion_matching.h"
+#include "keyvi/dictionary/matching/top_k_prefix_completion_matching.h"
 #include "keyvi/dictionary/util/bounded_priority_queue.h"
 
 // #define ENABLE_TRACING
@@ -84,6 +88,45 @@ class Dictionary final {
 
   match_t operator[](const std::string& key) const { return GetSubscript(fsa_->GetStartState(), key); }
 
+  /**
+   * Batched version of Contains, checks several keys at once.
+   *
+   * The keys are walked in lock-step, the next transition of every key gets prefetched before any of them is
+   * resolved. This hides memory latency on large dictionaries, use it if many keys must be checked.
+   *
+   * @param keys the keys
+   * @return a vector with one entry per key: true if the key is in the dictionary, false otherwise.
+   */
+  std::vector<bool> ContainsBatch(const std::vector<std::string>& keys) const {
+    const std::vector<uint64_t> final_states = WalkBatch(fsa_->GetStartState(), keys);
+    std::vector<bool> result(keys.size());
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+      result[i] = final_states[i] != 0;
+    }
+
+    return result;
+  }
+
+  /**
+   * Batched version of operator[], looks up several keys at once (see ContainsBatch).
+   *
+   * @param keys the keys
+   * @return a vector with one match per key, the match is empty if the key is not in the dictionary.
+   */
+  std::vector<match_t> GetBatch(const std::vector<std::string>& keys) const {
+    const std::vector<uint64_t> final_states = WalkBatch(fsa_->GetStartState(), keys);
+    std::vector<match_t> result(keys.size());
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+      if (final_states[i] != 0) {
+        result[i] = MakeMatch(0, keys[i].size(), keys[i], 0, fsa_, fsa_->GetStateValue(final_states[i]));
+      }
+    }
+
+    return result;
+  }
+
   /**
    * Exact Match function.
    *
@@ -130,9 +173,8 @@ class Dictionary final {
 
     if (last_final_state) {
       // right now this is returning just 1 match, but it could do more
-      m = std::make_shared<Match>(offset, last_final_state_position,
-                                  text.substr(offset, last_final_state_position - offset), 0, fsa_,
-                                  fsa_->GetStateValue(last_final_state));
+      m = MakeMatch(offset, last_final_state_position, text.substr(offset, last_final_state_position - offset), 0, fsa_,
+                    fsa_->GetStateValue(last_final_state));
     }
 
     return MatchIterator::MakeIteratorPair([]() { return match_t(); }, std::move(m));
@@ -194,9 +236,10 @@ class Dictionary final {
     return GetNear(fsa_->GetStartState(), key, minimum_prefix_length, greedy);
   }
 
-  MatchIterator::MatchIteratorPair GetFuzzy(const std::string& query, const int32_t max_edit_distance,
-                                            const size_t minimum_exact_prefix = 2) const {
-    return GetFuzzy(fsa_->GetStartState(), query, max_edit_distance, minimum_exact_prefix);
+  MatchIterator::MatchIteratorPair GetFuzzy(
+      const std::string& query, const int32_t max_edit_distance, const size_t minimum_exact_prefix = 2,
+      const matching::fuzzy_strategy_t strategy = matching::fuzzy_strategy_t::NEEDLEMAN_WUNSCH) const {
+    return GetFuzzy(fsa_->GetStartState(), query, max_edit_distance, minimum_exact_prefix, strategy);
   }
 
   MatchIterator::MatchIteratorPair GetPrefixCompletion(const std::string& query) const {
@@ -225,6 +268,58 @@ class Dictionary final {
                                        multiword_separator);
   }
 
+  /**
+   * Brute force k nearest neighbor search, only for dictionaries with float vector values.
+   *
+   * @param query the query vector
+   * @param top_n the number of neighbors to return
+   * @param distance the distance function, the score of a match is the similarity or the euclidean distance
+   * @param number_of_threads the number of threads to use for scoring
+   */
+  MatchIterator::MatchIteratorPair GetNearestNeighbors(
+      const std::vector<float>& query, const size_t top_n,
+      const keyvi::util::float_vector_distance_t distance = keyvi::util::float_vector_distance_t::COSINE,
+      const size_t number_of_threads = 1) const {
+    auto data = std::make_shared<matching::NearestNeighborMatching>(
+        matching::NearestNeighborMatching::FromSingleFsa(fsa_, query, top_n, distance, number_of_threads));
+
+    auto func = [data]() { return data->NextMatch(); };
+    return MatchIterator::MakeIteratorPair(func, std::move(data->FirstMatch()));
+  }
+
+  /**
+   * Statically typed variants of the matching functions above, iterating over them avoids the type erasure of
+   * MatchIterator, see MatcherRange.
+   */
+  MatcherRange<matching::NearMatching<>> GetNearRange(const std::string& key, const size_t minimum_prefix_length,
+                                                      const bool greedy = false) const {
+    return MatcherRange<matching::NearMatching<>>(
+        matching::NearMatching<>::FromSingleFsa(fsa_, key, minimum_prefix_length, greedy));
+  }
+
+  MatcherRange<matching::FuzzyMatching<>> GetFuzzyRange(const std::string& query, const int32_t max_edit_distance,
+                                                        const size_t minimum_exact_prefix = 2) const {
+    return MatcherRange<matching::FuzzyMatching<>>(
+        matching::FuzzyMatching<>::FromSingleFsa(fsa_, query, max_edit_distance, minimum_exact_prefix));
+  }
+
+  MatcherRange<matching::PrefixCompletionMatching<>> GetPrefixCompletionRange(const std::string& query) const {
+    return MatcherRange<matching::PrefixCompletionMatching<>>(
+        matching::PrefixCompletionMatching<>::FromSingleFsa(fsa_, query));
+  }
+
+  MatcherRange<matching::TopKPrefixCompletionMatching> GetPrefixCompletionRange(const std::string& query,
+                                                                                 size_t top_n) const {
+    return MatcherRange<matching::TopKPrefixCompletionMatching>(
+        matching::TopKPrefixCompletionMatching::FromSingleFsa(fsa_, query, top_n));
+  }
+
+  MatcherRange<matching::MultiwordCompletionMatching<>> GetMultiwordCompletionRange(
+      const std::string& query, const unsigned char multiword_separator = 0x1b) const {
+    return MatcherRange<matching::MultiwordCompletionMatching<>>(
+        matching::MultiwordCompletionMatching<>::FromSingleFsa(fsa_, query, multiword_separator));
+  }
+
   const std::string& GetManifest() const { return fsa_->GetManifest(); }
 
  private:
@@ -253,7 +348,82 @@ class Dictionary final {
       return match_t();
     }
 
-    return std::make_shared<Match>(0, text_length, key, 0, fsa_, fsa_->GetStateValue(state));
+    return MakeMatch(0, text_length, key, 0, fsa_, fsa_->GetStateValue(state));
+  }
+
+  /**
+   * Walk all keys in lock-step, in windows of BATCH_LOOKUP_INTERLEAVE_WIDTH keys.
+   *
+   * Every round advances all unfinished keys of a window by 1 transition and prefetches the next one, so the cache
+   * misses of the keys overlap.
+   *
+   * @param start_state the state to start from
+   * @param keys the keys
+   * @return the final state of every key or 0 if the key does not match.
+   */
+  std::vector<uint64_t> WalkBatch(const uint64_t start_state, const std::vector<std::string>& keys) const {
+    std::vector<uint64_t> final_states(keys.size(), 0);
+
+    if (!start_state) {
+      return final_states;
+    }
+
+    uint64_t states[BATCH_LOOKUP_INTERLEAVE_WIDTH];
+    size_t positions[BATCH_LOOKUP_INTERLEAVE_WIDTH];
+    size_t active[BATCH_LOOKUP_INTERLEAVE_WIDTH];
+
+    for (size_t window_start = 0; window_start < keys.size(); window_start += BATCH_LOOKUP_INTERLEAVE_WIDTH) {
+      const size_t window_size = std::min(BATCH_LOOKUP_INTERLEAVE_WIDTH, keys.size() - window_start);
+      size_t number_of_active = 0;
+
+      for (size_t i = 0; i < window_size; ++i) {
+        const std::string& key = keys[window_start + i];
+        states[i] = start_state;
+        positions[i] = 0;
+        active[number_of_active++] = i;
+
+        if (key.size() > 0) {
+          fsa_->PrefetchTransition(start_state, key[0]);
+        } else {
+          fsa_->PrefetchFinalState(start_state);
+        }
+      }
+
+      while (number_of_active > 0) {
+        size_t still_active = 0;
+
+        for (size_t j = 0; j < number_of_active; ++j) {
+          const size_t i = active[j];
+          const std::string& key = keys[window_start + i];
+
+          if (positions[i] == key.size()) {
+            if (fsa_->IsFinalState(states[i])) {
+              final_states[window_start + i] = states[i];
+            }
+            continue;
+          }
+
+          const uint64_t state = fsa_->TryWalkTransition(states[i], key[positions[i]]);
+          if (!state) {
+            continue;
+          }
+
+          states[i] = state;
+          ++positions[i];
+
+          if (positions[i] < key.size()) {
+            fsa_->PrefetchTransition(state, key[positions[i]]);
+          } else {
+            fsa_->PrefetchFinalState(state);
+          }
+          active[still_active++] = i;
+        }
+
+        number_of_active = still_active;
+      }
+    }
+
+    return final_states;
   }
 
   bool Contains(const uint64_t start_state, const std::string& key) const {
@@ -308,7 +478,7 @@ class Dictionary final {
     match_t m;
 
     // right now this is returning just 1 match, but it could be more if it is a multi-value dictionary
-    m = std::make_shared<Match>(0, text_length, key, 0, fsa_, fsa_->GetStateValue(state));
+    m = MakeMatch(0, text_length, key, 0, fsa_, fsa_->GetStateValue(state));
 
     return MatchIterator::MakeIteratorPair([]() { return match_t(); }, std::move(m));
   }
@@ -347,8 +517,8 @@ class Dictionary final {
             std::string match_str =
                 std::string(reinterpret_cast<char*>(&data->traversal_stack[0]), data->traverser.GetDepth());
             TRACE("found final state at depth %d %s", data->traverser.GetDepth(), match_str.c_str());
-            match_t m = std::make_shared<Match>(0, data->traverser.GetDepth(), match_str, 0, data->traverser.GetFsa(),
-                                                data->traverser.GetStateValue());
+            match_t m = MakeMatch(0, data->traverser.GetDepth(), match_str, 0, data->traverser.GetFsa(),
+                                  data->traverser.GetStateValue());
 
             data->traverser++;
             return m;
@@ -376,15 +546,29 @@ class Dictionary final {
     return MatchIterator::MakeIteratorPair(func, std::move(data->FirstMatch()));
   }
 
-  MatchIterator::MatchIteratorPair GetFuzzy(const uint64_t state, const std::string& query,
-                                            const int32_t max_edit_distance,
-                                            const size_t minimum_exact_prefix = 2) const {
+  MatchIterator::MatchIteratorPair GetFuzzy(
+      const uint64_t state, const std::string& query, const int32_t max_edit_distance,
+      const size_t minimum_exact_prefix = 2,
+      const matching::fuzzy_strategy_t strategy = matching::fuzzy_strategy_t::NEEDLEMAN_WUNSCH) const {
+    if (matching::UseBitParallelLevenshtein(strategy, query)) {
+      return GetFuzzyWithMetric<stringdistance::BitParallelLevenshtein>(state, query, max_edit_distance,
+                                                                        minimum_exact_prefix);
+    }
+
+    return GetFuzzyWithMetric<stringdistance::Levenshtein>(state, query, max_edit_distance, minimum_exact_prefix);
+  }
+
+  template <class DistanceMetricT>
+  MatchIterator::MatchIteratorPair GetFuzzyWithMetric(const uint64_t state, const std::string& query,
+                                                      const int32_t max_edit_distance,
+                                                      const size_t minimum_exact_prefix) const {
     if (!state) {
       return MatchIterator::EmptyIteratorPair();
     }
 
-    auto data = std::make_shared<matching::FuzzyMatching<>>(
-        matching::FuzzyMatching<>::FromSingleFsa(fsa_, state, query, max_edit_distance, minimum_exact_prefix));
+    using fuzzy_matcher_t = matching::FuzzyMatching<fsa::WeightedStateTraverser, DistanceMetricT>;
+    auto data = std::make_shared<fuzzy_matcher_t>(
+        fuzzy_matcher_t::FromSingleFsa(fsa_, state, query, max_edit_distance, minimum_exact_prefix));
 
     auto func = [data]() { return data->NextMatch(); };
     return MatchIterator::MakeIteratorPair(func, std::move(data->FirstMatch()));
@@ -409,27 +593,13 @@ class Dictionary final {
       return MatchIterator::EmptyIteratorPair();
     }
 
-    auto data = std::make_shared<matching::PrefixCompletionMatching<>>(
-        matching::PrefixCompletionMatching<>::FromSingleFsa(fsa_, state, query));
-
-    auto best_weights = std::make_shared<util::BoundedPriorityQueue<uint32_t>>(top_n);
-
-    auto func = [data, best_weights = std::move(best_weights)]() {
-      auto m = data->NextMatch();
-      while (m) {
-        if (m->GetWeight() >= best_weights->Back()) {
-          best_weights->Put(m->GetWeight());
-          return m;
-        }
-
-        m = data->NextMatch();
-      }
-      return match_t();
-    };
+    auto data = std::make_shared<matching::TopKPrefixCompletionMatching>(
+        matching::TopKPrefixCompletionMatching::FromSingleFsa(fsa_, state, query, top_n));
 
+    auto func = [data]() { return data->NextMatch(); };
     return MatchIterator::MakeIteratorPair(
         func, std::move(data->FirstMatch()),
-        std::bind(&matching::PrefixCompletionMatching<>::SetMinWeight, &(*data), std::placeholders::_1));
+        std::bind(&matching::TopKPrefixCompletionMatching::SetMinWeight, &(*data), std::placeholders::_1));
   }
 
   MatchIterator::MatchIteratorPair GetMultiwordCompletion(const uint64_t state, const std::string& query,
@@ -26,10 +26,13 @@
 #define KEYVI_DICTIONARY_DICTIONARY_COMPILER_H_
 
 #include <algorithm>
+#include <deque>
+#include <exception>
 #include <functional>
+#include <future>
 #include <memory>
-#include <queue>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -41,14 +44,16 @@
 
 #include "keyvi/dictionary/dictionary_compiler_common.h"
 #include "keyvi/dictionary/fsa/automata.h"
+#include "keyvi/dictionary/fsa/entry_iterator_merger.h"
 #include "keyvi/dictionary/fsa/generator_adapter.h"
 #include "keyvi/dictionary/fsa/internal/constants.h"
 #include "keyvi/dictionary/fsa/internal/null_value_store.h"
-#include "keyvi/dictionary/fsa/segment_iterator.h"
 #include "keyvi/util/configuration.h"
-#include "keyvi/util/os_utils.h"
+#include "keyvi/util/direct_output_stream.h"
 #include "keyvi/util/serialization_utils.h"
 
+#include "blockingconcurrentqueue.h"
+
 // #define ENABLE_TRACING
 #include "keyvi/dictionary/util/trace.h"
 
@@ -78,6 +83,12 @@ class DictionaryCompiler final {
    * memory usage for small short-lived objects and the library itself is not
    * part of the limit.
    *
+   * With compile_threads > 1 chunks are sorted and compiled in the background while new keys are added and the
+   * final merge runs in a separate thread, feeding the generator with batches of keys. The result is the same as
+   * compiling single-threaded, but memory usage grows up to compile_threads times the memory limit.
+   *
+   * For json values, value_store_threads > 1 encodes and compresses values on background threads.
+   *
    * @param params compiler parameters
    */
   explicit DictionaryCompiler(const keyvi::util::parameters_t& params = keyvi::util::parameters_t()) : params_(params) {
@@ -95,10 +106,22 @@ class DictionaryCompiler final {
     parallel_sort_threshold_ =
         keyvi::util::mapGet(params_, PARALLEL_SORT_THRESHOLD_KEY, DEFAULT_PARALLEL_SORT_THRESHOLD);
 
+    compile_threads_ = std::max<size_t>(1, keyvi::util::mapGet(params_, COMPILE_THREADS_KEY, DEFAULT_COMPILE_THREADS));
+
     value_store_ = new ValueStoreT(params_);
+
+    if constexpr (ValueStoreType == fsa::internal::value_store_t::JSON) {
+      value_store_->SetEncodingThreads(
+          std::max<size_t>(1, keyvi::util::mapGet(params_, VALUE_STORE_THREADS_KEY, DEFAULT_VALUE_STORE_THREADS)));
+    }
   }
 
   ~DictionaryCompiler() {
+    // chunks might still be written in the background
+    for (auto& pending_chunk : pending_chunks_) {
+      pending_chunk.wait();
+    }
+
     if (!generator_) {
       // if generator was not created we have to delete the value store
       // ourselves
@@ -189,10 +212,8 @@ class DictionaryCompiler final {
       throw compiler_exception("not compiled yet");
     }
 
-    std::ofstream out_stream = keyvi::util::OsUtils::OpenOutFileStream(filename);
-
-    generator_->Write(out_stream);
-    out_stream.close();
+    keyvi::util::WriteOutputFile(filename, keyvi::util::mapGetBool(params_, DIRECT_IO_KEY, false),
+                                 [this](std::ostream& out_stream) { generator_->Write(out_stream); });
   }
 
  private:
@@ -207,13 +228,20 @@ class DictionaryCompiler final {
   size_t chunk_ = 0;
   size_t size_of_keys_ = 0;
   size_t parallel_sort_threshold_;
+  size_t compile_threads_;
   boost::filesystem::path temporary_directory_;
+  std::deque<std::future<void>> pending_chunks_;
+
+  // number of keys handed from the merging thread to the generator at once
+  static const size_t MERGE_BATCH_SIZE = 4096;
+
+  inline void Sort() { Sort(&key_values_); }
 
-  inline void Sort() {
-    if (key_values_.size() > parallel_sort_threshold_ && parallel_sort_threshold_ != 0) {
-      boost::sort::block_indirect_sort(key_values_.begin(), key_values_.end());
+  inline void Sort(key_values_t* key_values) const {
+    if (key_values->size() > parallel_sort_threshold_ && parallel_sort_threshold_ != 0) {
+      boost::sort::block_indirect_sort(key_values->begin(), key_values->end());
     } else {
-      std::sort(key_values_.begin(), key_values_.end());
+      std::sort(key_values->begin(), key_values->end());
     }
   }
 
@@ -230,30 +258,60 @@ class DictionaryCompiler final {
       boost::filesystem::create_directory(temporary_directory_);
     }
 
-    Sort();
+    boost::filesystem::path filename(temporary_directory_);
+    filename /= "fsa_";
+    filename += std::to_string(chunk_);
+    ++chunk_;
+    memory_estimate_ = 0;
+
+    if (compile_threads_ == 1) {
+      CompileChunk(&key_values_, filename);
+      key_values_.clear();
+      return;
+    }
+
+    // limit the number of chunks in flight, this also limits memory usage
+    if (pending_chunks_.size() >= compile_threads_) {
+      WaitForPendingChunk();
+    }
+
+    pending_chunks_.push_back(
+        std::async(std::launch::async, [this, filename, key_values = std::move(key_values_)]() mutable {
+          CompileChunk(&key_values, filename);
+        }));
+    key_values_ = key_values_t();
+  }
+
+  inline void CompileChunk(key_values_t* key_values, const boost::filesystem::path& filename) const {
+    Sort(key_values);
 
     // disable minimization for faster compile
     keyvi::util::parameters_t params(params_);
     params[MINIMIZATION_KEY] = "off";
+    // chunks are read back right away for the final merge, keep them in the page cache
+    params[DIRECT_IO_KEY] = "off";
     fsa::Generator<keyvi::dictionary::fsa::internal::SparseArrayPersistence<uint16_t>, fsa::internal::NullValueStore,
                    uint32_t, int32_t>
         generator(params);
 
-    for (const key_value_t& key_value : key_values_) {
+    for (const key_value_t& key_value : *key_values) {
       TRACE("adding to generator: %s", key_value.key.c_str());
       generator.Add(key_value.key, key_value.value);
     }
 
-    key_values_.clear();
-    memory_estimate_ = 0;
     generator.CloseFeeding();
 
-    boost::filesystem::path filename(temporary_directory_);
-    filename /= "fsa_";
-    filename += std::to_string(chunk_);
     TRACE("write chunk to %s", filename.string().c_str());
     generator.WriteToFile(filename.string());
-    ++chunk_;
+  }
+
+  /**
+   * Wait for the oldest chunk compiled in the background, rethrows if compilation failed.
+   */
+  inline void WaitForPendingChunk() {
+    std::future<void> pending_chunk = std::move(pending_chunks_.front());
+    pending_chunks_.pop_front();
+    pending_chunk.get();
   }
 
   inline void CompileSingleChunk(callback_t progress_callback = nullptr, void* user_data = nullptr) {
@@ -277,7 +335,9 @@ class DictionaryCompiler final {
       for (const key_value_t& key_value : key_values_) {
         TRACE("adding to generator: %s", key_value.key.c_str());
 
-        generator_->Add(key_value.key, key_value.value);
+        fsa::ValueHandle handle = key_value.value;
+        handle.value_idx_ = ResolveValue(handle.value_idx_, &handle.no_minimization_);
+        generator_->Add(key_value.key, handle);
         ++added_key_values;
         if (progress_callback && (added_key_values % callback_trigger == 0)) {
           progress_callback(added_key_values, number_of_items, user_data);
@@ -298,10 +358,12 @@ class DictionaryCompiler final {
       CreateChunk();
     }
 
-    TRACE("merge chunks");
-    keyvi::util::parameters_t params;
+    while (!pending_chunks_.empty()) {
+      WaitForPendingChunk();
+    }
 
-    std::priority_queue<fsa::SegmentIterator> segments_pqueue;
+    TRACE("merge chunks");
+    std::vector<fsa::automata_t> chunks;
 
     // add all chunks
     for (size_t i = 0; i < chunk_; ++i) {
@@ -311,10 +373,8 @@ class DictionaryCompiler final {
 
       TRACE("add for merge %s", filename.string().c_str());
 
-      // todo: make shared
-      fsa::automata_t fsa(new fsa::Automata(filename.string()));
-      segments_pqueue.emplace(fsa::EntryIterator(fsa), segments_pqueue.size());
-      number_of_items += fsa->GetNumberOfKeys();
+      chunks.emplace_back(new fsa::Automata(filename.string()));
+      number_of_items += chunks.back()->GetNumberOfKeys();
     }
 
     callback_trigger = 1 + (number_of_items - 1) / 100;
@@ -327,52 +387,143 @@ class DictionaryCompiler final {
         GeneratorAdapter::template CreateGenerator<keyvi::dictionary::fsa::internal::SparseArrayPersistence<uint16_t>>(
             size_of_keys_, params_, value_store_);
 
-    std::string top_key;
-    while (!segments_pqueue.empty()) {
-      auto segment_it = segments_pqueue.top();
-      segments_pqueue.pop();
-
-      top_key = segment_it.entryIterator().GetKey();
-
-      // check for same keys and merge only the most recent one
-      while (!segments_pqueue.empty() && segments_pqueue.top().entryIterator().operator==(top_key)) {
-        auto to_inc = segments_pqueue.top();
-
-        segments_pqueue.pop();
-        if (++to_inc) {
-          TRACE("push iterator");
-          segments_pqueue.push(to_inc);
-        }
+    // consumed counts the merged entries including duplicates that got dropped
+    auto add_to_generator = [&](std::string&& key, const fsa::ValueHandle& handle, size_t consumed) {
+      TRACE("Add key: %s", key.c_str());
+      // like the value index, the minimization flag does not survive the chunk, keep it unset
+      bool no_minimization = false;
+      fsa::ValueHandle resolved_handle = handle;
+      resolved_handle.value_idx_ = ResolveValue(handle.value_idx_, &no_minimization);
+      generator_->Add(std::move(key), resolved_handle);
 
+      for (size_t i = 0; i < consumed; ++i) {
         ++added_key_values;
         if (progress_callback && (added_key_values % callback_trigger == 0)) {
           progress_callback(added_key_values, number_of_items, user_data);
         }
       }
+    };
+
+    if (compile_threads_ == 1) {
+      MergeChunks(chunks, add_to_generator);
+    } else {
+      MergeChunksPipelined(chunks, add_to_generator);
+    }
+
+    // free up disk space as early as possible
+    chunks.clear();
+    boost::filesystem::remove_all(temporary_directory_);
+    chunk_ = 0;
+    generator_->CloseFeeding();
+  }
+
+  /**
+   * K-way merge of the chunks, for duplicate keys only the most recent one is kept.
+   *
+   * @param chunks the chunks in the order they have been created
+   * @param emit called for every key in sorted order with the value handle and the number of consumed entries
+   */
+  template <typename EmitFuncT>
+  inline void MergeChunks(const std::vector<fsa::automata_t>& chunks, EmitFuncT&& emit) const {
+    fsa::EntryIteratorMerger merger;
+
+    for (const fsa::automata_t& chunk : chunks) {
+      merger.Add(fsa::EntryIterator(chunk));
+    }
+
+    std::string key;
+    while (merger.Next(&key)) {
       fsa::ValueHandle handle;
       handle.no_minimization_ = false;
 
       // get the weight value, for now simple: does not require access to the
       // value store itself
-      handle.weight_ = value_store_->GetMergeWeight(segment_it.entryIterator().GetValueId());
-      handle.value_idx_ = segment_it.entryIterator().GetValueId();
+      handle.weight_ = value_store_->GetMergeWeight(merger.GetValueId());
+      handle.value_idx_ = merger.GetValueId();
+
+      emit(std::move(key), handle, 1 + merger.GetNumberOfDroppedEntries());
+    }
+  }
+
+  /**
+   * Merge the chunks in a separate thread, the calling thread feeds the results into the generator.
+   *
+   * Batches of keys are passed between the threads, the number of batches is bounded and they get recycled.
+   */
+  template <typename EmitFuncT>
+  inline void MergeChunksPipelined(const std::vector<fsa::automata_t>& chunks, EmitFuncT&& emit) const {
+    using batch_t = std::vector<std::pair<key_value_t, size_t>>;
+
+    moodycamel::BlockingConcurrentQueue<batch_t> filled_batches;
+    moodycamel::BlockingConcurrentQueue<batch_t> free_batches;
 
-      TRACE("Add key: %s", top_key.c_str());
-      generator_->Add(std::move(top_key), handle);
+    for (size_t i = 0; i < 2 * compile_threads_; ++i) {
+      batch_t batch;
+      batch.reserve(MERGE_BATCH_SIZE);
+      free_batches.enqueue(std::move(batch));
+    }
 
-      if (++segment_it) {
-        segments_pqueue.push(segment_it);
+    std::exception_ptr merge_exception;
+    std::thread merger([&]() {
+      batch_t batch;
+      try {
+        free_batches.wait_dequeue(batch);
+        MergeChunks(chunks, [&](std::string&& key, const fsa::ValueHandle& handle, size_t consumed) {
+          batch.emplace_back(key_value_t(std::move(key), handle), consumed);
+          if (batch.size() == MERGE_BATCH_SIZE) {
+            filled_batches.enqueue(std::move(batch));
+            free_batches.wait_dequeue(batch);
+          }
+        });
+        if (!batch.empty()) {
+          filled_batches.enqueue(std::move(batch));
+        }
+      } catch (...) {
+        merge_exception = std::current_exception();
       }
-      ++added_key_values;
-      if (progress_callback && (added_key_values % callback_trigger == 0)) {
-        progress_callback(added_key_values, number_of_items, user_data);
+
+      // an empty batch marks the end
+      filled_batches.enqueue(batch_t());
+    });
+
+    std::exception_ptr generator_exception;
+    batch_t batch;
+    for (filled_batches.wait_dequeue(batch); !batch.empty(); filled_batches.wait_dequeue(batch)) {
+      // after an error keep on draining, so the merger does not block
+      if (!generator_exception) {
+        try {
+          for (auto& key_value : batch) {
+            emit(std::move(key_value.first.key), key_value.first.value, key_value.second);
+          }
+        } catch (...) {
+          generator_exception = std::current_exception();
+        }
       }
+
+      batch.clear();
+      free_batches.enqueue(std::move(batch));
     }
 
-    // free up disk space as early as possible
-    boost::filesystem::remove_all(temporary_directory_);
-    chunk_ = 0;
-    generator_->CloseFeeding();
+    merger.join();
+
+    if (merge_exception) {
+      std::rethrow_exception(merge_exception);
+    }
+    if (generator_exception) {
+      std::rethrow_exception(generator_exception);
+    }
+  }
+
+  /**
+   * Translate a value index returned by the value store into the offset of the value.
+   *
+   * With encoding threads the json value store hands out tickets, which can be resolved after CloseFeeding.
+   */
+  inline uint64_t ResolveValue(uint64_t value_idx, bool* no_minimization) const {
+    if constexpr (ValueStoreType == fsa::internal::value_store_t::JSON) {
+      return value_store_->ResolveValue(value_idx, no_minimization);
+    }
+    return value_idx;
   }
 
   /**
@@ -41,7 +41,7 @@
 #include "keyvi/dictionary/fsa/generator_adapter.h"
 #include "keyvi/dictionary/fsa/internal/constants.h"
 #include "keyvi/util/configuration.h"
-#include "keyvi/util/os_utils.h"
+#include "keyvi/util/direct_output_stream.h"
 #include "keyvi/util/serialization_utils.h"
 
 // #define ENABLE_TRACING
@@ -203,10 +203,8 @@ class DictionaryIndexCompiler final {
       throw compiler_exception("not compiled yet");
     }
 
-    std::ofstream out_stream = keyvi::util::OsUtils::OpenOutFileStream(filename);
-
-    generator_->Write(out_stream);
-    out_stream.close();
+    keyvi::util::WriteOutputFile(filename, keyvi::util::mapGetBool(params_, DIRECT_IO_KEY, false),
+                                 [this](std::ostream& out_stream) { generator_->Write(out_stream); });
   }
 
  private:
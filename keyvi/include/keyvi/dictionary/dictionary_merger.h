@@ -27,10 +27,10 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <functional>
 #include <memory>
-#include <queue>
 #include <string>
 #include <utility>
 #include <vector>
@@ -41,10 +41,11 @@
 
 #include "keyvi/dictionary/fsa/automata.h"
 #include "keyvi/dictionary/fsa/entry_iterator.h"
+#include "keyvi/dictionary/fsa/entry_iterator_merger.h"
 #include "keyvi/dictionary/fsa/generator_adapter.h"
 #include "keyvi/dictionary/fsa/internal/constants.h"
+#include "keyvi/dictionary/fsa/internal/outgoing_transitions_scan.h"
 #include "keyvi/dictionary/fsa/internal/value_store_factory.h"
-#include "keyvi/dictionary/fsa/segment_iterator.h"
 #include "keyvi/util/configuration.h"
 
 // #define ENABLE_TRACING
@@ -76,6 +77,8 @@ class DictionaryMerger final {
   using parameters_t = keyvi::util::parameters_t;
 
  public:
+  using key_callback_t = std::function<void(const std::string&)>;
+
   /**
    * Instantiate a dictionary merger.
    *
@@ -85,7 +88,9 @@ class DictionaryMerger final {
       : dicts_to_merge_(), params_(params), stats_() {
     params_[TEMPORARY_PATH_KEY] = keyvi::util::mapGetTemporaryPath(params);
 
-    append_merge_ = MERGE_APPEND == keyvi::util::mapGet<std::string>(params_, MERGE_MODE, "");
+    const std::string merge_mode = keyvi::util::mapGet<std::string>(params_, MERGE_MODE, "");
+    append_merge_ = MERGE_APPEND == merge_mode;
+    structural_merge_ = MERGE_STRUCTURAL == merge_mode;
   }
 
   void Add(const std::string& filename) {
@@ -94,7 +99,7 @@ class DictionaryMerger final {
     }
 
     fsa::automata_t fsa;
-    if (append_merge_) {
+    if (append_merge_ || structural_merge_) {
       // TODO(hendrik) https://github.com/KeyviDev/keyvi/issues/102
       fsa.reset(new fsa::Automata(std::make_shared<DictionaryProperties>(DictionaryProperties::FromFile(filename)),
                                   loading_strategy_types::lazy, false));
@@ -107,20 +112,23 @@ class DictionaryMerger final {
     }
 
     // check if value stores are compatible, TODO: how to check for append merge?
-    if (!append_merge_ && dicts_to_merge_.size() > 0) {
+    if (!append_merge_ && !structural_merge_ && dicts_to_merge_.size() > 0) {
       dicts_to_merge_[0]->GetValueStore()->CheckCompatibility(*(fsa->GetValueStore()));
     }
 
     // check whether dictionary is completely empty
-    const auto segment_iterator = fsa::SegmentIterator(fsa::EntryIterator(fsa), segments_pqueue_.size());
-    if (!segment_iterator) {
+    const fsa::EntryIterator entry_iterator(fsa);
+    if (entry_iterator == fsa::EntryIterator()) {
       return;
     }
 
     // push back deleted keys (list might be empty)
     deleted_keys_.push_back(TryLoadDeletedKeys(filename));
 
-    segments_pqueue_.push(segment_iterator);
+    // in structural mode the first dictionary is the base, it does not get iterated
+    if (!structural_merge_ || !dicts_to_merge_.empty()) {
+      segments_merger_.Add(entry_iterator);
+    }
     inputFiles_.push_back(filename);
     dicts_to_merge_.push_back(fsa);
   }
@@ -137,6 +145,20 @@ class DictionaryMerger final {
     }
   }
 
+  /**
+   * Set a callback that gets called for every key of the merged dictionary, e.g. to build a filter over the keys.
+   *
+   * Not available in structural mode, unchanged subtrees of the base are not iterated.
+   *
+   * @param key_callback the callback
+   */
+  void SetKeyCallback(const key_callback_t& key_callback) {
+    if (structural_merge_) {
+      throw merger_exception("key callback not supported in structural merge mode");
+    }
+    key_callback_ = key_callback;
+  }
+
   void Merge(const std::string& filename) {
     Merge();
     generator_->WriteToFile(filename);
@@ -145,6 +167,8 @@ class DictionaryMerger final {
   void Merge() {
     if (append_merge_) {
       AppendMerge();
+    } else if (structural_merge_) {
+      StructuralMerge();
     } else {
       CompleteMerge();
     }
@@ -171,12 +195,14 @@ class DictionaryMerger final {
  private:
   typename GeneratorAdapter::AdapterPtr generator_;
   bool append_merge_ = false;
+  bool structural_merge_ = false;
   std::vector<fsa::automata_t> dicts_to_merge_;
   std::vector<std::vector<std::string>> deleted_keys_;
   std::vector<std::string> inputFiles_;
-  std::priority_queue<fsa::SegmentIterator> segments_pqueue_;
+  fsa::EntryIteratorMerger segments_merger_;
   parameters_t params_;
   std::string manifest_ = std::string();
+  key_callback_t key_callback_;
   MergeStats stats_;
 
   size_t GetTotalSparseArraySize() const {
@@ -212,42 +238,29 @@ class DictionaryMerger final {
 
     std::string top_key;
 
-    while (!segments_pqueue_.empty()) {
-      auto segment_it = segments_pqueue_.top();
-      segments_pqueue_.pop();
-
-      top_key = segment_it.entryIterator().GetKey();
-
-      // check for same keys and merge only the most recent one
-      while (!segments_pqueue_.empty() && segments_pqueue_.top().entryIterator().operator==(top_key)) {
-        ++stats_.updated_keys_;
-        auto to_inc = segments_pqueue_.top();
+    // for same keys only the most recent one gets merged
+    while (segments_merger_.Next(&top_key)) {
+      const size_t segment_index = segments_merger_.GetSegmentIndex();
+      stats_.updated_keys_ += segments_merger_.GetNumberOfDroppedEntries();
 
-        segments_pqueue_.pop();
-        if (++to_inc) {
-          TRACE("push iterator");
-          segments_pqueue_.push(to_inc);
-        }
-      }
-
-      if (KeyDeleted(segment_it.segmentIndex(), top_key) == false) {
+      if (KeyDeleted(segment_index, top_key) == false) {
         fsa::ValueHandle handle;
         handle.no_minimization_ = false;
 
         // get the weight value, for now simple: does not require access to the
         // value store itself
-        handle.weight_ = value_store->GetMergeWeight(segment_it.entryIterator().GetValueId());
+        handle.weight_ = value_store->GetMergeWeight(segments_merger_.GetValueId());
         handle.value_idx_ =
-            value_store->AddValueMerge(segment_it.entryIterator().GetFsa()->GetValueStore()->GetValueStorePayload(),
-                                       segment_it.entryIterator().GetValueId(), &handle.no_minimization_);
+            value_store->AddValueMerge(dicts_to_merge_[segment_index]->GetValueStore()->GetValueStorePayload(),
+                                       segments_merger_.GetValueId(), &handle.no_minimization_);
 
         TRACE("Add key: %s", top_key.c_str());
         ++stats_.number_of_keys_;
+        if (key_callback_) {
+          key_callback_(top_key);
+        }
         generator_->Add(std::move(top_key), handle);
       }
-      if (++segment_it) {
-        segments_pqueue_.push(segment_it);
-      }
     }
     dicts_to_merge_.clear();
     TRACE("finished iterating, do final compile.");
@@ -262,41 +275,27 @@ class DictionaryMerger final {
 
     std::string top_key;
 
-    while (!segments_pqueue_.empty()) {
-      auto segment_it = segments_pqueue_.top();
-      segments_pqueue_.pop();
-
-      top_key = segment_it.entryIterator().GetKey();
-
-      // check for same keys and merge only the most recent one
-      while (!segments_pqueue_.empty() && segments_pqueue_.top().entryIterator().operator==(top_key)) {
-        ++stats_.updated_keys_;
-        auto to_inc = segments_pqueue_.top();
-
-        segments_pqueue_.pop();
-        if (++to_inc) {
-          TRACE("push iterator");
-          segments_pqueue_.push(to_inc);
-        }
-      }
+    // for same keys only the most recent one gets merged
+    while (segments_merger_.Next(&top_key)) {
+      const size_t segment_index = segments_merger_.GetSegmentIndex();
+      stats_.updated_keys_ += segments_merger_.GetNumberOfDroppedEntries();
 
-      if (KeyDeleted(segment_it.segmentIndex(), top_key) == false) {
+      if (KeyDeleted(segment_index, top_key) == false) {
         fsa::ValueHandle handle;
         handle.no_minimization_ = false;
 
         // get the weight value, for now simple: does not require access to the
         // value store itself
-        handle.weight_ = value_store->GetMergeWeight(segment_it.entryIterator().GetValueId());
-        handle.value_idx_ =
-            value_store->AddValueAppendMerge(segment_it.segmentIndex(), segment_it.entryIterator().GetValueId());
+        handle.weight_ = value_store->GetMergeWeight(segments_merger_.GetValueId());
+        handle.value_idx_ = value_store->AddValueAppendMerge(segment_index, segments_merger_.GetValueId());
 
         TRACE("Add key: %s", top_key.c_str());
         ++stats_.number_of_keys_;
+        if (key_callback_) {
+          key_callback_(top_key);
+        }
         generator_->Add(std::move(top_key), handle);
       }
-      if (++segment_it) {
-        segments_pqueue_.push(segment_it);
-      }
     }
     dicts_to_merge_.clear();
     TRACE("finished iterating, do final compile.");
@@ -304,19 +303,276 @@ class DictionaryMerger final {
   }
 
   /**
-   * Load a file with deleted keys if it exists
+   * A key of the dictionaries merged into the base in structural mode.
+   */
+  struct StructuralMergeEntry {
+    std::string key;
+    fsa::ValueHandle handle;
+    // deleted by the deleted keys of the base, this is not an update
+    bool base_deletion = false;
+  };
+
+  using structural_merge_entries_t = std::vector<StructuralMergeEntry>;
+
+  /**
+   * Merge the other dictionaries into the first one (the base) without iterating over the base.
+   *
+   * The sparse array of the base gets copied as a whole, only the states on the paths of the keys to merge are
+   * regenerated, all other subtrees of the base are referenced as they are. Values are appended like in append mode,
+   * so the values of the base keep their ids. States of the base that became unreachable are not removed, a complete
+   * merge compacts the dictionary again.
+   */
+  void StructuralMerge() {
+    ValueStoreAppendMergeT* value_store = new ValueStoreAppendMergeT(inputFiles_);
+
+    // subtrees of the base can only be referenced from a single sparse array
+    parameters_t params = params_;
+    params[GENERATOR_THREADS_KEY] = "1";
+
+    generator_ =
+        GeneratorAdapter::template CreateGenerator<keyvi::dictionary::fsa::internal::SparseArrayPersistence<uint16_t>>(
+            GetTotalSparseArraySize(), params, value_store);
+
+    if (dicts_to_merge_.empty()) {
+      generator_->CloseFeeding();
+      return;
+    }
+
+    const fsa::Automata& base = *dicts_to_merge_[0];
+    generator_->ReuseSparseArray(base.labels_, base.transitions_compact_, base.SparseArraySize(),
+                                 base.dictionary_properties_->GetNumberOfStates());
+
+    structural_merge_entries_t entries;
+    std::vector<std::string>& base_deleted_keys = deleted_keys_[0];
+    std::string top_key;
+
+    // for same keys only the most recent one gets merged
+    while (segments_merger_.Next(&top_key)) {
+      const size_t segment_index = segments_merger_.GetSegmentIndex() + 1;
+      stats_.updated_keys_ += segments_merger_.GetNumberOfDroppedEntries();
+
+      AddBaseDeletions(top_key, &base_deleted_keys, &entries);
+
+      StructuralMergeEntry entry;
+      if (KeyDeleted(segment_index, top_key)) {
+        entry.handle.deleted_ = true;
+      } else {
+        entry.handle.weight_ = value_store->GetMergeWeight(segments_merger_.GetValueId());
+        entry.handle.value_idx_ = value_store->AddValueAppendMerge(segment_index, segments_merger_.GetValueId());
+      }
+      entry.key = std::move(top_key);
+      entries.push_back(std::move(entry));
+    }
+    AddBaseDeletions(std::string(), &base_deleted_keys, &entries);
+
+    std::string prefix;
+    uint64_t rebuilt_base_keys = 0;
+    const uint64_t start_state = base.GetStartState();
+    StructuralMergeState(base, start_state, entries.begin(), entries.end(), value_store, &prefix, &rebuilt_base_keys);
+
+    // all other keys of the base are in the referenced subtrees
+    generator_->AddNumberOfKeys(base.GetNumberOfKeys() - rebuilt_base_keys);
+    stats_.number_of_keys_ += base.GetNumberOfKeys() - rebuilt_base_keys;
+
+    dicts_to_merge_.clear();
+    TRACE("finished structural merge, do final compile.");
+    generator_->CloseFeeding();
+  }
+
+  /**
+   * Turn the deleted keys of the base that sort before the given key into entries.
+   *
+   * @param key the next key to merge, if empty all remaining deleted keys get added
+   * @param base_deleted_keys deleted keys of the base in reverse order
+   * @param entries the entries to add to
+   */
+  void AddBaseDeletions(const std::string& key, std::vector<std::string>* base_deleted_keys,
+                        structural_merge_entries_t* entries) {
+    while (!base_deleted_keys->empty() && (key.empty() || base_deleted_keys->back() < key)) {
+      StructuralMergeEntry entry;
+      entry.key = std::move(base_deleted_keys->back());
+      entry.handle.deleted_ = true;
+      entry.base_deletion = true;
+      entries->push_back(std::move(entry));
+      base_deleted_keys->pop_back();
+    }
+
+    // the key itself gets overwritten anyway
+    if (!base_deleted_keys->empty() && base_deleted_keys->back() == key) {
+      base_deleted_keys->pop_back();
+    }
+  }
+
+  /**
+   * Regenerate a state of the base, recursively for the paths to all entries, untouched subtrees are referenced.
+   *
+   * @param base the base dictionary
+   * @param base_state the state in the base, 0 if the prefix does not exist in the base
+   * @param begin first entry with the prefix
+   * @param end end of the entries with the prefix
+   * @param value_store the value store
+   * @param prefix the path to the state
+   * @param rebuilt_base_keys counts the keys of the base in regenerated states
+   */
+  void StructuralMergeState(const fsa::Automata& base, uint64_t base_state,
+                            typename structural_merge_entries_t::iterator begin,
+                            typename structural_merge_entries_t::iterator end, ValueStoreAppendMergeT* value_store,
+                            std::string* prefix, uint64_t* rebuilt_base_keys) {
+    if (begin == end && !prefix->empty()) {
+      if (base_state != 0) {
+        generator_->AddSubtree(*prefix, base_state, GetSubtreeWeight(base, base_state, prefix->size(), value_store));
+      }
+      return;
+    }
+
+    const size_t depth = prefix->size();
+    const bool base_final = base_state != 0 && base.IsFinalState(base_state);
+    if (base_final) {
+      ++(*rebuilt_base_keys);
+    }
+
+    // keys are sorted, so an entry for the prefix itself comes first
+    if (begin != end && begin->key.size() == depth) {
+      if (base_final) {
+        if (begin->base_deletion) {
+          ++stats_.deleted_keys_;
+        } else {
+          ++stats_.updated_keys_;
+        }
+      }
+
+      if (!begin->handle.deleted_) {
+        ++stats_.number_of_keys_;
+        generator_->Add(*prefix, begin->handle);
+      }
+      ++begin;
+    } else if (base_final) {
+      fsa::ValueHandle handle;
+      const uint64_t value_id = base.GetStateValue(base_state);
+      handle.weight_ = value_store->GetMergeWeight(value_id);
+      handle.value_idx_ = value_store->AddValueAppendMerge(0, value_id);
+
+      ++stats_.number_of_keys_;
+      generator_->Add(*prefix, handle);
+    }
+
+    uint64_t outgoing[fsa::internal::OUTGOING_TRANSITIONS_BITMASK_WORDS] = {};
+    if (base_state != 0) {
+      fsa::internal::ScanOutgoingTransitions(base.labels_ + base_state, outgoing);
+    }
+
+    for (size_t label = 0; label < 256; ++label) {
+      const bool base_transition = (outgoing[label / 64] >> (label % 64)) & 1;
+      auto label_end = begin;
+      while (label_end != end && static_cast<unsigned char>(label_end->key[depth]) == label) {
+        ++label_end;
+      }
+
+      if (!base_transition && label_end == begin) {
+        continue;
+      }
+
+      uint64_t child_state = 0;
+      if (base_transition) {
+        child_state = base.ResolvePointer(base_state, static_cast<unsigned char>(label));
+      }
+
+      prefix->push_back(static_cast<char>(label));
+      StructuralMergeState(base, child_state, begin, label_end, value_store, prefix, rebuilt_base_keys);
+      prefix->pop_back();
+      begin = label_end;
+    }
+  }
+
+  /**
+   * Get the inner weight of an untouched subtree of the base, the highest weight of its keys.
+   *
+   * Deep states do not store an inner weight, in this case the weight gets computed from the values of the subtree.
+   *
+   * @param base the base dictionary
+   * @param base_state the root state of the subtree
+   * @param depth the depth of the root state
+   * @param value_store the value store
+   */
+  uint32_t GetSubtreeWeight(const fsa::Automata& base, uint64_t base_state, size_t depth,
+                            ValueStoreAppendMergeT* value_store) const {
+    if (!ValueStoreAppendMergeT::inner_weight) {
+      return 0;
+    }
+
+    if (depth < INNER_WEIGHT_CUT_OFF_DEPTH) {
+      return base.GetInnerWeight(base_state);
+    }
+
+    uint32_t weight = 0;
+    std::vector<uint64_t> states{base_state};
+    while (!states.empty()) {
+      const uint64_t state = states.back();
+      states.pop_back();
+
+      if (base.IsFinalState(state)) {
+        weight = std::max(weight, value_store->GetMergeWeight(base.GetStateValue(state)));
+      }
+
+      uint64_t outgoing[fsa::internal::OUTGOING_TRANSITIONS_BITMASK_WORDS] = {};
+      fsa::internal::ScanOutgoingTransitions(base.labels_ + state, outgoing);
+      for (size_t label = 0; label < 256; ++label) {
+        if ((outgoing[label / 64] >> (label % 64)) & 1) {
+          states.push_back(base.ResolvePointer(state, static_cast<unsigned char>(label)));
+        }
+      }
+    }
+
+    return weight;
+  }
+
+  /**
+   * Load the deleted keys of a dictionary, sorted in reverse order
    */
   std::vector<std::string> TryLoadDeletedKeys(const std::string& filename) {
     std::vector<std::string> deleted_keys;
-    boost::filesystem::path deleted_keys_file{filename};
-    deleted_keys_file += ".dk";
 
+    // the list of deleted keys and the delta of recent deletes, see index::internal::Segment::Persist
+    for (const char* suffix : {".dk", ".dkd"}) {
+      boost::filesystem::path deleted_keys_file{filename};
+      deleted_keys_file += suffix;
+      TryLoadDeletedKeysFile(deleted_keys_file, &deleted_keys);
+    }
+
+    // sort in reverse order
+    std::sort(deleted_keys.begin(), deleted_keys.end(), std::greater<std::string>());
+    deleted_keys.erase(std::unique(deleted_keys.begin(), deleted_keys.end()), deleted_keys.end());
+
+    return deleted_keys;
+  }
+
+  /**
+   * Load a file with deleted keys if it exists and append them
+   */
+  void TryLoadDeletedKeysFile(const boost::filesystem::path& deleted_keys_file,
+                              std::vector<std::string>* deleted_keys) {
     TRACE("check for deleted keys file: %s", deleted_keys_file.string().c_str());
     std::ifstream deleted_keys_stream(deleted_keys_file.string(), std::ios::binary);
 
     if (deleted_keys_stream.good()) {
       TRACE("found deleted keys file");
 
+      char magic[KEYVI_FILE_MAGIC_LEN];
+      deleted_keys_stream.read(magic, KEYVI_FILE_MAGIC_LEN);
+
+      if (deleted_keys_stream.good() && std::strncmp(magic, KEYVI_FILE_MAGIC, KEYVI_FILE_MAGIC_LEN) == 0) {
+        // deleted keys stored as key only dictionary
+        fsa::EntryIterator end_it;
+        for (fsa::EntryIterator it(fsa::automata_t(new fsa::Automata(deleted_keys_file.string()))); it != end_it;
+             ++it) {
+          deleted_keys->push_back(it.GetKey());
+        }
+        return;
+      }
+
+      // deleted keys in msgpack format (older versions)
+      deleted_keys_stream.clear();
+      deleted_keys_stream.seekg(0, std::ios::beg);
       {
         // reads the buffer as 1 big chunk, could be improved
         // msgpack v2.x provides a better interface (visitor)
@@ -326,14 +582,11 @@ class DictionaryMerger final {
         msgpack::unpacked unpacked_object;
         msgpack::unpack(unpacked_object, buffer.str().data(), buffer.str().size());
 
-        unpacked_object.get().convert(deleted_keys);
+        std::vector<std::string> legacy_deleted_keys;
+        unpacked_object.get().convert(legacy_deleted_keys);
+        deleted_keys->insert(deleted_keys->end(), legacy_deleted_keys.begin(), legacy_deleted_keys.end());
       }
-
-      // sort in reverse order
-      std::sort(deleted_keys.begin(), deleted_keys.end(), std::greater<std::string>());
     }
-
-    return deleted_keys;
   }
 };
 
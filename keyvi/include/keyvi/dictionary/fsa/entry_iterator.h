@@ -70,6 +70,16 @@ class EntryIterator final {
 
   size_t GetDepth() const { return stack_.GetDepth(); }
 
+  /**
+   * The current key as raw bytes, GetDepth() bytes long, only valid until the iterator gets advanced.
+   */
+  const unsigned char* GetKeyData() const { return traversal_stack_.data(); }
+
+  /**
+   * The length of the prefix the current key shares with the previous one, known from the traversal for free.
+   */
+  size_t GetCommonPrefixLengthWithPreviousKey() const { return common_prefix_length_; }
+
   internal::IValueStoreReader::attributes_t GetValueAsAttributeVector() const {
     return fsa_->GetValueAsAttributeVector(current_value_);
   }
@@ -81,6 +91,7 @@ class EntryIterator final {
     current_state_ = other.current_state_;
     current_value_ = other.current_value_;
     traversal_stack_ = other.traversal_stack_;
+    common_prefix_length_ = other.common_prefix_length_;
     stack_ = other.stack_;
     return *this;
   }
@@ -132,6 +143,8 @@ class EntryIterator final {
       return;
     }
 
+    common_prefix_length_ = traversal_stack_.size();
+
     for (;;) {
       current_state_ = stack_.GetStates().GetNextState();
       TRACE("next state: %ld depth: %ld", current_state_, stack_.GetDepth());
@@ -146,6 +159,7 @@ class EntryIterator final {
         TRACE("state is 0, go up");
         --stack_;
         traversal_stack_.pop_back();
+        common_prefix_length_ = std::min(common_prefix_length_, traversal_stack_.size());
         stack_.GetStates()++;
         current_state_ = stack_.GetStates().GetNextState();
         TRACE("next state %ld depth %ld", current_state_, stack_.GetDepth());
@@ -170,6 +184,7 @@ class EntryIterator final {
   uint64_t current_state_;
   uint64_t current_value_;
   std::vector<unsigned char> traversal_stack_;
+  size_t common_prefix_length_ = 0;
 
   traversal::TraversalStack<> stack_;
 };
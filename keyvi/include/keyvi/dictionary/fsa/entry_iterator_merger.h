@@ -0,0 +1,254 @@
+/* * keyvi - A key value store.
+ *
+ * Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * entry_iterator_merger.h
+ */
+
+#ifndef KEYVI_DICTIONARY_FSA_ENTRY_ITERATOR_MERGER_H_
+#define KEYVI_DICTIONARY_FSA_ENTRY_ITERATOR_MERGER_H_
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "keyvi/dictionary/fsa/entry_iterator.h"
+
+// #define ENABLE_TRACING
+#include "keyvi/dictionary/util/trace.h"
+
+namespace keyvi {
+namespace dictionary {
+namespace fsa {
+
+/**
+ * K-way merge of the keys of several segments (entry iterators) using a tournament tree of losers.
+ *
+ * Segments are numbered in the order they are added, for equal keys the segment added last wins, the others are
+ * dropped. Every internal node of the tree holds the loser of the match played there together with the length of the
+ * common prefix of the loser's key and the winner's key. After the winner got advanced, the length of the common prefix
+ * of its previous and current key is known from the traversal, this is enough to decide most matches on the path to
+ * the root without touching the keys, otherwise the keys are compared from the common prefix onwards.
+ */
+class EntryIteratorMerger final {
+ public:
+  EntryIteratorMerger() = default;
+
+  EntryIteratorMerger& operator=(EntryIteratorMerger const&) = delete;
+  EntryIteratorMerger(const EntryIteratorMerger& that) = delete;
+
+  /**
+   * Add a segment, must not be called after the merge started.
+   *
+   * @param entry_iterator iterator of the segment, the segment index is the number of segments added before
+   */
+  void Add(const EntryIterator& entry_iterator) { iterators_.push_back(entry_iterator); }
+
+  size_t GetNumberOfSegments() const { return iterators_.size(); }
+
+  /**
+   * Advance to the next key.
+   *
+   * @param key the key, only copied if there is one
+   * @return false if all segments are exhausted
+   */
+  bool Next(std::string* key) {
+    if (!initialized_) {
+      Initialize();
+    }
+
+    if (iterators_.empty() || IsExhausted(winner_)) {
+      return false;
+    }
+
+    segment_index_ = winner_;
+    value_id_ = iterators_[winner_].GetValueId();
+    const size_t key_length = iterators_[winner_].GetDepth();
+    key->assign(reinterpret_cast<const char*>(iterators_[winner_].GetKeyData()), key_length);
+
+    // drop the same key from other segments, they are the next winners
+    number_of_dropped_entries_ = 0;
+    for (;;) {
+      const size_t common_prefix_length = AdvanceWinner();
+      if (IsExhausted(winner_) || common_prefix_length != key_length ||
+          iterators_[winner_].GetDepth() != key_length) {
+        break;
+      }
+      ++number_of_dropped_entries_;
+    }
+
+    return true;
+  }
+
+  /**
+   * The segment the current key has been taken from.
+   */
+  size_t GetSegmentIndex() const { return segment_index_; }
+
+  /**
+   * The value id of the current key in its segment.
+   */
+  uint64_t GetValueId() const { return value_id_; }
+
+  /**
+   * Number of entries in other segments with the same key as the current key, those got dropped.
+   */
+  size_t GetNumberOfDroppedEntries() const { return number_of_dropped_entries_; }
+
+ private:
+  std::vector<EntryIterator> iterators_;
+  // losers and the common prefix length with the winner of the match, index 0 is unused
+  std::vector<size_t> losers_;
+  std::vector<size_t> loser_common_prefix_lengths_;
+  size_t winner_ = 0;
+  bool initialized_ = false;
+  size_t segment_index_ = 0;
+  uint64_t value_id_ = 0;
+  size_t number_of_dropped_entries_ = 0;
+
+  static const EntryIterator& EndIterator() {
+    static EntryIterator end_it;
+    return end_it;
+  }
+
+  bool IsExhausted(size_t segment) const { return iterators_[segment] == EndIterator(); }
+
+  void Initialize() {
+    initialized_ = true;
+    const size_t k = iterators_.size();
+    if (k == 0) {
+      return;
+    }
+
+    losers_.resize(k);
+    loser_common_prefix_lengths_.resize(k);
+
+    // winners of the matches, leaves are stored at k..2k-1
+    std::vector<size_t> winners(2 * k);
+    for (size_t i = 0; i < k; ++i) {
+      winners[k + i] = i;
+    }
+
+    for (size_t node = k - 1; node > 0; --node) {
+      size_t common_prefix_length = 0;
+      const size_t left = winners[2 * node];
+      const size_t right = winners[2 * node + 1];
+
+      if (Wins(left, right, 0, &common_prefix_length)) {
+        winners[node] = left;
+        losers_[node] = right;
+      } else {
+        winners[node] = right;
+        losers_[node] = left;
+      }
+      loser_common_prefix_lengths_[node] = common_prefix_length;
+    }
+
+    // with a single segment, node 1 is its leaf
+    winner_ = winners[1];
+  }
+
+  /**
+   * Advance the winner and replay its path to the root.
+   *
+   * @return length of the common prefix of the new winner's key and the key of the previous winner
+   */
+  size_t AdvanceWinner() {
+    const size_t k = iterators_.size();
+    size_t candidate = winner_;
+    ++iterators_[candidate];
+
+    // all losers on the path store their common prefix length with the previous winner, so does the candidate
+    bool candidate_exhausted = IsExhausted(candidate);
+    size_t candidate_common_prefix_length =
+        candidate_exhausted ? 0 : iterators_[candidate].GetCommonPrefixLengthWithPreviousKey();
+
+    for (size_t node = (candidate + k) / 2; node > 0; node /= 2) {
+      const size_t loser = losers_[node];
+      const size_t loser_common_prefix_length = loser_common_prefix_lengths_[node];
+
+      if (IsExhausted(loser)) {
+        continue;
+      }
+
+      if (candidate_exhausted || candidate_common_prefix_length < loser_common_prefix_length) {
+        // the loser equals the previous winner on a longer prefix than the candidate, so it is smaller
+        losers_[node] = candidate;
+        loser_common_prefix_lengths_[node] = candidate_exhausted ? 0 : candidate_common_prefix_length;
+        candidate = loser;
+        candidate_exhausted = false;
+        candidate_common_prefix_length = loser_common_prefix_length;
+      } else if (candidate_common_prefix_length == loser_common_prefix_length) {
+        size_t common_prefix_length = 0;
+        if (!Wins(candidate, loser, candidate_common_prefix_length, &common_prefix_length)) {
+          losers_[node] = candidate;
+          candidate = loser;
+        }
+        loser_common_prefix_lengths_[node] = common_prefix_length;
+      }
+      // else: the candidate equals the previous winner on a longer prefix than the loser, it wins again
+    }
+
+    winner_ = candidate;
+    return candidate_common_prefix_length;
+  }
+
+  /**
+   * Play a match, exhausted segments always lose.
+   *
+   * @param a first segment
+   * @param b second segment
+   * @param offset known length of the common prefix of both keys
+   * @param common_prefix_length the length of the common prefix of both keys
+   * @return true if a wins against b
+   */
+  bool Wins(size_t a, size_t b, size_t offset, size_t* common_prefix_length) const {
+    if (IsExhausted(a) || IsExhausted(b)) {
+      *common_prefix_length = 0;
+      return IsExhausted(b) && (!IsExhausted(a) || a > b);
+    }
+
+    const unsigned char* key_a = iterators_[a].GetKeyData();
+    const unsigned char* key_b = iterators_[b].GetKeyData();
+    const size_t length_a = iterators_[a].GetDepth();
+    const size_t length_b = iterators_[b].GetDepth();
+    const size_t length = std::min(length_a, length_b);
+
+    size_t i = offset;
+    while (i < length && key_a[i] == key_b[i]) {
+      ++i;
+    }
+    *common_prefix_length = i;
+
+    if (i < length) {
+      return key_a[i] < key_b[i];
+    }
+
+    if (length_a != length_b) {
+      return length_a < length_b;
+    }
+
+    // same key, the segment added later wins
+    return a > b;
+  }
+};
+
+} /* namespace fsa */
+} /* namespace dictionary */
+} /* namespace keyvi */
+
+#endif  // KEYVI_DICTIONARY_FSA_ENTRY_ITERATOR_MERGER_H_
@@ -26,16 +26,23 @@
 #define KEYVI_DICTIONARY_FSA_GENERATOR_H_
 
 #include <algorithm>
+#include <deque>
+#include <future>
+#include <memory>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "keyvi/dictionary/dictionary_properties.h"
+#include "keyvi/dictionary/fsa/internal/generator_partition.h"
+#include "keyvi/dictionary/fsa/internal/lru_generation_cache.h"
 #include "keyvi/dictionary/fsa/internal/null_value_store.h"
+#include "keyvi/dictionary/fsa/internal/packed_state.h"
 #include "keyvi/dictionary/fsa/internal/sparse_array_builder.h"
 #include "keyvi/dictionary/fsa/internal/unpacked_state.h"
 #include "keyvi/dictionary/fsa/internal/unpacked_state_stack.h"
 #include "keyvi/util/configuration.h"
-#include "keyvi/util/os_utils.h"
+#include "keyvi/util/direct_output_stream.h"
 #include "keyvi/util/serialization_utils.h"
 
 // #define ENABLE_TRACING
@@ -127,7 +134,9 @@ struct ValueHandle final {
 };
 
 template <class PersistenceT, class ValueStoreT = internal::NullValueStore, class OffsetTypeT = uint32_t,
-          class HashCodeTypeT = int32_t>
+          class HashCodeTypeT = int32_t,
+          class MinimizationCacheT =
+              internal::LeastRecentlyUsedGenerationsCache<internal::PackedState<OffsetTypeT, HashCodeTypeT>>>
 class Generator final {
  public:
   explicit Generator(const keyvi::util::parameters_t& params = keyvi::util::parameters_t(),
@@ -141,12 +150,20 @@ class Generator final {
 
     params_[TEMPORARY_PATH_KEY] = keyvi::util::mapGetTemporaryPath(params);
     minimize_ = keyvi::util::mapGetBool(params_, MINIMIZATION_KEY, true);
+    generator_threads_ =
+        std::max<size_t>(1, keyvi::util::mapGet(params_, GENERATOR_THREADS_KEY, DEFAULT_GENERATOR_THREADS));
+
+    if (generator_threads_ > 1) {
+      // partitioned mode: the partitions bring their own persistence, only the root state is written here
+      persistence_ = new PersistenceT(ROOT_PERSISTENCE_MEMORY_LIMIT, params_[TEMPORARY_PATH_KEY]);
+      stack_ = 0;
+      builder_ = 0;
+    } else {
+      persistence_ = new PersistenceT(memory_limit_ - memory_limit_minimization, params_[TEMPORARY_PATH_KEY]);
 
-    persistence_ = new PersistenceT(memory_limit_ - memory_limit_minimization, params_[TEMPORARY_PATH_KEY]);
-
-    stack_ = new internal::UnpackedStateStack<PersistenceT>(persistence_, 30);
-    builder_ = new internal::SparseArrayBuilder<PersistenceT, OffsetTypeT, HashCodeTypeT>(
-        memory_limit_minimization, persistence_, ValueStoreT::inner_weight, minimize_);
+      stack_ = new internal::UnpackedStateStack<PersistenceT>(persistence_, 30);
+      builder_ = new builder_t(memory_limit_minimization, persistence_, ValueStoreT::inner_weight, minimize_);
+    }
 
     if (value_store != NULL) {
       value_store_ = value_store;
@@ -156,6 +173,12 @@ class Generator final {
   }
 
   ~Generator() {
+    // partitions still being fed block their compile thread, the pending futures wait for it
+    for (const auto& partition : partitions_) {
+      partition->CloseFeeding();
+    }
+    pending_partitions_.clear();
+
     delete persistence_;
     delete value_store_;
     if (stack_) {
@@ -186,6 +209,13 @@ class Generator final {
       return;
     }
 
+    if (generator_threads_ > 1) {
+      bool no_minimization = false;
+      uint64_t value_idx = value_store_->AddValue(value, &no_minimization);
+      AddToPartition(input_key, value_idx, value_store_->GetWeightValue(value), no_minimization);
+      return;
+    }
+
     // check which stack can be consumed (packed into the sparse array)
     ConsumeStack(commonPrefixLength);
 
@@ -229,6 +259,11 @@ class Generator final {
       return;
     }
 
+    if (generator_threads_ > 1) {
+      AddToPartition(input_key, handle.value_idx_, handle.weight_, handle.no_minimization_);
+      return;
+    }
+
     // check which stack can be consumed (packed into the sparse array)
     ConsumeStack(commonPrefixLength);
 
@@ -250,6 +285,77 @@ class Generator final {
     state_ = generator_state::FEEDING;
   }
 
+  /**
+   * Start with the sparse array of an existing automaton, its states can be referenced with AddSubtree.
+   *
+   * The sparse array gets copied as a whole, new states are placed behind it. Must be called before adding keys, not
+   * supported in partitioned mode.
+   *
+   * @param labels the labels of the sparse array
+   * @param transitions the transitions of the sparse array (as persisted)
+   * @param size the size of the sparse array
+   * @param number_of_states the number of states in the sparse array
+   */
+  void ReuseSparseArray(const unsigned char* labels, const uint16_t* transitions, size_t size,
+                        uint64_t number_of_states) {
+    if (state_ != generator_state::FEEDING || !last_key_.empty()) {
+      throw generator_exception("sparse array must be reused before adding keys");
+    }
+
+    if (generator_threads_ > 1) {
+      throw generator_exception("reusing a sparse array is not supported in partitioned mode");
+    }
+
+    persistence_->AppendSparseArray(labels, transitions, size);
+
+    // keep a gap, so new states can not interfere with the copied ones (ghost states)
+    builder_->SetMinimumStateOffset(static_cast<OffsetTypeT>(size + PARTITION_GAP));
+    number_of_states_ = number_of_states;
+  }
+
+  /**
+   * Add all keys of an existing subtree, which must be part of the sparse array given to ReuseSparseArray.
+   *
+   * The keys of the subtree are not counted, see AddNumberOfKeys.
+   *
+   * @param prefix the path to the subtree, all keys of the subtree start with it, must not be empty
+   * @param state the root state of the subtree
+   * @param weight the inner weight of the subtree
+   */
+  void AddSubtree(const std::string& prefix, uint64_t state, uint32_t weight) {
+    if (state_ != generator_state::FEEDING) {
+      throw generator_exception("not in feeding state");
+    }
+
+    if (generator_threads_ > 1) {
+      throw generator_exception("subtrees are not supported in partitioned mode");
+    }
+
+    const size_t commonPrefixLength = get_common_prefix_length(last_key_, prefix);
+    ConsumeStack(commonPrefixLength);
+
+    // the subtree is persisted already, only the path to it goes into the stack
+    const size_t depth = prefix.size() - 1;
+    for (size_t i = commonPrefixLength; i < depth; ++i) {
+      stack_->Insert(i, static_cast<unsigned char>(prefix[i]), 0);
+    }
+    stack_->Insert(depth, static_cast<unsigned char>(prefix[depth]), state);
+    highest_stack_ = depth;
+
+    if (weight > 0) {
+      stack_->UpdateWeights(0, prefix.size(), weight);
+    }
+
+    last_key_ = prefix;
+  }
+
+  /**
+   * Account for keys that have not been added one by one, e.g. with AddSubtree.
+   *
+   * @param number_of_keys the number of keys to add to the count
+   */
+  void AddNumberOfKeys(uint64_t number_of_keys) { number_of_keys_added_ += number_of_keys; }
+
   void CloseFeeding() {
     if (state_ != generator_state::FEEDING) {
       throw generator_exception("not in feeding state");
@@ -257,6 +363,13 @@ class Generator final {
 
     state_ = generator_state::FINALIZING;
 
+    if (generator_threads_ > 1) {
+      ClosePartitions();
+      persistence_->Flush();
+      state_ = generator_state::COMPILED;
+      return;
+    }
+
     if (number_of_keys_added_ > 0) {
       // Consume all but stack[0].
       ConsumeStack(0);
@@ -280,7 +393,9 @@ class Generator final {
     // free structures that are not needed anymore
     delete stack_;
     stack_ = 0;
-    number_of_states_ = builder_->GetNumberOfStates();
+    number_of_states_ += builder_->GetNumberOfStates();
+    minimization_lookups_ = builder_->GetNumberOfMinimizationLookups();
+    minimization_hits_ = builder_->GetNumberOfMinimizationHits();
     delete builder_;
     builder_ = 0;
 
@@ -303,27 +418,55 @@ class Generator final {
     // value stores can ask for a higher version
     const uint64_t file_version = std::max(KEYVI_FILE_VERSION_MIN, value_store_->GetFileVersionMin());
 
+    // in partitioned mode the sparse array is the concatenation of all partitions followed by the root state
+    uint64_t sparse_array_size = persistence_->GetSize();
+    for (const auto& partition : partitions_) {
+      sparse_array_size += partition->GetSize() + PARTITION_GAP;
+    }
+
     keyvi::dictionary::DictionaryProperties p(file_version, start_state_, number_of_keys_added_, number_of_states_,
                                               value_store_->GetValueStoreType(), persistence_->GetVersion(),
-                                              persistence_->GetSize(), manifest_, specialized_dictionary_properties_);
+                                              sparse_array_size, manifest_, specialized_dictionary_properties_);
     p.WriteAsJsonV2(stream);
 
     // write data from persistence
-    persistence_->Write(stream);
+    if (partitions_.empty()) {
+      persistence_->Write(stream);
+    } else {
+      const std::vector<char> zeros(PARTITION_GAP * sizeof(uint16_t), 0);
+      for (const auto& partition : partitions_) {
+        partition->WriteLabels(stream);
+        stream.write(zeros.data(), PARTITION_GAP);
+      }
+      persistence_->WriteLabels(stream);
+
+      for (const auto& partition : partitions_) {
+        partition->WriteTransitions(stream);
+        stream.write(zeros.data(), zeros.size());
+      }
+      persistence_->WriteTransitions(stream);
+    }
 
     // write date from value store
     value_store_->Write(stream);
   }
 
   void WriteToFile(const std::string& filename) {
-    std::ofstream out_stream = keyvi::util::OsUtils::OpenOutFileStream(filename);
-
-    Write(out_stream);
-    out_stream.close();
+    keyvi::util::WriteOutputFile(filename, keyvi::util::mapGetBool(params_, DIRECT_IO_KEY, false),
+                                 [this](std::ostream& out_stream) { Write(out_stream); });
   }
 
   size_t GetFsaSize() const { return builder_->GetSize(); }
 
+  /**
+   * The ratio of minimization lookups that found an equal state, available after CloseFeeding.
+   *
+   * A low ratio indicates that the minimization cache is too small (see memory limit).
+   */
+  double GetMinimizationHitRate() const {
+    return minimization_lookups_ > 0 ? static_cast<double>(minimization_hits_) / minimization_lookups_ : 0.0;
+  }
+
   /**
    * Set a custom manifest to be embedded into the index file.
    *
@@ -336,11 +479,26 @@ class Generator final {
   }
 
  private:
+  typedef internal::SparseArrayBuilder<PersistenceT, OffsetTypeT, HashCodeTypeT, MinimizationCacheT> builder_t;
+  typedef internal::GeneratorPartition<PersistenceT, OffsetTypeT, HashCodeTypeT, MinimizationCacheT> partition_t;
+
+  // slot in the table of canonical states, states are given as global states (see partition_t)
+  struct CanonicalStateSlot {
+    uint64_t hashcode;
+    uint64_t state_plus_one;  // 0 marks an empty slot
+  };
+
+  static constexpr size_t CANONICAL_STATES_MIN_BITS = 16;
+
+  // space between partitions, ensures states of different partitions can not interfere (ghost states)
+  static constexpr size_t PARTITION_GAP = 2 * COMPACT_SIZE_WINDOW;
+  static constexpr size_t ROOT_PERSISTENCE_MEMORY_LIMIT = 1024 * 1024;
+
   size_t memory_limit_;
   keyvi::util::parameters_t params_;
   PersistenceT* persistence_;
   ValueStoreT* value_store_;
-  internal::SparseArrayBuilder<PersistenceT, OffsetTypeT, HashCodeTypeT>* builder_;
+  builder_t* builder_;
   internal::UnpackedStateStack<PersistenceT>* stack_;
   std::string last_key_ = std::string();
   size_t highest_stack_ = 0;
@@ -348,9 +506,250 @@ class Generator final {
   generator_state state_ = generator_state::FEEDING;
   OffsetTypeT start_state_ = 0;
   uint64_t number_of_states_ = 0;
+  uint64_t minimization_lookups_ = 0;
+  uint64_t minimization_hits_ = 0;
   std::string manifest_;
   std::string specialized_dictionary_properties_;
   bool minimize_ = true;
+  size_t generator_threads_ = 1;
+  std::vector<std::unique_ptr<partition_t>> partitions_;
+  std::deque<std::future<void>> pending_partitions_;
+  size_t deduplicated_partitions_ = 0;
+  std::vector<CanonicalStateSlot> canonical_states_;
+  size_t canonical_states_bits_ = 0;
+  size_t number_of_canonical_states_ = 0;
+
+  void AddToPartition(const std::string& input_key, uint64_t value_idx, uint32_t weight, bool no_minimization) {
+    const unsigned char label = static_cast<unsigned char>(input_key[0]);
+
+    if (partitions_.empty() || partitions_.back()->GetLabel() != label) {
+      if (!partitions_.empty()) {
+        partitions_.back()->CloseFeeding();
+      }
+      partitions_.emplace_back(new partition_t(label, partitions_.size(), memory_limit_ / generator_threads_,
+                                               params_[TEMPORARY_PATH_KEY], ValueStoreT::inner_weight, minimize_));
+      SubmitLastPartition();
+    }
+
+    partitions_.back()->Add(input_key.substr(1), value_idx, weight, no_minimization);
+    ++number_of_keys_added_;
+    last_key_ = input_key;
+  }
+
+  /**
+   * Start compiling the last partition while it gets fed, waits for the oldest partition if all threads are busy.
+   */
+  void SubmitLastPartition() {
+    if (pending_partitions_.size() >= generator_threads_) {
+      WaitForOldestPartition();
+    }
+
+    partition_t* partition = partitions_.back().get();
+    pending_partitions_.push_back(std::async(std::launch::async, [partition]() { partition->Compile(); }));
+  }
+
+  /**
+   * Wait for the oldest compiling partition and deduplicate it, partitions finish in order.
+   */
+  void WaitForOldestPartition() {
+    // get() rethrows exceptions from the worker
+    pending_partitions_.front().get();
+    pending_partitions_.pop_front();
+    DeduplicatePartition(deduplicated_partitions_++);
+  }
+
+  /**
+   * Replace the states of a compiled partition that are equal to a state of an earlier partition.
+   *
+   * The states of a partition are visited children first, so the children of a state are replaced before the state
+   * gets compared. Like in sequential generation a replaced state passes its weight on if it is higher.
+   */
+  void DeduplicatePartition(size_t partition_index) {
+    partition_t* partition = partitions_[partition_index].get();
+
+    for (uint32_t state = 0; state < partition->GetNumberOfCompiledStates(); ++state) {
+      if (!partition->IsMinimizable(state)) {
+        continue;
+      }
+
+      ++minimization_lookups_;
+      const uint64_t global_state = partition_t::GetGlobalState(partition_index, state);
+      const uint64_t canonical_state = FindOrAddCanonicalState(global_state, partition->GetCanonicalHashcode(state));
+      if (canonical_state != global_state) {
+        ++minimization_hits_;
+        partition->SetCanonicalState(state, canonical_state);
+        partitions_[partition_t::GetPartitionIndex(canonical_state)]->UpdateStateWeightIfHigher(
+            partition_t::GetLocalState(canonical_state), partition->GetStateWeight(state));
+      }
+    }
+  }
+
+  /**
+   * Find a state equal to the given state in the table of canonical states, the state gets added if there is none.
+   *
+   * The table uses open addressing with linear probing, it is kept at most half full.
+   *
+   * @return the equal state or the given state if it got added
+   */
+  uint64_t FindOrAddCanonicalState(uint64_t global_state, uint64_t hashcode) {
+    if ((number_of_canonical_states_ + 1) * 2 > canonical_states_.size()) {
+      GrowCanonicalStates();
+    }
+
+    const size_t mask = canonical_states_.size() - 1;
+    for (size_t slot = GetCanonicalStateSlot(hashcode);; slot = (slot + 1) & mask) {
+      CanonicalStateSlot& canonical_state = canonical_states_[slot];
+
+      if (canonical_state.state_plus_one == 0) {
+        canonical_state = {hashcode, global_state + 1};
+        ++number_of_canonical_states_;
+        return global_state;
+      }
+
+      const uint64_t other_state = canonical_state.state_plus_one - 1;
+      if (canonical_state.hashcode == hashcode &&
+          partitions_[partition_t::GetPartitionIndex(other_state)]->IsCanonicalEqual(
+              partition_t::GetLocalState(other_state), *partitions_[partition_t::GetPartitionIndex(global_state)],
+              partition_t::GetLocalState(global_state))) {
+        return other_state;
+      }
+    }
+  }
+
+  void GrowCanonicalStates() {
+    canonical_states_bits_ = std::max(CANONICAL_STATES_MIN_BITS, canonical_states_bits_ + 1);
+    std::vector<CanonicalStateSlot> old_canonical_states(size_t(1) << canonical_states_bits_);
+    old_canonical_states.swap(canonical_states_);
+
+    const size_t mask = canonical_states_.size() - 1;
+    for (const auto& canonical_state : old_canonical_states) {
+      if (canonical_state.state_plus_one != 0) {
+        size_t slot = GetCanonicalStateSlot(canonical_state.hashcode);
+        while (canonical_states_[slot].state_plus_one != 0) {
+          slot = (slot + 1) & mask;
+        }
+        canonical_states_[slot] = canonical_state;
+      }
+    }
+  }
+
+  // fibonacci hashing, the hashcodes of states with few transitions are not well distributed in the lower bits
+  size_t GetCanonicalStateSlot(uint64_t hashcode) const {
+    return static_cast<size_t>((hashcode * 0x9E3779B97F4A7C15ULL) >> (64 - canonical_states_bits_));
+  }
+
+  /**
+   * Wait for all partitions, pack them and write the root state after the last partition.
+   *
+   * The partitions are compiled in parallel into state graphs and deduplicated in order as they finish, so suffixes
+   * shared across partitions are minimized. Afterwards the partitions are packed in parallel into relocatable sparse
+   * arrays, partition i is placed at the sum of the sizes of all previous partitions (plus gaps). Only the transitions
+   * to states of other partitions are rewritten, once all positions are known.
+   */
+  void ClosePartitions() {
+    if (!partitions_.empty()) {
+      partitions_.back()->CloseFeeding();
+    }
+    while (!pending_partitions_.empty()) {
+      WaitForOldestPartition();
+    }
+
+    // free the hashtable before packing
+    std::vector<CanonicalStateSlot>().swap(canonical_states_);
+    number_of_canonical_states_ = 0;
+
+    if (partitions_.empty()) {
+      // empty dictionaries have start_state_ = 1 for backwards compatibility
+      start_state_ = 1;
+      return;
+    }
+
+    for (const auto& partition : partitions_) {
+      if (pending_partitions_.size() >= generator_threads_) {
+        pending_partitions_.front().get();
+        pending_partitions_.pop_front();
+      }
+
+      partition_t* p = partition.get();
+      pending_partitions_.push_back(std::async(std::launch::async, [p]() { p->Pack(); }));
+    }
+    while (!pending_partitions_.empty()) {
+      pending_partitions_.front().get();
+      pending_partitions_.pop_front();
+    }
+
+    std::vector<uint64_t> partition_offsets;
+    uint64_t partition_offset = 0;
+    for (const auto& partition : partitions_) {
+      partition_offsets.push_back(partition_offset);
+      partition_offset += partition->GetSize() + PARTITION_GAP;
+    }
+
+    auto resolve = [this, &partition_offsets](uint64_t global_state) {
+      const size_t partition_index = partition_t::GetPartitionIndex(global_state);
+      return partition_offsets[partition_index] +
+             partitions_[partition_index]->GetPackedState(partition_t::GetLocalState(global_state));
+    };
+
+    for (const auto& partition : partitions_) {
+      partition->ResolveExternalTransitions(resolve);
+    }
+
+    // the root gets its own gap inside the root persistence
+    const size_t root_local_offset = PARTITION_GAP;
+    const uint64_t root_offset = partition_offset + root_local_offset;
+
+    persistence_->BeginNewState(root_local_offset);
+
+    uint32_t root_weight = 0;
+    size_t overflow_bucket = root_local_offset + MAX_TRANSITIONS_OF_A_STATE;
+    bool has_zerobyte_transition = false;
+    number_of_states_ = 1;
+
+    for (const auto& partition : partitions_) {
+      const unsigned char label = partition->GetLabel();
+      const uint64_t child = resolve(partition->GetCanonicalStartState());
+      const uint64_t difference = root_offset + label + COMPACT_SIZE_WINDOW - child;
+
+      if (difference < COMPACT_SIZE_RELATIVE_MAX_VALUE) {
+        persistence_->WriteTransition(root_local_offset + label, label, static_cast<uint16_t>(difference));
+      } else {
+        // relative overflow coding, the extra buckets are placed behind the root state
+        uint16_t vshort_pointer[8];
+        size_t vshort_size = 0;
+        keyvi::util::encodeVarShort(difference >> 3, vshort_pointer, &vshort_size);
+        for (size_t i = 0; i < vshort_size; ++i) {
+          persistence_->WriteTransition(overflow_bucket + i, 0, vshort_pointer[i]);
+        }
+
+        const size_t overflow_bucket_pointer = COMPACT_SIZE_WINDOW + overflow_bucket - (root_local_offset + label);
+        persistence_->WriteTransition(
+            root_local_offset + label, label,
+            static_cast<uint16_t>(0x8000 | 0x8 | (overflow_bucket_pointer << 4) | (difference & 0x7)));
+        overflow_bucket += vshort_size;
+      }
+
+      has_zerobyte_transition |= label == 0;
+      root_weight = std::max(root_weight, partition->GetWeight());
+      number_of_states_ += partition->GetNumberOfStates();
+      minimization_lookups_ += partition->GetNumberOfMinimizationLookups();
+      minimization_hits_ += partition->GetNumberOfMinimizationHits();
+    }
+
+    if (!has_zerobyte_transition) {
+      // scramble the zero byte to avoid a ghost transition
+      persistence_->WriteTransition(root_local_offset, 0xff, 0);
+    }
+
+    if (root_weight > 0) {
+      persistence_->WriteTransition(
+          root_local_offset + INNER_WEIGHT_TRANSITION_COMPACT, 0,
+          static_cast<uint16_t>(std::min<size_t>(root_weight, COMPACT_SIZE_INNER_WEIGHT_MAX_VALUE)));
+    }
+
+    start_state_ = static_cast<OffsetTypeT>(root_offset);
+    TRACE("wrote stitched start state at %d", start_state_);
+  }
 
   inline void FeedStack(const size_t start, const std::string& key) {
     for (size_t i = start; i < key.size(); ++i) {
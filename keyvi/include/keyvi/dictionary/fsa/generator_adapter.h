@@ -53,6 +53,11 @@ class GeneratorAdapterInterface {
   virtual void Add(const std::string& input_key, ValueT value) {}
   virtual void Add(const std::string& input_key, const fsa::ValueHandle& value) {}
 
+  virtual void ReuseSparseArray(const unsigned char* labels, const uint16_t* transitions, size_t size,
+                                uint64_t number_of_states) {}
+  virtual void AddSubtree(const std::string& prefix, uint64_t state, uint32_t weight) {}
+  virtual void AddNumberOfKeys(uint64_t number_of_keys) {}
+
   virtual size_t GetFsaSize() const { return 0; }
   virtual void CloseFeeding() {}
   virtual void Write(std::ostream& stream) {}
@@ -76,6 +81,17 @@ class GeneratorAdapter final : public GeneratorAdapterInterface<typename ValueSt
 
   void Add(const std::string& input_key, const fsa::ValueHandle& value) { generator_.Add(std::move(input_key), value); }
 
+  void ReuseSparseArray(const unsigned char* labels, const uint16_t* transitions, size_t size,
+                        uint64_t number_of_states) {
+    generator_.ReuseSparseArray(labels, transitions, size, number_of_states);
+  }
+
+  void AddSubtree(const std::string& prefix, uint64_t state, uint32_t weight) {
+    generator_.AddSubtree(prefix, state, weight);
+  }
+
+  void AddNumberOfKeys(uint64_t number_of_keys) { generator_.AddNumberOfKeys(number_of_keys); }
+
   size_t GetFsaSize() const { return generator_.GetFsaSize(); }
 
   void CloseFeeding() { generator_.CloseFeeding(); }
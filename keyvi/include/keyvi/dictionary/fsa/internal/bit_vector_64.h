@@ -214,22 +214,23 @@ struct BitVector final {
     size_t byte_position = start_bit >> 6;
     const size_t length_to_check = std::min(other.bits_.size(), bits_.size() - byte_position);
     const size_t bit_position = start_bit & 63;
+    int shifts = 0;
 
+    // every word gives a lower bound for the shift, checking all words allows to jump further
     for (size_t i = 0; i < length_to_check; ++i) {
       const uint64_t b = other.bits_[i];
       if (b != 0) {
         const uint64_t a = GetUnderlyingIntegerAtPosition(byte_position, bit_position);
 
         if ((a & b) != 0) {
-          // shift until it fits
-          return GetMinimumNumberOfShifts(b, a);
+          shifts = std::max(shifts, GetMinimumNumberOfShifts(b, a));
         }
       }
 
       ++byte_position;
     }
 
-    return 0;
+    return shifts;
   }
 
   /***
@@ -252,12 +253,26 @@ struct BitVector final {
 
   inline int Position(uint64_t number) const { return __builtin_ffsll(number) - 1; }
 
+  /**
+   * Get the minimum number of shifts of a, so that a and b are disjoint. Instead of shifting bit by bit, the run of
+   * set bits in a starting at the lowest collision is skipped in one step (count trailing zeros).
+   */
   inline int GetMinimumNumberOfShifts(uint64_t b, uint64_t a) const {
-    int shifts = 1;
-    a = a >> 1;
-    while ((a & b) != 0) {
-      a = a >> 1;
-      ++shifts;
+    int shifts = 0;
+    uint64_t shifted = a;
+    uint64_t collisions = a & b;
+
+    while (collisions != 0) {
+      const int first_collision = __builtin_ctzll(collisions);
+      const uint64_t free_bits = ~(shifted >> first_collision);
+      shifts += free_bits != 0 ? __builtin_ctzll(free_bits) : 64;
+
+      if (shifts >= 64) {
+        return shifts;
+      }
+
+      shifted = a >> shifts;
+      collisions = shifted & b;
     }
 
     return shifts;
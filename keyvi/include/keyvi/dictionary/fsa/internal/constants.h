@@ -37,7 +37,10 @@ static const size_t KEYVI_FILE_MAGIC_LEN = 8;
 // min version of the file format
 static const uint64_t KEYVI_FILE_VERSION_MIN = 2;
 // max version of the file format supported
-static const uint64_t KEYVI_FILE_VERSION_MAX = 3;
+static const uint64_t KEYVI_FILE_VERSION_MAX = 4;
+
+// min version of the file format for values compressed with a (trained or predictive) dictionary
+static const uint64_t KEYVI_FILE_VERSION_COMPRESSION_DICTIONARIES = 4;
 
 // min version of the persistence part
 static const int KEYVI_FILE_PERSISTENCE_VERSION_MIN = 2;
@@ -53,6 +56,9 @@ static const size_t COMPACT_SIZE_ABSOLUTE_MAX_VALUE = 16384;
 static const size_t COMPACT_SIZE_WINDOW = 512;
 static const size_t COMPACT_SIZE_INNER_WEIGHT_MAX_VALUE = 0xffff;
 
+// states at this depth or deeper do not get an inner weight
+static const int INNER_WEIGHT_CUT_OFF_DEPTH = 30;
+
 // how many buckets to go left doing (brute force) search for free buckets in
 // the sparse array where the new state fits in
 static const size_t SPARSE_ARRAY_SEARCH_OFFSET = 151;
@@ -68,6 +74,26 @@ static const size_t DEFAULT_MEMORY_LIMIT_VALUE_STORE = 500 * 1024 * 1024;
 
 static const size_t DEFAULT_PARALLEL_SORT_THRESHOLD = 10000;
 
+// number of threads the dictionary compiler uses for building chunks and merging, 1 compiles on the calling thread
+static const size_t DEFAULT_COMPILE_THREADS = 1;
+
+// number of threads the generator uses for building partitions (keys sharing the 1st byte), 1 disables partitioning.
+// The output is as small as a sequential one, but the state graphs of all partitions are kept in memory until the last
+// partition is done, outside of the memory limit.
+static const size_t DEFAULT_GENERATOR_THREADS = 1;
+
+// number of threads the dictionary compiler uses for encoding and compressing json values, 1 encodes inline
+static const size_t DEFAULT_VALUE_STORE_THREADS = 1;
+
+// maximum size of a trained zstd dictionary for json values
+static const size_t DEFAULT_COMPRESSION_DICTIONARY_SIZE = 64 * 1024;
+
+// size of the values sampled for training a zstd dictionary, as multiple of the dictionary size
+static const size_t DEFAULT_COMPRESSION_DICTIONARY_SAMPLES_FACTOR = 100;
+
+// number of keys walked in lock-step by batched lookups, the lookups interleave to hide memory latency
+static const size_t BATCH_LOOKUP_INTERLEAVE_WIDTH = 16;
+
 // default for vector values
 static const size_t DEFAULT_VECTOR_SIZE = 10;
 
@@ -76,12 +102,21 @@ static const char MEMORY_LIMIT_KEY[] = "memory_limit";
 static const char TEMPORARY_PATH_KEY[] = "temporary_path";
 static const char COMPRESSION_KEY[] = "compression";
 static const char COMPRESSION_THRESHOLD_KEY[] = "compression_threshold";
+static const char COMPRESSION_DICTIONARY_SIZE_KEY[] = "compression_dictionary_size";
+static const char COMPRESSION_DICTIONARY_SAMPLES_KEY[] = "compression_dictionary_samples";
+static const char COMPRESSION_MODEL_KEY[] = "compression_model";
 static const char MINIMIZATION_KEY[] = "minimization";
+// write the final dictionary bypassing the page cache, off by default as it evicts pages that might get read next
+static const char DIRECT_IO_KEY[] = "direct_io";
 static const char SINGLE_PRECISION_FLOAT_KEY[] = "floating_point_precision";
 static const char PARALLEL_SORT_THRESHOLD_KEY[] = "parallel_sort_threshold";
+static const char COMPILE_THREADS_KEY[] = "compile_threads";
+static const char GENERATOR_THREADS_KEY[] = "generator_threads";
+static const char VALUE_STORE_THREADS_KEY[] = "value_store_threads";
 static const char VECTOR_SIZE_KEY[] = "vector_size";
 static const char MERGE_MODE[] = "merge_mode";
 static const char MERGE_APPEND[] = "append";
+static const char MERGE_STRUCTURAL[] = "structural";
 
 // constants for specialized dictionaries
 static const char SECONDARY_KEY_DICT_KEYS_PROPERTY[] = "secondary_keys";
@@ -421,6 +421,23 @@ class FloatVectorValueStoreReader final : public IValueStoreReader {
     return compressor->CompressWithoutHeader(msgpacked_value);
   }
 
+  const float* GetFloatVector(uint64_t fsa_value, size_t* dimensions, std::vector<float>* buffer) const override {
+    size_t value_size;
+    const char* value_ptr = keyvi::util::decodeVarIntString(strings_ + fsa_value, &value_size);
+
+#ifdef KEYVI_LITTLE_ENDIAN
+    // uncompressed values are used in place
+    if (value_size > 0 && value_ptr[0] == compression::CompressionAlgorithm::NO_COMPRESSION) {
+      *dimensions = (value_size - 1) / sizeof(float);
+      return reinterpret_cast<const float*>(value_ptr + 1);
+    }
+#endif
+
+    *buffer = keyvi::util::DecodeFloatVector(std::string(value_ptr, value_size));
+    *dimensions = buffer->size();
+    return buffer->data();
+  }
+
   void CheckCompatibility(const IValueStoreReader& other) override {
     if (other.GetValueStoreType() != GetValueStoreType()) {
       throw std::invalid_argument("Dictionaries must have the same value store type");
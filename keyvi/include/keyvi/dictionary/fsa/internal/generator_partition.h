@@ -0,0 +1,532 @@
+/* * keyvi - A key value store.
+ *
+ * Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * generator_partition.h
+ */
+
+#ifndef KEYVI_DICTIONARY_FSA_INTERNAL_GENERATOR_PARTITION_H_
+#define KEYVI_DICTIONARY_FSA_INTERNAL_GENERATOR_PARTITION_H_
+
+#include <algorithm>
+#include <condition_variable>  // NOLINT
+#include <memory>
+#include <mutex>  // NOLINT
+#include <ostream>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "keyvi/dictionary/fsa/internal/constants.h"
+#include "keyvi/dictionary/fsa/internal/lru_generation_cache.h"
+#include "keyvi/dictionary/fsa/internal/packed_state.h"
+#include "keyvi/dictionary/fsa/internal/sparse_array_builder.h"
+#include "keyvi/dictionary/fsa/internal/unpacked_state.h"
+#include "keyvi/dictionary/fsa/internal/unpacked_state_stack.h"
+
+// #define ENABLE_TRACING
+#include "keyvi/dictionary/util/trace.h"
+
+namespace keyvi {
+namespace dictionary {
+namespace fsa {
+namespace internal {
+
+/**
+ * A partition of the key space sharing the same first byte, used for partitioned generation.
+ *
+ * Keys (without the first byte) are handed over to Compile() through a buffer, Compile() runs on a separate thread and
+ * builds a minimized state graph of the partition in memory. The buffer is bounded: if it holds more than a quarter of
+ * the memory limit, Add() blocks until Compile() consumed entries.
+ *
+ * Once a partition is compiled, the generator finds the states that are equal to a state of an earlier partition
+ * (suffixes shared across partitions) and marks them with SetCanonicalState. Pack() then writes only the remaining
+ * states into a relocatable sparse array, transitions to states of other partitions are written as external
+ * transitions and resolved with ResolveExternalTransitions, after all partitions got their final position.
+ *
+ * States are identified across partitions by the index of the partition and the id of the state in the graph, see
+ * GetGlobalState.
+ */
+template <class PersistenceT, class OffsetTypeT = uint32_t, class HashCodeTypeT = int32_t,
+          class MinimizationCacheT = LeastRecentlyUsedGenerationsCache<PackedState<OffsetTypeT, HashCodeTypeT>>>
+class GeneratorPartition final {
+ public:
+  GeneratorPartition(unsigned char label, size_t index, size_t memory_limit,
+                     const boost::filesystem::path& temporary_path, bool inner_weight, bool minimize)
+      : label_(label),
+        index_(index),
+        memory_limit_(memory_limit),
+        buffer_limit_(memory_limit / 4),
+        temporary_path_(temporary_path),
+        inner_weight_(inner_weight),
+        minimize_(minimize) {}
+
+  GeneratorPartition& operator=(GeneratorPartition const&) = delete;
+  GeneratorPartition(const GeneratorPartition& that) = delete;
+
+  /**
+   * Add a key, keys must be added in sorted order. Blocks if the buffer is full.
+   *
+   * @param suffix the key without the first byte
+   */
+  void Add(std::string&& suffix, uint64_t value_idx, uint32_t weight, bool no_minimization) {
+    const size_t entry_size = sizeof(Entry) + suffix.size();
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // an entry that is larger than the buffer is accepted if the buffer is empty
+    if (buffered_bytes_ + entry_size > buffer_limit_ && buffered_bytes_ > 0) {
+      condition_.wait(lock, [this, entry_size] {
+        return buffered_bytes_ + entry_size <= buffer_limit_ || buffered_bytes_ == 0 || failed_;
+      });
+    }
+
+    if (failed_) {
+      // the error is reported by Compile
+      return;
+    }
+
+    weight_ = std::max(weight_, weight);
+    key_bytes_ += suffix.size() + 1;
+    buffered_bytes_ += entry_size;
+    entries_.push_back({std::move(suffix), value_idx, weight, no_minimization});
+    condition_.notify_all();
+  }
+
+  /**
+   * Signal that all keys have been added.
+   */
+  void CloseFeeding() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    condition_.notify_all();
+  }
+
+  /**
+   * Build the state graph for this partition, consumes the keys until CloseFeeding got called.
+   */
+  void Compile() {
+    try {
+      CompileEntries();
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      failed_ = true;
+      std::vector<Entry>().swap(entries_);
+      buffered_bytes_ = 0;
+      condition_.notify_all();
+      throw;
+    }
+  }
+
+  /**
+   * Write the states that are not part of another partition into the sparse array of this partition, available after
+   * the canonical states have been set. Frees the state graph.
+   */
+  void Pack() {
+    // small partitions do not need the full memory limit, the persistence pre-allocates its buffers
+    const size_t memory_limit = std::min(memory_limit_, std::max(MIN_MEMORY_LIMIT, key_bytes_ * 64));
+    persistence_.reset(new PersistenceT(memory_limit, temporary_path_));
+
+    // the states are unique already, the builder does not need to minimize
+    builder_t builder(MIN_MEMORY_LIMIT, persistence_.get(), inner_weight_, false, true);
+    UnpackedState<PersistenceT> unpacked_state(persistence_.get());
+    packed_states_.resize(states_.size());
+
+    for (uint32_t i = 0; i < states_.size(); ++i) {
+      if (canonical_states_[i] != GetGlobalState(index_, i)) {
+        continue;
+      }
+
+      const State& state = states_[i];
+      unpacked_state.Clear();
+
+      // the final transition comes first, like in the stack
+      if (state.final) {
+        unpacked_state.AddFinalState(state.final_value);
+      }
+
+      for (size_t t = state.first_transition; t < state.first_transition + state.number_of_transitions; ++t) {
+        const uint64_t target = canonical_states_[transitions_[t].target];
+
+        if (GetPartitionIndex(target) == index_) {
+          unpacked_state.Add(transitions_[t].label, packed_states_[GetLocalState(target)]);
+        } else {
+          unpacked_state.Add(transitions_[t].label, builder_t::EXTERNAL_TRANSITION | target);
+        }
+      }
+
+      if (state.weight > 0) {
+        unpacked_state.UpdateWeightIfHigher(state.weight);
+      }
+
+      // skip the lookup in the minimization cache
+      unpacked_state.IncrementNoMinimizationCounter();
+      packed_states_[i] = builder.PersistState(&unpacked_state);
+    }
+
+    number_of_states_ = builder.GetNumberOfStates();
+    canonical_start_state_ = canonical_states_[start_state_];
+    external_transitions_ = builder.GetExternalTransitions();
+
+    TRACE("partition %d: packed %d states, %d external transitions", label_, number_of_states_,
+          external_transitions_.size());
+
+    std::vector<State>().swap(states_);
+    std::vector<Transition>().swap(transitions_);
+    std::vector<uint64_t>().swap(canonical_states_);
+    persistence_->Flush();
+  }
+
+  /**
+   * Write the targets of the transitions to states of other partitions.
+   *
+   * @param resolve returns the absolute position of a (global) state in the final sparse array
+   */
+  template <class ResolverT>
+  void ResolveExternalTransitions(ResolverT resolve) {
+    for (const auto& external_transition : external_transitions_) {
+      builder_t::ResolveExternalTransition(persistence_.get(), external_transition, resolve(external_transition.target));
+    }
+    std::vector<typename builder_t::ExternalTransition>().swap(external_transitions_);
+  }
+
+  /**
+   * Identify a state across partitions.
+   */
+  static uint64_t GetGlobalState(size_t partition_index, uint32_t state) {
+    return (static_cast<uint64_t>(partition_index) << 32) | state;
+  }
+
+  static size_t GetPartitionIndex(uint64_t global_state) { return static_cast<size_t>(global_state >> 32); }
+
+  static uint32_t GetLocalState(uint64_t global_state) { return static_cast<uint32_t>(global_state); }
+
+  unsigned char GetLabel() const { return label_; }
+
+  uint32_t GetWeight() const { return weight_; }
+
+  /**
+   * The (global) state replacing the start state, available after Pack().
+   */
+  uint64_t GetCanonicalStartState() const { return canonical_start_state_; }
+
+  /**
+   * Number of states in the state graph, available after Compile().
+   */
+  uint32_t GetNumberOfCompiledStates() const { return static_cast<uint32_t>(states_.size()); }
+
+  /**
+   * Whether the state can be replaced by an equal state of another partition.
+   */
+  bool IsMinimizable(uint32_t state) const { return !states_[state].no_minimization; }
+
+  /**
+   * Hash of the state, computed from the hashes of its children when compiling, so equal states of different
+   * partitions get the same hash.
+   */
+  uint64_t GetCanonicalHashcode(uint32_t state) const { return states_[state].hashcode; }
+
+  /**
+   * Compare states of 2 partitions, transitions are compared by their canonical target.
+   */
+  bool IsCanonicalEqual(uint32_t state, const GeneratorPartition& other, uint32_t other_state) const {
+    return IsEqual(state, other, other_state, true);
+  }
+
+  /**
+   * Replace the state by an equal state, the state does not get packed.
+   *
+   * @param state the state
+   * @param canonical_state the (global) state replacing it
+   */
+  void SetCanonicalState(uint32_t state, uint64_t canonical_state) { canonical_states_[state] = canonical_state; }
+
+  uint32_t GetStateWeight(uint32_t state) const { return states_[state].weight; }
+
+  void UpdateStateWeightIfHigher(uint32_t state, uint32_t weight) {
+    states_[state].weight = std::max(states_[state].weight, weight);
+  }
+
+  /**
+   * Position of a state in the sparse array of this partition, available after Pack().
+   */
+  OffsetTypeT GetPackedState(uint32_t state) const { return packed_states_[state]; }
+
+  uint64_t GetNumberOfStates() const { return number_of_states_; }
+
+  uint64_t GetNumberOfMinimizationLookups() const { return minimization_lookups_; }
+
+  uint64_t GetNumberOfMinimizationHits() const { return minimization_hits_; }
+
+  uint64_t GetSize() const { return persistence_->GetSize(); }
+
+  void WriteLabels(std::ostream& stream) { persistence_->WriteLabels(stream); }
+
+  void WriteTransitions(std::ostream& stream) { persistence_->WriteTransitions(stream); }
+
+ private:
+  typedef SparseArrayBuilder<PersistenceT, OffsetTypeT, HashCodeTypeT, MinimizationCacheT> builder_t;
+
+  static constexpr size_t MIN_MEMORY_LIMIT = 4 * 1024 * 1024;
+
+  // number of consumed entries after which the buffer space gets released
+  static constexpr size_t RELEASE_INTERVAL = 4096;
+
+  struct Entry {
+    std::string suffix;
+    uint64_t value_idx;
+    uint32_t weight;
+    bool no_minimization;
+  };
+
+  struct State {
+    uint64_t final_value;
+    uint64_t hashcode;
+    size_t first_transition;
+    uint32_t weight;
+    uint16_t number_of_transitions;
+    bool final;
+    bool no_minimization;
+  };
+
+  struct Transition {
+    uint32_t label;
+    uint32_t target;
+  };
+
+  struct StateHash {
+    const GeneratorPartition* partition;
+
+    size_t operator()(uint32_t state) const { return static_cast<size_t>(partition->states_[state].hashcode); }
+  };
+
+  struct StateEqual {
+    const GeneratorPartition* partition;
+
+    bool operator()(uint32_t state, uint32_t other_state) const {
+      return partition->IsEqual(state, *partition, other_state, false);
+    }
+  };
+
+  unsigned char label_;
+  size_t index_;
+  size_t memory_limit_;
+  size_t buffer_limit_;
+  boost::filesystem::path temporary_path_;
+  bool inner_weight_;
+  bool minimize_;
+  uint32_t weight_ = 0;
+  size_t key_bytes_ = 0;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::vector<Entry> entries_;
+  size_t buffered_bytes_ = 0;
+  bool closed_ = false;
+  bool failed_ = false;
+  std::vector<State> states_;
+  std::vector<Transition> transitions_;
+  std::vector<uint64_t> canonical_states_;
+  std::vector<OffsetTypeT> packed_states_;
+  std::vector<typename builder_t::ExternalTransition> external_transitions_;
+  std::unique_ptr<PersistenceT> persistence_;
+  uint32_t start_state_ = 0;
+  uint64_t canonical_start_state_ = 0;
+  uint64_t number_of_states_ = 0;
+  uint64_t minimization_lookups_ = 0;
+  uint64_t minimization_hits_ = 0;
+
+  void CompileEntries() {
+    // the stack does not compare states, so it does not need a persistence
+    // cut off weights 1 level earlier, the partition starts 1 level below the root
+    UnpackedStateStack<PersistenceT> stack(nullptr, 30, INNER_WEIGHT_CUT_OFF_DEPTH - 1);
+    std::unordered_set<uint32_t, StateHash, StateEqual> state_table(0, StateHash{this}, StateEqual{this});
+
+    std::string last_key;
+    size_t highest_stack = 0;
+    std::vector<Entry> entries;
+
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_.wait(lock, [this] { return closed_ || !entries_.empty(); });
+        if (entries_.empty()) {
+          break;
+        }
+        entries.swap(entries_);
+      }
+
+      size_t consumed_bytes = 0;
+      for (size_t i = 0; i < entries.size(); ++i) {
+        Entry& entry = entries[i];
+        const size_t common_prefix_length = GetCommonPrefixLength(last_key, entry.suffix);
+
+        ConsumeStack(common_prefix_length, &highest_stack, &stack, &state_table);
+
+        for (size_t j = common_prefix_length; j < entry.suffix.size(); ++j) {
+          stack.Insert(j, static_cast<uint32_t>(static_cast<unsigned char>(entry.suffix[j])), 0);
+        }
+        highest_stack = std::max(highest_stack, entry.suffix.size());
+
+        stack.InsertFinalState(entry.suffix.size(), entry.value_idx, entry.no_minimization);
+
+        if (entry.weight > 0) {
+          stack.UpdateWeights(0, entry.suffix.size() + 1, entry.weight);
+        }
+
+        consumed_bytes += sizeof(Entry) + entry.suffix.size();
+        last_key.swap(entry.suffix);
+        std::string().swap(entry.suffix);
+
+        if ((i + 1) % RELEASE_INTERVAL == 0 || i + 1 == entries.size()) {
+          ReleaseBuffer(consumed_bytes);
+          consumed_bytes = 0;
+        }
+      }
+      entries.clear();
+    }
+
+    ConsumeStack(0, &highest_stack, &stack, &state_table);
+    start_state_ = AddState(stack.Get(0), &state_table);
+
+    // every state represents itself, until the generator finds an equal state in an earlier partition
+    canonical_states_.resize(states_.size());
+    for (uint32_t i = 0; i < states_.size(); ++i) {
+      canonical_states_[i] = GetGlobalState(index_, i);
+    }
+
+    TRACE("partition %d: start state %d, states %d", label_, start_state_, states_.size());
+
+    std::vector<Entry>().swap(entries);
+  }
+
+  /**
+   * Add a state to the state graph, unless an equal state exists already.
+   *
+   * @return the id of the state in the graph
+   */
+  uint32_t AddState(UnpackedState<PersistenceT>* unpacked_state,
+                    std::unordered_set<uint32_t, StateHash, StateEqual>* state_table) {
+    const uint32_t id = static_cast<uint32_t>(states_.size());
+    State state{0, 0, transitions_.size(), unpacked_state->GetWeight(), 0, false,
+                !minimize_ || unpacked_state->GetNoMinimizationCounter() > 0};
+
+    for (size_t i = 0; i < unpacked_state->size(); ++i) {
+      const auto& transition = (*unpacked_state)[i];
+      if (transition.label < FINAL_OFFSET_TRANSITION) {
+        transitions_.push_back({static_cast<uint32_t>(transition.label), static_cast<uint32_t>(transition.value)});
+        ++state.number_of_transitions;
+      } else if (transition.label == FINAL_OFFSET_TRANSITION) {
+        state.final = true;
+        state.final_value = transition.value;
+      }
+    }
+    state.hashcode = GetHashcode(state);
+    states_.push_back(state);
+
+    if (state.no_minimization) {
+      return id;
+    }
+
+    ++minimization_lookups_;
+    const auto inserted = state_table->insert(id);
+    if (inserted.second) {
+      return id;
+    }
+
+    // equal state found, like the sparse array builder keep the highest weight
+    ++minimization_hits_;
+    states_.pop_back();
+    transitions_.resize(state.first_transition);
+    UpdateStateWeightIfHigher(*inserted.first, state.weight);
+
+    return *inserted.first;
+  }
+
+  // hashes the children by their hash instead of their id, equal states get the same hash in every partition
+  uint64_t GetHashcode(const State& s) const {
+    uint64_t hashcode = s.final ? s.final_value * 31 + 1 : 0;
+    hashcode = hashcode * 2 + (s.weight > 0 ? 1 : 0);
+
+    for (size_t t = s.first_transition; t < s.first_transition + s.number_of_transitions; ++t) {
+      hashcode = (hashcode ^ (states_[transitions_[t].target].hashcode * 257 + transitions_[t].label)) *
+                 0x9E3779B97F4A7C15ULL;
+      hashcode ^= hashcode >> 29;
+    }
+
+    return hashcode;
+  }
+
+  // states with and without weight are not equal, like in the sparse array builder (the hashcode differs)
+  bool IsEqual(uint32_t state, const GeneratorPartition& other, uint32_t other_state, bool canonical) const {
+    const State& s = states_[state];
+    const State& o = other.states_[other_state];
+
+    if (s.final != o.final || s.final_value != o.final_value || (s.weight > 0) != (o.weight > 0) ||
+        s.number_of_transitions != o.number_of_transitions) {
+      return false;
+    }
+
+    for (size_t i = 0; i < s.number_of_transitions; ++i) {
+      const Transition& t = transitions_[s.first_transition + i];
+      const Transition& ot = other.transitions_[o.first_transition + i];
+
+      if (t.label != ot.label) {
+        return false;
+      }
+
+      if (canonical ? canonical_states_[t.target] != other.canonical_states_[ot.target] : t.target != ot.target) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  void ReleaseBuffer(const size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffered_bytes_ -= bytes;
+    condition_.notify_all();
+  }
+
+  // unlike get_common_prefix_length, this treats the first (possibly empty) key as a new key
+  static size_t GetCommonPrefixLength(const std::string& first, const std::string& second) {
+    const auto mismatch = std::mismatch(first.begin(), first.end(), second.begin(), second.end());
+    return static_cast<size_t>(mismatch.first - first.begin());
+  }
+
+  void ConsumeStack(const size_t end, size_t* highest_stack, UnpackedStateStack<PersistenceT>* stack,
+                    std::unordered_set<uint32_t, StateHash, StateEqual>* state_table) {
+    while (*highest_stack > end) {
+      UnpackedState<PersistenceT>* unpacked_state = stack->Get(*highest_stack);
+      const uint32_t state = AddState(unpacked_state, state_table);
+
+      stack->PushTransitionPointer(*highest_stack - 1, state, unpacked_state->GetNoMinimizationCounter());
+      stack->Erase(*highest_stack);
+
+      --(*highest_stack);
+    }
+  }
+};
+
+} /* namespace internal */
+} /* namespace fsa */
+} /* namespace dictionary */
+} /* namespace keyvi */
+
+#endif  // KEYVI_DICTIONARY_FSA_INTERNAL_GENERATOR_PARTITION_H_
@@ -33,4 +33,13 @@
 #include <nmmintrin.h>
 #endif
 
+// runtime dispatch between SSE2/AVX2/AVX-512 kernels via function multiversioning (cpuid)
+#if !defined(KEYVI_DISABLE_OPTIMIZATIONS) && (defined(__x86_64__) || defined(__amd64__)) && defined(__GNUC__)
+#define KEYVI_X86_DISPATCH
+#endif
+
+#if defined(KEYVI_X86_DISPATCH)
+#include <immintrin.h>
+#endif
+
 #endif  // KEYVI_DICTIONARY_FSA_INTERNAL_INTRINSICS_H_
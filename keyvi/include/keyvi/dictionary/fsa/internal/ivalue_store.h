@@ -26,8 +26,11 @@
 #define KEYVI_DICTIONARY_FSA_INTERNAL_IVALUE_STORE_H_
 
 #include <memory>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <variant>
+#include <vector>
 
 #include <boost/container/flat_map.hpp>
 #include <boost/interprocess/file_mapping.hpp>
@@ -140,6 +143,34 @@ class IValueStoreReader {
    */
   virtual std::string GetValueAsString(uint64_t fsa_value) const = 0;
 
+  /**
+   * Get Value as string without copying it if possible.
+   *
+   * Value store implementers that hold the string in the memory mapped file should override this method.
+   *
+   * @param fsa_value
+   * @param buffer buffer for the value if it can not be returned in place
+   * @return view on the value, valid as long as the value store and the buffer are
+   */
+  virtual std::string_view GetValueAsStringView(uint64_t fsa_value, std::string* buffer) const {
+    *buffer = GetValueAsString(fsa_value);
+    return *buffer;
+  }
+
+  /**
+   * Get Value as msgpack without copying it if possible.
+   *
+   * Value store implementers that hold uncompressed msgpack in the memory mapped file should override this method.
+   *
+   * @param fsa_value
+   * @param buffer buffer for the value if it can not be returned in place, e.g. because it is compressed
+   * @return view on the msgpack'ed value, valid as long as the value store and the buffer are
+   */
+  virtual std::string_view GetMsgPackedValueView(uint64_t fsa_value, std::string* buffer) const {
+    *buffer = GetMsgPackedValueAsString(fsa_value);
+    return *buffer;
+  }
+
   /**
    * Get Weight
    *
@@ -150,6 +181,20 @@ class IValueStoreReader {
    */
   virtual uint32_t GetWeight(uint64_t fsa_value) const { return 0; }
 
+  /**
+   * Get a float vector without copying it if possible.
+   *
+   * This is only supported by value stores that store float vectors.
+   *
+   * @param fsa_value
+   * @param dimensions returns the number of dimensions
+   * @param buffer buffer for the decoded vector if the value can not be used in place
+   * @return pointer to the floats, the pointer might not be aligned
+   */
+  virtual const float* GetFloatVector(uint64_t fsa_value, size_t* dimensions, std::vector<float>* buffer) const {
+    throw std::invalid_argument("value store does not contain float vectors");
+  }
+
   /**
    * Test whether this value store is compatible to the given value store.
    * Throws if they are not compatible.
@@ -26,9 +26,14 @@
 #define KEYVI_DICTIONARY_FSA_INTERNAL_JSON_VALUE_STORE_H_
 
 #include <algorithm>
+#include <deque>
+#include <fstream>
 #include <functional>
+#include <future>  // NOLINT
 #include <memory>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "keyvi/dictionary/fsa/internal/intrinsics.h"
@@ -40,6 +45,7 @@
 #include <boost/lexical_cast.hpp>
 
 #include "keyvi/compression/compression_selector.h"
+#include "keyvi/compression/predictive_compression_strategy.h"
 #include "keyvi/dictionary/dictionary_properties.h"
 #include "keyvi/dictionary/fsa/internal/constants.h"
 #include "keyvi/dictionary/fsa/internal/ivalue_store.h"
@@ -51,6 +57,7 @@
 #include "keyvi/dictionary/fsa/internal/value_store_types.h"
 #include "keyvi/util/configuration.h"
 #include "keyvi/util/json_value.h"
+#include "keyvi/util/serialization_utils.h"
 #include "msgpack.hpp"
 
 // #define ENABLE_TRACING
@@ -84,6 +91,18 @@ class JsonValueStoreBase {
   size_t number_of_values_ = 0;
   size_t number_of_unique_values_ = 0;
   size_t values_buffer_size_ = 0;
+  // dictionaries values are compressed with, stored after the values
+  std::vector<std::string> compression_dictionaries_;
+
+  /**
+   * Add the compression dictionaries of the value store of a dictionary file, known dictionaries are skipped.
+   */
+  void ReadCompressionDictionaries(const std::string& file_name, const ValueStoreProperties& properties) {
+    for (const std::string& dictionary : compression::CompressionDictionaries::ReadFromFile(
+             file_name, properties.GetOffset() + properties.GetSize(), properties.GetCompressionDictionariesSize())) {
+      compression::CompressionDictionaries::AddUnique(dictionary, &compression_dictionaries_);
+    }
+  }
 };
 
 class JsonValueStoreMinimizationBase : public JsonValueStoreBase {
@@ -137,62 +156,131 @@ class JsonValueStore final : public JsonValueStoreMinimizationBase {
       single_precision_float_ = true;
     }
 
-    compressor_.reset(compression::compression_strategy(compressor));
+    if (compressor == "zstd_dictionary") {
+      // values are compressed with zstd until enough samples have been collected for training the dictionary
+      compressor = "zstd";
+      sample_compression_dictionary_ = true;
+      compression_dictionary_size_ =
+          keyvi::util::mapGet(parameters, COMPRESSION_DICTIONARY_SIZE_KEY, DEFAULT_COMPRESSION_DICTIONARY_SIZE);
+      compression_dictionary_samples_size_ =
+          keyvi::util::mapGet(parameters, COMPRESSION_DICTIONARY_SAMPLES_KEY,
+                              DEFAULT_COMPRESSION_DICTIONARY_SAMPLES_FACTOR * compression_dictionary_size_);
+    }
+
+    if (compressor == "predictive") {
+      // the model is stored like a dictionary
+      predictive_compression_model_ = compression::LoadPredictiveCompressionModel(
+          keyvi::util::mapGet<std::string>(parameters, COMPRESSION_MODEL_KEY, {}));
+      compression_dictionaries_.push_back(
+          static_cast<char>(compression::PREDICTIVE_COMPRESSION) +
+          compression::PredictiveCompressionStrategy::SerializeModel(*predictive_compression_model_));
+    }
+
+    compressor_name_ = compressor;
+    compressor_.reset(CreateCompressor());
     raw_compressor_.reset(compression::compression_strategy("raw"));
+    // the compressor gets replaced once a dictionary has been trained
+    long_compress_ = [this](compression::buffer_t* buffer, const char* raw, size_t raw_size) {
+      compressor_->Compress(buffer, raw, raw_size);
+    };
     // This is beyond ugly, but needed for EncodeJsonValue :(
-    long_compress_ = std::bind(static_cast<compression::compress_mem_fn_t>(&compression::CompressionStrategy::Compress),
-                               compressor_.get(), std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
     short_compress_ =
         std::bind(static_cast<compression::compress_mem_fn_t>(&compression::CompressionStrategy::Compress),
                   raw_compressor_.get(), std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
   }
 
+  /**
+   * Encode and compress values on the given number of threads while values are added. Values are still deduplicated
+   * and stored in the order they have been added, the result is the same as encoding inline.
+   *
+   * In this mode AddValue returns a ticket instead of the offset of the value, it must be translated with ResolveValue
+   * after CloseFeeding. Must be called before adding values.
+   *
+   * @param threads number of encoding threads, 1 encodes inline
+   */
+  void SetEncodingThreads(size_t threads) {
+    encoders_.clear();
+    for (size_t i = 0; threads > 1 && i < threads; ++i) {
+      encoders_.emplace_back(new Encoder(CreateCompressor(), single_precision_float_, compression_threshold_));
+    }
+  }
+
   /**
    * Simple implementation of a value store for json values:
    * todo: performance improvements?
    */
   uint64_t AddValue(const value_t& value, bool* no_minimization) {
+    if (!encoders_.empty() && !sample_compression_dictionary_) {
+      return AddValueToBatch(value);
+    }
+
     keyvi::util::EncodeJsonValue(long_compress_, short_compress_, &msgpack_buffer_, &string_buffer_, value,
                                  single_precision_float_, compression_threshold_);
 
-    ++number_of_values_;
+    if (sample_compression_dictionary_ && msgpack_buffer_.size() > compression_threshold_) {
+      AddCompressionDictionarySample();
+    }
 
-    if (!minimize_) {
-      TRACE("Minimization is turned off.");
-      *no_minimization = true;
-      return CreateNewValue();
+    ++number_of_values_;
+    if (encoders_.empty()) {
+      return StoreValue(string_buffer_, no_minimization);
     }
 
-    const RawPointerForCompare<MemoryMapManager> stp(string_buffer_.data(), string_buffer_.size(),
-                                                     values_extern_.get());
-    const RawPointer<> p = hash_.Get(stp);
+    // sampled inline, resolved like the values encoded by the encoding threads
+    bool new_value = false;
+    resolved_offsets_.push_back(StoreValue(string_buffer_, &new_value));
+    resolved_no_minimization_.push_back(new_value);
+    return number_of_values_ - 1;
+  }
 
-    if (!p.IsEmpty()) {
-      // found the same value again, minimize
-      TRACE("Minimized value");
-      return p.GetOffset();
-    }  // else persist string value
+  /**
+   * Translate the return value of AddValue into the offset of the value, only needed with encoding threads.
+   *
+   * @param value_idx the return value of AddValue
+   * @param no_minimization set to true if the value has been new, untouched without encoding threads
+   * @return the offset of the value
+   */
+  uint64_t ResolveValue(uint64_t value_idx, bool* no_minimization) const {
+    if (encoders_.empty()) {
+      return value_idx;
+    }
 
-    *no_minimization = true;
-    TRACE("New unique value");
-    ++number_of_unique_values_;
+    *no_minimization = resolved_no_minimization_[value_idx];
+    return resolved_offsets_[value_idx];
+  }
 
-    uint64_t pt = CreateNewValue();
+  /**
+   * Close the value store, so no more updates;
+   */
+  void CloseFeeding() {
+    if (sample_compression_dictionary_) {
+      // too few samples for training, the values have been compressed without a dictionary
+      sample_compression_dictionary_ = false;
+      std::string().swap(compression_dictionary_samples_);
+      std::vector<size_t>().swap(compression_dictionary_sample_sizes_);
+    }
 
-    TRACE("add value to hash at %d, length %d", pt, string_buffer_.size());
-    hash_.Add(RawPointer<>(pt, stp.GetHashcode(), string_buffer_.size()));
+    if (current_batch_) {
+      SubmitBatch();
+    }
 
-    return pt;
+    while (!pending_batches_.empty()) {
+      StoreBatch();
+    }
+
+    JsonValueStoreMinimizationBase::CloseFeeding();
   }
 
   void Write(std::ostream& stream) {
+    const std::string packed_dictionaries = compression::CompressionDictionaries::Pack(compression_dictionaries_);
     ValueStoreProperties properties(0, values_buffer_size_, number_of_values_, number_of_unique_values_,
-                                    compressor_->name());
+                                    compressor_->name(), packed_dictionaries.size());
 
     properties.WriteAsJsonV2(stream);
     TRACE("Wrote JSON header, stream at %d", stream.tellp());
 
     values_extern_->Write(stream, values_buffer_size_);
+    stream.write(packed_dictionaries.data(), packed_dictionaries.size());
   }
 
   uint64_t GetFileVersionMin() const { return compressor_->GetFileVersionMin(); }
@@ -210,21 +298,188 @@ class JsonValueStore final : public JsonValueStoreMinimizationBase {
   size_t compression_threshold_;
   bool minimize_ = true;
 
+  // training of a zstd dictionary from the msgpack'ed values that get compressed
+  bool sample_compression_dictionary_ = false;
+  size_t compression_dictionary_size_ = 0;
+  size_t compression_dictionary_samples_size_ = 0;
+  std::string compression_dictionary_samples_;
+  std::vector<size_t> compression_dictionary_sample_sizes_;
+
   compression::buffer_t string_buffer_;
   msgpack::sbuffer msgpack_buffer_;
 
+  // number of values encoded by a thread at once
+  static const size_t ENCODING_BATCH_SIZE = 1024;
+
+  struct EncodingBatch {
+    std::vector<std::string> values;
+    std::vector<compression::buffer_t> encoded_values;
+    std::future<void> encoding;
+  };
+
+  /**
+   * Compressors keep state, every encoding thread gets its own.
+   */
+  struct Encoder {
+    Encoder(compression::CompressionStrategy* compressor, bool single_precision_float, size_t compression_threshold)
+        : compressor(compressor),
+          raw_compressor(compression::compression_strategy("raw")),
+          single_precision_float(single_precision_float),
+          compression_threshold(compression_threshold) {}
+
+    void Encode(EncodingBatch* batch) {
+      const auto long_compress = [this](compression::buffer_t* buffer, const char* raw, size_t raw_size) {
+        compressor->Compress(buffer, raw, raw_size);
+      };
+      const auto short_compress = [this](compression::buffer_t* buffer, const char* raw, size_t raw_size) {
+        raw_compressor->Compress(buffer, raw, raw_size);
+      };
+
+      batch->encoded_values.resize(batch->values.size());
+      for (size_t i = 0; i < batch->values.size(); ++i) {
+        keyvi::util::EncodeJsonValue(long_compress, short_compress, &msgpack_buffer, &batch->encoded_values[i],
+                                     batch->values[i], single_precision_float, compression_threshold);
+      }
+    }
+
+    std::unique_ptr<compression::CompressionStrategy> compressor;
+    std::unique_ptr<compression::CompressionStrategy> raw_compressor;
+    bool single_precision_float;
+    size_t compression_threshold;
+    msgpack::sbuffer msgpack_buffer;
+  };
+
+  std::string compressor_name_;
+  std::shared_ptr<const compression::PredictiveCompression> predictive_compression_model_;
+  std::vector<std::unique_ptr<Encoder>> encoders_;
+  std::unique_ptr<EncodingBatch> current_batch_;
+  // destructed before the encoders, waits for running encodings
+  std::deque<std::unique_ptr<EncodingBatch>> pending_batches_;
+  size_t submitted_batches_ = 0;
+  std::vector<uint64_t> resolved_offsets_;
+  std::vector<bool> resolved_no_minimization_;
+
  private:
-  uint64_t CreateNewValue() {
+  compression::CompressionStrategy* CreateCompressor() const {
+    if (predictive_compression_model_) {
+      return new compression::PredictiveCompressionStrategy(predictive_compression_model_);
+    }
+
+    return compression::compression_strategy(compressor_name_);
+  }
+
+  uint64_t StoreValue(const compression::buffer_t& buffer, bool* no_minimization) {
+    if (!minimize_) {
+      TRACE("Minimization is turned off.");
+      *no_minimization = true;
+      return CreateNewValue(buffer);
+    }
+
+    const RawPointerForCompare<MemoryMapManager> stp(buffer.data(), buffer.size(), values_extern_.get());
+    const RawPointer<> p = hash_.Get(stp);
+
+    if (!p.IsEmpty()) {
+      // found the same value again, minimize
+      TRACE("Minimized value");
+      return p.GetOffset();
+    }  // else persist string value
+
+    *no_minimization = true;
+    TRACE("New unique value");
+    ++number_of_unique_values_;
+
+    uint64_t pt = CreateNewValue(buffer);
+
+    TRACE("add value to hash at %d, length %d", pt, buffer.size());
+    hash_.Add(RawPointer<>(pt, stp.GetHashcode(), buffer.size()));
+
+    return pt;
+  }
+
+  uint64_t CreateNewValue(const compression::buffer_t& buffer) {
     uint64_t pt = static_cast<uint64_t>(values_buffer_size_);
     size_t length;
 
-    keyvi::util::encodeVarInt(string_buffer_.size(), values_extern_.get(), &length);
+    keyvi::util::encodeVarInt(buffer.size(), values_extern_.get(), &length);
     values_buffer_size_ += length;
-    values_extern_->Append(reinterpret_cast<const void*>(string_buffer_.data()), string_buffer_.size());
-    values_buffer_size_ += string_buffer_.size();
+    values_extern_->Append(reinterpret_cast<const void*>(buffer.data()), buffer.size());
+    values_buffer_size_ += buffer.size();
 
     return pt;
   }
+
+  void AddCompressionDictionarySample() {
+    compression_dictionary_samples_.append(msgpack_buffer_.data(), msgpack_buffer_.size());
+    compression_dictionary_sample_sizes_.push_back(msgpack_buffer_.size());
+
+    if (compression_dictionary_samples_.size() >= compression_dictionary_samples_size_) {
+      TrainCompressionDictionary();
+    }
+  }
+
+  void TrainCompressionDictionary() {
+    sample_compression_dictionary_ = false;
+    const std::string dictionary = compression::TrainZstdDictionary(
+        compression_dictionary_samples_, compression_dictionary_sample_sizes_, compression_dictionary_size_);
+    std::string().swap(compression_dictionary_samples_);
+    std::vector<size_t>().swap(compression_dictionary_sample_sizes_);
+
+    if (dictionary.empty()) {
+      // not trainable, stay with zstd
+      return;
+    }
+
+    compression_dictionaries_.push_back(static_cast<char>(compression::ZSTD_DICTIONARY_COMPRESSION) + dictionary);
+    compression::ZstdDictionaryCompressionStrategy* compressor =
+        new compression::ZstdDictionaryCompressionStrategy(dictionary);
+    compressor_.reset(compressor);
+
+    // no batch has been submitted yet, the encoders are idle
+    for (const auto& encoder : encoders_) {
+      encoder->compressor.reset(new compression::ZstdDictionaryCompressionStrategy(*compressor));
+    }
+  }
+
+  uint64_t AddValueToBatch(const value_t& value) {
+    if (!current_batch_) {
+      current_batch_.reset(new EncodingBatch());
+      current_batch_->values.reserve(ENCODING_BATCH_SIZE);
+    }
+
+    current_batch_->values.push_back(value);
+    if (current_batch_->values.size() == ENCODING_BATCH_SIZE) {
+      SubmitBatch();
+    }
+
+    return number_of_values_++;
+  }
+
+  void SubmitBatch() {
+    // bound the number of batches in flight, this also guarantees the encoder is not in use anymore
+    if (pending_batches_.size() == encoders_.size()) {
+      StoreBatch();
+    }
+
+    EncodingBatch* batch = current_batch_.get();
+    Encoder* encoder = encoders_[submitted_batches_++ % encoders_.size()].get();
+    batch->encoding = std::async(std::launch::async, [batch, encoder]() { encoder->Encode(batch); });
+    pending_batches_.push_back(std::move(current_batch_));
+  }
+
+  /**
+   * Store the values of the oldest batch, rethrows if encoding failed.
+   */
+  void StoreBatch() {
+    std::unique_ptr<EncodingBatch> batch = std::move(pending_batches_.front());
+    pending_batches_.pop_front();
+    batch->encoding.get();
+
+    for (const compression::buffer_t& encoded_value : batch->encoded_values) {
+      bool no_minimization = false;
+      resolved_offsets_.push_back(StoreValue(encoded_value, &no_minimization));
+      resolved_no_minimization_.push_back(no_minimization);
+    }
+  }
 };
 
 class JsonValueStoreMerge final : public JsonValueStoreMinimizationBase {
@@ -235,7 +490,10 @@ class JsonValueStoreMerge final : public JsonValueStoreMinimizationBase {
                                const keyvi::util::parameters_t& parameters = keyvi::util::parameters_t())
       : JsonValueStoreMinimizationBase(parameters) {
     for (const auto& file_name : inputFiles) {
-      file_version_min_ = std::max(file_version_min_, DictionaryProperties::FromFile(file_name).GetVersion());
+      const DictionaryProperties properties = DictionaryProperties::FromFile(file_name);
+      file_version_min_ = std::max(file_version_min_, properties.GetVersion());
+      // values are copied compressed, so the dictionaries they need are carried over
+      ReadCompressionDictionaries(file_name, properties.GetValueStoreProperties());
     }
   }
 
@@ -271,12 +529,15 @@ class JsonValueStoreMerge final : public JsonValueStoreMinimizationBase {
 
   void Write(std::ostream& stream) {
     // TODO(hendrik) write compressor
-    ValueStoreProperties properties(0, values_buffer_size_, number_of_values_, number_of_unique_values_, {});
+    const std::string packed_dictionaries = compression::CompressionDictionaries::Pack(compression_dictionaries_);
+    ValueStoreProperties properties(0, values_buffer_size_, number_of_values_, number_of_unique_values_, {},
+                                    packed_dictionaries.size());
 
     properties.WriteAsJsonV2(stream);
     TRACE("Wrote JSON header, stream at %d", stream.tellp());
 
     values_extern_->Write(stream, values_buffer_size_);
+    stream.write(packed_dictionaries.data(), packed_dictionaries.size());
   }
 
   uint64_t GetFileVersionMin() const { return file_version_min_; }
@@ -300,6 +561,7 @@ class JsonValueStoreAppendMerge final : public JsonValueStoreBase {
       number_of_unique_values_ += properties_.back().GetValueStoreProperties().GetNumberOfUniqueValues();
       values_buffer_size_ += properties_.back().GetValueStoreProperties().GetSize();
       file_version_min_ = std::max(file_version_min_, properties_.back().GetVersion());
+      ReadCompressionDictionaries(file_name, properties_.back().GetValueStoreProperties());
     }
   }
 
@@ -309,16 +571,22 @@ class JsonValueStoreAppendMerge final : public JsonValueStoreBase {
 
   void Write(std::ostream& stream) {
     // todo: preserve compression
-    ValueStoreProperties properties(0, values_buffer_size_, number_of_values_, number_of_unique_values_, {});
+    const std::string packed_dictionaries = compression::CompressionDictionaries::Pack(compression_dictionaries_);
+    ValueStoreProperties properties(0, values_buffer_size_, number_of_values_, number_of_unique_values_, {},
+                                    packed_dictionaries.size());
 
     properties.WriteAsJsonV2(stream);
     TRACE("Wrote JSON header, stream at %d", stream.tellp());
 
     for (size_t i = 0; i < input_files_.size(); ++i) {
-      std::ifstream in_stream(input_files_[i]);
+      std::ifstream in_stream(input_files_[i], std::ios::binary);
       in_stream.seekg(properties_[i].GetValueStoreProperties().GetOffset());
-      stream << in_stream.rdbuf();
+      // only the values, the compression dictionaries of the inputs follow them
+      keyvi::util::SerializationUtils::CopyStream(in_stream, stream,
+                                                  properties_[i].GetValueStoreProperties().GetSize());
     }
+
+    stream.write(packed_dictionaries.data(), packed_dictionaries.size());
   }
 
   uint64_t GetFileVersionMin() const { return file_version_min_; }
@@ -343,13 +611,19 @@ class JsonValueStoreReader final : public IValueStoreReader {
         internal::MemoryMapFlags::ValuesGetMemoryMapOptions(loading_strategy);
 
     strings_region_ = new boost::interprocess::mapped_region(
-        *file_mapping, boost::interprocess::read_only, properties.GetOffset(), properties.GetSize(), 0, map_options);
+        *file_mapping, boost::interprocess::read_only, properties.GetOffset(),
+        properties.GetSize() + properties.GetCompressionDictionariesSize(), 0, map_options);
 
     const auto advise = internal::MemoryMapFlags::ValuesGetMemoryMapAdvices(loading_strategy);
 
     strings_region_->advise(advise);
 
     strings_ = (const char*)strings_region_->get_address();
+
+    if (properties.GetCompressionDictionariesSize() > 0) {
+      compression_dictionaries_.reset(new compression::CompressionDictionaries(
+          strings_ + properties.GetSize(), properties.GetCompressionDictionariesSize()));
+    }
   }
 
   ~JsonValueStoreReader() { delete strings_region_; }
@@ -369,7 +643,27 @@ class JsonValueStoreReader final : public IValueStoreReader {
   }
 
   std::string GetRawValueAsString(uint64_t fsa_value) const override {
-    return keyvi::util::decodeVarIntString(strings_ + fsa_value);
+    size_t value_size;
+    const char* value_ptr = keyvi::util::decodeVarIntString(strings_ + fsa_value, &value_size);
+
+    if (value_size > 0 && compression::CompressionDictionaries::RequiresDictionary(
+                              static_cast<compression::CompressionAlgorithm>(value_ptr[0]))) {
+      // raw values must be decodable without the value store, recompress without the dictionary
+      std::string buffer;
+      const std::string_view msgpacked_value =
+          compression::DecompressToView(value_ptr, value_size, &buffer, compression_dictionaries_.get());
+      compression::buffer_t compressed_value;
+      if (value_ptr[0] == compression::ZSTD_DICTIONARY_COMPRESSION) {
+        compression::ZstdCompressionStrategy().Compress(&compressed_value, msgpacked_value.data(),
+                                                        msgpacked_value.size());
+      } else {
+        compression::RawCompressionStrategy::DoCompress(&compressed_value, msgpacked_value.data(),
+                                                        msgpacked_value.size());
+      }
+      return std::string(compressed_value.data(), compressed_value.size());
+    }
+
+    return std::string(value_ptr, value_size);
   }
 
   std::string GetMsgPackedValueAsString(uint64_t fsa_value,
@@ -387,9 +681,9 @@ class JsonValueStoreReader final : public IValueStoreReader {
     }
 
     // decompress
-    const compression::decompress_func_t decompressor =
-        compression::decompressor_by_code(static_cast<compression::CompressionAlgorithm>(value_ptr[0]));
-    std::string msgpacked_value = decompressor(std::string(value_ptr, value_size));
+    std::string buffer;
+    const std::string msgpacked_value(
+        compression::DecompressToView(value_ptr, value_size, &buffer, compression_dictionaries_.get()));
 
     if (compression_algorithm == compression::CompressionAlgorithm::NO_COMPRESSION) {
       return msgpacked_value;
@@ -401,16 +695,26 @@ class JsonValueStoreReader final : public IValueStoreReader {
     return compressor->CompressWithoutHeader(msgpacked_value);
   }
 
+  std::string_view GetMsgPackedValueView(uint64_t fsa_value, std::string* buffer) const override {
+    size_t value_size;
+    const char* value_ptr = keyvi::util::decodeVarIntString(strings_ + fsa_value, &value_size);
+
+    return compression::DecompressToView(value_ptr, value_size, buffer, compression_dictionaries_.get());
+  }
+
   std::string GetValueAsString(uint64_t fsa_value) const override {
     TRACE("JsonValueStoreReader GetValueAsString");
-    std::string packed_string = keyvi::util::decodeVarIntString(strings_ + fsa_value);
+    size_t value_size;
+    const char* value_ptr = keyvi::util::decodeVarIntString(strings_ + fsa_value, &value_size);
 
-    return keyvi::util::DecodeJsonValue(packed_string);
+    return keyvi::util::DecodeJsonValue(value_ptr, value_size, compression_dictionaries_.get());
   }
 
  private:
   boost::interprocess::mapped_region* strings_region_;
   const char* strings_;
+  // nullptr if values are not compressed with dictionaries
+  std::unique_ptr<compression::CompressionDictionaries> compression_dictionaries_;
 
   const char* GetValueStorePayload() const override { return strings_; }
 };
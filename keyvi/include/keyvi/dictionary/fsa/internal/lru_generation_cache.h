@@ -102,9 +102,11 @@ class LeastRecentlyUsedGenerationsCache final {
 
   template <typename EqualityType>
   const EntryT Get(EqualityType &key) {  // NOLINT
+    ++lookups_;
     EntryT state = current_generation_->Get(key);
 
     if (!state.IsEmpty()) {
+      ++hits_;
       return state;
     }
 
@@ -113,6 +115,7 @@ class LeastRecentlyUsedGenerationsCache final {
       state = generations_[i - 1]->GetAndMove(key, current_generation_);
 
       if (!state.IsEmpty()) {
+        ++hits_;
         return state;
       }
     }
@@ -145,11 +148,22 @@ class LeastRecentlyUsedGenerationsCache final {
     return memory;
   }
 
+  uint64_t GetNumberOfLookups() const { return lookups_; }
+
+  uint64_t GetNumberOfHits() const { return hits_; }
+
+  /***
+   * The ratio of lookups that found an equal state.
+   */
+  double GetHitRate() const { return lookups_ > 0 ? static_cast<double>(hits_) / lookups_ : 0.0; }
+
  private:
   size_t size_per_generation_;
   size_t max_number_of_generations_;
   MinimizationHash<EntryT> *current_generation_;
   std::vector<MinimizationHash<EntryT> *> generations_;
+  uint64_t lookups_ = 0;
+  uint64_t hits_ = 0;
 };
 
 } /* namespace internal */
@@ -176,15 +176,21 @@ class MemoryMapManager final {
   void Write(std::ostream& stream, const size_t end) const {
     if (persisted_) {
       for (size_t i = 0; i < number_of_chunks_; i++) {
-        std::ifstream data_stream(GetFilenameForChunk(i).native().c_str(), std::ios::binary);
+        const boost::filesystem::path filename = GetFilenameForChunk(i);
 
-        if (!data_stream) {
-          throw memory_map_manager_exception("failed to open data stream");
+        // an empty file can not be mapped
+        if (boost::filesystem::file_size(filename) == 0) {
+          continue;
         }
 
-        stream << data_stream.rdbuf();
+        // write straight from the mapped chunk, avoids copying through a file stream buffer
+        boost::interprocess::file_mapping const mapping(filename.string().c_str(), boost::interprocess::read_only);
+        boost::interprocess::mapped_region mapped_region(mapping, boost::interprocess::read_only);
+        mapped_region.advise(boost::interprocess::mapped_region::advice_types::advice_sequential);
 
-        if (!data_stream) {
+        stream.write(static_cast<const char*>(mapped_region.get_address()), mapped_region.get_size());
+
+        if (!stream) {
           throw memory_map_manager_exception("failed to write into output stream");
         }
       }
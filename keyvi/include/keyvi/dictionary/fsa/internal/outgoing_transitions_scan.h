@@ -0,0 +1,167 @@
+/* * keyvi - A key value store.
+ *
+ * Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * outgoing_transitions_scan.h
+ */
+
+#ifndef KEYVI_DICTIONARY_FSA_INTERNAL_OUTGOING_TRANSITIONS_SCAN_H_
+#define KEYVI_DICTIONARY_FSA_INTERNAL_OUTGOING_TRANSITIONS_SCAN_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "keyvi/dictionary/fsa/internal/intrinsics.h"
+
+namespace keyvi {
+namespace dictionary {
+namespace fsa {
+namespace internal {
+
+/**
+ * Lookup table to find outgoing transitions quickly(in parallel) by comparing the
+ * real buffer with this table.
+ */
+alignas(64) static const unsigned char OUTGOING_TRANSITIONS_MASK[256] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12,
+    0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25,
+    0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38,
+    0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x3e, 0x3f, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x4b,
+    0x4c, 0x4d, 0x4e, 0x4f, 0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x5b, 0x5c, 0x5d, 0x5e,
+    0x5f, 0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71,
+    0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x7b, 0x7c, 0x7d, 0x7e, 0x7f, 0x80, 0x81, 0x82, 0x83, 0x84,
+    0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f, 0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97,
+    0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d, 0x9e, 0x9f, 0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa,
+    0xab, 0xac, 0xad, 0xae, 0xaf, 0xb0, 0xb1, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xbb, 0xbc, 0xbd,
+    0xbe, 0xbf, 0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf, 0xd0,
+    0xd1, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xdb, 0xdc, 0xdd, 0xde, 0xdf, 0xe0, 0xe1, 0xe2, 0xe3,
+    0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xeb, 0xec, 0xed, 0xee, 0xef, 0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6,
+    0xf7, 0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff};
+
+/**
+ * Number of 64 bit words needed to hold one bit per label.
+ */
+static const size_t OUTGOING_TRANSITIONS_BITMASK_WORDS = 4;
+
+/**
+ * Signature of a scan kernel: takes the 256 labels of a state and sets bit i of the bitmask if label i is an
+ * outgoing transition (labels[i] == i).
+ */
+typedef void (*outgoing_transitions_scan_t)(const unsigned char* labels, uint64_t* bitmask);
+
+/**
+ * Portable implementation, checks byte by byte.
+ */
+inline void ScanOutgoingTransitionsGeneric(const unsigned char* labels, uint64_t* bitmask) {
+  for (size_t word = 0; word < OUTGOING_TRANSITIONS_BITMASK_WORDS; ++word) {
+    uint64_t bits = 0;
+    for (size_t i = 0; i < 64; ++i) {
+      if (labels[word * 64 + i] == OUTGOING_TRANSITIONS_MASK[word * 64 + i]) {
+        bits |= 1ULL << i;
+      }
+    }
+    bitmask[word] = bits;
+  }
+}
+
+#if defined(KEYVI_X86_DISPATCH)
+
+/**
+ * SSE2 implementation, checks 16 bytes at a time. SSE2 is part of the x86_64 baseline, so this kernel is always
+ * available.
+ */
+__attribute__((target("sse2"))) inline void ScanOutgoingTransitionsSSE2(const unsigned char* labels,
+                                                                        uint64_t* bitmask) {
+  for (size_t word = 0; word < OUTGOING_TRANSITIONS_BITMASK_WORDS; ++word) {
+    uint64_t bits = 0;
+    for (size_t offset = 0; offset < 64; offset += 16) {
+      const __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(labels + word * 64 + offset));
+      const __m128i m =
+          _mm_load_si128(reinterpret_cast<const __m128i*>(OUTGOING_TRANSITIONS_MASK + word * 64 + offset));
+      bits |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(l, m)))) << offset;
+    }
+    bitmask[word] = bits;
+  }
+}
+
+/**
+ * AVX2 implementation, checks 32 bytes at a time.
+ */
+__attribute__((target("avx2"))) inline void ScanOutgoingTransitionsAVX2(const unsigned char* labels,
+                                                                        uint64_t* bitmask) {
+  for (size_t word = 0; word < OUTGOING_TRANSITIONS_BITMASK_WORDS; ++word) {
+    const __m256i l_low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(labels + word * 64));
+    const __m256i l_high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(labels + word * 64 + 32));
+    const __m256i m_low = _mm256_load_si256(reinterpret_cast<const __m256i*>(OUTGOING_TRANSITIONS_MASK + word * 64));
+    const __m256i m_high =
+        _mm256_load_si256(reinterpret_cast<const __m256i*>(OUTGOING_TRANSITIONS_MASK + word * 64 + 32));
+
+    const uint64_t bits_low = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(l_low, m_low)));
+    const uint64_t bits_high = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(l_high, m_high)));
+    bitmask[word] = bits_low | (bits_high << 32);
+  }
+}
+
+/**
+ * AVX-512BW implementation, checks 64 bytes at a time.
+ */
+__attribute__((target("avx512f,avx512bw"))) inline void ScanOutgoingTransitionsAVX512(const unsigned char* labels,
+                                                                                      uint64_t* bitmask) {
+  for (size_t word = 0; word < OUTGOING_TRANSITIONS_BITMASK_WORDS; ++word) {
+    const __m512i l = _mm512_loadu_si512(reinterpret_cast<const void*>(labels + word * 64));
+    const __m512i m = _mm512_load_si512(reinterpret_cast<const void*>(OUTGOING_TRANSITIONS_MASK + word * 64));
+    bitmask[word] = _mm512_cmpeq_epi8_mask(l, m);
+  }
+}
+
+#endif
+
+/**
+ * Select the best kernel for the CPU we are running on.
+ */
+inline outgoing_transitions_scan_t SelectOutgoingTransitionsScan() {
+#if defined(KEYVI_X86_DISPATCH)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512bw")) {
+    return &ScanOutgoingTransitionsAVX512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return &ScanOutgoingTransitionsAVX2;
+  }
+  return &ScanOutgoingTransitionsSSE2;
+#else
+  return &ScanOutgoingTransitionsGeneric;
+#endif
+}
+
+/**
+ * Scan the labels of a state for outgoing transitions using the kernel selected for this CPU (once, on first use).
+ *
+ * @param labels pointer to the 256 labels of the state
+ * @param bitmask array of OUTGOING_TRANSITIONS_BITMASK_WORDS words, bit i is set if label i is an outgoing transition
+ */
+inline void ScanOutgoingTransitions(const unsigned char* labels, uint64_t* bitmask) {
+  static const outgoing_transitions_scan_t scan = SelectOutgoingTransitionsScan();
+  scan(labels, bitmask);
+}
+
+} /* namespace internal */
+} /* namespace fsa */
+} /* namespace dictionary */
+} /* namespace keyvi */
+
+#endif  // KEYVI_DICTIONARY_FSA_INTERNAL_OUTGOING_TRANSITIONS_SCAN_H_
@@ -25,6 +25,8 @@
 #ifndef KEYVI_DICTIONARY_FSA_INTERNAL_SPARSE_ARRAY_BUILDER_H_
 #define KEYVI_DICTIONARY_FSA_INTERNAL_SPARSE_ARRAY_BUILDER_H_
 
+#include <vector>
+
 #include "keyvi/dictionary/fsa/internal/constants.h"
 #include "keyvi/dictionary/fsa/internal/lru_generation_cache.h"
 #include "keyvi/dictionary/fsa/internal/minimization_hash.h"
@@ -41,7 +43,8 @@ namespace dictionary {
 namespace fsa {
 namespace internal {
 
-template <class PersistenceT, class OffsetTypeT = uint32_t, class HashCodeTypeT = int32_t>
+template <class PersistenceT, class OffsetTypeT = uint32_t, class HashCodeTypeT = int32_t,
+          class MinimizationCacheT = LeastRecentlyUsedGenerationsCache<PackedState<OffsetTypeT, HashCodeTypeT>>>
 class SparseArrayBuilder final {
  public:
   SparseArrayBuilder(size_t memory_limit, PersistenceT* persistence, bool inner_weight, bool minimize = true) {
@@ -49,17 +52,39 @@ class SparseArrayBuilder final {
   }
 };
 
-template <class OffsetTypeT, class HashCodeTypeT>
-class SparseArrayBuilder<SparseArrayPersistence<uint16_t>, OffsetTypeT, HashCodeTypeT> final {
+template <class OffsetTypeT, class HashCodeTypeT, class MinimizationCacheT>
+class SparseArrayBuilder<SparseArrayPersistence<uint16_t>, OffsetTypeT, HashCodeTypeT, MinimizationCacheT> final {
  public:
+  /**
+   * Flag for a transition value that points to a state outside of this sparse array, e.g. in another partition. The
+   * other bits are an id chosen by the caller, the transition gets resolved later with ResolveExternalTransition.
+   */
+  static constexpr uint64_t EXTERNAL_TRANSITION = 1ULL << 63;
+
+  // number of extra buckets of an external transition, enough for any pointer of OffsetTypeT
+  static constexpr size_t EXTERNAL_TRANSITION_BUCKETS = (sizeof(OffsetTypeT) * 8 - 3 + 14) / 15;
+
+  struct ExternalTransition {
+    size_t offset;
+    size_t bucket;
+    uint64_t target;
+    unsigned char label;
+    unsigned char bucket_label;
+  };
+
+  /**
+   * @param relocatable if true, all transitions are coded relative to the position of the state, so the packed array
+   *                    can be moved to another offset as a whole (used for partitioned generation)
+   */
   SparseArrayBuilder(size_t memory_limit, SparseArrayPersistence<uint16_t>* persistence, bool inner_weight,
-                     bool minimize = true)
+                     bool minimize = true, bool relocatable = false)
       : number_of_states_(0),
         highest_persisted_state_(0),
         persistence_(persistence),
         inner_weight_(inner_weight),
-        minimize_(minimize) {
-    state_hashtable_ = new LeastRecentlyUsedGenerationsCache<PackedState<OffsetTypeT, HashCodeTypeT>>(memory_limit);
+        minimize_(minimize),
+        relocatable_(relocatable) {
+    state_hashtable_ = new MinimizationCacheT(memory_limit);
   }
 
   ~SparseArrayBuilder() { delete state_hashtable_; }
@@ -104,6 +129,14 @@ class SparseArrayBuilder<SparseArrayPersistence<uint16_t>, OffsetTypeT, HashCode
     return offset;
   }
 
+  /**
+   * Place new states at or behind the given offset, the buckets before are not tracked by the builder, e.g. because
+   * they have been copied from an existing sparse array.
+   *
+   * @param offset the lowest offset for a new state
+   */
+  void SetMinimumStateOffset(OffsetTypeT offset) { minimum_state_offset_ = offset; }
+
   // todo: this is not correct for compact mode!!!
   size_t GetSize() const { return (highest_persisted_state_ + MAX_TRANSITIONS_OF_A_STATE) * 5; }
 
@@ -113,6 +146,41 @@ class SparseArrayBuilder<SparseArrayPersistence<uint16_t>, OffsetTypeT, HashCode
    */
   uint64_t GetNumberOfStates() const { return number_of_states_; }
 
+  /**
+   * The transitions written with EXTERNAL_TRANSITION, in the order they have been written.
+   */
+  const std::vector<ExternalTransition>& GetExternalTransitions() const { return external_transitions_; }
+
+  /**
+   * Write the target of an external transition.
+   *
+   * @param persistence the sparse array the transition has been written to
+   * @param transition the external transition
+   * @param transition_pointer the absolute position of the target state in the final sparse array
+   */
+  static void ResolveExternalTransition(SparseArrayPersistence<uint16_t>* persistence,
+                                        const ExternalTransition& transition, uint64_t transition_pointer) {
+    uint16_t vshort_pointer[EXTERNAL_TRANSITION_BUCKETS];
+    EncodeExternalTransitionPointer(transition_pointer, vshort_pointer);
+
+    for (size_t i = 0; i < EXTERNAL_TRANSITION_BUCKETS; ++i) {
+      persistence->WriteTransition(transition.bucket + i, static_cast<unsigned char>(transition.bucket_label + i),
+                                   vshort_pointer[i]);
+    }
+    persistence->WriteTransition(transition.offset, transition.label,
+                                 GetExternalTransitionCode(transition, transition_pointer));
+  }
+
+  /**
+   * Get the number of lookups in the minimization cache.
+   */
+  uint64_t GetNumberOfMinimizationLookups() const { return state_hashtable_->GetNumberOfLookups(); }
+
+  /**
+   * Get the number of lookups in the minimization cache that found an equal state.
+   */
+  uint64_t GetNumberOfMinimizationHits() const { return state_hashtable_->GetNumberOfHits(); }
+
 #ifndef SPARSE_ARRAY_BUILDER_UNIT_TEST
 
  private:
@@ -122,7 +190,10 @@ class SparseArrayBuilder<SparseArrayPersistence<uint16_t>, OffsetTypeT, HashCode
   SparseArrayPersistence<uint16_t>* persistence_;
   bool inner_weight_;
   bool minimize_;
-  LeastRecentlyUsedGenerationsCache<PackedState<OffsetTypeT, HashCodeTypeT>>* state_hashtable_;
+  bool relocatable_;
+  OffsetTypeT minimum_state_offset_ = 1;
+  std::vector<ExternalTransition> external_transitions_;
+  MinimizationCacheT* state_hashtable_;
   SlidingWindowBitArrayPositionTracker state_start_positions_;
   SlidingWindowBitArrayPositionTracker taken_positions_in_sparsearray_;
   SlidingWindowBitArrayPositionTracker zerobyte_scrambling_state_start_positions_;  //< special construct to mark states
@@ -131,9 +202,20 @@ class SparseArrayBuilder<SparseArrayPersistence<uint16_t>, OffsetTypeT, HashCode
 
   OffsetTypeT FindFreeBucket(UnpackedState<SparseArrayPersistence<uint16_t>>* unpacked_state) const {
     // states (state ids) start with 1 as 0 is reserved to mark a 'none-state'
-    OffsetTypeT start_position = highest_persisted_state_ > SPARSE_ARRAY_SEARCH_OFFSET
+    OffsetTypeT start_position = highest_persisted_state_ > minimum_state_offset_ + SPARSE_ARRAY_SEARCH_OFFSET
                                      ? highest_persisted_state_ - SPARSE_ARRAY_SEARCH_OFFSET
-                                     : 1;
+                                     : minimum_state_offset_;
+
+    if (relocatable_) {
+      // place the state close enough to its children for relative coding, no absolute pointers allowed
+      for (size_t i = 0; i < unpacked_state->size(); ++i) {
+        const auto& transition = (*unpacked_state)[i];
+        if (transition.label < FINAL_OFFSET_TRANSITION && !(transition.value & EXTERNAL_TRANSITION) &&
+            transition.value >= start_position + COMPACT_SIZE_WINDOW) {
+          start_position = static_cast<OffsetTypeT>(transition.value - COMPACT_SIZE_WINDOW + 1);
+        }
+      }
+    }
 
     // further shift it taking the first outgoing transition and find the slot where it fits in
     start_position = taken_positions_in_sparsearray_.NextFreeSlot(start_position + (*unpacked_state)[0].label) -
@@ -354,6 +436,12 @@ class SparseArrayBuilder<SparseArrayPersistence<uint16_t>, OffsetTypeT, HashCode
    */
   inline void WriteTransition(size_t offset, unsigned char transitionId, uint64_t transitionPointer) {
     TRACE("Write offset: %ld, label: %d", offset, transitionId);
+
+    if (transitionPointer & EXTERNAL_TRANSITION) {
+      WriteExternalTransition(offset, transitionId, transitionPointer & ~EXTERNAL_TRANSITION);
+      return;
+    }
+
     size_t difference = SIZE_MAX;
 
     if (offset + COMPACT_SIZE_WINDOW > transitionPointer) {
@@ -369,7 +457,8 @@ class SparseArrayBuilder<SparseArrayPersistence<uint16_t>, OffsetTypeT, HashCode
       return;
     }
 
-    if (transitionPointer < COMPACT_SIZE_ABSOLUTE_MAX_VALUE) {
+    // in relocatable mode only the dummy pointer 0 (used for zerobyte scrambling) can be coded absolute
+    if (transitionPointer < COMPACT_SIZE_ABSOLUTE_MAX_VALUE && (!relocatable_ || transitionPointer == 0)) {
       TRACE("Transition fits in uint16 absolute: %d->%d", offset, transitionPointer);
 
       const uint16_t absolute_compact_coding = static_cast<uint16_t>(transitionPointer) | 0xC000;
@@ -385,7 +474,7 @@ class SparseArrayBuilder<SparseArrayPersistence<uint16_t>, OffsetTypeT, HashCode
 
     size_t overflow_code = transitionPointer;
 
-    if (difference < transitionPointer) {
+    if (difference < transitionPointer || (relocatable_ && difference != SIZE_MAX)) {
       // do relative coding
       // set corresponding bit
       pt_to_overflow_bucket |= 0x8;
@@ -401,6 +490,48 @@ class SparseArrayBuilder<SparseArrayPersistence<uint16_t>, OffsetTypeT, HashCode
 
     keyvi::util::encodeVarShort(transitionPointer_high, vshort_pointer, &vshort_size);
 
+    unsigned char bucket_label = 0;
+    const size_t start_position = WriteOverflowBuckets(offset, vshort_pointer, vshort_size, &bucket_label);
+
+    // encode the pointer to that bucket
+    size_t overflow_bucket = (COMPACT_SIZE_WINDOW + start_position) - offset;
+    pt_to_overflow_bucket |= overflow_bucket << 4;
+
+    // add the lower part (4 bits)
+    pt_to_overflow_bucket += transitionPointer_low;
+
+    persistence_->WriteTransition(offset, transitionId, pt_to_overflow_bucket);
+  }
+
+  /**
+   * Write a transition to a state outside of this sparse array (see EXTERNAL_TRANSITION), its target is unknown yet.
+   *
+   * The transition gets overflow coded with a fixed number of extra buckets, so ResolveExternalTransition can write
+   * the target in place.
+   */
+  inline void WriteExternalTransition(size_t offset, unsigned char transitionId, uint64_t target) {
+    uint16_t vshort_pointer[EXTERNAL_TRANSITION_BUCKETS];
+    EncodeExternalTransitionPointer(0, vshort_pointer);
+
+    unsigned char bucket_label = 0;
+    const size_t bucket = WriteOverflowBuckets(offset, vshort_pointer, EXTERNAL_TRANSITION_BUCKETS, &bucket_label);
+
+    const ExternalTransition external_transition{offset, bucket, target, transitionId, bucket_label};
+    persistence_->WriteTransition(offset, transitionId, GetExternalTransitionCode(external_transition, 0));
+    external_transitions_.push_back(external_transition);
+  }
+
+  /**
+   * Find free buckets close to offset and write the extra buckets of an overflow transition into them.
+   *
+   * @param offset the position of the transition
+   * @param vshort_pointer the extra buckets
+   * @param vshort_size the number of extra buckets
+   * @param bucket_label set to the label of the first extra bucket (zerobyte scrambling)
+   * @return the position of the first extra bucket
+   */
+  size_t WriteOverflowBuckets(size_t offset, const uint16_t* vshort_pointer, size_t vshort_size,
+                              unsigned char* bucket_label) {
     // find free spots in the sparse array where the pointer fits in
     size_t start_position = offset > COMPACT_SIZE_WINDOW ? offset - COMPACT_SIZE_WINDOW : 0;
     size_t zerobyte_scrambling_state = 0;
@@ -409,6 +540,12 @@ class SparseArrayBuilder<SparseArrayPersistence<uint16_t>, OffsetTypeT, HashCode
     for (;;) {
       start_position = taken_positions_in_sparsearray_.NextFreeSlot(start_position);
 
+      // without zerobyte scrambling the labels start at 0xff, a 2nd bucket would get label 0 (ghost transition)
+      if (vshort_size > 1 && start_position < NUMBER_OF_STATE_CODINGS) {
+        start_position = NUMBER_OF_STATE_CODINGS;
+        continue;
+      }
+
       // prevent that states without a weight get a 'zombie weight'.
       // check that we do not write into a bucket that is used for an inner weight of another transition
       if (inner_weight_ && state_start_positions_.IsSet(start_position + INNER_WEIGHT_TRANSITION_COMPACT)) {
@@ -484,14 +621,28 @@ class SparseArrayBuilder<SparseArrayPersistence<uint16_t>, OffsetTypeT, HashCode
                                     vshort_pointer[i]);
     }
 
-    // encode the pointer to that bucket
-    size_t overflow_bucket = (COMPACT_SIZE_WINDOW + start_position) - offset;
-    pt_to_overflow_bucket |= overflow_bucket << 4;
+    *bucket_label = zerobyte_scrambling_label;
+    return start_position;
+  }
 
-    // add the lower part (4 bits)
-    pt_to_overflow_bucket += transitionPointer_low;
+  static uint16_t GetExternalTransitionCode(const ExternalTransition& transition, uint64_t transition_pointer) {
+    // absolute overflow coding, pointer to the extra buckets
+    return static_cast<uint16_t>(0x8000 | ((COMPACT_SIZE_WINDOW + transition.bucket - transition.offset) << 4) |
+                                 (transition_pointer & 0x7));
+  }
 
-    persistence_->WriteTransition(offset, transitionId, pt_to_overflow_bucket);
+  /**
+   * Encode the higher part of the pointer into EXTERNAL_TRANSITION_BUCKETS varshorts, padded with empty varshorts.
+   */
+  static void EncodeExternalTransitionPointer(uint64_t transition_pointer, uint16_t* vshort_pointer) {
+    uint64_t value = transition_pointer >> 3;
+    for (size_t i = 0; i < EXTERNAL_TRANSITION_BUCKETS; ++i) {
+      vshort_pointer[i] = static_cast<uint16_t>(value & 0x7FFF);
+      if (i + 1 < EXTERNAL_TRANSITION_BUCKETS) {
+        vshort_pointer[i] |= 0x8000;
+      }
+      value >>= 15;
+    }
   }
 
   inline void WriteFinalTransition(size_t offset, uint64_t value) {
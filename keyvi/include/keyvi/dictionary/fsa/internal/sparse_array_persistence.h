@@ -108,6 +108,26 @@ class SparseArrayPersistence final {
   SparseArrayPersistence& operator=(SparseArrayPersistence const&) = delete;
   SparseArrayPersistence(const SparseArrayPersistence& that) = delete;
 
+  /**
+   * Start with the buckets of an existing sparse array, new states have to be placed behind it.
+   *
+   * Must be called before anything else got written.
+   *
+   * @param labels the labels of the existing sparse array
+   * @param transitions the transitions of the existing sparse array in persistence order
+   * @param size the size of the existing sparse array
+   */
+  void AppendSparseArray(const unsigned char* labels, const BucketT* transitions, size_t size) {
+    labels_extern_->Append(labels, size);
+    transitions_extern_->Append(transitions, size * sizeof(BucketT));
+    in_memory_buffer_offset_ = size;
+    highest_raw_write_bucket_ = size > 0 ? size - 1 : 0;
+
+    // the GH#360 guard is not needed, the buffer does not start at 0 anymore
+    labels_[0] = 0;
+    labels_[1] = 0;
+  }
+
   void BeginNewState(size_t offset) {
     while ((offset + COMPACT_SIZE_WINDOW + NUMBER_OF_STATE_CODINGS) >= (buffer_size_ + in_memory_buffer_offset_)) {
       FlushBuffers();
@@ -185,21 +205,32 @@ class SparseArrayPersistence final {
       delete[] transitions_;
       labels_ = 0;
       transitions_ = 0;
+
+      // from now on all reads go to external memory
+      in_memory_buffer_offset_ = highest_write_position;
     }
   }
 
   void Write(std::ostream& stream) {
     TRACE("Wrote JSON header, stream at %d", stream.tellp());
 
-    size_t size = GetSize();
-    labels_extern_->Write(stream, size);
-
+    WriteLabels(stream);
     TRACE("Wrote Labels, stream at %d", stream.tellp());
 
-    transitions_extern_->Write(stream, size * sizeof(BucketT));
+    WriteTransitions(stream);
     TRACE("Wrote Transitions, stream at %d", stream.tellp());
   }
 
+  /**
+   * Write only the labels part, used when stitching several sparse arrays together.
+   */
+  void WriteLabels(std::ostream& stream) { labels_extern_->Write(stream, GetSize()); }
+
+  /**
+   * Write only the transitions part, used when stitching several sparse arrays together.
+   */
+  void WriteTransitions(std::ostream& stream) { transitions_extern_->Write(stream, GetSize() * sizeof(BucketT)); }
+
   [[nodiscard]] size_t GetChunkSizeExternalTransitions() const { return transitions_extern_->GetChunkSize(); }
 
   uint32_t GetVersion() const;
@@ -25,13 +25,18 @@
 #ifndef KEYVI_DICTIONARY_FSA_INTERNAL_STRING_VALUE_STORE_H_
 #define KEYVI_DICTIONARY_FSA_INTERNAL_STRING_VALUE_STORE_H_
 
+#include <fstream>
 #include <memory>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <boost/functional/hash.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include "keyvi/compression/compression_selector.h"
+#include "keyvi/compression/predictive_compression_strategy.h"
 #include "keyvi/dictionary/dictionary_properties.h"
 #include "keyvi/dictionary/fsa/internal/constants.h"
 #include "keyvi/dictionary/fsa/internal/ivalue_store.h"
@@ -44,6 +49,7 @@
 #include "keyvi/dictionary/fsa/internal/value_store_types.h"
 #include "keyvi/util/configuration.h"
 #include "keyvi/util/msgpack_util.h"
+#include "keyvi/util/serialization_utils.h"
 
 // #define ENABLE_TRACING
 #include "keyvi/dictionary/util/trace.h"
@@ -72,12 +78,43 @@ class StringValueStoreBase {
 
   static value_store_t GetValueStoreType() { return value_store_t::STRING; }
 
-  uint64_t GetFileVersionMin() const { return KEYVI_FILE_VERSION_MIN; }
+  uint64_t GetFileVersionMin() const {
+    // compressed values are stored length prefixed instead of zero terminated
+    return compression_.empty() ? KEYVI_FILE_VERSION_MIN : KEYVI_FILE_VERSION_COMPRESSION_DICTIONARIES;
+  }
 
  protected:
   size_t number_of_values_ = 0;
   size_t number_of_unique_values_ = 0;
   size_t values_buffer_size_ = 0;
+  // name of the compression, empty if values are not compressed
+  std::string compression_;
+  // dictionaries values are compressed with, stored after the values
+  std::vector<std::string> compression_dictionaries_;
+
+  /**
+   * Take over the compression of the value store of an input file, all inputs must share it.
+   */
+  void AddInputCompression(const std::string& file_name, const ValueStoreProperties& properties, bool first_input) {
+    if (first_input) {
+      compression_ = properties.GetCompression();
+    } else if (compression_ != properties.GetCompression()) {
+      throw std::invalid_argument("can not merge string value stores with different compressions");
+    }
+
+    for (const std::string& dictionary : compression::CompressionDictionaries::ReadFromFile(
+             file_name, properties.GetOffset() + properties.GetSize(), properties.GetCompressionDictionariesSize())) {
+      compression::CompressionDictionaries::AddUnique(dictionary, &compression_dictionaries_);
+    }
+  }
+
+  void WriteProperties(std::ostream& stream, const std::string& packed_dictionaries) const {
+    ValueStoreProperties properties(0, values_buffer_size_, number_of_values_, number_of_unique_values_, compression_,
+                                    packed_dictionaries.size());
+
+    properties.WriteAsJsonV2(stream);
+    TRACE("Wrote JSON header, stream at %d", stream.tellp());
+  }
 };
 
 class StringValueStoreMinimizationBase : public StringValueStoreBase {
@@ -101,6 +138,14 @@ class StringValueStoreMinimizationBase : public StringValueStoreBase {
 
   ~StringValueStoreMinimizationBase() { boost::filesystem::remove_all(temporary_directory_); }
 
+  void Write(std::ostream& stream) const {
+    const std::string packed_dictionaries = compression::CompressionDictionaries::Pack(compression_dictionaries_);
+    WriteProperties(stream, packed_dictionaries);
+
+    values_extern_->Write(stream, values_buffer_size_);
+    stream.write(packed_dictionaries.data(), packed_dictionaries.size());
+  }
+
   /**
    * Close the value store, so no more updates;
    */
@@ -115,22 +160,9 @@ class StringValueStoreMinimizationBase : public StringValueStoreBase {
   boost::filesystem::path temporary_directory_;
   std::unique_ptr<MemoryMapManager> values_extern_;
   LeastRecentlyUsedGenerationsCache<RawPointer<>> hash_;
-};
-
-/**
- * Value store where the value consists of a string.
- */
-class StringValueStore final : public StringValueStoreMinimizationBase {
- public:
-  explicit StringValueStore(const keyvi::util::parameters_t& parameters = keyvi::util::parameters_t())
-      : StringValueStoreMinimizationBase(parameters) {}
 
-  /**
-   * Simple implementation of a value store for strings:
-   * todo: performance improvements / port stuff from json_value_store
-   */
-  uint64_t AddValue(const value_t& value, bool* no_minimization) {
-    const RawPointerForCompareString<MemoryMapManager> stp(value.data(), value.size(), values_extern_.get());
+  uint64_t AddZeroTerminatedValue(const char* value, size_t value_size, bool* no_minimization) {
+    const RawPointerForCompareString<MemoryMapManager> stp(value, value_size, values_extern_.get());
 
     const RawPointer<> p = hash_.Get(stp);
 
@@ -144,40 +176,23 @@ class StringValueStore final : public StringValueStoreMinimizationBase {
     // else persist string value
     uint64_t pt = static_cast<uint64_t>(values_buffer_size_);
 
-    values_extern_->Append(value.data(), value.size());
-    values_buffer_size_ += value.size();
+    values_extern_->Append(value, value_size);
+    values_buffer_size_ += value_size;
 
     // add zero termination
     values_extern_->push_back('\0');
     ++values_buffer_size_;
 
-    hash_.Add(RawPointer<>(pt, stp.GetHashcode(), value.size()));
+    hash_.Add(RawPointer<>(pt, stp.GetHashcode(), value_size));
 
     return pt;
   }
 
-  uint32_t GetWeightValue(value_t value) const { return 0; }
-
-  void Write(std::ostream& stream) const {
-    ValueStoreProperties properties(0, values_buffer_size_, number_of_values_, number_of_unique_values_, {});
-
-    properties.WriteAsJsonV2(stream);
-    TRACE("Wrote JSON header, stream at %d", stream.tellp());
-
-    values_extern_->Write(stream, values_buffer_size_);
-  }
-};
-
-class StringValueStoreMerge final : public StringValueStoreMinimizationBase {
- public:
-  explicit StringValueStoreMerge(const keyvi::util::parameters_t& parameters = keyvi::util::parameters_t()) {}
-  explicit StringValueStoreMerge(const std::vector<std::string>& inputFiles,
-                                 const keyvi::util::parameters_t& parameters = keyvi::util::parameters_t()) {}
-
-  uint64_t AddValueMerge(const char* payload, uint64_t fsa_value, bool* no_minimization) {
-    const char* value = payload + fsa_value;
-    const size_t value_size = std::strlen(value);
-    const RawPointerForCompareString<MemoryMapManager> stp(value, value_size, values_extern_.get());
+  /**
+   * Add a compressed value, stored with a length prefix as compressed values might contain zero bytes.
+   */
+  uint64_t AddLengthPrefixedValue(const char* value, size_t value_size, bool* no_minimization) {
+    const RawPointerForCompare<MemoryMapManager> stp(value, value_size, values_extern_.get());
 
     const RawPointer<> p = hash_.Get(stp);
 
@@ -190,25 +205,83 @@ class StringValueStoreMerge final : public StringValueStoreMinimizationBase {
 
     // else persist string value
     uint64_t pt = static_cast<uint64_t>(values_buffer_size_);
+    size_t length;
 
+    keyvi::util::encodeVarInt(value_size, values_extern_.get(), &length);
+    values_buffer_size_ += length;
     values_extern_->Append(value, value_size);
     values_buffer_size_ += value_size;
 
-    // add zero termination
-    values_extern_->push_back('\0');
-    ++values_buffer_size_;
-
     hash_.Add(RawPointer<>(pt, stp.GetHashcode(), value_size));
 
     return pt;
   }
+};
 
-  void Write(std::ostream& stream) {
-    ValueStoreProperties properties(0, values_buffer_size_, number_of_values_, number_of_unique_values_, {});
-    properties.WriteAsJsonV2(stream);
-    TRACE("Wrote JSON header, stream at %d", stream.tellp());
+/**
+ * Value store where the value consists of a string.
+ */
+class StringValueStore final : public StringValueStoreMinimizationBase {
+ public:
+  /**
+   * @param parameters the only supported compression is "predictive", which requires a model given as
+   *                   "compression_model", other compressions do not pay off for short strings and are ignored
+   */
+  explicit StringValueStore(const keyvi::util::parameters_t& parameters = keyvi::util::parameters_t())
+      : StringValueStoreMinimizationBase(parameters) {
+    if (keyvi::util::mapGet<std::string>(parameters, COMPRESSION_KEY, {}) == "predictive") {
+      std::shared_ptr<const compression::PredictiveCompression> model = compression::LoadPredictiveCompressionModel(
+          keyvi::util::mapGet<std::string>(parameters, COMPRESSION_MODEL_KEY, {}));
+      compression_dictionaries_.push_back(static_cast<char>(compression::PREDICTIVE_COMPRESSION) +
+                                          compression::PredictiveCompressionStrategy::SerializeModel(*model));
+      compressor_.reset(new compression::PredictiveCompressionStrategy(model));
+      compression_ = compressor_->name();
+    }
+  }
 
-    values_extern_->Write(stream, values_buffer_size_);
+  /**
+   * Simple implementation of a value store for strings:
+   * todo: performance improvements / port stuff from json_value_store
+   */
+  uint64_t AddValue(const value_t& value, bool* no_minimization) {
+    if (!compressor_) {
+      return AddZeroTerminatedValue(value.data(), value.size(), no_minimization);
+    }
+
+    compressor_->Compress(&compression_buffer_, value.data(), value.size());
+    return AddLengthPrefixedValue(compression_buffer_.data(), compression_buffer_.size(), no_minimization);
+  }
+
+  uint32_t GetWeightValue(value_t value) const { return 0; }
+
+ private:
+  std::unique_ptr<compression::CompressionStrategy> compressor_;
+  compression::buffer_t compression_buffer_;
+};
+
+class StringValueStoreMerge final : public StringValueStoreMinimizationBase {
+ public:
+  explicit StringValueStoreMerge(const keyvi::util::parameters_t& parameters = keyvi::util::parameters_t()) {}
+  explicit StringValueStoreMerge(const std::vector<std::string>& inputFiles,
+                                 const keyvi::util::parameters_t& parameters = keyvi::util::parameters_t())
+      : StringValueStoreMinimizationBase(parameters) {
+    for (size_t i = 0; i < inputFiles.size(); ++i) {
+      // values are copied compressed, so the dictionaries they need are carried over
+      AddInputCompression(inputFiles[i], DictionaryProperties::FromFile(inputFiles[i]).GetValueStoreProperties(),
+                          i == 0);
+    }
+  }
+
+  uint64_t AddValueMerge(const char* payload, uint64_t fsa_value, bool* no_minimization) {
+    const char* value = payload + fsa_value;
+
+    if (compression_.empty()) {
+      return AddZeroTerminatedValue(value, std::strlen(value), no_minimization);
+    }
+
+    size_t value_size;
+    value = keyvi::util::decodeVarIntString(value, &value_size);
+    return AddLengthPrefixedValue(value, value_size, no_minimization);
   }
 };
 
@@ -226,6 +299,7 @@ class StringValueStoreAppendMerge final : public StringValueStoreBase {
       number_of_values_ += properties_.back().GetValueStoreProperties().GetNumberOfValues();
       number_of_unique_values_ += properties_.back().GetValueStoreProperties().GetNumberOfUniqueValues();
       values_buffer_size_ += properties_.back().GetValueStoreProperties().GetSize();
+      AddInputCompression(file_name, properties_.back().GetValueStoreProperties(), properties_.size() == 1);
     }
   }
 
@@ -234,14 +308,17 @@ class StringValueStoreAppendMerge final : public StringValueStoreBase {
   void CloseFeeding() {}
 
   void Write(std::ostream& stream) {
-    ValueStoreProperties properties(0, values_buffer_size_, number_of_values_, number_of_unique_values_, {});
-    properties.WriteAsJsonV2(stream);
+    const std::string packed_dictionaries = compression::CompressionDictionaries::Pack(compression_dictionaries_);
+    WriteProperties(stream, packed_dictionaries);
 
     for (size_t i = 0; i < input_files_.size(); ++i) {
-      std::ifstream in_stream(input_files_[i]);
+      std::ifstream in_stream(input_files_[i], std::ios::binary);
       in_stream.seekg(properties_[i].GetValueStoreProperties().GetOffset());
-      stream << in_stream.rdbuf();
+      // only the values, the compression dictionaries of the inputs follow them
+      keyvi::util::SerializationUtils::CopyStream(in_stream, stream,
+                                                  properties_[i].GetValueStoreProperties().GetSize());
     }
+    stream.write(packed_dictionaries.data(), packed_dictionaries.size());
   }
 
  private:
@@ -260,14 +337,22 @@ class StringValueStoreReader final : public IValueStoreReader {
     const boost::interprocess::map_options_t map_options =
         internal::MemoryMapFlags::ValuesGetMemoryMapOptions(loading_strategy);
 
+    // the compression dictionaries follow the values
     strings_region_ = new boost::interprocess::mapped_region(
-        *file_mapping, boost::interprocess::read_only, properties.GetOffset(), properties.GetSize(), 0, map_options);
+        *file_mapping, boost::interprocess::read_only, properties.GetOffset(),
+        properties.GetSize() + properties.GetCompressionDictionariesSize(), 0, map_options);
 
     const auto advise = internal::MemoryMapFlags::ValuesGetMemoryMapAdvices(loading_strategy);
 
     strings_region_->advise(advise);
 
     strings_ = (const char*)strings_region_->get_address();
+
+    compressed_ = !properties.GetCompression().empty();
+    if (properties.GetCompressionDictionariesSize() > 0) {
+      compression_dictionaries_.reset(new compression::CompressionDictionaries(
+          strings_ + properties.GetSize(), properties.GetCompressionDictionariesSize()));
+    }
   }
 
   ~StringValueStoreReader() { delete strings_region_; }
@@ -277,26 +362,33 @@ class StringValueStoreReader final : public IValueStoreReader {
   attributes_t GetValueAsAttributeVector(uint64_t fsa_value) const override {
     attributes_t attributes(new attributes_raw_t());
 
-    std::string raw_value(strings_ + fsa_value);
+    std::string buffer;
+    std::string raw_value(GetValueView(fsa_value, &buffer));
 
     (*attributes)["value"] = raw_value;
     return attributes;
   }
 
-  std::string GetValueAsString(uint64_t fsa_value) const override { return std::string(strings_ + fsa_value); }
+  std::string GetValueAsString(uint64_t fsa_value) const override {
+    std::string buffer;
+    return std::string(GetValueView(fsa_value, &buffer));
+  }
+
+  std::string_view GetValueAsStringView(uint64_t fsa_value, std::string* buffer) const override {
+    return GetValueView(fsa_value, buffer);
+  }
 
   std::string GetRawValueAsString(uint64_t fsa_value) const override {
     // TODO(hendrik): replace with std::format once we have C++20
     return compression::compression_strategy_by_code(compression::CompressionAlgorithm::NO_COMPRESSION)
-        ->Compress(keyvi::util::ValueToMsgPack(std::string(strings_ + fsa_value)));
+        ->Compress(keyvi::util::ValueToMsgPack(GetValueAsString(fsa_value)));
   }
 
   std::string GetMsgPackedValueAsString(uint64_t fsa_value,
                                         const compression::CompressionAlgorithm compression_algorithm =
                                             compression::CompressionAlgorithm::NO_COMPRESSION) const override {
     // GH#333: if string is valid json, parse it as msgpack for backwards-compatibility
-    std::string msgpacked_value = keyvi::util::JsonStringToMsgPack(
-        std::string(strings_ + fsa_value));  // NOLINT : fine here, we access the mmaped buffer
+    std::string msgpacked_value = keyvi::util::JsonStringToMsgPack(GetValueAsString(fsa_value));
 
     if (compression_algorithm == compression::CompressionAlgorithm::NO_COMPRESSION) {
       return msgpacked_value;
@@ -312,8 +404,20 @@ class StringValueStoreReader final : public IValueStoreReader {
  private:
   boost::interprocess::mapped_region* strings_region_;
   const char* strings_;
+  bool compressed_ = false;
+  std::unique_ptr<compression::CompressionDictionaries> compression_dictionaries_;
 
   const char* GetValueStorePayload() const override { return strings_; }
+
+  std::string_view GetValueView(uint64_t fsa_value, std::string* buffer) const {
+    if (!compressed_) {
+      return std::string_view(strings_ + fsa_value);
+    }
+
+    size_t value_size;
+    const char* value_ptr = keyvi::util::decodeVarIntString(strings_ + fsa_value, &value_size);
+    return compression::DecompressToView(value_ptr, value_size, buffer, compression_dictionaries_.get());
+  }
 };
 
 template <>
@@ -0,0 +1,216 @@
+/* * keyvi - A key value store.
+ *
+ * Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * swiss_minimization_cache.h
+ */
+
+#ifndef KEYVI_DICTIONARY_FSA_INTERNAL_SWISS_MINIMIZATION_CACHE_H_
+#define KEYVI_DICTIONARY_FSA_INTERNAL_SWISS_MINIMIZATION_CACHE_H_
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "keyvi/dictionary/fsa/internal/intrinsics.h"
+#include "keyvi/dictionary/fsa/internal/packed_state.h"
+
+namespace keyvi {
+namespace dictionary {
+namespace fsa {
+namespace internal {
+
+/**
+ * An alternative to LeastRecentlyUsedGenerationsCache for state minimization, with the same interface.
+ *
+ * The cache is an open-addressing table in the style of SwissTable: slots are organized in groups of 16, each slot
+ * has a control byte holding either a 7 bit fingerprint of the hash or the empty marker. A lookup compares the
+ * control bytes of a group in one go (SSE) and only touches entries with a matching fingerprint. An entry is placed
+ * in its home group or the next one, if both are full an entry of the home group gets replaced (round robin), so the
+ * table never grows beyond the memory given at construction.
+ */
+template <class EntryT = PackedState<>>
+class SwissMinimizationCache final {
+ public:
+  /**
+   * @param memory_limit memory limit for control bytes and entries
+   */
+  explicit SwissMinimizationCache(size_t memory_limit) {
+    number_of_groups_ = 1;
+    while (number_of_groups_ * 2 * BYTES_PER_GROUP <= memory_limit) {
+      number_of_groups_ *= 2;
+    }
+
+    memory_usage_ = number_of_groups_ * BYTES_PER_GROUP;
+    data_.reset(new unsigned char[memory_usage_]);
+    control_bytes_ = data_.get();
+    next_victim_ = control_bytes_ + number_of_groups_ * GROUP_SIZE;
+    entries_ = reinterpret_cast<EntryT*>(next_victim_ + number_of_groups_);
+    Clear();
+  }
+
+  SwissMinimizationCache() = delete;
+  SwissMinimizationCache& operator=(SwissMinimizationCache const&) = delete;
+  SwissMinimizationCache(const SwissMinimizationCache& that) = delete;
+
+  /**
+   * Add this entry. This does not test whether an equal entry is already contained.
+   * @param key The key to add.
+   */
+  void Add(const EntryT key) {
+    const uint64_t hash = Mix(key.GetHashcode());
+    const unsigned char fingerprint = Fingerprint(hash);
+    const size_t home_group = hash & (number_of_groups_ - 1);
+
+    for (size_t probe = 0; probe < 2; ++probe) {
+      const size_t group = (home_group + probe) & (number_of_groups_ - 1);
+      const uint32_t empty_slots = Match(group, EMPTY);
+
+      if (empty_slots != 0) {
+        Set(group * GROUP_SIZE + __builtin_ctz(empty_slots), fingerprint, key);
+        ++size_;
+        return;
+      }
+    }
+
+    // both groups are full, replace the oldest entry of the home group
+    const size_t slot = home_group * GROUP_SIZE + next_victim_[home_group];
+    next_victim_[home_group] = (next_victim_[home_group] + 1) % GROUP_SIZE;
+    Set(slot, fingerprint, key);
+  }
+
+  /**
+   * Perform a lookup. If the fingerprints match, the key's equality operator is called upon the entry.
+   * @tparam EqualityType a type that can be used for comparison (must implement GetHashcode and operator==)
+   * @param key key for lookup
+   * @return the equal state or an empty value
+   */
+  template <typename EqualityType>
+  const EntryT Get(EqualityType& key) {  // NOLINT
+    ++lookups_;
+    const uint64_t hash = Mix(key.GetHashcode());
+    const unsigned char fingerprint = Fingerprint(hash);
+    const size_t home_group = hash & (number_of_groups_ - 1);
+
+    for (size_t probe = 0; probe < 2; ++probe) {
+      const size_t group = (home_group + probe) & (number_of_groups_ - 1);
+
+      for (uint32_t candidates = Match(group, fingerprint); candidates != 0; candidates &= candidates - 1) {
+        const size_t slot_in_group = __builtin_ctz(candidates);
+        EntryT entry;
+        std::memcpy(static_cast<void*>(&entry), entries_ + group * GROUP_SIZE + slot_in_group, sizeof(EntryT));
+        if (key == entry) {
+          ++hits_;
+          // give a recently used entry another round before it gets replaced
+          if (probe == 0 && next_victim_[group] == slot_in_group) {
+            next_victim_[group] = (next_victim_[group] + 1) % GROUP_SIZE;
+          }
+          return entry;
+        }
+      }
+
+      // the next group is only used if the home group is full
+      if (Match(group, EMPTY) != 0) {
+        break;
+      }
+    }
+
+    return EntryT();
+  }
+
+  /**
+   * Remove all entries, the memory is kept.
+   */
+  void Clear() {
+    std::memset(control_bytes_, EMPTY, number_of_groups_ * GROUP_SIZE);
+    std::memset(next_victim_, 0, number_of_groups_);
+    size_ = 0;
+  }
+
+  /**
+   * Number of entries added to empty slots, replaced entries are not counted.
+   */
+  size_t Size() const { return size_; }
+
+  size_t GetMemoryUsage() const { return memory_usage_; }
+
+  uint64_t GetNumberOfLookups() const { return lookups_; }
+
+  uint64_t GetNumberOfHits() const { return hits_; }
+
+  /**
+   * The ratio of lookups that found an equal state.
+   */
+  double GetHitRate() const { return lookups_ > 0 ? static_cast<double>(hits_) / lookups_ : 0.0; }
+
+ private:
+  static constexpr size_t GROUP_SIZE = 16;
+  // control bytes + victim pointer + entries
+  static constexpr size_t BYTES_PER_GROUP = GROUP_SIZE * (1 + sizeof(EntryT)) + 1;
+  static constexpr unsigned char EMPTY = 0x80;
+
+  std::unique_ptr<unsigned char[]> data_;
+  unsigned char* control_bytes_;
+  unsigned char* next_victim_;
+  EntryT* entries_;
+  size_t number_of_groups_;
+  size_t memory_usage_;
+  size_t size_ = 0;
+  uint64_t lookups_ = 0;
+  uint64_t hits_ = 0;
+
+  template <typename HashCodeT>
+  static uint64_t Mix(HashCodeT hashcode) {
+    // same bits as used by MinimizationHash, unpacked and packed states only agree on the lower 31 bits
+    uint64_t hash = static_cast<uint64_t>(hashcode & 0x7fffffff);
+    hash *= 0x9E3779B97F4A7C15ULL;
+    return hash ^ (hash >> 32);
+  }
+
+  static unsigned char Fingerprint(uint64_t hash) { return static_cast<unsigned char>(hash >> 57); }
+
+  inline void Set(size_t slot, unsigned char fingerprint, const EntryT key) {
+    control_bytes_[slot] = fingerprint;
+    std::memcpy(static_cast<void*>(entries_ + slot), &key, sizeof(EntryT));
+  }
+
+  /**
+   * Compare all control bytes of a group with the given byte.
+   * @return bitmask with a bit set for every matching slot
+   */
+  inline uint32_t Match(size_t group, unsigned char byte) const {
+    const unsigned char* control = control_bytes_ + group * GROUP_SIZE;
+#if defined(KEYVI_SSE42)
+    const __m128i control_vector = _mm_loadu_si128(reinterpret_cast<const __m128i*>(control));
+    return static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(control_vector, _mm_set1_epi8(static_cast<char>(byte)))));
+#else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < GROUP_SIZE; ++i) {
+      mask |= static_cast<uint32_t>(control[i] == byte) << i;
+    }
+    return mask;
+#endif
+  }
+};
+
+} /* namespace internal */
+} /* namespace fsa */
+} /* namespace dictionary */
+} /* namespace keyvi */
+
+#endif  // KEYVI_DICTIONARY_FSA_INTERNAL_SWISS_MINIMIZATION_CACHE_H_
@@ -27,6 +27,7 @@
 
 #include <vector>
 
+#include "keyvi/dictionary/fsa/internal/constants.h"
 #include "keyvi/dictionary/fsa/internal/unpacked_state.h"
 
 // #define ENABLE_TRACING
@@ -40,7 +41,7 @@ namespace internal {
 template <class PersistenceT>
 class UnpackedStateStack final {
  public:
-  UnpackedStateStack(PersistenceT* persistence, size_t initial_size, int weight_cut_off = 30)
+  UnpackedStateStack(PersistenceT* persistence, size_t initial_size, int weight_cut_off = INNER_WEIGHT_CUT_OFF_DEPTH)
       : persistence_(persistence), weight_cut_off_(weight_cut_off) {
     unpacked_state_pool_.reserve(initial_size);
   }
@@ -46,6 +46,7 @@ namespace fsa {
 namespace internal {
 
 static const char COMPRESSION_PROPERTY[] = "__compression";
+static const char COMPRESSION_DICTIONARIES_SIZE_PROPERTY[] = "__compression_dictionaries_size";
 static const char SIZE_PROPERTY[] = "size";
 static const char UNIQUE_VALUES_PROPERTY[] = "unique_values";
 static const char VALUES_PROPERTY[] = "values";
@@ -55,16 +56,28 @@ class ValueStoreProperties final {
   ValueStoreProperties() {}
 
   ValueStoreProperties(const size_t offset, const size_t size, const size_t number_of_values,
-                       const size_t number_of_unique_values, const std::string& compression) {
+                       const size_t number_of_unique_values, const std::string& compression,
+                       const size_t compression_dictionaries_size = 0) {
     offset_ = offset;
     size_ = size;
     number_of_values_ = number_of_values;
     number_of_unique_values_ = number_of_unique_values;
     compression_ = compression;
+    compression_dictionaries_size_ = compression_dictionaries_size;
   }
 
   size_t GetSize() const { return size_; }
 
+  /**
+   * Size of the compression dictionaries, they are stored right after the values.
+   */
+  size_t GetCompressionDictionariesSize() const { return compression_dictionaries_size_; }
+
+  /**
+   * Name of the compression values have been compressed with, empty if not set.
+   */
+  const std::string& GetCompression() const { return compression_; }
+
   size_t GetOffset() const { return offset_; }
 
   size_t GetNumberOfValues() const { return number_of_values_; }
@@ -95,6 +108,10 @@ class ValueStoreProperties final {
       writer->Key(COMPRESSION_PROPERTY);
       writer->String(compression_);
     }
+    if (compression_dictionaries_size_ > 0) {
+      writer->Key(COMPRESSION_DICTIONARIES_SIZE_PROPERTY);
+      writer->Uint64(compression_dictionaries_size_);
+    }
     writer->EndObject();
   }
 
@@ -121,6 +138,10 @@ class ValueStoreProperties final {
         writer.Key(COMPRESSION_PROPERTY);
         writer.String(compression_);
       }
+      if (compression_dictionaries_size_ > 0) {
+        writer.Key(COMPRESSION_DICTIONARIES_SIZE_PROPERTY);
+        writer.String(std::to_string(compression_dictionaries_size_));
+      }
       writer.EndObject();
     }
 
@@ -135,10 +156,12 @@ class ValueStoreProperties final {
     const size_t offset = stream.tellg();
     const size_t size =
         keyvi::util::SerializationUtils::GetOptionalSizeFromValueOrString(value_store_properties, SIZE_PROPERTY, 0);
+    const size_t compression_dictionaries_size = keyvi::util::SerializationUtils::GetOptionalSizeFromValueOrString(
+        value_store_properties, COMPRESSION_DICTIONARIES_SIZE_PROPERTY, 0);
 
     // check for file truncation
-    if (size > 0) {
-      stream.seekg(size - 1, stream.cur);
+    if (size + compression_dictionaries_size > 0) {
+      stream.seekg(size + compression_dictionaries_size - 1, stream.cur);
       if (stream.peek() == EOF) {
         throw std::invalid_argument("file is corrupt(truncated)");
       }
@@ -154,7 +177,8 @@ class ValueStoreProperties final {
       compression = value_store_properties[COMPRESSION_PROPERTY].GetString();
     }
 
-    return ValueStoreProperties(offset, size, number_of_values, number_of_unique_values, compression);
+    return ValueStoreProperties(offset, size, number_of_values, number_of_unique_values, compression,
+                                compression_dictionaries_size);
   }
 
  private:
@@ -164,6 +188,7 @@ class ValueStoreProperties final {
   size_t number_of_unique_values_ = 0;
   std::string compression_;
   std::string compression_threshold_;
+  size_t compression_dictionaries_size_ = 0;
 };  // namespace internal
 
 }  // namespace internal
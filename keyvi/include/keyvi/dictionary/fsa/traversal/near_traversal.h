@@ -45,6 +45,8 @@ struct NearTransition : public Transition {
 
 template <>
 struct TraversalPayload<NearTransition> {
+  using transitions_t = TransitionBuffer<NearTransition>;
+
   TraversalPayload() : current_depth(0), lookup_key() {}
   explicit TraversalPayload(std::shared_ptr<std::string>& lookup_key) : current_depth(0), lookup_key(lookup_key) {}
 
@@ -56,7 +58,7 @@ struct TraversalPayload<NearTransition> {
 
 template <>
 struct TraversalStatePayload<NearTransition> {
-  std::vector<NearTransition> transitions;
+  TraversalPayload<NearTransition>::transitions_t transitions;
   size_t position = 0;
 };
 
@@ -25,7 +25,13 @@
 #ifndef KEYVI_DICTIONARY_FSA_TRAVERSAL_TRAVERSAL_BASE_H_
 #define KEYVI_DICTIONARY_FSA_TRAVERSAL_TRAVERSAL_BASE_H_
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -44,8 +50,97 @@ struct Transition {
   unsigned char label;
 };
 
+/**
+ * Maximum number of transitions a traversal state can hold: 1 per label plus 1 extra slot, used by near traversal
+ * to keep the exact match in front.
+ */
+static const size_t TRAVERSAL_STATE_MAX_TRANSITIONS = std::numeric_limits<unsigned char>::max() + 2;
+
+/**
+ * Initial depth of a traversal stack.
+ */
+static const size_t TRAVERSAL_STACK_INITIAL_DEPTH = 20;
+
+/**
+ * Maximum number of traversal stacks kept per thread and transition type for re-use.
+ */
+static const size_t TRAVERSAL_STATE_ARENA_MAX_POOLED = 16;
+
+/**
+ * Maximum depth of a traversal stack kept for re-use, deeper stacks get shrunk before they are pooled.
+ */
+static const size_t TRAVERSAL_STATE_ARENA_MAX_POOLED_DEPTH = 64;
+
+/**
+ * Fixed capacity container with inline storage for the outgoing transitions of a state.
+ *
+ * Replaces std::vector to avoid heap allocations while traversing, copying only copies the used part.
+ */
+template <class TransitionT>
+class TransitionBuffer final {
+  static_assert(std::is_trivially_copyable<TransitionT>::value, "transitions must be trivially copyable");
+  static_assert(TRAVERSAL_STATE_MAX_TRANSITIONS > std::numeric_limits<decltype(TransitionT::label)>::max() + 1,
+                "a traversal state must hold a transition per label plus 1");
+
+ public:
+  // note: user-provided to avoid zero-initializing the storage
+  TransitionBuffer() : size_(0) {}
+
+  TransitionBuffer(const TransitionBuffer& other) : size_(other.size_) {
+    std::memcpy(storage_, other.storage_, size_ * sizeof(TransitionT));
+  }
+
+  TransitionBuffer& operator=(const TransitionBuffer& other) {
+    size_ = other.size_;
+    std::memmove(storage_, other.storage_, size_ * sizeof(TransitionT));
+    return *this;
+  }
+
+  void push_back(const TransitionT& transition) {
+    if (size_ == TRAVERSAL_STATE_MAX_TRANSITIONS) {
+      throw std::length_error("too many transitions for a traversal state");
+    }
+    new (data() + size_) TransitionT(transition);
+    ++size_;
+  }
+
+  void clear() { size_ = 0; }
+
+  size_t size() const { return size_; }
+
+  bool empty() const { return size_ == 0; }
+
+  TransitionT& operator[](size_t i) { return data()[i]; }
+
+  const TransitionT& operator[](size_t i) const { return data()[i]; }
+
+  TransitionT* begin() { return data(); }
+
+  TransitionT* end() { return data() + size_; }
+
+  const TransitionT* begin() const { return data(); }
+
+  const TransitionT* end() const { return data() + size_; }
+
+  TransitionT* data() { return reinterpret_cast<TransitionT*>(storage_); }
+
+  const TransitionT* data() const { return reinterpret_cast<const TransitionT*>(storage_); }
+
+ private:
+  alignas(TransitionT) unsigned char storage_[TRAVERSAL_STATE_MAX_TRANSITIONS * sizeof(TransitionT)];
+  size_t size_;
+};
+
+/**
+ * Payload of a traversal stack.
+ *
+ * transitions_t is the container for the outgoing transitions of a state. The built-in transition types all use
+ * TransitionBuffer, a custom transition type can specialize its payload to use another container.
+ */
 template <class TransitionT = Transition>
 struct TraversalPayload {
+  using transitions_t = TransitionBuffer<TransitionT>;
+
   TraversalPayload() : current_depth(0) {}
 
   size_t current_depth;
@@ -53,7 +148,7 @@ struct TraversalPayload {
 
 template <class TransitionT = Transition>
 struct TraversalStatePayload {
-  std::vector<TransitionT> transitions;
+  typename TraversalPayload<TransitionT>::transitions_t transitions;
   size_t position = 0;
 };
 
@@ -101,18 +196,109 @@ struct TraversalState {
   TraversalStatePayload<TransitionT> traversal_state_payload;
 };
 
+/**
+ * Depth-indexed storage for traversal states, re-used across traversals.
+ *
+ * Every thread keeps a small pool of state vectors per transition type. A traversal stack takes one from the pool
+ * and gives it back when it is destroyed, so after warm-up traversals do not allocate.
+ */
+template <class TransitionT = Transition>
+class TraversalStateArena final {
+ public:
+  using states_t = std::vector<TraversalState<TransitionT>>;
+
+  static states_t Acquire() {
+    if (!PoolDestroyed()) {
+      std::vector<states_t>& pool = Pool().free_states;
+      if (!pool.empty()) {
+        states_t states = std::move(pool.back());
+        pool.pop_back();
+
+        // reset to a pristine state, this does not touch the transition storage
+        for (auto& state : states) {
+          state.traversal_state_payload = TraversalStatePayload<TransitionT>();
+        }
+        return states;
+      }
+    }
+
+    states_t states;
+    states.resize(TRAVERSAL_STACK_INITIAL_DEPTH);
+    return states;
+  }
+
+  static void Release(states_t&& states) {
+    // the pool might be gone already if this happens at thread exit
+    if (states.empty() || PoolDestroyed()) {
+      return;
+    }
+
+    std::vector<states_t>& pool = Pool().free_states;
+    if (pool.size() < TRAVERSAL_STATE_ARENA_MAX_POOLED) {
+      // a single deep traversal should not pin its memory
+      if (states.size() > TRAVERSAL_STATE_ARENA_MAX_POOLED_DEPTH) {
+        states.resize(TRAVERSAL_STATE_ARENA_MAX_POOLED_DEPTH);
+        states.shrink_to_fit();
+      }
+      pool.push_back(std::move(states));
+    }
+  }
+
+ private:
+  struct StatesPool {
+    ~StatesPool() { PoolDestroyed() = true; }
+
+    std::vector<states_t> free_states;
+  };
+
+  static StatesPool& Pool() {
+    thread_local StatesPool pool;
+    return pool;
+  }
+
+  static bool& PoolDestroyed() {
+    thread_local bool destroyed = false;
+    return destroyed;
+  }
+};
+
 /**
  * A helper data structure memorize the path of a graph traversal.
  */
 template <class TransitionT = Transition>
 struct TraversalStack {
-  TraversalStack() : traversal_states(), traversal_stack_payload() { traversal_states.resize(20); }
+  TraversalStack() : traversal_states(TraversalStateArena<TransitionT>::Acquire()), traversal_stack_payload() {}
 
   explicit TraversalStack(TraversalPayload<TransitionT>&& payload)
-      : traversal_states(), traversal_stack_payload(std::move(payload)) {
-    traversal_states.resize(20);
+      : traversal_states(TraversalStateArena<TransitionT>::Acquire()), traversal_stack_payload(std::move(payload)) {}
+
+  TraversalStack(const TraversalStack& other)
+      : traversal_states(TraversalStateArena<TransitionT>::Acquire()),
+        traversal_stack_payload(other.traversal_stack_payload) {
+    CopyStates(other);
+  }
+
+  TraversalStack(TraversalStack&& other) = default;
+
+  TraversalStack& operator=(const TraversalStack& other) {
+    if (this != &other) {
+      traversal_stack_payload = other.traversal_stack_payload;
+      CopyStates(other);
+    }
+    return *this;
   }
 
+  TraversalStack& operator=(TraversalStack&& other) {
+    if (this != &other) {
+      TraversalStateArena<TransitionT>::Release(std::move(traversal_states));
+      traversal_states = std::move(other.traversal_states);
+      traversal_stack_payload = std::move(other.traversal_stack_payload);
+    }
+    return *this;
+  }
+
+  ~TraversalStack() { TraversalStateArena<TransitionT>::Release(std::move(traversal_states)); }
+
   TraversalState<TransitionT>& GetStates() { return traversal_states[traversal_stack_payload.current_depth]; }
 
   const TraversalState<TransitionT>& GetStates() const {
@@ -145,6 +331,19 @@ struct TraversalStack {
 
   std::vector<TraversalState<TransitionT>> traversal_states;
   TraversalPayload<TransitionT> traversal_stack_payload;
+
+ private:
+  /**
+   * Copy the states of the other stack, only the states up to the current depth are in use.
+   */
+  void CopyStates(const TraversalStack& other) {
+    const size_t used_states = std::min(other.traversal_states.size(), other.traversal_stack_payload.current_depth + 1);
+
+    if (traversal_states.size() < other.traversal_states.size()) {
+      traversal_states.resize(other.traversal_states.size());
+    }
+    std::copy(other.traversal_states.begin(), other.traversal_states.begin() + used_states, traversal_states.begin());
+  }
 };
 
 } /* namespace traversal */
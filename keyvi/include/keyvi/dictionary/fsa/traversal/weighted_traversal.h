@@ -27,6 +27,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <utility>
 
 #include "keyvi/dictionary/fsa/traversal/traversal_base.h"
 
@@ -46,6 +47,11 @@ struct WeightedTransition {
   unsigned char label;
 };
 
+/**
+ * Up to this number of transitions, sort with insertion sort, more transitions get merge sorted in runs of this length.
+ */
+static const size_t WEIGHTED_TRANSITION_INSERTION_SORT_THRESHOLD = 32;
+
 static bool WeightedTransitionCompare(const WeightedTransition& a, const WeightedTransition& b) {
   TRACE("compare %d %d", a.weight, b.weight);
 
@@ -54,6 +60,8 @@ static bool WeightedTransitionCompare(const WeightedTransition& a, const Weighte
 
 template <>
 struct TraversalPayload<WeightedTransition> {
+  using transitions_t = TransitionBuffer<WeightedTransition>;
+
   size_t current_depth;
   uint32_t min_weight = 0;
 };
@@ -66,12 +74,80 @@ inline void TraversalState<WeightedTransition>::Add(uint64_t s, uint32_t weight,
   }
 }
 
+/**
+ * Stable insertion sort of the transitions in [begin, end), for the typical small fan-out this is the fastest option.
+ */
+inline void InsertionSortWeightedTransitions(WeightedTransition* transitions, size_t begin, size_t end) {
+  for (size_t i = begin + 1; i < end; ++i) {
+    const WeightedTransition transition = transitions[i];
+    size_t j = i;
+    while (j > begin && WeightedTransitionCompare(transition, transitions[j - 1])) {
+      transitions[j] = transitions[j - 1];
+      --j;
+    }
+    transitions[j] = transition;
+  }
+}
+
+/**
+ * Stable bottom-up merge sort, merges insertion sorted runs using the given scratch space instead of allocating.
+ */
+inline void MergeSortWeightedTransitions(WeightedTransition* transitions, WeightedTransition* scratch,
+                                         size_t number_of_transitions) {
+  for (size_t begin = 0; begin < number_of_transitions; begin += WEIGHTED_TRANSITION_INSERTION_SORT_THRESHOLD) {
+    InsertionSortWeightedTransitions(
+        transitions, begin, std::min(begin + WEIGHTED_TRANSITION_INSERTION_SORT_THRESHOLD, number_of_transitions));
+  }
+
+  WeightedTransition* from = transitions;
+  WeightedTransition* to = scratch;
+
+  for (size_t width = WEIGHTED_TRANSITION_INSERTION_SORT_THRESHOLD; width < number_of_transitions; width *= 2) {
+    for (size_t left = 0; left < number_of_transitions; left += 2 * width) {
+      const size_t middle = std::min(left + width, number_of_transitions);
+      const size_t right = std::min(left + 2 * width, number_of_transitions);
+      size_t i = left;
+      size_t j = middle;
+      size_t k = left;
+
+      while (i < middle && j < right) {
+        // on equal weights take from the left run to keep the sort stable
+        to[k++] = WeightedTransitionCompare(from[j], from[i]) ? from[j++] : from[i++];
+      }
+      while (i < middle) {
+        to[k++] = from[i++];
+      }
+      while (j < right) {
+        to[k++] = from[j++];
+      }
+    }
+    std::swap(from, to);
+  }
+
+  if (from != transitions) {
+    std::copy(from, from + number_of_transitions, transitions);
+  }
+}
+
+/**
+ * Per thread scratch space for sorting the transitions of a state.
+ */
+inline TransitionBuffer<WeightedTransition>& WeightedTransitionSortBuffer() {
+  thread_local TransitionBuffer<WeightedTransition> buffer;
+  return buffer;
+}
+
 template <>
 inline void TraversalState<WeightedTransition>::PostProcess(TraversalPayload<WeightedTransition>* payload) {
-  if (traversal_state_payload.transitions.size() > 0) {
-    std::stable_sort(traversal_state_payload.transitions.begin(), traversal_state_payload.transitions.end(),
-                     WeightedTransitionCompare);
+  const size_t number_of_transitions = traversal_state_payload.transitions.size();
+
+  if (number_of_transitions > WEIGHTED_TRANSITION_INSERTION_SORT_THRESHOLD) {
+    MergeSortWeightedTransitions(traversal_state_payload.transitions.data(), WeightedTransitionSortBuffer().data(),
+                                 number_of_transitions);
+    return;
   }
+
+  InsertionSortWeightedTransitions(traversal_state_payload.transitions.data(), 0, number_of_transitions);
 }
 
 template <>
@@ -26,14 +26,18 @@
 #define KEYVI_DICTIONARY_MATCH_H_
 
 #include <memory>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <variant>
+#include <vector>
 
 #include <boost/container/flat_map.hpp>
 
 #include "keyvi/compression/compression_strategy.h"
 #include "keyvi/dictionary/fsa/automata.h"
+#include "keyvi/util/float_vector_value.h"
 #include "keyvi/util/json_value.h"
 
 // #define ENABLE_TRACING
@@ -180,6 +184,27 @@ struct Match {
     return fsa_->GetWeight(state_);
   }
 
+  /**
+   * Get the value as float vector, uncompressed values are not copied.
+   *
+   * @param dimensions returns the number of dimensions
+   * @param buffer buffer for the decoded vector if the value can not be used in place
+   * @return pointer to the floats, the pointer might not be aligned
+   */
+  const float* GetFloatVector(size_t* dimensions, std::vector<float>* buffer) const {
+    if (fsa_) {
+      return fsa_->GetFloatVector(state_, dimensions, buffer);
+    }
+
+    if (raw_value_.size() == 0) {
+      throw std::invalid_argument("match has no value");
+    }
+
+    *buffer = keyvi::util::DecodeFloatVector(raw_value_);
+    *dimensions = buffer->size();
+    return buffer->data();
+  }
+
   std::string GetValueAsString() const {
     if (!fsa_) {
       if (raw_value_.size() != 0) {
@@ -229,6 +254,35 @@ struct Match {
     return fsa_->GetMsgPackedValueAsString(state_, compression_algorithm);
   }
 
+  /**
+   * Get the value as string without copying it if possible.
+   *
+   * @param buffer buffer for the value if it can not be returned in place
+   * @return view on the value, valid as long as the match and the buffer are
+   */
+  std::string_view GetValueAsStringView(std::string* buffer) const {
+    if (!fsa_) {
+      *buffer = GetValueAsString();
+      return *buffer;
+    }
+
+    return fsa_->GetValueAsStringView(state_, buffer);
+  }
+
+  /**
+   * Get the value as msgpack without copying it if possible, uncompressed values are returned in place.
+   *
+   * @param buffer buffer for the value if it can not be returned in place, e.g. because it is compressed
+   * @return view on the msgpack'ed value, valid as long as the match and the buffer are
+   */
+  std::string_view GetMsgPackedValueView(std::string* buffer) const {
+    if (!fsa_) {
+      return compression::DecompressToView(raw_value_.data(), raw_value_.size(), buffer);
+    }
+
+    return fsa_->GetMsgPackedValueView(state_, buffer);
+  }
+
   /**
    * being able to set the value, e.g. when keyvi is used over network boundaries
    *
@@ -253,6 +307,30 @@ struct Match {
   friend match_t index::internal::FirstFilteredMatch(const MatcherT&, const DeletedT&);
 
   fsa::automata_t& GetFsa() { return fsa_; }
+
+  // friend for re-using matches
+  friend class MatchPool;
+
+  /**
+   * Re-initialize a match, the strings keep their capacity.
+   */
+  void Reset(size_t a, size_t b, const std::string& matched_item, uint32_t score = 0, uint32_t weight = 0) {
+    start_ = a;
+    end_ = b;
+    matched_item_.assign(matched_item);
+    raw_value_.clear();
+    score_ = score;
+    fsa_.reset();
+    state_ = 0;
+    attributes_.reset();
+  }
+
+  void Reset(size_t a, size_t b, const std::string& matched_item, uint32_t score, const fsa::automata_t& fsa,
+             uint64_t state, uint32_t weight = 0) {
+    Reset(a, b, matched_item, score);
+    fsa_ = fsa;
+    state_ = state;
+  }
 };
 
 } /* namespace dictionary */
@@ -25,6 +25,8 @@
 #ifndef KEYVI_DICTIONARY_MATCH_ITERATOR_H_
 #define KEYVI_DICTIONARY_MATCH_ITERATOR_H_
 
+#include <cstdint>
+#include <functional>
 #include <utility>
 
 #include <boost/iterator/iterator_facade.hpp>
@@ -52,6 +54,8 @@ namespace dictionary {
  *  http://www.codeproject.com/Articles/384572/Implementation-of-Delegates-in-Cplusplus11
  *  http://www.codeproject.com/Articles/11015/The-Impossibly-Fast-C-Delegates
  *  http://codereview.stackexchange.com/questions/14730/impossibly-fast-delegate-in-c11
+ *
+ *  If the matcher type is known at compile time, MatcherRange/MatcherIterator avoid the indirection.
  */
 class MatchIterator : public boost::iterator_facade<MatchIterator, match_t const, boost::single_pass_traversal_tag> {
  public:
@@ -124,6 +128,76 @@ class MatchIterator : public boost::iterator_facade<MatchIterator, match_t const
   std::function<void(uint32_t)> set_min_weight_;
 };
 
+/**
+ * A statically typed match iterator, it calls the matcher directly instead of going through a std::function.
+ *
+ * Use it from C++ code that knows the matcher type at compile time, this allows the compiler to inline NextMatch and
+ * avoids the allocation of the closure. The iterator does not own the matcher, see MatcherRange.
+ */
+template <class MatcherT>
+class MatcherIterator
+    : public boost::iterator_facade<MatcherIterator<MatcherT>, match_t const, boost::single_pass_traversal_tag> {
+ public:
+  explicit MatcherIterator(MatcherT* matcher) : matcher_(matcher), current_match_(std::move(matcher->FirstMatch())) {
+    if (!current_match_) {
+      TRACE("first match empty");
+      increment();
+    }
+  }
+
+  MatcherIterator() : matcher_(nullptr) {}
+
+ private:
+  friend class boost::iterator_core_access;
+
+  void increment() {
+    if (matcher_) {
+      current_match_ = matcher_->NextMatch();
+
+      // if we get an empty match, detach from the matcher
+      if (!current_match_) {
+        TRACE("Matcher Iterator: no more match found");
+        matcher_ = nullptr;
+      }
+    }
+  }
+
+  bool equal(MatcherIterator const& other) const { return !this->current_match_ && !other.current_match_; }
+
+  match_t const& dereference() const { return current_match_; }
+
+ private:
+  MatcherT* matcher_;
+  match_t current_match_;
+};
+
+/**
+ * Owns a matcher and exposes it as a range of matches, the statically typed counterpart of MatchIteratorPair.
+ *
+ * The range is single pass: begin() must only be called once, iterators must not outlive the range.
+ */
+template <class MatcherT>
+class MatcherRange final {
+ public:
+  using iterator = MatcherIterator<MatcherT>;
+
+  explicit MatcherRange(MatcherT&& matcher) : matcher_(std::move(matcher)) {}
+
+  iterator begin() { return iterator(&matcher_); }
+
+  iterator end() const { return iterator(); }
+
+  /**
+   * Only available for matchers that support a minimum weight, e.g. completions.
+   */
+  void SetMinWeight(uint32_t min_weight) { matcher_.SetMinWeight(min_weight); }
+
+  MatcherT& GetMatcher() { return matcher_; }
+
+ private:
+  MatcherT matcher_;
+};
+
 } /* namespace dictionary */
 } /* namespace keyvi */
 
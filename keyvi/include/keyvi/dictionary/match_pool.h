@@ -0,0 +1,298 @@
+/* * keyvi - A key value store.
+ *
+ * Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * match_pool.h
+ */
+
+#ifndef KEYVI_DICTIONARY_MATCH_POOL_H_
+#define KEYVI_DICTIONARY_MATCH_POOL_H_
+
+#include <cstddef>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <new>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "keyvi/dictionary/match.h"
+
+// #define ENABLE_TRACING
+#include "keyvi/dictionary/util/trace.h"
+
+namespace keyvi {
+namespace dictionary {
+
+// default number of matches (and shared pointer control blocks) a pool keeps for re-use
+static const size_t DEFAULT_MATCH_POOL_SIZE = 1024;
+
+// size of the memory blocks used for shared pointer control blocks, larger requests fall back to operator new
+static const size_t MATCH_POOL_BLOCK_SIZE = 64;
+
+/**
+ * An object pool for matches, to be used for queries that emit a lot of matches.
+ *
+ * Matches returned to the pool keep the capacity of their strings, the control blocks of the shared pointers get
+ * recycled as well. After warm-up creating a match does not require global allocations.
+ *
+ * The pool gets activated for the current thread with a Scope, all matches created by dictionaries, matchers and
+ * completers within the scope (e.g. while iterating over the results of a query) come from the pool:
+ *
+ *   MatchPool pool;
+ *   {
+ *     MatchPool::Scope scope(&pool);
+ *     for (auto m : d->GetPrefixCompletion("abc")) { ... }
+ *   }
+ *
+ * Matches can outlive the pool object and can be released from any thread.
+ *
+ * The pool belongs to the thread that created it: on this thread matches and control blocks are taken from and
+ * returned to free lists without locking. Other threads can use the pool as well, but they hand out and return
+ * objects through a separate, locked free list, which the owning thread drains once its own list runs empty.
+ */
+class MatchPool final {
+ public:
+  explicit MatchPool(size_t max_pooled = DEFAULT_MATCH_POOL_SIZE) : pool_state_(std::make_shared<PoolState>()) {
+    pool_state_->max_pooled = max_pooled;
+  }
+
+  MatchPool& operator=(MatchPool const&) = delete;
+  MatchPool(const MatchPool& that) = delete;
+
+  /**
+   * Activates a pool for the current thread, restores the previous pool on destruction.
+   */
+  class Scope final {
+   public:
+    explicit Scope(MatchPool* pool) : previous_(CurrentPool()) { CurrentPool() = pool; }
+
+    ~Scope() { CurrentPool() = previous_; }
+
+    Scope& operator=(Scope const&) = delete;
+    Scope(const Scope& that) = delete;
+
+   private:
+    MatchPool* previous_;
+  };
+
+  /**
+   * Create a match, takes the same arguments as the constructors of Match.
+   */
+  template <typename... Args>
+  match_t Make(Args&&... args) {
+    Match* match = pool_state_->Take(&PoolState::free_matches, &PoolState::shared_free_matches);
+
+    if (match) {
+      match->Reset(std::forward<Args>(args)...);
+    } else {
+      match = new Match(std::forward<Args>(args)...);
+    }
+
+    return match_t(match, MatchRecycler(pool_state_), BlockAllocator<Match>(pool_state_));
+  }
+
+  /**
+   * @return the number of matches available for re-use, must be called on the thread that created the pool.
+   */
+  size_t GetNumberOfPooledMatches() const {
+    std::lock_guard<std::mutex> lock(pool_state_->mutex);
+    return pool_state_->free_matches.size() + pool_state_->shared_free_matches.size();
+  }
+
+  /**
+   * @return the pool active for the current thread or nullptr if no pool is active.
+   */
+  static MatchPool* Current() { return CurrentPool(); }
+
+ private:
+  struct PoolState {
+    ~PoolState() {
+      for (Match* m : free_matches) {
+        delete m;
+      }
+      for (Match* m : shared_free_matches) {
+        delete m;
+      }
+      for (void* block : free_blocks) {
+        ::operator delete(block);
+      }
+      for (void* block : shared_free_blocks) {
+        ::operator delete(block);
+      }
+    }
+
+    bool IsOwner() const { return std::this_thread::get_id() == owner; }
+
+    /**
+     * Take an object from the given free lists, returns nullptr if none is available.
+     */
+    template <typename T>
+    T* Take(std::vector<T*> PoolState::*free_list, std::vector<T*> PoolState::*shared_free_list) {
+      if (IsOwner()) {
+        std::vector<T*>& objects = this->*free_list;
+        if (objects.empty()) {
+          // pick up what other threads returned, a swap keeps the lock short
+          std::lock_guard<std::mutex> lock(mutex);
+          objects.swap(this->*shared_free_list);
+        }
+
+        if (objects.empty()) {
+          return nullptr;
+        }
+        T* object = objects.back();
+        objects.pop_back();
+        return object;
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      std::vector<T*>& objects = this->*shared_free_list;
+      if (objects.empty()) {
+        return nullptr;
+      }
+      T* object = objects.back();
+      objects.pop_back();
+      return object;
+    }
+
+    /**
+     * Return an object to the given free lists, returns false if the pool is full.
+     */
+    template <typename T>
+    bool Give(T* object, std::vector<T*> PoolState::*free_list, std::vector<T*> PoolState::*shared_free_list) {
+      if (IsOwner()) {
+        std::vector<T*>& objects = this->*free_list;
+        if (objects.size() < max_pooled) {
+          objects.push_back(object);
+          return true;
+        }
+        return false;
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      std::vector<T*>& objects = this->*shared_free_list;
+      if (objects.size() < max_pooled) {
+        objects.push_back(object);
+        return true;
+      }
+      return false;
+    }
+
+    const std::thread::id owner = std::this_thread::get_id();
+    size_t max_pooled = DEFAULT_MATCH_POOL_SIZE;
+
+    // only accessed by the owning thread
+    std::vector<Match*> free_matches;
+    std::vector<void*> free_blocks;
+
+    // objects taken and returned by other threads, guarded by mutex
+    mutable std::mutex mutex;
+    std::vector<Match*> shared_free_matches;
+    std::vector<void*> shared_free_blocks;
+  };
+
+  using pool_state_t = std::shared_ptr<PoolState>;
+
+  /**
+   * Deleter, returns the match to the pool.
+   */
+  struct MatchRecycler {
+    explicit MatchRecycler(const pool_state_t& pool_state) : pool_state(pool_state) {}
+
+    void operator()(Match* match) const {
+      // drop references early, but keep the string capacity
+      match->fsa_.reset();
+      match->attributes_.reset();
+
+      if (!pool_state->Give(match, &PoolState::free_matches, &PoolState::shared_free_matches)) {
+        delete match;
+      }
+    }
+
+    pool_state_t pool_state;
+  };
+
+  /**
+   * Allocator for the shared pointer control block, hands out fixed size blocks from the pool.
+   */
+  template <typename T>
+  struct BlockAllocator {
+    using value_type = T;
+
+    explicit BlockAllocator(const pool_state_t& pool_state) : pool_state(pool_state) {}
+
+    template <typename U>
+    BlockAllocator(const BlockAllocator<U>& other) : pool_state(other.pool_state) {}  // NOLINT
+
+    T* allocate(size_t n) {
+      if (n * sizeof(T) > MATCH_POOL_BLOCK_SIZE || alignof(T) > alignof(std::max_align_t)) {
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+      }
+
+      void* block = pool_state->Take(&PoolState::free_blocks, &PoolState::shared_free_blocks);
+      if (block) {
+        return static_cast<T*>(block);
+      }
+      return static_cast<T*>(::operator new(MATCH_POOL_BLOCK_SIZE));
+    }
+
+    void deallocate(T* p, size_t n) {
+      if (n * sizeof(T) <= MATCH_POOL_BLOCK_SIZE && alignof(T) <= alignof(std::max_align_t) &&
+          pool_state->Give(static_cast<void*>(p), &PoolState::free_blocks, &PoolState::shared_free_blocks)) {
+        return;
+      }
+      ::operator delete(p);
+    }
+
+    template <typename U>
+    bool operator==(const BlockAllocator<U>& other) const {
+      return pool_state == other.pool_state;
+    }
+
+    template <typename U>
+    bool operator!=(const BlockAllocator<U>& other) const {
+      return pool_state != other.pool_state;
+    }
+
+    pool_state_t pool_state;
+  };
+
+  pool_state_t pool_state_;
+
+  static MatchPool*& CurrentPool() {
+    thread_local MatchPool* pool = nullptr;
+    return pool;
+  }
+};
+
+/**
+ * Create a match, from the pool active for this thread (see MatchPool::Scope) or with make_shared otherwise.
+ */
+template <typename... Args>
+inline match_t MakeMatch(Args&&... args) {
+  MatchPool* pool = MatchPool::Current();
+  if (pool) {
+    return pool->Make(std::forward<Args>(args)...);
+  }
+
+  return std::make_shared<Match>(std::forward<Args>(args)...);
+}
+
+} /* namespace dictionary */
+} /* namespace keyvi */
+
+#endif  // KEYVI_DICTIONARY_MATCH_POOL_H_
@@ -38,7 +38,9 @@
 #include "keyvi/dictionary/fsa/traverser_types.h"
 #include "keyvi/dictionary/fsa/zip_state_traverser.h"
 #include "keyvi/dictionary/match.h"
+#include "keyvi/dictionary/match_pool.h"
 #include "keyvi/dictionary/util/utf8_utils.h"
+#include "keyvi/stringdistance/bit_parallel_levenshtein.h"
 #include "keyvi/stringdistance/levenshtein.h"
 
 // #define ENABLE_TRACING
@@ -58,7 +60,21 @@ keyvi::dictionary::match_t NextFilteredMatch(const MatcherT&, const DeletedT&);
 namespace dictionary {
 namespace matching {
 
-template <class codepointInnerTraverserType = fsa::WeightedStateTraverser>
+/**
+ * Algorithm used for calculating the edit distance, both return the same matches.
+ *
+ * BIT_PARALLEL supports queries of up to BIT_PARALLEL_LEVENSHTEIN_MAX_LENGTH codepoints, longer queries fall back to
+ * NEEDLEMAN_WUNSCH.
+ */
+enum class fuzzy_strategy_t { NEEDLEMAN_WUNSCH, BIT_PARALLEL };
+
+inline bool UseBitParallelLevenshtein(const fuzzy_strategy_t strategy, const std::string& query) {
+  return strategy == fuzzy_strategy_t::BIT_PARALLEL &&
+         stringdistance::BitParallelLevenshtein::Supports(utf8::unchecked::distance(query.begin(), query.end()));
+}
+
+template <class codepointInnerTraverserType = fsa::WeightedStateTraverser,
+          class DistanceMetricT = stringdistance::Levenshtein>
 class FuzzyMatching final {
  public:
   /**
@@ -102,7 +118,7 @@ class FuzzyMatching final {
     }
 
     if (depth != minimum_exact_prefix) {
-      return FuzzyMatching<innerTraverserType>();
+      return FuzzyMatching<innerTraverserType, DistanceMetricT>();
     }
 
     return FromSingleFsaWithMatchedExactPrefix<innerTraverserType>(fsa, state, query, max_edit_distance,
@@ -118,7 +134,7 @@ class FuzzyMatching final {
    * @param minimum_exact_prefix the minimum exact prefix to match before matching approximate
    */
   template <class innerTraverserType = fsa::WeightedStateTraverser>
-  static FuzzyMatching<fsa::ZipStateTraverser<innerTraverserType>> FromMulipleFsas(
+  static FuzzyMatching<fsa::ZipStateTraverser<innerTraverserType>, DistanceMetricT> FromMulipleFsas(
       const std::vector<fsa::automata_t>& fsas, const std::string& query, const int32_t max_edit_distance,
       const size_t minimum_exact_prefix = 2) {
     std::vector<std::pair<fsa::automata_t, uint64_t>> fsa_start_state_pairs =
@@ -173,8 +189,8 @@ class FuzzyMatching final {
 
       if (traverser_ptr_->IsFinalState() && metric_ptr_->GetScore() <= max_edit_distance_) {
         TRACE("found match %s %lu", metric_ptr_->GetCandidate().c_str(), traverser_ptr_->GetStateValue());
-        match_t m = std::make_shared<Match>(0, candidate_length(), metric_ptr_->GetCandidate(), metric_ptr_->GetScore(),
-                                            traverser_ptr_->GetFsa(), traverser_ptr_->GetStateValue());
+        match_t m = MakeMatch(0, candidate_length(), metric_ptr_->GetCandidate(), metric_ptr_->GetScore(),
+                              traverser_ptr_->GetFsa(), traverser_ptr_->GetStateValue());
         (*traverser_ptr_)++;
         return m;
       }
@@ -184,8 +200,8 @@ class FuzzyMatching final {
 
  private:
   FuzzyMatching(std::unique_ptr<fsa::CodePointStateTraverser<codepointInnerTraverserType>>&& traverser,
-                std::unique_ptr<stringdistance::Levenshtein>&& metric, match_t&& first_match,
-                const int32_t max_edit_distance, const size_t minimum_exact_prefix)
+                std::unique_ptr<DistanceMetricT>&& metric, match_t&& first_match, const int32_t max_edit_distance,
+                const size_t minimum_exact_prefix)
       : metric_ptr_(std::move(metric)),
         traverser_ptr_(std::move(traverser)),
         max_edit_distance_(max_edit_distance),
@@ -200,7 +216,7 @@ class FuzzyMatching final {
   FuzzyMatching() : max_edit_distance_(0), exact_prefix_(0) {}
 
  private:
-  std::unique_ptr<stringdistance::Levenshtein> metric_ptr_;
+  std::unique_ptr<DistanceMetricT> metric_ptr_;
   std::unique_ptr<fsa::CodePointStateTraverser<codepointInnerTraverserType>> traverser_ptr_;
   const int32_t max_edit_distance_;
   const size_t exact_prefix_;
@@ -229,10 +245,10 @@ class FuzzyMatching final {
                                                            const std::string& query, const int32_t max_edit_distance,
                                                            const size_t exact_prefix) {
     if (start_state == 0) {
-      return FuzzyMatching<innerTraverserType>();
+      return FuzzyMatching<innerTraverserType, DistanceMetricT>();
     }
 
-    std::unique_ptr<stringdistance::Levenshtein> metric;
+    std::unique_ptr<DistanceMetricT> metric;
     std::unique_ptr<fsa::CodePointStateTraverser<innerTraverserType>> traverser;
     match_t first_match;
 
@@ -241,11 +257,11 @@ class FuzzyMatching final {
 
     if (start_state == 0) {
       TRACE("query lengh < minimum exact prefix, returning empty iterator");
-      return FuzzyMatching<innerTraverserType>();
+      return FuzzyMatching<innerTraverserType, DistanceMetricT>();
     }
 
     // initialize the distance metric with the exact prefix
-    metric.reset(new stringdistance::Levenshtein(codepoints, 20, max_edit_distance));
+    metric.reset(new DistanceMetricT(codepoints, 20, max_edit_distance));
     for (size_t i = 0; i < exact_prefix; ++i) {
       metric->Put(codepoints[i], i);
     }
@@ -254,13 +270,13 @@ class FuzzyMatching final {
 
     if (fsa->IsFinalState(start_state) && metric->GetScore() <= max_edit_distance) {
       TRACE("exact prefix matched");
-      first_match = std::make_shared<Match>(0, exact_prefix, metric->GetCandidate(), metric->GetScore(), fsa,
-                                            fsa->GetStateValue(start_state));
+      first_match = MakeMatch(0, exact_prefix, metric->GetCandidate(), metric->GetScore(), fsa,
+                              fsa->GetStateValue(start_state));
     }
 
     TRACE("create iterator");
-    return FuzzyMatching<innerTraverserType>(std::move(traverser), std::move(metric), std::move(first_match),
-                                             max_edit_distance, exact_prefix);
+    return FuzzyMatching<innerTraverserType, DistanceMetricT>(std::move(traverser), std::move(metric),
+                                                              std::move(first_match), max_edit_distance, exact_prefix);
   }
 
   /**
@@ -272,15 +288,16 @@ class FuzzyMatching final {
    * @param exact_prefix the exact prefix that already matched
    */
   template <class innerTraverserType = fsa::WeightedStateTraverser>
-  static FuzzyMatching<fsa::ZipStateTraverser<innerTraverserType>> FromMulipleFsasWithMatchedExactPrefix(
+  static FuzzyMatching<fsa::ZipStateTraverser<innerTraverserType>, DistanceMetricT>
+  FromMulipleFsasWithMatchedExactPrefix(
       const std::vector<std::pair<fsa::automata_t, uint64_t>>& fsa_start_state_pairs, const std::string& query,
       const int32_t max_edit_distance, const size_t exact_prefix) {
     // if the list of fsa's is empty return an empty matcher
     if (fsa_start_state_pairs.size() == 0) {
-      return FuzzyMatching<fsa::ZipStateTraverser<innerTraverserType>>();
+      return FuzzyMatching<fsa::ZipStateTraverser<innerTraverserType>, DistanceMetricT>();
     }
 
-    std::unique_ptr<stringdistance::Levenshtein> metric;
+    std::unique_ptr<DistanceMetricT> metric;
     std::unique_ptr<fsa::CodePointStateTraverser<fsa::ZipStateTraverser<innerTraverserType>>> traverser;
     match_t first_match;
 
@@ -289,7 +306,7 @@ class FuzzyMatching final {
     utf8::unchecked::utf8to32(query.begin(), query.end(), back_inserter(codepoints));
 
     // initialize the distance metric with the exact prefix
-    metric.reset(new stringdistance::Levenshtein(codepoints, 20, max_edit_distance));
+    metric.reset(new DistanceMetricT(codepoints, 20, max_edit_distance));
     for (size_t i = 0; i < exact_prefix; ++i) {
       metric->Put(codepoints[i], i);
     }
@@ -297,8 +314,8 @@ class FuzzyMatching final {
     // check for a match given the exact prefix
     for (const auto& fsa_state : fsa_start_state_pairs) {
       if (fsa_state.first->IsFinalState(fsa_state.second) && metric->GetScore() <= max_edit_distance) {
-        first_match = std::make_shared<Match>(0, exact_prefix, metric->GetCandidate(), metric->GetScore(),
-                                              fsa_state.first, fsa_state.first->GetStateValue(fsa_state.second));
+        first_match = MakeMatch(0, exact_prefix, metric->GetCandidate(), metric->GetScore(), fsa_state.first,
+                                fsa_state.first->GetStateValue(fsa_state.second));
         break;
       }
     }
@@ -309,7 +326,7 @@ class FuzzyMatching final {
         new fsa::CodePointStateTraverser<fsa::ZipStateTraverser<innerTraverserType>>(std::move(zip_state_traverser)));
 
     TRACE("create iterator");
-    return FuzzyMatching<fsa::ZipStateTraverser<innerTraverserType>>(
+    return FuzzyMatching<fsa::ZipStateTraverser<innerTraverserType>, DistanceMetricT>(
         std::move(traverser), std::move(metric), std::move(first_match), max_edit_distance, exact_prefix);
   }
 
@@ -34,6 +34,7 @@
 #include "keyvi/dictionary/fsa/traverser_types.h"
 #include "keyvi/dictionary/fsa/zip_state_traverser.h"
 #include "keyvi/dictionary/match.h"
+#include "keyvi/dictionary/match_pool.h"
 #include "keyvi/dictionary/util/transform.h"
 #include "keyvi/dictionary/util/utf8_utils.h"
 #include "keyvi/stringdistance/levenshtein.h"
@@ -126,7 +127,7 @@ class FuzzyMultiwordCompletionMatching final {
     match_t first_match;
     if (depth == utf8_query_length && fsa->IsFinalState(state)) {
       TRACE("first_match %d %s", utf8_query_length, query);
-      first_match = std::make_shared<Match>(0, utf8_query_length, query, 0, fsa, fsa->GetStateValue(state));
+      first_match = MakeMatch(0, utf8_query_length, query, 0, fsa, fsa->GetStateValue(state));
     }
 
     return FuzzyMultiwordCompletionMatching(std::move(traverser), std::move(first_match), std::move(metric),
@@ -190,8 +191,8 @@ class FuzzyMultiwordCompletionMatching final {
     // check for a match given the exact prefix
     for (const auto& fsa_state : fsa_start_state_pairs) {
       if (fsa_state.first->IsFinalState(fsa_state.second)) {
-        first_match = std::make_shared<Match>(0, query_length, query, 0, fsa_state.first,
-                                              fsa_state.first->GetStateValue(fsa_state.second));
+        first_match = MakeMatch(0, query_length, query, 0, fsa_state.first,
+                                fsa_state.first->GetStateValue(fsa_state.second));
         break;
       }
     }
@@ -254,9 +255,8 @@ class FuzzyMultiwordCompletionMatching final {
                                     : distance_metric_->GetCandidate();
 
         TRACE("found final state at depth %d %s", prefix_length_ + traverser_ptr_->GetDepth(), match_str.c_str());
-        match_t m = std::make_shared<Match>(0, prefix_length_ + traverser_ptr_->GetDepth(), match_str,
-                                            distance_metric_->GetScore(), traverser_ptr_->GetFsa(),
-                                            traverser_ptr_->GetStateValue());
+        match_t m = MakeMatch(0, prefix_length_ + traverser_ptr_->GetDepth(), match_str, distance_metric_->GetScore(),
+                              traverser_ptr_->GetFsa(), traverser_ptr_->GetStateValue());
 
         (*traverser_ptr_)++;
         return m;
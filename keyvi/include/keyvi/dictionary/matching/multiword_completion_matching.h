@@ -32,6 +32,7 @@
 #include "keyvi/dictionary/fsa/traverser_types.h"
 #include "keyvi/dictionary/fsa/zip_state_traverser.h"
 #include "keyvi/dictionary/match.h"
+#include "keyvi/dictionary/match_pool.h"
 #include "keyvi/dictionary/util/transform.h"
 
 // #define ENABLE_TRACING
@@ -108,7 +109,7 @@ class MultiwordCompletionMatching final {
     std::unique_ptr<innerTraverserType> traverser = std::make_unique<innerTraverserType>(fsa, state);
 
     if (fsa->IsFinalState(state)) {
-      first_match = std::make_shared<Match>(0, query_length, query, 0, fsa, fsa->GetStateValue(state));
+      first_match = MakeMatch(0, query_length, query, 0, fsa, fsa->GetStateValue(state));
     }
 
     TRACE("create matcher");
@@ -159,8 +160,8 @@ class MultiwordCompletionMatching final {
     // check for a match given the exact prefix
     for (const auto& fsa_state : fsa_start_state_pairs) {
       if (fsa_state.first->IsFinalState(fsa_state.second)) {
-        first_match = std::make_shared<Match>(0, query_length, query, 0, fsa_state.first,
-                                              fsa_state.first->GetStateValue(fsa_state.second));
+        first_match = MakeMatch(0, query_length, query, 0, fsa_state.first,
+                                fsa_state.first->GetStateValue(fsa_state.second));
         break;
       }
     }
@@ -203,8 +204,8 @@ class MultiwordCompletionMatching final {
                 : std::string(traversal_stack_->begin(), traversal_stack_->end());
 
         TRACE("found final state at depth %d %s", prefix_length_ + traverser_ptr_->GetDepth(), match_str.c_str());
-        match_t m = std::make_shared<Match>(0, prefix_length_ + traverser_ptr_->GetDepth(), match_str, 0,
-                                            traverser_ptr_->GetFsa(), traverser_ptr_->GetStateValue());
+        match_t m = MakeMatch(0, prefix_length_ + traverser_ptr_->GetDepth(), match_str, 0, traverser_ptr_->GetFsa(),
+                              traverser_ptr_->GetStateValue());
 
         (*traverser_ptr_)++;
         return m;
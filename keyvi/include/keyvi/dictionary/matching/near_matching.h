@@ -33,6 +33,7 @@
 #include "keyvi/dictionary/fsa/traverser_types.h"
 #include "keyvi/dictionary/fsa/zip_state_traverser.h"
 #include "keyvi/dictionary/match.h"
+#include "keyvi/dictionary/match_pool.h"
 
 // #define ENABLE_TRACING
 #include "keyvi/dictionary/util/trace.h"
@@ -127,9 +128,9 @@ class NearMatching final {
                                         traverser_ptr_->GetDepth());
 
         // length should be query.size???
-        match_t m = std::make_shared<Match>(0, traverser_ptr_->GetDepth() + exact_prefix_.size(), match_str,
-                                            exact_prefix_.size() + traverser_ptr_->GetTraversalPayload().exact_depth,
-                                            traverser_ptr_->GetFsa(), traverser_ptr_->GetStateValue());
+        match_t m = MakeMatch(0, traverser_ptr_->GetDepth() + exact_prefix_.size(), match_str,
+                              exact_prefix_.size() + traverser_ptr_->GetTraversalPayload().exact_depth,
+                              traverser_ptr_->GetFsa(), traverser_ptr_->GetStateValue());
 
         if (!greedy_) {
           // remember the depth
@@ -185,7 +186,7 @@ class NearMatching final {
                                                           const bool greedy = false) {
     match_t first_match;
     if (fsa->IsFinalState(start_state)) {
-      first_match = std::make_shared<Match>(0, query.size(), query, exact_prefix, fsa, fsa->GetStateValue(start_state));
+      first_match = MakeMatch(0, query.size(), query, exact_prefix, fsa, fsa->GetStateValue(start_state));
     }
 
     std::shared_ptr<std::string> near_key = std::make_shared<std::string>(query.substr(exact_prefix));
@@ -223,8 +224,8 @@ class NearMatching final {
     // check if the prefix is already an exact match
     for (const auto& fsa_state : boost::adaptors::reverse(fsa_start_state_payloads)) {
       if (std::get<0>(fsa_state)->IsFinalState(std::get<1>(fsa_state))) {
-        first_match = std::make_shared<Match>(0, query.size(), query, exact_prefix, std::get<0>(fsa_state),
-                                              std::get<0>(fsa_state)->GetStateValue(std::get<1>(fsa_state)));
+        first_match = MakeMatch(0, query.size(), query, exact_prefix, std::get<0>(fsa_state),
+                                std::get<0>(fsa_state)->GetStateValue(std::get<1>(fsa_state)));
         break;
       }
     }
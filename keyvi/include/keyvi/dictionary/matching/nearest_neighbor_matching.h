@@ -0,0 +1,287 @@
+/* keyvi - A key value store.
+ *
+ * Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * nearest_neighbor_matching.h
+ */
+
+#ifndef KEYVI_DICTIONARY_MATCHING_NEAREST_NEIGHBOR_MATCHING_H_
+#define KEYVI_DICTIONARY_MATCHING_NEAREST_NEIGHBOR_MATCHING_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "keyvi/dictionary/fsa/automata.h"
+#include "keyvi/dictionary/fsa/entry_iterator.h"
+#include "keyvi/dictionary/match.h"
+#include "keyvi/dictionary/match_pool.h"
+#include "keyvi/util/float_vector_distance.h"
+
+// #define ENABLE_TRACING
+#include "keyvi/dictionary/util/trace.h"
+
+namespace keyvi {
+namespace dictionary {
+namespace matching {
+
+/**
+ * Brute force k nearest neighbor search over float vector values.
+ *
+ * Scores every candidate against the query vector and returns the k best in order, the score of a match is the
+ * similarity (dot product, cosine) or the distance (euclidean). Candidates are either all entries of a dictionary or
+ * the results of another query, e.g. a prefix completion.
+ */
+class NearestNeighborMatching final {
+ public:
+  /**
+   * Create a nearest neighbor matcher over all entries of a dictionary with float vector values.
+   *
+   * The key space is split by the first byte of the key, threads take the next subtree until all are done.
+   *
+   * @param fsa the fsa
+   * @param query the query vector
+   * @param k the number of neighbors to return
+   * @param distance the distance function
+   * @param number_of_threads the number of threads to use for scoring
+   */
+  static NearestNeighborMatching FromSingleFsa(
+      const fsa::automata_t& fsa, const std::vector<float>& query, const size_t k,
+      const keyvi::util::float_vector_distance_t distance = keyvi::util::float_vector_distance_t::COSINE,
+      const size_t number_of_threads = 1) {
+    if (k == 0 || fsa->GetNumberOfKeys() == 0) {
+      return NearestNeighborMatching();
+    }
+
+    const keyvi::util::FloatVectorScorer scorer(query, distance);
+    const uint64_t start_state = fsa->GetStartState();
+
+    std::vector<std::pair<unsigned char, uint64_t>> subtrees;
+    for (size_t label = 0; label < 256; ++label) {
+      const uint64_t state = fsa->TryWalkTransition(start_state, static_cast<unsigned char>(label));
+      if (state != 0) {
+        subtrees.emplace_back(static_cast<unsigned char>(label), state);
+      }
+    }
+
+    std::vector<TopK<std::string>> partial_results(std::max<size_t>(1, std::min(number_of_threads, subtrees.size())),
+                                                   TopK<std::string>(k));
+    if (fsa->IsFinalState(start_state)) {
+      std::vector<float> buffer;
+      ScoreValue(fsa, scorer, fsa->GetStateValue(start_state), [] { return std::string(); }, &partial_results[0],
+                 &buffer);
+    }
+
+    std::atomic<size_t> next_subtree(0);
+    auto worker = [&](TopK<std::string>* top_k) {
+      std::vector<float> buffer;
+      for (size_t i = next_subtree++; i < subtrees.size(); i = next_subtree++) {
+        const std::string prefix(1, subtrees[i].first);
+
+        if (fsa->IsFinalState(subtrees[i].second)) {
+          ScoreValue(fsa, scorer, fsa->GetStateValue(subtrees[i].second), [&prefix] { return prefix; }, top_k,
+                     &buffer);
+        }
+
+        // the key is only created for candidates that make it into the top k
+        const fsa::EntryIterator end_it;
+        for (fsa::EntryIterator it(fsa, subtrees[i].second); it != end_it; ++it) {
+          ScoreValue(fsa, scorer, it.GetValueId(), [&prefix, &it] { return prefix + it.GetKey(); }, top_k, &buffer);
+        }
+      }
+    };
+
+    if (partial_results.size() == 1) {
+      worker(&partial_results[0]);
+    } else {
+      std::vector<std::thread> threads;
+      std::vector<std::exception_ptr> exceptions(partial_results.size());
+
+      for (size_t i = 0; i < partial_results.size(); ++i) {
+        threads.emplace_back([&, i]() {
+          try {
+            worker(&partial_results[i]);
+          } catch (...) {
+            exceptions[i] = std::current_exception();
+          }
+        });
+      }
+
+      for (auto& thread : threads) {
+        thread.join();
+      }
+
+      for (const auto& exception : exceptions) {
+        if (exception) {
+          std::rethrow_exception(exception);
+        }
+      }
+    }
+
+    std::vector<Candidate<std::string>> candidates = Merge(&partial_results, k);
+    NearestNeighborMatching matcher;
+    for (const auto& c : candidates) {
+      match_t m = MakeMatch(0, c.payload.size(), c.payload, 0, fsa, c.value_id);
+      m->SetScore(c.score);
+      matcher.matches_.push_back(std::move(m));
+    }
+
+    return matcher;
+  }
+
+  /**
+   * Create a nearest neighbor matcher that re-ranks the results of another query, e.g. a prefix completion.
+   *
+   * @param matches the candidates, any range of matches with float vector values
+   * @param query the query vector
+   * @param k the number of neighbors to return
+   * @param distance the distance function
+   */
+  template <class MatchRangeT>
+  static NearestNeighborMatching FromMatches(
+      MatchRangeT&& matches, const std::vector<float>& query, const size_t k,
+      const keyvi::util::float_vector_distance_t distance = keyvi::util::float_vector_distance_t::COSINE) {
+    if (k == 0) {
+      return NearestNeighborMatching();
+    }
+
+    const keyvi::util::FloatVectorScorer scorer(query, distance);
+    std::vector<TopK<match_t>> partial_results(1, TopK<match_t>(k));
+    std::vector<float> buffer;
+
+    for (const match_t& m : matches) {
+      size_t dimensions;
+      const float* vector = m->GetFloatVector(&dimensions, &buffer);
+      const float score = scorer.Score(vector, dimensions);
+      partial_results[0].Put(scorer.GetRank(score), score, 0, [&m] { return m; });
+    }
+
+    std::vector<Candidate<match_t>> candidates = Merge(&partial_results, k);
+    NearestNeighborMatching matcher;
+    for (auto& c : candidates) {
+      c.payload->SetScore(c.score);
+      matcher.matches_.push_back(std::move(c.payload));
+    }
+
+    return matcher;
+  }
+
+  match_t& FirstMatch() { return first_match_; }
+
+  match_t NextMatch() {
+    if (next_match_ < matches_.size()) {
+      return std::move(matches_[next_match_++]);
+    }
+
+    return match_t();
+  }
+
+ private:
+  template <class PayloadT>
+  struct Candidate {
+    Candidate(float r, float s, uint64_t v, PayloadT p) : rank(r), score(s), value_id(v), payload(std::move(p)) {}
+
+    float rank;
+    float score;
+    uint64_t value_id;
+    PayloadT payload;
+
+    // better candidates first, on ties in the order of values
+    bool operator<(const Candidate& other) const {
+      return rank != other.rank ? rank > other.rank : value_id < other.value_id;
+    }
+  };
+
+  /**
+   * The k best candidates seen so far, kept as a heap with the worst one on top.
+   */
+  template <class PayloadT>
+  class TopK final {
+   public:
+    explicit TopK(size_t k) : k_(k) { candidates_.reserve(k); }
+
+    /**
+     * Add a candidate if it is better than the worst one.
+     *
+     * @param get_payload creates the payload, only called if the candidate is added
+     */
+    template <class PayloadFuncT>
+    void Put(float rank, float score, uint64_t value_id, PayloadFuncT&& get_payload) {
+      if (candidates_.size() == k_) {
+        if (rank <= candidates_.front().rank) {
+          return;
+        }
+        std::pop_heap(candidates_.begin(), candidates_.end());
+        candidates_.pop_back();
+      }
+
+      candidates_.emplace_back(rank, score, value_id, get_payload());
+      std::push_heap(candidates_.begin(), candidates_.end());
+    }
+
+    std::vector<Candidate<PayloadT>>* GetCandidates() { return &candidates_; }
+
+   private:
+    size_t k_;
+    std::vector<Candidate<PayloadT>> candidates_;
+  };
+
+  std::vector<match_t> matches_;
+  size_t next_match_ = 0;
+  match_t first_match_;
+
+  NearestNeighborMatching() {}
+
+  template <class KeyFuncT>
+  static void ScoreValue(const fsa::automata_t& fsa, const keyvi::util::FloatVectorScorer& scorer, uint64_t value_id,
+                         KeyFuncT&& get_key, TopK<std::string>* top_k, std::vector<float>* buffer) {
+    size_t dimensions;
+    const float* vector = fsa->GetFloatVector(value_id, &dimensions, buffer);
+    const float score = scorer.Score(vector, dimensions);
+    top_k->Put(scorer.GetRank(score), score, value_id, std::forward<KeyFuncT>(get_key));
+  }
+
+  /**
+   * Merge the partial results, best first.
+   */
+  template <class PayloadT>
+  static std::vector<Candidate<PayloadT>> Merge(std::vector<TopK<PayloadT>>* partial_results, size_t k) {
+    std::vector<Candidate<PayloadT>> candidates;
+    for (auto& partial_result : *partial_results) {
+      auto partial_candidates = partial_result.GetCandidates();
+      std::move(partial_candidates->begin(), partial_candidates->end(), std::back_inserter(candidates));
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+    if (candidates.size() > k) {
+      candidates.erase(candidates.begin() + k, candidates.end());
+    }
+
+    return candidates;
+  }
+};
+
+} /* namespace matching */
+} /* namespace dictionary */
+} /* namespace keyvi */
+#endif  // KEYVI_DICTIONARY_MATCHING_NEAREST_NEIGHBOR_MATCHING_H_
@@ -33,6 +33,7 @@
 #include "keyvi/dictionary/fsa/traverser_types.h"
 #include "keyvi/dictionary/fsa/zip_state_traverser.h"
 #include "keyvi/dictionary/match.h"
+#include "keyvi/dictionary/match_pool.h"
 #include "keyvi/dictionary/util/utf8_utils.h"
 #include "keyvi/stringdistance/levenshtein.h"
 #include "utf8.h"
@@ -105,7 +106,7 @@ class PrefixCompletionMatching final {
     std::unique_ptr<innerTraverserType> traverser = std::make_unique<innerTraverserType>(fsa, state);
 
     if (fsa->IsFinalState(state)) {
-      first_match = std::make_shared<Match>(0, query_length, query, 0, fsa, fsa->GetStateValue(state));
+      first_match = MakeMatch(0, query_length, query, 0, fsa, fsa->GetStateValue(state));
     }
 
     TRACE("create matcher");
@@ -152,8 +153,8 @@ class PrefixCompletionMatching final {
     // check for a match given the exact prefix
     for (const auto& fsa_state : fsa_start_state_pairs) {
       if (fsa_state.first->IsFinalState(fsa_state.second)) {
-        first_match = std::make_shared<Match>(0, query_length, query, 0, fsa_state.first,
-                                              fsa_state.first->GetStateValue(fsa_state.second));
+        first_match = MakeMatch(0, query_length, query, 0, fsa_state.first,
+                                fsa_state.first->GetStateValue(fsa_state.second));
         break;
       }
     }
@@ -176,8 +177,8 @@ class PrefixCompletionMatching final {
         std::string match_str = std::string(traversal_stack_->begin(), traversal_stack_->end());
 
         TRACE("found final state at depth %d %s", prefix_length_ + traverser_ptr_->GetDepth(), match_str.c_str());
-        match_t m = std::make_shared<Match>(0, prefix_length_ + traverser_ptr_->GetDepth(), match_str, 0,
-                                            traverser_ptr_->GetFsa(), traverser_ptr_->GetStateValue());
+        match_t m = MakeMatch(0, prefix_length_ + traverser_ptr_->GetDepth(), match_str, 0, traverser_ptr_->GetFsa(),
+                              traverser_ptr_->GetStateValue());
 
         (*traverser_ptr_)++;
         return m;
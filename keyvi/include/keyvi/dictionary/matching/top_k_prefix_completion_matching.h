@@ -0,0 +1,318 @@
+/* keyvi - A key value store.
+ *
+ * Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * top_k_prefix_completion_matching.h
+ */
+
+#ifndef KEYVI_DICTIONARY_MATCHING_TOP_K_PREFIX_COMPLETION_MATCHING_H_
+#define KEYVI_DICTIONARY_MATCHING_TOP_K_PREFIX_COMPLETION_MATCHING_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "keyvi/dictionary/fsa/automata.h"
+#include "keyvi/dictionary/fsa/internal/constants.h"
+#include "keyvi/dictionary/fsa/internal/value_store_types.h"
+#include "keyvi/dictionary/fsa/traversal/weighted_traversal.h"
+#include "keyvi/dictionary/match.h"
+#include "keyvi/dictionary/match_pool.h"
+
+// #define ENABLE_TRACING
+#include "keyvi/dictionary/util/trace.h"
+
+namespace keyvi {
+namespace index {
+namespace internal {
+template <class MatcherT, class DeletedT>
+keyvi::dictionary::match_t NextFilteredMatchSingle(const MatcherT&, const DeletedT&);
+template <class MatcherT, class DeletedT>
+keyvi::dictionary::match_t NextFilteredMatch(const MatcherT&, const DeletedT&);
+}  // namespace internal
+}  // namespace index
+namespace dictionary {
+namespace matching {
+
+/**
+ * Best-first prefix completion, returns the k completions with the highest weight in descending order of weight.
+ *
+ * Instead of traversing the subtree below the prefix, all discovered states are kept in a max-heap (the frontier),
+ * keyed on their inner weight which is an upper bound for the weight of all completions below the state. Final
+ * states are put back into the frontier with the weight of the completion, so a completion is returned as soon as no
+ * state in the frontier can lead to a better one. The search stops after k completions, the work done is proportional
+ * to k and the fan-out instead of the size of the subtree.
+ *
+ * With multiple fsa's (segments of an index, ordered from oldest to newest) all states share the frontier, so the
+ * k-th best weight prunes globally. If a key exists in several fsa's, only the newest one is returned.
+ */
+class TopKPrefixCompletionMatching final {
+ public:
+  /**
+   * Create a top k prefix completer from a single Fsa
+   *
+   * @param fsa the fsa
+   * @param query the query
+   * @param k the number of completions to return
+   */
+  static TopKPrefixCompletionMatching FromSingleFsa(const fsa::automata_t& fsa, const std::string& query,
+                                                    const size_t k) {
+    return FromSingleFsa(fsa, fsa->GetStartState(), query, k);
+  }
+
+  /**
+   * Create a top k prefix completer from a single Fsa
+   *
+   * @param fsa the fsa
+   * @param start_state the state to start from
+   * @param query the query
+   * @param k the number of completions to return
+   */
+  static TopKPrefixCompletionMatching FromSingleFsa(const fsa::automata_t& fsa, const uint64_t start_state,
+                                                    const std::string& query, const size_t k) {
+    if (start_state == 0 || k == 0) {
+      return TopKPrefixCompletionMatching();
+    }
+
+    uint64_t state = start_state;
+    for (size_t i = 0; state != 0 && i < query.size(); ++i) {
+      state = fsa->TryWalkTransition(state, query[i]);
+    }
+
+    if (state == 0) {
+      return TopKPrefixCompletionMatching();
+    }
+
+    return TopKPrefixCompletionMatching({fsa}, {state}, query, k);
+  }
+
+  /**
+   * Create a top k prefix completer from multiple Fsas
+   *
+   * @param fsas a vector of fsas, if a key exists in more than 1 fsa, the last one wins
+   * @param query the query
+   * @param k the number of completions to return
+   */
+  static TopKPrefixCompletionMatching FromMulipleFsas(const std::vector<fsa::automata_t>& fsas,
+                                                      const std::string& query, const size_t k) {
+    if (k == 0) {
+      return TopKPrefixCompletionMatching();
+    }
+
+    std::vector<fsa::automata_t> fsas_with_prefix;
+    std::vector<uint64_t> states;
+
+    for (const fsa::automata_t& fsa : fsas) {
+      uint64_t state = fsa->GetStartState();
+      for (size_t i = 0; state != 0 && i < query.size(); ++i) {
+        state = fsa->TryWalkTransition(state, query[i]);
+      }
+
+      if (state != 0) {
+        fsas_with_prefix.push_back(fsa);
+        states.push_back(state);
+      }
+    }
+
+    if (fsas_with_prefix.size() == 0) {
+      return TopKPrefixCompletionMatching();
+    }
+
+    return TopKPrefixCompletionMatching(std::move(fsas_with_prefix), std::move(states), query, k);
+  }
+
+  match_t& FirstMatch() { return first_match_; }
+
+  match_t NextMatch() {
+    while (number_of_matches_ < k_ && !frontier_.empty()) {
+      const FrontierEntry entry = frontier_.top();
+      frontier_.pop();
+
+      if (entry.weight < min_weight_) {
+        // nothing left in the frontier can reach the minimum weight
+        break;
+      }
+
+      if (entry.is_final) {
+        const std::string match_str = GetKey(entry.path_index);
+        if (IsShadowed(entry.fsa_index, match_str)) {
+          TRACE("skip %s, key exists in a newer fsa", match_str.c_str());
+          continue;
+        }
+
+        ++number_of_matches_;
+        TRACE("found final state %s weight %d", match_str.c_str(), entry.weight);
+        const fsa::automata_t& fsa = fsas_[entry.fsa_index];
+        return MakeMatch(0, match_str.size(), match_str, 0, fsa, fsa->GetStateValue(entry.state));
+      }
+
+      Expand(entry);
+    }
+
+    return match_t();
+  }
+
+  void SetMinWeight(uint32_t min_weight) {
+    min_weight_ = min_weight;
+    traversal_payload_.min_weight = min_weight;
+  }
+
+ private:
+  struct FrontierEntry {
+    FrontierEntry(uint32_t w, bool f, uint32_t i, uint32_t p, uint64_t s)
+        : weight(w), is_final(f), fsa_index(i), path_index(p), state(s) {}
+
+    uint32_t weight;
+    bool is_final;
+    uint32_t fsa_index;
+    uint32_t path_index;
+    uint64_t state;
+  };
+
+  /**
+   * Order of the frontier: highest weight first, on ties completions before states and otherwise in the order of
+   * discovery, so shorter completions come first.
+   */
+  struct FrontierEntryCompare {
+    bool operator()(const FrontierEntry& a, const FrontierEntry& b) const {
+      if (a.weight != b.weight) {
+        return a.weight < b.weight;
+      }
+      if (a.is_final != b.is_final) {
+        return b.is_final;
+      }
+      return a.path_index > b.path_index;
+    }
+  };
+
+  /**
+   * The labels of all discovered states, stored as a tree: every node points to the node of its parent.
+   */
+  struct PathNode {
+    PathNode(uint32_t p, unsigned char l) : parent(p), label(l) {}
+
+    uint32_t parent;
+    unsigned char label;
+  };
+
+  static constexpr uint32_t ROOT_PATH_INDEX = 0;
+
+  std::vector<fsa::automata_t> fsas_;
+  std::vector<uint64_t> prefix_states_;
+  std::string prefix_;
+  size_t k_ = 0;
+  size_t number_of_matches_ = 0;
+  uint32_t min_weight_ = 0;
+  std::priority_queue<FrontierEntry, std::vector<FrontierEntry>, FrontierEntryCompare> frontier_;
+  std::vector<PathNode> path_;
+  fsa::traversal::TraversalState<fsa::traversal::WeightedTransition> traversal_state_;
+  fsa::traversal::TraversalPayload<fsa::traversal::WeightedTransition> traversal_payload_;
+  match_t first_match_;
+
+  TopKPrefixCompletionMatching(std::vector<fsa::automata_t>&& fsas, std::vector<uint64_t>&& prefix_states,
+                               const std::string& prefix, const size_t k)
+      : fsas_(std::move(fsas)), prefix_states_(std::move(prefix_states)), prefix_(prefix), k_(k) {
+    path_.emplace_back(ROOT_PATH_INDEX, 0);
+
+    for (size_t i = 0; i < fsas_.size(); ++i) {
+      uint32_t weight = fsas_[i]->GetInnerWeight(prefix_states_[i]);
+
+      // inner weights are only stored up to a certain depth, below we do not know an upper bound
+      if (weight == 0 && fsas_[i]->GetValueStoreType() == fsa::internal::value_store_t::INT_WITH_WEIGHTS) {
+        weight = std::numeric_limits<uint32_t>::max();
+      }
+
+      frontier_.emplace(GetUpperBound(weight, std::numeric_limits<uint32_t>::max()), false, static_cast<uint32_t>(i),
+                        ROOT_PATH_INDEX, prefix_states_[i]);
+    }
+  }
+
+  TopKPrefixCompletionMatching() {}
+
+  void Expand(const FrontierEntry& entry) {
+    const fsa::automata_t& fsa = fsas_[entry.fsa_index];
+
+    if (fsa->IsFinalState(entry.state)) {
+      const uint32_t weight = fsa->GetWeight(fsa->GetStateValue(entry.state));
+      if (weight >= min_weight_) {
+        frontier_.emplace(weight, true, entry.fsa_index, entry.path_index, entry.state);
+      }
+    }
+
+    // states without inner weight inherit the weight of the parent
+    fsa->GetOutGoingTransitions(entry.state, &traversal_state_, &traversal_payload_, entry.weight);
+
+    for (const auto& transition : traversal_state_.traversal_state_payload.transitions) {
+      path_.emplace_back(entry.path_index, transition.label);
+      frontier_.emplace(GetUpperBound(transition.weight, entry.weight), false, entry.fsa_index,
+                        static_cast<uint32_t>(path_.size() - 1), transition.state);
+    }
+  }
+
+  /**
+   * Check whether a newer fsa contains the key, in which case that one wins.
+   */
+  bool IsShadowed(uint32_t fsa_index, const std::string& key) const {
+    for (size_t i = fsa_index + 1; i < fsas_.size(); ++i) {
+      uint64_t state = prefix_states_[i];
+      for (size_t j = prefix_.size(); state != 0 && j < key.size(); ++j) {
+        state = fsas_[i]->TryWalkTransition(state, key[j]);
+      }
+
+      if (state != 0 && fsas_[i]->IsFinalState(state)) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  /**
+   * Inner weights are capped, a capped inner weight is no upper bound, use the bound of the parent instead.
+   */
+  static uint32_t GetUpperBound(uint32_t inner_weight, uint32_t parent_weight) {
+    return inner_weight < COMPACT_SIZE_INNER_WEIGHT_MAX_VALUE ? inner_weight : parent_weight;
+  }
+
+  std::string GetKey(uint32_t path_index) const {
+    std::string key;
+    for (; path_index != ROOT_PATH_INDEX; path_index = path_[path_index].parent) {
+      key.push_back(path_[path_index].label);
+    }
+    std::reverse(key.begin(), key.end());
+
+    return prefix_ + key;
+  }
+
+  // reset method for the index in the special case the match is deleted
+  template <class MatcherT, class DeletedT>
+  friend match_t index::internal::NextFilteredMatchSingle(const MatcherT&, const DeletedT&);
+  template <class MatcherT, class DeletedT>
+  friend match_t index::internal::NextFilteredMatch(const MatcherT&, const DeletedT&);
+
+  // a deleted key does not count as a completion
+  void ResetLastMatch() { --number_of_matches_; }
+};
+
+} /* namespace matching */
+} /* namespace dictionary */
+} /* namespace keyvi */
+#endif  // KEYVI_DICTIONARY_MATCHING_TOP_K_PREFIX_COMPLETION_MATCHING_H_
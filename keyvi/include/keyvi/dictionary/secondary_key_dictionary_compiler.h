@@ -140,10 +140,8 @@ class SecondaryKeyDictionaryCompiler final {
   }
 
   void WriteToFile(const std::string& filename) {
-    std::ofstream out_stream = keyvi::util::OsUtils::OpenOutFileStream(filename);
-
-    Write(out_stream);
-    out_stream.close();
+    keyvi::util::WriteOutputFile(filename, keyvi::util::mapGetBool(params_, DIRECT_IO_KEY, false),
+                                 [this](std::ostream& out_stream) { Write(out_stream); });
   }
 
  private:
@@ -28,6 +28,7 @@
 #include <cstddef>
 
 static const char INDEX_REFRESH_INTERVAL[] = "refresh_interval";
+static const char INDEX_REFRESH_WATCH[] = "refresh_watch";
 static const char MERGE_POLICY[] = "merge_policy";
 static const char DEFAULT_MERGE_POLICY[] = "tiered";
 static const char KEYVIMERGER_BIN[] = "keyvimerger_bin";
@@ -35,11 +36,17 @@ static const char INDEX_MAX_SEGMENTS[] = "max_segments";
 static const char SEGMENT_COMPILE_KEY_THRESHOLD[] = "segment_compile_key_threshold";
 static const char SEGMENT_EXTERNAL_MERGE_KEY_THRESHOLD[] = "segment_external_merge_key_threshold";
 static const char MAX_CONCURRENT_MERGES[] = "max_concurrent_merges";
+static const char INDEX_WRITER_THREADS[] = "writer_threads";
 
 // defaults
 static const size_t DEFAULT_REFRESH_INTERVAL = 1000ul;
+// watch the index directory for changes, only supported on Linux
+static const bool DEFAULT_REFRESH_WATCH = true;
+// with a directory watch the index is reloaded on changes, and after this interval in case events got lost
+static const size_t DEFAULT_REFRESH_WATCH_SAFETY_INTERVAL = 60000ul;
 static const size_t DEFAULT_COMPILE_KEY_THRESHOLD = 10000ul;
 static const size_t DEFAULT_EXTERNAL_MERGE_KEY_THRESHOLD = 100000ul;
+static const size_t DEFAULT_WRITER_THREADS = 1ul;
 #if defined(_WIN32)
 static const char DEFAULT_KEYVIMERGER_BIN[] = "keyvimerger.exe";
 #else
@@ -52,4 +59,7 @@ static const size_t SPINLOCK_WAIT_FOR_SEGMENT_MERGES_MS = 10;
 // max parallel process for segment merging
 static const size_t MAX_CONCURRENT_MERGES_DEFAULT = 8;
 
+// compact the deleted keys delta file into the deleted keys file once it has more than 1/n of its keys
+static const size_t DELETED_KEYS_COMPACTION_RATIO = 8;
+
 #endif  // KEYVI_INDEX_CONSTANTS_H_
@@ -26,19 +26,30 @@
 #ifndef KEYVI_INDEX_INTERNAL_BASE_INDEX_READER_H_
 #define KEYVI_INDEX_INTERNAL_BASE_INDEX_READER_H_
 
+#include <algorithm>
+#include <functional>
+#include <iterator>
 #include <map>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <tuple>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
+#include "utf8.h"
+
 #include "keyvi/dictionary/fsa/automata.h"
 #include "keyvi/dictionary/match.h"
 #include "keyvi/dictionary/match_iterator.h"
 #include "keyvi/dictionary/matching/fuzzy_matching.h"
 #include "keyvi/dictionary/matching/near_matching.h"
+#include "keyvi/dictionary/matching/top_k_prefix_completion_matching.h"
+#include "keyvi/dictionary/util/utf8_utils.h"
 #include "keyvi/index/internal/index_lookup_util.h"
+#include "keyvi/index/internal/key_filter.h"
+#include "keyvi/index/internal/memtable.h"
 #include "keyvi/index/internal/read_only_segment.h"
 
 // #define ENABLE_TRACING
@@ -66,9 +77,22 @@ class BaseIndexReader {
    */
   dictionary::match_t operator[](const std::string& key) {
     dictionary::match_t match;
+
+    // the memtable must be read before the segments, keys move from the memtable into the segments
+    const Memtable* memtable = payload_.GetMemtable(key);
+    if (memtable && memtable->Get(key, &match)) {
+      return match;
+    }
+
     const_segments_t segments = payload_.Segments();
+    // the filters of all segments share the hash
+    const uint64_t key_hash = KeyFilter::Hash(key);
 
     for (auto it = segments->crbegin(); it != segments->crend(); ++it) {
+      if (!(*it)->MayContain(key_hash)) {
+        continue;
+      }
+
       match = (*it)->GetDictionary()->operator[](key);
       if (match) {
         if ((*it)->IsDeleted(key)) {
@@ -87,9 +111,17 @@ class BaseIndexReader {
    * @param key the key
    */
   bool Contains(const std::string& key) {
+    bool deleted = false;
+    const Memtable* memtable = payload_.GetMemtable(key);
+    if (memtable && memtable->Contains(key, &deleted)) {
+      return !deleted;
+    }
+
     const_segments_t segments = payload_.Segments();
+    const uint64_t key_hash = KeyFilter::Hash(key);
+
     for (auto it = segments->crbegin(); it != segments->crend(); it++) {
-      if ((*it)->GetDictionary()->Contains(key)) {
+      if ((*it)->MayContain(key_hash) && (*it)->GetDictionary()->Contains(key)) {
         return !(*it)->IsDeleted(key);
       }
     }
@@ -103,6 +135,9 @@ class BaseIndexReader {
    *
    * If greedy is True it matches everything below the minimum_prefix_length, but in the order of exact first.
    *
+   * Matches are ordered by score, for matches with equal score keys that are not compiled into a segment yet are
+   * returned first. If greedy is False only the matches with the best score of memtables and segments are returned.
+   *
    * @param query a query to match against
    * @param minimum_exact_prefix prefix length to be matched exact
    * @param greedy if true matches everything below minimum prefix
@@ -111,8 +146,121 @@ class BaseIndexReader {
   dictionary::MatchIterator::MatchIteratorPair GetNear(const std::string& query, const size_t minimum_exact_prefix = 2,
                                                        const bool greedy = false) {
     TRACE("matching near: %s minimum prefix %ld", query.c_str(), minimum_exact_prefix);
+    Memtable::entries_t memtable_entries;
+    if (query.size() >= minimum_exact_prefix) {
+      memtable_entries = GetMemtableEntries(query.substr(0, minimum_exact_prefix));
+    }
     const_segments_t segments = payload_.Segments();
 
+    if (memtable_entries.size() == 0) {
+      return GetNearFromSegments(segments, query, minimum_exact_prefix, greedy, shadowed_keys_t());
+    }
+
+    return MergeNearMatches(
+        GetNearFromMemtables(memtable_entries, query),
+        GetNearFromSegments(segments, query, minimum_exact_prefix, greedy, GetShadowedKeys(memtable_entries)), greedy);
+  }
+
+  /**
+   * Match approximate given the query and edit distance
+   *
+   * Keys that are not compiled into a segment yet are returned first.
+   *
+   * @param query a query to match against
+   * @param max_edit_distance the max edit distance allowed for a single match
+   * @param minimum_exact_prefix prefix length to be matched exact
+   * @param strategy the algorithm used for calculating the edit distance
+   */
+  dictionary::MatchIterator::MatchIteratorPair GetFuzzy(
+      const std::string& query, const int32_t max_edit_distance, const size_t minimum_exact_prefix = 2,
+      const dictionary::matching::fuzzy_strategy_t strategy =
+          dictionary::matching::fuzzy_strategy_t::NEEDLEMAN_WUNSCH) {
+    if (dictionary::matching::UseBitParallelLevenshtein(strategy, query)) {
+      return GetFuzzyWithMetric<stringdistance::BitParallelLevenshtein>(query, max_edit_distance,
+                                                                        minimum_exact_prefix);
+    }
+
+    return GetFuzzyWithMetric<stringdistance::Levenshtein>(query, max_edit_distance, minimum_exact_prefix);
+  }
+  /**
+   * Complete the given prefix, returns the top_n completions with the highest weight in descending order of weight.
+   *
+   * All segments are traversed together, for keys that exist in several segments the newest one wins. Keys that are
+   * not compiled into a segment yet are included, their values have no weight so they rank with weight 0.
+   *
+   * @param query the prefix to complete
+   * @param top_n the number of completions to return
+   */
+  dictionary::MatchIterator::MatchIteratorPair GetPrefixCompletion(const std::string& query, const size_t top_n) {
+    TRACE("prefix completion: %s top n %ld", query.c_str(), top_n);
+    const Memtable::entries_t memtable_entries = GetMemtableEntries(query);
+    const_segments_t segments = payload_.Segments();
+
+    if (memtable_entries.size() == 0) {
+      return GetPrefixCompletionFromSegments(segments, query, top_n, shadowed_keys_t());
+    }
+
+    return MergeMatchesByWeight(
+        GetPrefixCompletionFromMemtables(memtable_entries, top_n),
+        GetPrefixCompletionFromSegments(segments, query, top_n, GetShadowedKeys(memtable_entries)), top_n);
+  }
+
+ protected:
+  PayloadT& Payload() { return payload_; }
+
+ private:
+  PayloadT payload_;
+
+  /**
+   * Prefix completion on the segments, keys in shadowed_keys are skipped as the memtables have newer writes for them.
+   */
+  dictionary::MatchIterator::MatchIteratorPair GetPrefixCompletionFromSegments(const const_segments_t& segments,
+                                                                               const std::string& query,
+                                                                               const size_t top_n,
+                                                                               const shadowed_keys_t& shadowed_keys) {
+    if (segments->size() == 0) {
+      return dictionary::MatchIterator::EmptyIteratorPair();
+    }
+
+    std::vector<dictionary::fsa::automata_t> fsas;
+    std::vector<std::tuple<dictionary::fsa::automata_t>> fsa_tuples;
+    std::map<dictionary::fsa::automata_t, typename SegmentT::deleted_ptr_t> deleted_keys_map;
+    for (auto it = segments->cbegin(); it != segments->cend(); it++) {
+      fsas.push_back((*it)->GetDictionary()->GetFsa());
+      fsa_tuples.emplace_back(fsas.back());
+      if ((*it)->DeletedKeysSize() > 0) {
+        deleted_keys_map.emplace(fsas.back(), (*it)->DeletedKeys());
+      }
+    }
+    auto shadowed_keys_map = CreateShadowedKeysFilterMap(deleted_keys_map, fsa_tuples, shadowed_keys);
+
+    auto completer = std::make_shared<dictionary::matching::TopKPrefixCompletionMatching>(
+        dictionary::matching::TopKPrefixCompletionMatching::FromMulipleFsas(fsas, query, top_n));
+    auto set_min_weight = std::bind(&dictionary::matching::TopKPrefixCompletionMatching::SetMinWeight, &(*completer),
+                                    std::placeholders::_1);
+
+    if (shadowed_keys_map.size() > 0) {
+      auto func = [completer, shadowed_keys_map]() { return NextFilteredMatch(completer, shadowed_keys_map); };
+      return dictionary::MatchIterator::MakeIteratorPair(func, FirstFilteredMatch(completer, shadowed_keys_map),
+                                                         set_min_weight);
+    }
+
+    if (deleted_keys_map.size() == 0) {
+      auto func = [completer]() { return completer->NextMatch(); };
+      return dictionary::MatchIterator::MakeIteratorPair(func, std::move(completer->FirstMatch()), set_min_weight);
+    }
+
+    auto func = [completer, deleted_keys_map]() { return NextFilteredMatch(completer, deleted_keys_map); };
+    return dictionary::MatchIterator::MakeIteratorPair(func, std::move(completer->FirstMatch()), set_min_weight);
+  }
+
+  /**
+   * Near matching on the segments, keys in shadowed_keys are skipped as the memtables have newer writes for them.
+   */
+  dictionary::MatchIterator::MatchIteratorPair GetNearFromSegments(const const_segments_t& segments,
+                                                                   const std::string& query,
+                                                                   const size_t minimum_exact_prefix, const bool greedy,
+                                                                   const shadowed_keys_t& shadowed_keys) {
     if (segments->size() == 0) {
       return dictionary::MatchIterator::EmptyIteratorPair();
     }
@@ -138,6 +286,13 @@ class BaseIndexReader {
       for (auto it = segments->crbegin(); it != segments->crend(); it++) {
         if ((*it)->GetDictionary()->GetFsa() == std::get<0>(fsa_start_state_payloads[0])) {
           typename SegmentT::deleted_ptr_t deleted_keys = (*it)->DeletedKeys();
+          if (shadowed_keys) {
+            auto filter = std::make_shared<ShadowedKeysFilter<typename SegmentT::deleted_ptr_t>>(
+                (*it)->DeletedKeysSize() > 0 ? deleted_keys : typename SegmentT::deleted_ptr_t(), shadowed_keys);
+            auto func = [near_matcher, filter]() { return NextFilteredMatchSingle(near_matcher, filter); };
+
+            return dictionary::MatchIterator::MakeIteratorPair(func, FirstFilteredMatchSingle(near_matcher, filter));
+          }
           if ((*it)->DeletedKeysSize() > 0) {
             auto func = [near_matcher, deleted_keys]() { return NextFilteredMatchSingle(near_matcher, deleted_keys); };
 
@@ -154,12 +309,18 @@ class BaseIndexReader {
     }
 
     auto deleted_keys_map = CreatedDeletedKeysMap(segments, fsa_start_state_payloads);
+    auto shadowed_keys_map = CreateShadowedKeysFilterMap(deleted_keys_map, fsa_start_state_payloads, shadowed_keys);
     auto near_matcher = std::make_shared<
         dictionary::matching::NearMatching<dictionary::fsa::ZipStateTraverser<dictionary::fsa::NearStateTraverser>>>(
         dictionary::matching::NearMatching<dictionary::fsa::ZipStateTraverser<dictionary::fsa::NearStateTraverser>>::
             FromMulipleFsasWithMatchedExactPrefix(std::move(fsa_start_state_payloads), query, minimum_exact_prefix,
                                                   greedy));
 
+    if (shadowed_keys_map.size() > 0) {
+      auto func = [near_matcher, shadowed_keys_map]() { return NextFilteredMatch(near_matcher, shadowed_keys_map); };
+      return dictionary::MatchIterator::MakeIteratorPair(func, FirstFilteredMatch(near_matcher, shadowed_keys_map));
+    }
+
     if (deleted_keys_map.size() == 0) {
       auto func = [near_matcher]() { return near_matcher->NextMatch(); };
       return dictionary::MatchIterator::MakeIteratorPair(func, std::move(near_matcher->FirstMatch()));
@@ -170,19 +331,44 @@ class BaseIndexReader {
     return dictionary::MatchIterator::MakeIteratorPair(func, FirstFilteredMatch(near_matcher, deleted_keys_map));
   }
 
-  /**
-   * Match approximate given the query and edit distance
-   *
-   * @param query a query to match against
-   * @param max_edit_distance the max edit distance allowed for a single match
-   * @param minimum_exact_prefix prefix length to be matched exact
-   */
-  dictionary::MatchIterator::MatchIteratorPair GetFuzzy(const std::string& query, const int32_t max_edit_distance,
-                                                        const size_t minimum_exact_prefix = 2) {
+  template <class DistanceMetricT>
+  dictionary::MatchIterator::MatchIteratorPair GetFuzzyWithMetric(const std::string& query,
+                                                                  const int32_t max_edit_distance,
+                                                                  const size_t minimum_exact_prefix) {
     TRACE("matching fuzzy: %s max edit distance %ld minimum prefix %ld", query.c_str(), max_edit_distance,
           minimum_exact_prefix);
+    // the exact prefix is given in codepoints
+    Memtable::entries_t memtable_entries;
+    size_t depth = 0;
+    size_t utf8_depth = 0;
+    for (; depth < minimum_exact_prefix && utf8_depth < query.size(); ++depth) {
+      utf8_depth += dictionary::util::Utf8Utils::GetCharLength(query[utf8_depth]);
+    }
+    if (depth == minimum_exact_prefix) {
+      memtable_entries = GetMemtableEntries(query.substr(0, utf8_depth));
+    }
     const_segments_t segments = payload_.Segments();
 
+    if (memtable_entries.size() == 0) {
+      return GetFuzzyFromSegments<DistanceMetricT>(segments, query, max_edit_distance, minimum_exact_prefix,
+                                                   shadowed_keys_t());
+    }
+
+    return PrependMatches(
+        GetFuzzyFromMemtables<DistanceMetricT>(memtable_entries, query, max_edit_distance),
+        GetFuzzyFromSegments<DistanceMetricT>(segments, query, max_edit_distance, minimum_exact_prefix,
+                                              GetShadowedKeys(memtable_entries)));
+  }
+
+  /**
+   * Fuzzy matching on the segments, keys in shadowed_keys are skipped as the memtables have newer writes for them.
+   */
+  template <class DistanceMetricT>
+  dictionary::MatchIterator::MatchIteratorPair GetFuzzyFromSegments(const const_segments_t& segments,
+                                                                    const std::string& query,
+                                                                    const int32_t max_edit_distance,
+                                                                    const size_t minimum_exact_prefix,
+                                                                    const shadowed_keys_t& shadowed_keys) {
     if (segments->size() == 0) {
       return dictionary::MatchIterator::EmptyIteratorPair();
     }
@@ -200,14 +386,22 @@ class BaseIndexReader {
     }
 
     if (fsa_start_state_pairs.size() == 1) {
-      auto fuzzy_matcher = std::make_shared<dictionary::matching::FuzzyMatching<>>(
-          dictionary::matching::FuzzyMatching<>::FromSingleFsaWithMatchedExactPrefix<>(
-              fsa_start_state_pairs[0].first, fsa_start_state_pairs[0].second, query, max_edit_distance,
-              minimum_exact_prefix));
+      using fuzzy_matcher_t =
+          dictionary::matching::FuzzyMatching<dictionary::fsa::WeightedStateTraverser, DistanceMetricT>;
+      auto fuzzy_matcher = std::make_shared<fuzzy_matcher_t>(fuzzy_matcher_t::FromSingleFsaWithMatchedExactPrefix(
+          fsa_start_state_pairs[0].first, fsa_start_state_pairs[0].second, query, max_edit_distance,
+          minimum_exact_prefix));
 
       for (auto it = segments->crbegin(); it != segments->crend(); it++) {
         if ((*it)->GetDictionary()->GetFsa() == fsa_start_state_pairs[0].first) {
           typename SegmentT::deleted_ptr_t deleted_keys = (*it)->DeletedKeys();
+          if (shadowed_keys) {
+            auto filter = std::make_shared<ShadowedKeysFilter<typename SegmentT::deleted_ptr_t>>(
+                (*it)->DeletedKeysSize() > 0 ? deleted_keys : typename SegmentT::deleted_ptr_t(), shadowed_keys);
+            auto func = [fuzzy_matcher, filter]() { return NextFilteredMatchSingle(fuzzy_matcher, filter); };
+
+            return dictionary::MatchIterator::MakeIteratorPair(func, FirstFilteredMatchSingle(fuzzy_matcher, filter));
+          }
           if ((*it)->DeletedKeysSize() > 0) {
             auto func = [fuzzy_matcher, deleted_keys]() {
               return NextFilteredMatchSingle(fuzzy_matcher, deleted_keys);
@@ -228,14 +422,20 @@ class BaseIndexReader {
     TRACE("collect deleted keys");
     // segments and filtered fsa's must have the same order
     auto deleted_keys_map = CreatedDeletedKeysMap(segments, fsa_start_state_pairs);
+    auto shadowed_keys_map = CreateShadowedKeysFilterMap(deleted_keys_map, fsa_start_state_pairs, shadowed_keys);
 
     TRACE("create the fuzzy matcher");
 
-    auto fuzzy_matcher = std::make_shared<
-        dictionary::matching::FuzzyMatching<dictionary::fsa::ZipStateTraverser<dictionary::fsa::StateTraverser<>>>>(
-        dictionary::matching::FuzzyMatching<dictionary::fsa::ZipStateTraverser<dictionary::fsa::StateTraverser<>>>::
-            FromMulipleFsasWithMatchedExactPrefix<dictionary::fsa::StateTraverser<>>(
-                fsa_start_state_pairs, query, max_edit_distance, minimum_exact_prefix));
+    using zip_fuzzy_matcher_t = dictionary::matching::FuzzyMatching<
+        dictionary::fsa::ZipStateTraverser<dictionary::fsa::StateTraverser<>>, DistanceMetricT>;
+    auto fuzzy_matcher = std::make_shared<zip_fuzzy_matcher_t>(
+        zip_fuzzy_matcher_t::template FromMulipleFsasWithMatchedExactPrefix<dictionary::fsa::StateTraverser<>>(
+            fsa_start_state_pairs, query, max_edit_distance, minimum_exact_prefix));
+
+    if (shadowed_keys_map.size() > 0) {
+      auto func = [fuzzy_matcher, shadowed_keys_map]() { return NextFilteredMatch(fuzzy_matcher, shadowed_keys_map); };
+      return dictionary::MatchIterator::MakeIteratorPair(func, FirstFilteredMatch(fuzzy_matcher, shadowed_keys_map));
+    }
 
     if (deleted_keys_map.size() == 0) {
       auto func = [fuzzy_matcher]() { return fuzzy_matcher->NextMatch(); };
@@ -247,11 +447,256 @@ class BaseIndexReader {
     return dictionary::MatchIterator::MakeIteratorPair(func, FirstFilteredMatch(fuzzy_matcher, deleted_keys_map));
   }
 
- protected:
-  PayloadT& Payload() { return payload_; }
+  /**
+   * Collect the entries of all memtables starting with the given prefix, deleted ones included.
+   */
+  Memtable::entries_t GetMemtableEntries(const std::string& prefix) {
+    Memtable::entries_t entries;
 
- private:
-  PayloadT payload_;
+    for (const Memtable* memtable : payload_.Memtables()) {
+      Memtable::entries_t memtable_entries = memtable->GetEntriesWithPrefix(prefix);
+      std::move(memtable_entries.begin(), memtable_entries.end(), std::back_inserter(entries));
+    }
+
+    // every memtable is ordered, but not across memtables
+    if (payload_.Memtables().size() > 1) {
+      std::sort(entries.begin(), entries.end(),
+                [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+    }
+
+    return entries;
+  }
+
+  /**
+   * The keys of the memtable entries, the matches of the segments for these keys are outdated.
+   */
+  static shadowed_keys_t GetShadowedKeys(const Memtable::entries_t& memtable_entries) {
+    auto shadowed_keys = std::make_shared<std::unordered_set<std::string>>();
+    for (const auto& entry : memtable_entries) {
+      shadowed_keys->insert(entry.first);
+    }
+
+    return shadowed_keys;
+  }
+
+  /**
+   * Near matching on the memtable entries, the score is the length of the prefix shared with the query.
+   *
+   * All entries are returned, ordered by score, the non-greedy cut off is done in MergeNearMatches as it depends on
+   * the segments, too.
+   */
+  static std::vector<dictionary::match_t> GetNearFromMemtables(const Memtable::entries_t& memtable_entries,
+                                                               const std::string& query) {
+    std::vector<dictionary::match_t> matches;
+
+    for (const auto& entry : memtable_entries) {
+      if (entry.second.deleted) {
+        continue;
+      }
+
+      const size_t common_prefix_length =
+          std::mismatch(query.begin(), query.end(), entry.first.begin(), entry.first.end()).first - query.begin();
+      matches.push_back(Memtable::MakeMatch(entry.first, entry.second.value, common_prefix_length));
+    }
+
+    // exact first
+    std::stable_sort(matches.begin(), matches.end(),
+                     [](const dictionary::match_t& lhs, const dictionary::match_t& rhs) {
+                       return lhs->GetScore() > rhs->GetScore();
+                     });
+
+    return matches;
+  }
+
+  /**
+   * Merge the near matches of the memtables and the segments, both ordered by descending score.
+   *
+   * For non-greedy matching only matches with the best score of both get returned, the segment matches are already
+   * cut off at the best score of the segments.
+   */
+  static dictionary::MatchIterator::MatchIteratorPair MergeNearMatches(
+      std::vector<dictionary::match_t>&& matches, const dictionary::MatchIterator::MatchIteratorPair& other_matches,
+      const bool greedy) {
+    auto first_matches = std::make_shared<std::vector<dictionary::match_t>>(std::move(matches));
+    auto position = std::make_shared<size_t>(0);
+    auto it = std::make_shared<dictionary::MatchIterator>(other_matches.begin());
+    auto other_exhausted = std::make_shared<bool>(*it == dictionary::MatchIterator());
+
+    if (!greedy) {
+      double best_score = first_matches->size() > 0 ? first_matches->front()->GetScore() : 0;
+      if (!*other_exhausted) {
+        best_score = std::max(best_score, static_cast<double>((**it)->GetScore()));
+        *other_exhausted = (**it)->GetScore() < best_score;
+      }
+
+      first_matches->erase(
+          std::find_if(first_matches->begin(), first_matches->end(),
+                       [best_score](const dictionary::match_t& m) { return m->GetScore() < best_score; }),
+          first_matches->end());
+    }
+
+    auto func = [first_matches, position, it, other_exhausted]() -> dictionary::match_t {
+      if (!*other_exhausted && *it == dictionary::MatchIterator()) {
+        *other_exhausted = true;
+      }
+
+      // on equal score the keys not compiled into a segment yet come first
+      if (*position < first_matches->size() &&
+          (*other_exhausted || (*first_matches)[*position]->GetScore() >= (**it)->GetScore())) {
+        return (*first_matches)[(*position)++];
+      }
+
+      if (*other_exhausted) {
+        return dictionary::match_t();
+      }
+
+      dictionary::match_t m = **it;
+      ++(*it);
+      return m;
+    };
+
+    return dictionary::MatchIterator::MakeIteratorPair(func);
+  }
+
+  /**
+   * Prefix completion on the memtable entries, at most top_n, shorter keys first like for equal weights in segments.
+   */
+  static std::vector<dictionary::match_t> GetPrefixCompletionFromMemtables(const Memtable::entries_t& memtable_entries,
+                                                                           const size_t top_n) {
+    std::vector<dictionary::match_t> matches;
+
+    for (const auto& entry : memtable_entries) {
+      if (!entry.second.deleted) {
+        matches.push_back(Memtable::MakeMatch(entry.first, entry.second.value));
+      }
+    }
+
+    std::stable_sort(matches.begin(), matches.end(),
+                     [](const dictionary::match_t& lhs, const dictionary::match_t& rhs) {
+                       return lhs->GetMatchedString().size() < rhs->GetMatchedString().size();
+                     });
+    if (matches.size() > top_n) {
+      matches.resize(top_n);
+    }
+
+    return matches;
+  }
+
+  /**
+   * Merge the completions of the memtables and the segments, both ordered by descending weight, into the top_n.
+   *
+   * A minimum weight is passed on to the segments and applied to the memtable matches.
+   */
+  static dictionary::MatchIterator::MatchIteratorPair MergeMatchesByWeight(
+      std::vector<dictionary::match_t>&& matches, const dictionary::MatchIterator::MatchIteratorPair& other_matches,
+      const size_t top_n) {
+    auto first_matches = std::make_shared<std::vector<dictionary::match_t>>(std::move(matches));
+    auto position = std::make_shared<size_t>(0);
+    auto number_of_matches = std::make_shared<size_t>(0);
+    auto min_weight = std::make_shared<uint32_t>(0);
+    auto it = std::make_shared<dictionary::MatchIterator>(other_matches.begin());
+
+    auto func = [first_matches, position, number_of_matches, min_weight, it, top_n]() -> dictionary::match_t {
+      if (*number_of_matches >= top_n) {
+        return dictionary::match_t();
+      }
+
+      while (*position < first_matches->size() && (*first_matches)[*position]->GetWeight() < *min_weight) {
+        ++(*position);
+      }
+
+      const bool other_exhausted = *it == dictionary::MatchIterator();
+
+      // on equal weight the keys not compiled into a segment yet come first
+      if (*position < first_matches->size() &&
+          (other_exhausted || (*first_matches)[*position]->GetWeight() >= (**it)->GetWeight())) {
+        ++(*number_of_matches);
+        return (*first_matches)[(*position)++];
+      }
+
+      if (other_exhausted) {
+        return dictionary::match_t();
+      }
+
+      ++(*number_of_matches);
+      dictionary::match_t m = **it;
+      ++(*it);
+      return m;
+    };
+
+    auto set_min_weight = [min_weight, it](uint32_t weight) {
+      *min_weight = weight;
+      it->SetMinWeight(weight);
+    };
+
+    return dictionary::MatchIterator::MakeIteratorPair(func, dictionary::match_t(), set_min_weight);
+  }
+
+  /**
+   * Fuzzy matching on the memtable entries, the score is the edit distance.
+   */
+  template <class DistanceMetricT>
+  static std::vector<dictionary::match_t> GetFuzzyFromMemtables(const Memtable::entries_t& memtable_entries,
+                                                                const std::string& query,
+                                                                const int32_t max_edit_distance) {
+    std::vector<dictionary::match_t> matches;
+    std::vector<uint32_t> query_codepoints;
+    utf8::unchecked::utf8to32(query.begin(), query.end(), back_inserter(query_codepoints));
+
+    for (const auto& entry : memtable_entries) {
+      if (entry.second.deleted) {
+        continue;
+      }
+
+      std::vector<uint32_t> codepoints;
+      utf8::unchecked::utf8to32(entry.first.begin(), entry.first.end(), back_inserter(codepoints));
+      if (codepoints.size() > query_codepoints.size() + max_edit_distance) {
+        continue;
+      }
+
+      DistanceMetricT metric(query_codepoints, 20, max_edit_distance);
+      for (size_t i = 0; i < codepoints.size(); ++i) {
+        metric.Put(codepoints[i], i);
+      }
+
+      if (metric.GetScore() <= max_edit_distance) {
+        matches.push_back(Memtable::MakeMatch(entry.first, entry.second.value, metric.GetScore()));
+      }
+    }
+
+    std::stable_sort(matches.begin(), matches.end(),
+                     [](const dictionary::match_t& lhs, const dictionary::match_t& rhs) {
+                       return lhs->GetScore() < rhs->GetScore();
+                     });
+
+    return matches;
+  }
+
+  /**
+   * Return the given matches before the matches of the iterator.
+   */
+  static dictionary::MatchIterator::MatchIteratorPair PrependMatches(
+      std::vector<dictionary::match_t>&& matches, const dictionary::MatchIterator::MatchIteratorPair& other_matches) {
+    auto first_matches = std::make_shared<std::vector<dictionary::match_t>>(std::move(matches));
+    auto position = std::make_shared<size_t>(0);
+    auto it = std::make_shared<dictionary::MatchIterator>(other_matches.begin());
+
+    auto func = [first_matches, position, it]() -> dictionary::match_t {
+      if (*position < first_matches->size()) {
+        return (*first_matches)[(*position)++];
+      }
+
+      if (*it == dictionary::MatchIterator()) {
+        return dictionary::match_t();
+      }
+
+      dictionary::match_t m = **it;
+      ++(*it);
+      return m;
+    };
+
+    return dictionary::MatchIterator::MakeIteratorPair(func);
+  }
 
   // friend for unit testing only
   friend class keyvi::index::unit_test::IndexFriend;
@@ -0,0 +1,270 @@
+/* * keyvi - A key value store.
+ *
+ * Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * deleted_keys.h
+ */
+
+#ifndef KEYVI_INDEX_INTERNAL_DELETED_KEYS_H_
+#define KEYVI_INDEX_INTERNAL_DELETED_KEYS_H_
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <msgpack.hpp>
+
+#include "keyvi/dictionary/dictionary.h"
+#include "keyvi/dictionary/fsa/entry_iterator.h"
+#include "keyvi/dictionary/fsa/generator.h"
+#include "keyvi/dictionary/fsa/internal/constants.h"
+#include "keyvi/dictionary/fsa/internal/sparse_array_persistence.h"
+
+// #define ENABLE_TRACING
+#include "keyvi/dictionary/util/trace.h"
+
+namespace keyvi {
+namespace index {
+namespace internal {
+
+/**
+ * The deleted keys of a segment.
+ *
+ * Deleted keys are persisted as key only dictionaries which get memory mapped, loading a file does not parse it and a
+ * lookup is a FSA walk. Files in the msgpack format of older versions are still read, the next write converts them.
+ *
+ * A dictionary can not be appended to, a write rewrites the whole file. To keep persisting cheap, new deletes go into a
+ * small delta file first, which gets compacted into the main file once it grows too big, see Segment::Persist.
+ */
+class DeletedKeys final {
+ public:
+  /**
+   * Load the deleted keys from the given files, files that do not exist are skipped.
+   */
+  explicit DeletedKeys(const std::vector<boost::filesystem::path>& files) : dictionaries_(), legacy_keys_(), size_(0) {
+    for (const auto& file : files) {
+      boost::system::error_code ec;
+      if (!boost::filesystem::is_regular_file(file, ec)) {
+        continue;
+      }
+
+      if (IsDictionaryFile(file)) {
+        dictionary::fsa::automata_t fsa(new dictionary::fsa::Automata(file.string()));
+        if (fsa->GetNumberOfKeys() > 0) {
+          size_ += fsa->GetNumberOfKeys();
+          dictionaries_.emplace_back(new dictionary::Dictionary(fsa));
+        }
+      } else {
+        std::vector<std::string> keys = LoadLegacyFile(file);
+        legacy_keys_.insert(keys.begin(), keys.end());
+      }
+    }
+    size_ += legacy_keys_.size();
+  }
+
+  DeletedKeys() = delete;
+  DeletedKeys& operator=(DeletedKeys const&) = delete;
+  DeletedKeys(const DeletedKeys& that) = delete;
+
+  /**
+   * Check whether the key has been deleted, same interface as for std::unordered_set.
+   */
+  size_t count(const std::string& key) const {
+    for (const auto& dictionary : dictionaries_) {
+      if (dictionary->Contains(key)) {
+        return 1;
+      }
+    }
+
+    return legacy_keys_.count(key);
+  }
+
+  /**
+   * The number of deleted keys, a key that is in more than 1 file is counted more than once.
+   */
+  size_t size() const { return size_; }
+
+  /**
+   * Merge the keys of the given files and the new keys into one file.
+   *
+   * All inputs are sorted, the keys are streamed into the new dictionary without loading the input files.
+   *
+   * @param files files with deleted keys, files that do not exist are skipped
+   * @param new_keys keys to add
+   * @param filename the file to write
+   * @param swap_filename temporary file, renamed to filename when written
+   * @return the number of keys written
+   */
+  static size_t Write(const std::vector<boost::filesystem::path>& files, const std::set<std::string>& new_keys,
+                    const boost::filesystem::path& filename, const boost::filesystem::path& swap_filename) {
+    std::vector<std::unique_ptr<KeyCursor>> cursors;
+    for (const auto& file : files) {
+      boost::system::error_code ec;
+      if (boost::filesystem::is_regular_file(file, ec)) {
+        cursors.emplace_back(new KeyCursor(file));
+      }
+    }
+    cursors.emplace_back(new KeyCursor(std::vector<std::string>(new_keys.begin(), new_keys.end())));
+
+    size_t number_of_keys = 0;
+    {
+      dictionary::fsa::Generator<dictionary::fsa::internal::SparseArrayPersistence<>> generator(
+          keyvi::util::parameters_t{{"memory_limit_mb", "5"}});
+
+      for (;;) {
+        KeyCursor* smallest = nullptr;
+        for (const auto& cursor : cursors) {
+          if (cursor->Valid() && (smallest == nullptr || cursor->Key() < smallest->Key())) {
+            smallest = cursor.get();
+          }
+        }
+
+        if (smallest == nullptr) {
+          break;
+        }
+
+        const std::string key = smallest->Key();
+        generator.Add(key);
+        ++number_of_keys;
+
+        // skip duplicates
+        for (const auto& cursor : cursors) {
+          if (cursor->Valid() && cursor->Key() == key) {
+            cursor->Next();
+          }
+        }
+      }
+
+      generator.CloseFeeding();
+      generator.WriteToFile(swap_filename.string());
+    }
+
+    // the input files are not used anymore, renaming replaces them atomically
+    cursors.clear();
+    std::rename(swap_filename.string().c_str(), filename.string().c_str());
+    return number_of_keys;
+  }
+
+  /**
+   * The number of keys in the given file, 0 if it does not exist.
+   */
+  static size_t NumberOfKeys(const boost::filesystem::path& file) {
+    boost::system::error_code ec;
+    if (!boost::filesystem::is_regular_file(file, ec)) {
+      return 0;
+    }
+
+    if (IsDictionaryFile(file)) {
+      return dictionary::fsa::Automata(file.string()).GetNumberOfKeys();
+    }
+
+    return LoadLegacyFile(file).size();
+  }
+
+ private:
+  std::vector<dictionary::dictionary_t> dictionaries_;
+  std::unordered_set<std::string> legacy_keys_;
+  size_t size_;
+
+  /**
+   * Iterates over the keys of a file or a vector in sorted order.
+   */
+  class KeyCursor final {
+   public:
+    explicit KeyCursor(const boost::filesystem::path& file) : iterator_(), keys_(), position_(0), use_fsa_(false) {
+      if (IsDictionaryFile(file)) {
+        use_fsa_ = true;
+        iterator_ = dictionary::fsa::EntryIterator(
+            dictionary::fsa::automata_t(new dictionary::fsa::Automata(file.string())));
+        if (Valid()) {
+          key_ = iterator_.GetKey();
+        }
+      } else {
+        keys_ = LoadLegacyFile(file);
+        std::sort(keys_.begin(), keys_.end());
+      }
+    }
+
+    explicit KeyCursor(std::vector<std::string>&& keys)
+        : iterator_(), keys_(std::move(keys)), position_(0), use_fsa_(false) {}
+
+    bool Valid() const { return use_fsa_ ? iterator_ != dictionary::fsa::EntryIterator() : position_ < keys_.size(); }
+
+    const std::string& Key() const { return use_fsa_ ? key_ : keys_[position_]; }
+
+    void Next() {
+      if (use_fsa_) {
+        ++iterator_;
+        if (Valid()) {
+          key_ = iterator_.GetKey();
+        }
+      } else {
+        ++position_;
+      }
+    }
+
+   private:
+    dictionary::fsa::EntryIterator iterator_;
+    std::string key_;
+    std::vector<std::string> keys_;
+    size_t position_;
+    bool use_fsa_;
+  };
+
+  static bool IsDictionaryFile(const boost::filesystem::path& file) {
+    char magic[KEYVI_FILE_MAGIC_LEN];
+    std::ifstream file_stream(file.string(), std::ios::binary);
+    file_stream.read(magic, KEYVI_FILE_MAGIC_LEN);
+
+    return file_stream.good() && std::strncmp(magic, KEYVI_FILE_MAGIC, KEYVI_FILE_MAGIC_LEN) == 0;
+  }
+
+  static std::vector<std::string> LoadLegacyFile(const boost::filesystem::path& file) {
+    TRACE("loading legacy deleted keys file %s", file.string().c_str());
+
+    std::vector<std::string> keys;
+    std::ifstream deleted_keys_stream(file.string(), std::ios::binary);
+    if (deleted_keys_stream.good()) {
+      std::string buffer;
+      deleted_keys_stream.seekg(0, std::ios::end);
+      buffer.resize(deleted_keys_stream.tellg());
+      deleted_keys_stream.seekg(0, std::ios::beg);
+      deleted_keys_stream.read(&buffer[0], buffer.size());
+      if (buffer.size() > 0) {
+        msgpack::unpacked unpacked_object;
+        msgpack::unpack(unpacked_object, buffer.data(), buffer.size());
+        unpacked_object.get().convert(keys);
+      }
+    }
+    return keys;
+  }
+};
+
+} /* namespace internal */
+} /* namespace index */
+} /* namespace keyvi */
+
+#endif  // KEYVI_INDEX_INTERNAL_DELETED_KEYS_H_
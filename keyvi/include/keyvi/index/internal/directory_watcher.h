@@ -0,0 +1,167 @@
+/* * keyvi - A key value store.
+ *
+ * Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * directory_watcher.h
+ */
+
+#ifndef KEYVI_INDEX_INTERNAL_DIRECTORY_WATCHER_H_
+#define KEYVI_INDEX_INTERNAL_DIRECTORY_WATCHER_H_
+
+#if defined(__linux__)
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>  //NOLINT
+#include <cstdint>
+#include <set>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+// #define ENABLE_TRACING
+#include "keyvi/dictionary/util/trace.h"
+
+namespace keyvi {
+namespace index {
+namespace internal {
+
+/**
+ * Watches a directory for files that get renamed into it or written, using inotify.
+ *
+ * The index writes the toc and the deleted keys to a temporary file and renames it, other tools might write the toc in
+ * place, closing a written file is reported as well.
+ */
+class DirectoryWatcher final {
+ public:
+  /**
+   * Start watching, IsValid returns false if the watch could not be created, e.g. if the directory does not exist.
+   */
+  explicit DirectoryWatcher(const boost::filesystem::path& directory) : inotify_fd_(-1), wakeup_fd_(-1) {
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd_ == -1) {
+      TRACE("inotify not available, errno: %d", errno);
+      return;
+    }
+
+    if (inotify_add_watch(inotify_fd_, directory.string().c_str(), IN_MOVED_TO | IN_CLOSE_WRITE) == -1) {
+      TRACE("failed to watch %s, errno: %d", directory.string().c_str(), errno);
+      Close();
+      return;
+    }
+
+    wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup_fd_ == -1) {
+      Close();
+    }
+  }
+
+  ~DirectoryWatcher() { Close(); }
+
+  DirectoryWatcher() = delete;
+  DirectoryWatcher& operator=(DirectoryWatcher const&) = delete;
+  DirectoryWatcher(const DirectoryWatcher& that) = delete;
+
+  bool IsValid() const { return inotify_fd_ != -1; }
+
+  /**
+   * Block until files got renamed into the directory or written, the timeout expired or WakeUp got called.
+   *
+   * @param timeout the maximum time to wait
+   * @param filenames the names of the renamed or written files
+   * @return true if files got renamed into the directory or written or if events got lost
+   */
+  bool Wait(const std::chrono::milliseconds timeout, std::set<std::string>* filenames) {
+    pollfd poll_fds[2] = {{inotify_fd_, POLLIN, 0}, {wakeup_fd_, POLLIN, 0}};
+    if (poll(poll_fds, 2, static_cast<int>(timeout.count())) <= 0) {
+      return false;
+    }
+
+    if (poll_fds[1].revents & POLLIN) {
+      uint64_t value;
+      ssize_t ignored = read(wakeup_fd_, &value, sizeof(value));
+      (void)ignored;
+    }
+
+    if (poll_fds[0].revents & POLLIN) {
+      return ReadEvents(filenames);
+    }
+
+    return false;
+  }
+
+  /**
+   * Interrupt a blocking Wait, e.g. to stop the thread that waits.
+   */
+  void WakeUp() {
+    const uint64_t value = 1;
+    ssize_t ignored = write(wakeup_fd_, &value, sizeof(value));
+    (void)ignored;
+  }
+
+ private:
+  int inotify_fd_;
+  int wakeup_fd_;
+
+  bool ReadEvents(std::set<std::string>* filenames) {
+    alignas(inotify_event) char buffer[4096];
+    bool changed = false;
+
+    // drain the queue, renames come in bursts
+    for (;;) {
+      const ssize_t length = read(inotify_fd_, buffer, sizeof(buffer));
+      if (length <= 0) {
+        return changed;
+      }
+
+      for (const char* p = buffer; p < buffer + length;) {
+        const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+        if (event->mask & IN_Q_OVERFLOW) {
+          TRACE("inotify queue overflow");
+          changed = true;
+        } else if (event->len > 0) {
+          filenames->emplace(event->name);
+          changed = true;
+        }
+        p += sizeof(inotify_event) + event->len;
+      }
+    }
+  }
+
+  void Close() {
+    if (wakeup_fd_ != -1) {
+      close(wakeup_fd_);
+      wakeup_fd_ = -1;
+    }
+    if (inotify_fd_ != -1) {
+      close(inotify_fd_);
+      inotify_fd_ = -1;
+    }
+  }
+};
+
+} /* namespace internal */
+} /* namespace index */
+} /* namespace keyvi */
+
+#endif  // defined(__linux__)
+
+#endif  // KEYVI_INDEX_INTERNAL_DIRECTORY_WATCHER_H_
@@ -24,6 +24,8 @@
 
 #include <map>
 #include <memory>
+#include <string>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -135,6 +137,55 @@ inline std::map<dictionary::fsa::automata_t, typename SegmentT::deleted_ptr_t> C
   return deleted_keys_map;
 }
 
+using shadowed_keys_t = std::shared_ptr<const std::unordered_set<std::string>>;
+
+/**
+ * Keys to drop from the matches of a segment: its deleted keys and the keys that have newer writes in a memtable.
+ */
+template <class DeletedPtrT>
+class ShadowedKeysFilter final {
+ public:
+  ShadowedKeysFilter(const DeletedPtrT& deleted_keys, const shadowed_keys_t& shadowed_keys)
+      : deleted_keys_(deleted_keys), shadowed_keys_(shadowed_keys) {}
+
+  size_t count(const std::string& key) const {
+    if (shadowed_keys_->count(key) > 0) {
+      return 1;
+    }
+    return deleted_keys_ ? deleted_keys_->count(key) : 0;
+  }
+
+ private:
+  DeletedPtrT deleted_keys_;
+  shadowed_keys_t shadowed_keys_;
+};
+
+/**
+ * Create a filter for every fsa, unlike for deleted keys every segment needs one. Empty if no keys are shadowed.
+ */
+template <class DeletedMapT, class StatePairT>
+inline std::map<dictionary::fsa::automata_t, std::shared_ptr<ShadowedKeysFilter<typename DeletedMapT::mapped_type>>>
+CreateShadowedKeysFilterMap(const DeletedMapT& deleted_keys_map, const std::vector<StatePairT>& fsa_start_state_pairs,
+                            const shadowed_keys_t& shadowed_keys) {
+  using filter_t = ShadowedKeysFilter<typename DeletedMapT::mapped_type>;
+  std::map<dictionary::fsa::automata_t, std::shared_ptr<filter_t>> filter_map;
+
+  if (!shadowed_keys) {
+    return filter_map;
+  }
+
+  for (const auto& fsa : fsa_start_state_pairs) {
+    typename DeletedMapT::mapped_type deleted_keys;
+    auto dk = deleted_keys_map.find(std::get<0>(fsa));
+    if (dk != deleted_keys_map.end()) {
+      deleted_keys = dk->second;
+    }
+    filter_map.emplace(std::get<0>(fsa), std::make_shared<filter_t>(deleted_keys, shadowed_keys));
+  }
+
+  return filter_map;
+}
+
 } /* namespace internal */
 } /* namespace index */
 } /* namespace keyvi */
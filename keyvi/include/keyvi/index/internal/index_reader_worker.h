@@ -26,13 +26,13 @@
 #ifndef KEYVI_INDEX_INTERNAL_INDEX_READER_WORKER_H_
 #define KEYVI_INDEX_INTERNAL_INDEX_READER_WORKER_H_
 
-#include <algorithm>
 #include <atomic>
 #include <chrono>  //NOLINT
 #include <ctime>
 #include <exception>
 #include <memory>
 #include <mutex>  //NOLINT
+#include <set>
 #include <string>
 #include <thread>  //NOLINT
 #include <unordered_map>
@@ -48,6 +48,8 @@
 #include "keyvi/dictionary/dictionary.h"
 #include "keyvi/dictionary/match.h"
 #include "keyvi/index/constants.h"
+#include "keyvi/index/internal/directory_watcher.h"
+#include "keyvi/index/internal/memtable.h"
 #include "keyvi/index/internal/read_only_segment.h"
 #include "keyvi/util/configuration.h"
 
@@ -64,7 +66,9 @@ class IndexReaderWorker final {
       : segments_(),
         refresh_interval_(
             std::chrono::milliseconds(keyvi::util::mapGet<uint64_t>(params, INDEX_REFRESH_INTERVAL, 1000))),
-        stop_update_thread_(true) {
+        refresh_watch_(keyvi::util::mapGetBool(params, INDEX_REFRESH_WATCH, DEFAULT_REFRESH_WATCH)),
+        stop_update_thread_(true),
+        memtables_() {
     index_directory_ = index_directory;
 
     index_toc_file_ = index_directory_;
@@ -76,12 +80,7 @@ class IndexReaderWorker final {
     ReloadIndex();
   }
 
-  ~IndexReaderWorker() {
-    stop_update_thread_ = true;
-    if (update_thread_.joinable()) {
-      update_thread_.join();
-    }
-  }
+  ~IndexReaderWorker() { StopWorkerThread(); }
 
   void StartWorkerThread() {
     if (stop_update_thread_ == false) {
@@ -89,20 +88,41 @@ class IndexReaderWorker final {
       return;
     }
 
+#if defined(__linux__)
+    if (refresh_watch_) {
+      std::unique_ptr<DirectoryWatcher> directory_watcher(new DirectoryWatcher(index_directory_));
+
+      // fall back to polling if the directory can not be watched
+      if (directory_watcher->IsValid()) {
+        directory_watcher_ = std::move(directory_watcher);
+      }
+    }
+#endif
+
     stop_update_thread_ = false;
     update_thread_ = std::thread(&IndexReaderWorker::UpdateWatcher, this);
   }
 
   void StopWorkerThread() {
     stop_update_thread_ = true;
+#if defined(__linux__)
+    if (directory_watcher_) {
+      directory_watcher_->WakeUp();
+    }
+#endif
     if (update_thread_.joinable()) {
       update_thread_.join();
     }
+#if defined(__linux__)
+    directory_watcher_.reset();
+#endif
   }
 
   void Reload() {
+    std::unique_lock<std::mutex> lock(reload_mutex_);
     ReloadIndex();
-    ReloadDeletedKeys();
+    // deletes might have been written within the second of the last reload
+    ReloadDeletedKeys(true);
   }
 
   const_read_only_segments_t Segments() {
@@ -115,6 +135,13 @@ class IndexReaderWorker final {
     return segments;
   }
 
+  /**
+   * A read only index has no pending writes, all keys are in segments.
+   */
+  const Memtable* GetMemtable(const std::string& key) const { return nullptr; }
+
+  const std::vector<const Memtable*>& Memtables() const { return memtables_; }
+
  private:
   boost::filesystem::path index_directory_;
   boost::filesystem::path index_toc_file_;
@@ -122,10 +149,20 @@ class IndexReaderWorker final {
   read_only_segments_t segments_;
   std::weak_ptr<read_only_segment_vec_t> segments_weak_;
   std::mutex mutex_;
+  // reloads happen in the update thread and on request
+  std::mutex reload_mutex_;
   std::unordered_map<std::string, read_only_segment_t> segments_by_name_;
+  // segments with changed deleted keys reported by the watcher, guarded by reload_mutex_
+  std::set<std::string> changed_deleted_keys_;
+  bool force_deleted_keys_reload_ = false;
   std::chrono::milliseconds refresh_interval_;
+  bool refresh_watch_;
+#if defined(__linux__)
+  std::unique_ptr<DirectoryWatcher> directory_watcher_;
+#endif
   std::thread update_thread_;
   std::atomic_bool stop_update_thread_;
+  const std::vector<const Memtable*> memtables_;
 
   void ReloadIndex() {
     std::time_t t = boost::filesystem::last_write_time(index_toc_file_);
@@ -188,31 +225,87 @@ class IndexReaderWorker final {
     TRACE("Loaded new segments");
   }
 
-  void ReloadDeletedKeys() {
-    for (const read_only_segment_t& s : *segments_) {
-      s->ReloadDeletedKeys();
+  void ReloadDeletedKeys(bool force = false) {
+    force = force || force_deleted_keys_reload_;
+    for (const auto& segment : segments_by_name_) {
+      segment.second->ReloadDeletedKeys(force || changed_deleted_keys_.count(segment.first) > 0);
     }
+    changed_deleted_keys_.clear();
+    force_deleted_keys_reload_ = false;
   }
 
   void UpdateWatcher() {
     int retries_left = 3;
+    bool reload = true;
     while (!stop_update_thread_) {
-      TRACE("UpdateWatcher: Check for new segments");
-      try {
-        ReloadIndex();
-        ReloadDeletedKeys();
-        retries_left = 0;
-      } catch (const std::exception& ex) {
-        TRACE("UpdateWatcher: reload failed: %s, retries left: %d", ex.what(), retries_left);
+      if (reload) {
+        TRACE("UpdateWatcher: Check for new segments");
+        try {
+          std::unique_lock<std::mutex> lock(reload_mutex_);
+          ReloadIndex();
+          ReloadDeletedKeys();
+          reload = false;
+          retries_left = 0;
+        } catch (const std::exception& ex) {
+          TRACE("UpdateWatcher: reload failed: %s, retries left: %d", ex.what(), retries_left);
+          last_modification_time_ = 0;
+          if (retries_left > 0) {
+            --retries_left;
+            continue;
+          }
+          retries_left = 3;
+        }
+      }
+
+      // a failed reload is repeated after the refresh interval
+      reload = WaitForUpdates(reload) || reload;
+    }
+  }
+
+  /**
+   * Wait for changes of the index, returns true if the index should be reloaded.
+   *
+   * @param retry whether the last reload failed, in this case wait at most the refresh interval
+   */
+  bool WaitForUpdates(const bool retry) {
+#if defined(__linux__)
+    if (directory_watcher_) {
+      // inotify reports every change, the safety interval only guards against lost events
+      const std::chrono::milliseconds timeout =
+          retry ? refresh_interval_ : std::chrono::milliseconds(DEFAULT_REFRESH_WATCH_SAFETY_INTERVAL);
+      const auto start = std::chrono::steady_clock::now();
+      std::set<std::string> filenames;
+
+      if (!directory_watcher_->Wait(timeout, &filenames)) {
+        return std::chrono::steady_clock::now() - start >= timeout;
+      }
+
+      // no filenames: events got lost
+      if (filenames.empty() || filenames.count("index.toc") > 0) {
+        // the toc got replaced, the modification time might be unchanged as it has a resolution of seconds
+        std::unique_lock<std::mutex> lock(reload_mutex_);
         last_modification_time_ = 0;
-        if (retries_left > 0) {
-          --retries_left;
-          continue;
+        force_deleted_keys_reload_ = true;
+        return true;
+      }
+
+      // new segment files only become visible with the toc, deleted keys are reloaded per segment,
+      // forced as a second delete might have been written within the same second
+      bool reload = false;
+      std::unique_lock<std::mutex> lock(reload_mutex_);
+      for (const std::string& filename : filenames) {
+        const boost::filesystem::path path(filename);
+        const std::string extension = path.extension().string();
+        if (extension == ".dk" || extension == ".dkm" || extension == ".dkd") {
+          changed_deleted_keys_.insert(path.stem().string());
+          reload = true;
         }
-        retries_left = 3;
       }
-      std::this_thread::sleep_for(refresh_interval_);
+      return reload;
     }
+#endif
+    std::this_thread::sleep_for(refresh_interval_);
+    return true;
   }
 };
 
@@ -75,6 +75,11 @@ class IndexSettings final {
     } else {
       settings_[SEGMENT_EXTERNAL_MERGE_KEY_THRESHOLD] = DEFAULT_EXTERNAL_MERGE_KEY_THRESHOLD;
     }
+    if (params.count(INDEX_WRITER_THREADS)) {
+      settings_[INDEX_WRITER_THREADS] = keyvi::util::mapGet<size_t>(params, INDEX_WRITER_THREADS);
+    } else {
+      settings_[INDEX_WRITER_THREADS] = DEFAULT_WRITER_THREADS;
+    }
   }
 
   const std::string& GetKeyviMergerBin() const { return std::get<std::string>(settings_.at(KEYVIMERGER_BIN)); }
@@ -93,6 +98,11 @@ class IndexSettings final {
     return std::get<size_t>(settings_.at(SEGMENT_EXTERNAL_MERGE_KEY_THRESHOLD));
   }
 
+  /**
+   * Number of in-memory shards, each filled and compiled by its own thread.
+   */
+  const size_t GetWriterThreads() const { return std::get<size_t>(settings_.at(INDEX_WRITER_THREADS)); }
+
  private:
   std::unordered_map<std::string, std::variant<std::string, size_t>> settings_;
 };
@@ -52,6 +52,8 @@
 #include "keyvi/dictionary/dictionary_types.h"
 #include "keyvi/index/constants.h"
 #include "keyvi/index/internal/index_settings.h"
+#include "keyvi/index/internal/key_filter.h"
+#include "keyvi/index/internal/memtable.h"
 #include "keyvi/index/internal/merge_job.h"
 #include "keyvi/index/internal/merge_policy_selector.h"
 #include "keyvi/index/internal/segment.h"
@@ -71,10 +73,9 @@ class IndexWriterWorker final {
   struct IndexPayload {
     explicit IndexPayload(const std::string& index_directory, const keyvi::util::parameters_t& params)
         : external_process_ctx_(),
-          compiler_(),
-          write_counter_(0),
           segments_(),
           segments_mutex_(),
+          segments_update_mutex_(),
           flush_mutex_(),
           index_directory_(index_directory),
           index_toc_file_(index_directory_ / "index.toc"),
@@ -91,11 +92,11 @@ class IndexWriterWorker final {
     }
 
     boost::asio::io_context external_process_ctx_;
-    compiler_t compiler_;
-    std::atomic_size_t write_counter_;
     segments_t segments_;
     std::weak_ptr<segment_vec_t> segments_weak_;
     std::mutex segments_mutex_;
+    // serializes changes of the segments, e.g. new segments and deletes from the shards and merges
+    std::mutex segments_update_mutex_;
     std::mutex flush_mutex_;
     const boost::filesystem::path index_directory_;
     const boost::filesystem::path index_toc_file_;
@@ -110,14 +111,48 @@ class IndexWriterWorker final {
     std::atomic_bool merge_enabled_;
   };
 
+  /**
+   * In-memory part of the index, compiled into segments independently of the other shards.
+   *
+   * Keys are assigned to shards by hash, all writes of a key are therefore processed in order by the thread of its
+   * shard, which keeps last-write-wins and deletes correct across shards.
+   *
+   * Writes are numbered and put into the memtable before they are queued, this makes them visible for readers
+   * until the shard thread compiled them into a segment.
+   */
+  struct IndexShard {
+    compiler_t compiler_;
+    // filled together with the compiler, written next to the segment
+    std::unique_ptr<KeyFilterBuilder> key_filter_;
+    std::atomic_size_t write_counter_{0};
+    Memtable memtable_;
+    // assigning a sequence number and queuing must happen atomically to keep the queue ordered
+    std::mutex write_mutex_;
+    uint64_t next_sequence_ = 0;
+    // sequence number of the last write processed by the shard thread
+    uint64_t sequence_ = 0;
+  };
+
+  using shard_active_object_t = util::ActiveObject<IndexShard>;
+
  public:
   explicit IndexWriterWorker(const std::string& index_directory, const keyvi::util::parameters_t& params)
       : payload_(index_directory, params),
         merge_policy_(merge_policy(keyvi::util::mapGet<std::string>(params, MERGE_POLICY, DEFAULT_MERGE_POLICY))),
-        compiler_active_object_(&payload_, std::bind(&index::internal::IndexWriterWorker::ScheduledTask, this),
-                                std::chrono::milliseconds(payload_.index_refresh_interval_)) {
+        merge_active_object_(&payload_, std::bind(&index::internal::IndexWriterWorker::ScheduledTask, this),
+                             std::chrono::milliseconds(payload_.index_refresh_interval_)) {
     TRACE("construct worker: %s", payload_.index_directory_.c_str());
     LoadIndex();
+
+    const size_t writer_threads = std::max<size_t>(payload_.settings_.GetWriterThreads(), 1);
+    for (size_t i = 0; i < writer_threads; ++i) {
+      shards_.emplace_back(new IndexShard());
+      IndexShard* shard = shards_.back().get();
+      shard_active_objects_.emplace_back(new shard_active_object_t(
+          shard, [this, shard]() { ShardScheduledTask(shard); },
+          std::chrono::milliseconds(payload_.index_refresh_interval_)));
+      memtables_.push_back(&shard->memtable_);
+    }
   }
 
   IndexWriterWorker& operator=(IndexWriterWorker const&) = delete;
@@ -127,9 +162,12 @@ class IndexWriterWorker final {
     TRACE("destruct worker: %s", payload_.index_directory_.c_str());
     payload_.merge_enabled_ = false;
 
+    // stopping the shards compiles what is left
+    shard_active_objects_.clear();
+
     // push a function to finish all pending merges
-    compiler_active_object_([](IndexPayload& payload) {
-      Compile(&payload);
+    merge_active_object_([](IndexPayload& payload) {
+      std::unique_lock<std::mutex> lock(payload.segments_update_mutex_);
       for (MergeJob& p : payload.merge_jobs_) {
         p.Finalize();
       }
@@ -147,54 +185,118 @@ class IndexWriterWorker final {
     return segments;
   }
 
+  /**
+   * Get the memtable that holds the pending writes for the given key.
+   */
+  const Memtable* GetMemtable(const std::string& key) const { return &shards_[GetShard(key)]->memtable_; }
+
+  const std::vector<const Memtable*>& Memtables() const { return memtables_; }
+
   // todo: rvalue version??
   void Add(const std::string& key, const std::string& value) {
     // push function
     TRACE("add key %s, pt: %p", key.c_str(), &key);
 
-    // strings are copied
-    compiler_active_object_([key, value](IndexPayload& payload) {
-      CreateCompilerIfNeeded(&payload);
-      TRACE("add_async key %s, pt: %p", key.c_str(), &key);
-      payload.compiler_->Add(key, value);
-    });
+    const size_t shard = GetShard(key);
 
-    CompileIfThresholdIsHit();
+    {
+      std::unique_lock<std::mutex> lock(shards_[shard]->write_mutex_);
+      const uint64_t sequence = ++shards_[shard]->next_sequence_;
+      shards_[shard]->memtable_.Add(key, value, sequence);
+
+      // strings are copied
+      (*shard_active_objects_[shard])([key, value, sequence](IndexShard& shard) {
+        CreateCompilerIfNeeded(&shard);
+        TRACE("add_async key %s, pt: %p", key.c_str(), &key);
+        shard.compiler_->Add(key, value);
+        shard.key_filter_->Add(key);
+        shard.sequence_ = sequence;
+      });
+    }
+
+    CompileIfThresholdIsHit(shard);
   }
 
   template <typename ContainerType>
   void Add(const std::shared_ptr<ContainerType>& key_values) {
     TRACE("bulk add keys: %ul", key_values->size());
+    using key_value_t = typename ContainerType::value_type;
+    using slice_t = std::vector<const key_value_t*>;
+
+    // split the batch once, every shard gets pointers to its own key/values, the shared pointer keeps them alive
+    const size_t number_of_shards = shards_.size();
+    std::vector<std::shared_ptr<slice_t>> slices(number_of_shards);
+    for (const key_value_t& key_value : *key_values) {
+      std::shared_ptr<slice_t>& slice = slices[GetShard(key_value.first, number_of_shards)];
+      if (!slice) {
+        slice = std::make_shared<slice_t>();
+      }
+      slice->push_back(&key_value);
+    }
 
-    // the shared pointer is copied (not the key/values)
-    compiler_active_object_([key_values](IndexPayload& payload) {
-      CreateCompilerIfNeeded(&payload);
+    // lock all affected shards, in order, so the batch becomes visible at once
+    std::vector<std::unique_lock<std::mutex>> locks;
+    for (size_t i = 0; i < number_of_shards; ++i) {
+      if (slices[i]) {
+        locks.emplace_back(shards_[i]->write_mutex_);
+      }
+    }
 
-      for (auto key_value : *key_values) {
-        TRACE("add_async key %s, pt: %p", key_value.first.c_str(), &key_value.first);
-        payload.compiler_->Add(key_value.first, key_value.second);
+    for (size_t i = 0; i < number_of_shards; ++i) {
+      if (!slices[i]) {
+        continue;
       }
-    });
-    CompileIfThresholdIsHit();
+
+      const uint64_t sequence = ++shards_[i]->next_sequence_;
+      for (const key_value_t* key_value : *slices[i]) {
+        shards_[i]->memtable_.Add(key_value->first, key_value->second, sequence);
+      }
+
+      (*shard_active_objects_[i])([key_values, slice = slices[i], sequence](IndexShard& shard) {
+        CreateCompilerIfNeeded(&shard);
+        for (const key_value_t* key_value : *slice) {
+          TRACE("add_async key %s, pt: %p", key_value->first.c_str(), &key_value->first);
+          shard.compiler_->Add(key_value->first, key_value->second);
+          shard.key_filter_->Add(key_value->first);
+        }
+        shard.sequence_ = sequence;
+      });
+    }
+    locks.clear();
+
+    for (size_t i = 0; i < number_of_shards; ++i) {
+      if (slices[i]) {
+        CompileIfThresholdIsHit(i);
+      }
+    }
   }
 
   void Delete(const std::string& key) {
-    compiler_active_object_([key](IndexPayload& payload) {
-      payload.any_delete_ = true;
+    const size_t shard = GetShard(key);
+
+    std::unique_lock<std::mutex> write_lock(shards_[shard]->write_mutex_);
+    const uint64_t sequence = ++shards_[shard]->next_sequence_;
+    shards_[shard]->memtable_.Delete(key, sequence);
+
+    (*shard_active_objects_[shard])([this, key, sequence](IndexShard& shard) {
       TRACE("delete key %s", key.c_str());
+      shard.sequence_ = sequence;
 
-      if (payload.compiler_) {
-        payload.compiler_->Delete(key);
+      if (shard.compiler_) {
+        shard.compiler_->Delete(key);
       }
 
-      if (payload.segments_) {
-        for (const segment_t& s : *payload.segments_) {
+      std::unique_lock<std::mutex> lock(payload_.segments_update_mutex_);
+      payload_.any_delete_ = true;
+      if (payload_.segments_) {
+        for (const segment_t& s : *payload_.segments_) {
           s->DeleteKey(key);
         }
       }
     });
+    write_lock.unlock();
 
-    CompileIfThresholdIsHit();
+    CompileIfThresholdIsHit(shard);
   }
 
   /**
@@ -204,46 +306,51 @@ class IndexWriterWorker final {
     TRACE("flush");
 
     if (async) {
-      compiler_active_object_([](IndexPayload& payload) {
-        PersistDeletes(&payload);
-        Compile(&payload);
-      });
+      for (const auto& shard_active_object : shard_active_objects_) {
+        (*shard_active_object)([this](IndexShard& shard) { Compile(&payload_, &shard); });
+      }
+      // deletes that are still queued get persisted with the next scheduled run
+      merge_active_object_([](IndexPayload& payload) { PersistDeletes(&payload); });
     } else {
       std::condition_variable c;
       std::unique_lock<std::mutex> lock(payload_.flush_mutex_);
-      std::atomic_bool flushed{false};
-
-      compiler_active_object_([&c, &flushed](IndexPayload& payload) {
-        std::unique_lock<std::mutex> lock(payload.flush_mutex_);
-        PersistDeletes(&payload);
-        Compile(&payload);
-        flushed = true;
-        c.notify_all();
-      });
+      size_t pending_shards = shard_active_objects_.size();
+
+      // the shards compile in parallel, writes queued before have been processed by then
+      for (const auto& shard_active_object : shard_active_objects_) {
+        (*shard_active_object)([this, &c, &pending_shards](IndexShard& shard) {
+          Compile(&payload_, &shard);
+          std::unique_lock<std::mutex> lock(payload_.flush_mutex_);
+          --pending_shards;
+          c.notify_all();
+        });
+      }
 
-      // condition may be unblocked spuriously, check flushed
-      while (flushed == false) {
+      // condition may be unblocked spuriously, check the pending shards
+      while (pending_shards > 0) {
         c.wait(lock);
       }
+
+      PersistDeletes(&payload_);
     }
   }
 
   void ForceMerge(const size_t max_segments) {
     TRACE("force merge");
 
-    // 1st check the queue and empty it if necessary
-    if (compiler_active_object_.Size() > 0) {
+    // 1st check the queues and empty them if necessary
+    if (PendingWrites() > 0) {
       Flush();
     }
 
     // spin until we reach the desired size
-    while (payload_.segments_->size() > max_segments) {
+    while (NumberOfSegments() > max_segments) {
       // wait some time for segments being merged
       // todo improve this dependent on number and size of segments
       std::this_thread::sleep_for(std::chrono::milliseconds(SPINLOCK_WAIT_FOR_SEGMENT_MERGES_MS));
 
       // should we somehow got new data, flush again
-      if (compiler_active_object_.Size() > 0) {
+      if (PendingWrites() > 0) {
         Flush();
       }
     }
@@ -252,15 +359,39 @@ class IndexWriterWorker final {
  private:
   IndexPayload payload_;
   merge_policy_t merge_policy_;
-  util::ActiveObject<IndexPayload> compiler_active_object_;
+  // merges and persists deletes
+  util::ActiveObject<IndexPayload> merge_active_object_;
+  std::vector<std::unique_ptr<IndexShard>> shards_;
+  // fill and compile the shards, destructed first
+  std::vector<std::unique_ptr<shard_active_object_t>> shard_active_objects_;
+  std::vector<const Memtable*> memtables_;
+
+  size_t GetShard(const std::string& key) const { return GetShard(key, shards_.size()); }
 
-  void CompileIfThresholdIsHit() {
-    if (++payload_.write_counter_ > payload_.compile_key_threshold_) {
-      compiler_active_object_([](IndexPayload& payload) { Compile(&payload); });
-      payload_.write_counter_ = 0;
+  static size_t GetShard(const std::string& key, size_t number_of_shards) {
+    return number_of_shards == 1 ? 0 : std::hash<std::string>()(key) % number_of_shards;
+  }
+
+  size_t PendingWrites() const {
+    size_t pending_writes = 0;
+    for (const auto& shard_active_object : shard_active_objects_) {
+      pending_writes += shard_active_object->Size();
+    }
+    return pending_writes;
+  }
+
+  size_t NumberOfSegments() {
+    std::unique_lock<std::mutex> lock(payload_.segments_mutex_);
+    return payload_.segments_->size();
+  }
+
+  void CompileIfThresholdIsHit(size_t shard) {
+    if (++shards_[shard]->write_counter_ > payload_.compile_key_threshold_) {
+      (*shard_active_objects_[shard])([this](IndexShard& shard) { Compile(&payload_, &shard); });
+      shards_[shard]->write_counter_ = 0;
 
       // worst case scenario, to many segments, throttle further writes until we are below the limit
-      while (compiler_active_object_.Size() + payload_.segments_->size() >= payload_.max_segments_) {
+      while (PendingWrites() + NumberOfSegments() >= payload_.max_segments_) {
         // wait some time and then flush, which should give time to reduce the number of open file descriptors
         std::this_thread::sleep_for(std::chrono::milliseconds(SPINLOCK_WAIT_FOR_SEGMENT_MERGES_MS));
         Flush();
@@ -279,12 +410,12 @@ class IndexWriterWorker final {
       RunMerge();
     }
 
-    if (!payload_.compiler_ && !payload_.any_delete_) {
-      return;
-    }
-
     PersistDeletes(&payload_);
-    Compile(&payload_);
+  }
+
+  void ShardScheduledTask(IndexShard* shard) {
+    TRACE("Scheduled shard task");
+    Compile(&payload_, shard);
   }
 
   /**
@@ -292,6 +423,7 @@ class IndexWriterWorker final {
    */
   void FinalizeMerge() {
     bool any_merge_finalized = false;
+    std::unique_lock<std::mutex> lock(payload_.segments_update_mutex_);
 
     TRACE("Finalize Merge");
     for (MergeJob& p : payload_.merge_jobs_) {
@@ -382,24 +514,29 @@ class IndexWriterWorker final {
 
     size_t merge_policy_id = 0;
     std::vector<segment_t> to_merge;
+    size_t number_of_segments = 0;
 
-    if (merge_policy_->SelectMergeSegments(payload_.segments_, &to_merge, &merge_policy_id) == false) {
-      return;
+    {
+      std::unique_lock<std::mutex> lock(payload_.segments_update_mutex_);
+      if (merge_policy_->SelectMergeSegments(payload_.segments_, &to_merge, &merge_policy_id) == false) {
+        return;
+      }
+
+      for (segment_t& s : to_merge) {
+        s->ElectedForMerge();
+      }
+      number_of_segments = payload_.segments_->size();
     }
 
     TRACE("enough segments found for merging");
     boost::filesystem::path p(payload_.index_directory_);
     p /= boost::filesystem::unique_path("%%%%-%%%%-%%%%-%%%%.kv");
 
-    for (segment_t& s : to_merge) {
-      s->ElectedForMerge();
-    }
-
     payload_.merge_jobs_.emplace_back(to_merge, merge_policy_id, p, payload_.settings_);
 
     // force external merge if low on filedescriptors
     payload_.merge_jobs_.back().Run(&payload_.external_process_ctx_,
-                                    payload_.segments_->size() + to_merge.size() + 10 > payload_.max_segments_);
+                                    number_of_segments + to_merge.size() + 10 > payload_.max_segments_);
   }
 
   void LoadIndex() {
@@ -426,6 +563,8 @@ class IndexWriterWorker final {
   }
 
   static inline void PersistDeletes(IndexPayload* payload) {
+    std::unique_lock<std::mutex> lock(payload->segments_update_mutex_);
+
     // only loop through segments if any delete has happened
     if (payload->any_delete_) {
       for (segment_t& s : *payload->segments_) {
@@ -439,18 +578,23 @@ class IndexWriterWorker final {
     payload->any_delete_ = false;
   }
 
-  static inline void CreateCompilerIfNeeded(IndexPayload* payload) {
-    if (!payload->compiler_) {
+  static inline void CreateCompilerIfNeeded(IndexShard* shard) {
+    if (!shard->compiler_) {
       TRACE("recreate compiler");
       keyvi::util::parameters_t params = keyvi::util::parameters_t{{"memory_limit_mb", "5"}};
 
-      payload->compiler_.reset(new dictionary::JsonDictionaryIndexCompiler(params));
+      shard->compiler_.reset(new dictionary::JsonDictionaryIndexCompiler(params));
+      shard->key_filter_.reset(new KeyFilterBuilder());
     }
   }
 
-  static inline void Compile(IndexPayload* payload) {
-    if (!payload->compiler_) {
+  static inline void Compile(IndexPayload* payload, IndexShard* shard) {
+    // everything up to this write is either in the compiler or has been applied to the segments
+    const uint64_t sequence = shard->sequence_;
+
+    if (!shard->compiler_) {
       TRACE("no compiler found");
+      TrimMemtable(payload, shard, sequence);
       return;
     }
 
@@ -458,18 +602,21 @@ class IndexWriterWorker final {
     p /= boost::filesystem::unique_path("%%%%-%%%%-%%%%-%%%%.kv");
 
     TRACE("compiling");
-    payload->compiler_->Compile();
+    shard->compiler_->Compile();
     TRACE("write to file [%s] [%s]", p.string().c_str(), p.filename().string().c_str());
 
-    payload->compiler_->WriteToFile(p.string());
+    shard->compiler_->WriteToFile(p.string());
+    shard->key_filter_->WriteToFile(p.string() + ".kf");
 
     // free resources
-    payload->compiler_.reset();
+    shard->compiler_.reset();
+    shard->key_filter_.reset();
 
     // add/register new segment
     // we have to copy the segments (shallow copy/list of shared pointers to segments)
     // and then swap it
     segment_t new_segment(new Segment(p, true));
+    std::unique_lock<std::mutex> update_lock(payload->segments_update_mutex_);
     segments_t new_segments = std::make_shared<segment_vec_t>(*payload->segments_);
     new_segments->push_back(new_segment);
 
@@ -483,6 +630,16 @@ class IndexWriterWorker final {
 
     // reset as segments have been changed
     payload->segments_weak_.reset();
+    update_lock.unlock();
+
+    // only now the segment is visible, readers find the keys either in the memtable or in the segment
+    TrimMemtable(payload, shard, sequence);
+  }
+
+  static inline void TrimMemtable(IndexPayload* payload, IndexShard* shard, const uint64_t sequence) {
+    // deletes applied to the segments only become visible once persisted, keep the tombstones until then
+    PersistDeletes(payload);
+    shard->memtable_.Trim(sequence);
   }
 
   static void WriteToc(const IndexPayload* payload) {
@@ -0,0 +1,260 @@
+/* * keyvi - A key value store.
+ *
+ * Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * key_filter.h
+ */
+
+#ifndef KEYVI_INDEX_INTERNAL_KEY_FILTER_H_
+#define KEYVI_INDEX_INTERNAL_KEY_FILTER_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "keyvi/dictionary/util/endian.h"
+
+// #define ENABLE_TRACING
+#include "keyvi/dictionary/util/trace.h"
+
+namespace keyvi {
+namespace index {
+namespace internal {
+
+/**
+ * Split block bloom filter over the keys of a segment, persisted next to the dictionary file.
+ *
+ * Every key sets one bit in each of the 8 words of a 64 byte block, a lookup therefore touches a single cache line.
+ * The filter has no false negatives, a negative answer means the segment does not need to be searched.
+ *
+ * The file is written in little endian byte order.
+ */
+class KeyFilter final {
+ public:
+  static const size_t BLOCK_WORDS = 8;
+  static const size_t BITS_PER_KEY = 10;
+  static const uint32_t VERSION = 1;
+
+  /**
+   * Load a filter file, IsValid returns false if the file does not exist or can not be used.
+   */
+  explicit KeyFilter(const boost::filesystem::path& path) : region_(), blocks_(nullptr), number_of_blocks_(0) {
+    boost::system::error_code ec;
+    if (!boost::filesystem::is_regular_file(path, ec) || boost::filesystem::file_size(path, ec) < sizeof(Header)) {
+      return;
+    }
+
+    boost::interprocess::file_mapping file_mapping(path.string().c_str(), boost::interprocess::read_only);
+    region_ = boost::interprocess::mapped_region(file_mapping, boost::interprocess::read_only);
+
+    Header header;
+    std::memcpy(&header, region_.get_address(), sizeof(Header));
+    const uint32_t version = le32toh(header.version);
+    const uint64_t number_of_blocks = le64toh(header.number_of_blocks);
+    if (std::memcmp(header.magic, MAGIC, sizeof(header.magic)) != 0 || version != VERSION || number_of_blocks == 0 ||
+        region_.get_size() != sizeof(Header) + number_of_blocks * BLOCK_WORDS * sizeof(uint64_t)) {
+      TRACE("ignore invalid key filter %s", path.string().c_str());
+      region_ = boost::interprocess::mapped_region();
+      return;
+    }
+
+    blocks_ = reinterpret_cast<const uint64_t*>(static_cast<const char*>(region_.get_address()) + sizeof(Header));
+    number_of_blocks_ = number_of_blocks;
+  }
+
+  KeyFilter() = delete;
+  KeyFilter& operator=(KeyFilter const&) = delete;
+  KeyFilter(const KeyFilter& that) = delete;
+
+  bool IsValid() const { return blocks_ != nullptr; }
+
+  /**
+   * Check the hash of a key, returns false only if the key is not in the segment.
+   *
+   * @param key_hash the hash of the key as returned by Hash
+   */
+  bool MayContain(const uint64_t key_hash) const {
+    const uint64_t* block = blocks_ + GetBlock(key_hash, number_of_blocks_) * BLOCK_WORDS;
+    const uint32_t x = static_cast<uint32_t>(key_hash);
+
+    uint64_t missing = 0;
+    for (size_t i = 0; i < BLOCK_WORDS; ++i) {
+      missing |= ~le64toh(block[i]) & GetMask(x, i);
+    }
+    return missing == 0;
+  }
+
+  /**
+   * Hash a key, stable across processes and platforms as it is persisted.
+   *
+   * The hash is MurmurHash64A, the key is consumed 8 bytes at a time.
+   */
+  static uint64_t Hash(const std::string& key) {
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
+    const int r = 47;
+    const size_t len = key.size();
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(key.data());
+    const unsigned char* end = data + (len & ~static_cast<size_t>(7));
+
+    uint64_t h = 0x2f7d3bfe8a9e1c45ULL ^ (len * m);
+
+    for (; data != end; data += 8) {
+      uint64_t k;
+      std::memcpy(&k, data, sizeof(k));
+      k = le64toh(k);
+
+      k *= m;
+      k ^= k >> r;
+      k *= m;
+
+      h ^= k;
+      h *= m;
+    }
+
+    switch (len & 7) {
+      case 7:
+        h ^= static_cast<uint64_t>(data[6]) << 48;
+        [[fallthrough]];
+      case 6:
+        h ^= static_cast<uint64_t>(data[5]) << 40;
+        [[fallthrough]];
+      case 5:
+        h ^= static_cast<uint64_t>(data[4]) << 32;
+        [[fallthrough]];
+      case 4:
+        h ^= static_cast<uint64_t>(data[3]) << 24;
+        [[fallthrough]];
+      case 3:
+        h ^= static_cast<uint64_t>(data[2]) << 16;
+        [[fallthrough]];
+      case 2:
+        h ^= static_cast<uint64_t>(data[1]) << 8;
+        [[fallthrough]];
+      case 1:
+        h ^= static_cast<uint64_t>(data[0]);
+        h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+
+    return h;
+  }
+
+ private:
+  friend class KeyFilterBuilder;
+
+  static constexpr char MAGIC[8] = {'k', 'e', 'y', 'v', 'i', 'k', 'f', '\0'};
+
+  // padded to the block size, blocks stay cache line aligned in the mapping
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t number_of_blocks;
+    uint64_t number_of_keys;
+    uint64_t padding[4];
+  };
+
+  static_assert(sizeof(Header) % (BLOCK_WORDS * sizeof(uint64_t)) == 0, "header must be padded to the block size");
+
+  boost::interprocess::mapped_region region_;
+  const uint64_t* blocks_;
+  uint64_t number_of_blocks_;
+
+  static inline uint64_t GetBlock(const uint64_t key_hash, const uint64_t number_of_blocks) {
+    // the upper 32 bits select the block, the lower 32 bits the bits in the block
+    return ((key_hash >> 32) * number_of_blocks) >> 32;
+  }
+
+  static inline uint64_t GetMask(const uint32_t x, const size_t word) {
+    static const uint32_t SALT[BLOCK_WORDS] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                                              0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+    return 1ULL << ((x * SALT[word]) >> 26);
+  }
+};
+
+/**
+ * Collects the hashes of the keys of a segment while it gets compiled or merged and writes the filter.
+ */
+class KeyFilterBuilder final {
+ public:
+  void Add(const std::string& key) { hashes_.push_back(KeyFilter::Hash(key)); }
+
+  size_t Size() const { return hashes_.size(); }
+
+  /**
+   * Write the filter.
+   *
+   * @throws std::runtime_error if writing the file failed
+   */
+  void WriteToFile(const std::string& filename) const {
+    // at most 2^32 blocks can be addressed
+    const uint64_t number_of_blocks = std::min<uint64_t>(
+        std::max<uint64_t>(1, (hashes_.size() * KeyFilter::BITS_PER_KEY + 511) / 512), UINT32_MAX);
+    std::vector<uint64_t> blocks(number_of_blocks * KeyFilter::BLOCK_WORDS, 0);
+
+    for (const uint64_t key_hash : hashes_) {
+      uint64_t* block = blocks.data() + KeyFilter::GetBlock(key_hash, number_of_blocks) * KeyFilter::BLOCK_WORDS;
+      const uint32_t x = static_cast<uint32_t>(key_hash);
+
+      for (size_t i = 0; i < KeyFilter::BLOCK_WORDS; ++i) {
+        block[i] |= KeyFilter::GetMask(x, i);
+      }
+    }
+
+    for (uint64_t& word : blocks) {
+      word = htole64(word);
+    }
+
+    KeyFilter::Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, KeyFilter::MAGIC, sizeof(header.magic));
+    header.version = htole32(KeyFilter::VERSION);
+    header.number_of_blocks = htole64(number_of_blocks);
+    header.number_of_keys = htole64(static_cast<uint64_t>(hashes_.size()));
+
+    TRACE("write key filter %s, %lu keys, %lu blocks", filename.c_str(), hashes_.size(), number_of_blocks);
+    std::ofstream out_stream(filename, std::ios::binary);
+    out_stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out_stream.write(reinterpret_cast<const char*>(blocks.data()), blocks.size() * sizeof(uint64_t));
+    out_stream.close();
+
+    if (out_stream.bad() || out_stream.fail()) {
+      throw std::runtime_error("failed to write key filter " + filename);
+    }
+  }
+
+ private:
+  std::vector<uint64_t> hashes_;
+};
+
+} /* namespace internal */
+} /* namespace index */
+} /* namespace keyvi */
+
+#endif  // KEYVI_INDEX_INTERNAL_KEY_FILTER_H_
@@ -0,0 +1,164 @@
+//
+// keyvi - A key value store.
+//
+// Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/*
+ * memtable.h
+ */
+
+#ifndef KEYVI_INDEX_INTERNAL_MEMTABLE_H_
+#define KEYVI_INDEX_INTERNAL_MEMTABLE_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>         //NOLINT
+#include <shared_mutex>  //NOLINT
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "keyvi/dictionary/match.h"
+#include "keyvi/dictionary/match_pool.h"
+#include "keyvi/util/json_value.h"
+
+// #define ENABLE_TRACING
+#include "keyvi/dictionary/util/trace.h"
+
+namespace keyvi {
+namespace index {
+namespace internal {
+
+/**
+ * Ordered in-memory table of the writes that are not compiled into a segment yet.
+ *
+ * Writers and readers use different threads, the table is guarded by a reader/writer lock so lookups
+ * run concurrently. Every entry carries the sequence number of its write, after a segment has been
+ * published all entries up to the compiled sequence number are trimmed.
+ */
+class Memtable final {
+ public:
+  struct Entry {
+    std::string value;
+    uint64_t sequence;
+    bool deleted;
+  };
+
+  using entries_t = std::vector<std::pair<std::string, Entry>>;
+
+  void Add(const std::string& key, const std::string& value, const uint64_t sequence) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    entries_[key] = Entry{value, sequence, false};
+  }
+
+  void Delete(const std::string& key, const uint64_t sequence) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    entries_[key] = Entry{std::string(), sequence, true};
+  }
+
+  /**
+   * Lookup a key.
+   *
+   * @param key the key
+   * @param match set to the match of the key, stays empty if the key has been deleted
+   * @return true if the memtable has an entry for the key, false if the segments have to be consulted
+   */
+  bool Get(const std::string& key, dictionary::match_t* match) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+      return false;
+    }
+
+    if (!it->second.deleted) {
+      *match = MakeMatch(key, it->second.value);
+    }
+    return true;
+  }
+
+  /**
+   * Check a key without creating a match.
+   *
+   * @param key the key
+   * @param deleted set to true if the key has been deleted
+   * @return true if the memtable has an entry for the key, false if the segments have to be consulted
+   */
+  bool Contains(const std::string& key, bool* deleted) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+      return false;
+    }
+
+    *deleted = it->second.deleted;
+    return true;
+  }
+
+  /**
+   * Copy all entries starting with the given prefix, including deleted ones, in key order.
+   */
+  entries_t GetEntriesWithPrefix(const std::string& prefix) const {
+    entries_t entries;
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    for (auto it = entries_.lower_bound(prefix); it != entries_.end(); ++it) {
+      if (it->first.compare(0, prefix.size(), prefix) != 0) {
+        break;
+      }
+      entries.emplace_back(*it);
+    }
+
+    return entries;
+  }
+
+  /**
+   * Remove all entries that are part of a segment, which are the ones up to the given sequence number.
+   */
+  void Trim(const uint64_t sequence) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    TRACE("trim memtable up to %lu", sequence);
+
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      if (it->second.sequence <= sequence) {
+        it = entries_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  size_t Size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return entries_.size();
+  }
+
+  static dictionary::match_t MakeMatch(const std::string& key, const std::string& value, const uint32_t score = 0) {
+    dictionary::match_t match = dictionary::MakeMatch(0, key.size(), key, score);
+    match->SetRawValue(keyvi::util::EncodeJsonValue(value));
+    return match;
+  }
+
+ private:
+  std::map<std::string, Entry> entries_;
+  mutable std::shared_mutex mutex_;
+};
+
+} /* namespace internal */
+} /* namespace index */
+} /* namespace keyvi */
+
+#endif  // KEYVI_INDEX_INTERNAL_MEMTABLE_H_
@@ -33,6 +33,7 @@
 #include "keyvi/dictionary/fsa/internal/json_value_store.h"
 #include "keyvi/dictionary/fsa/internal/sparse_array_persistence.h"
 #include "keyvi/index/internal/index_settings.h"
+#include "keyvi/index/internal/key_filter.h"
 #include "keyvi/index/internal/segment.h"
 
 // #define ENABLE_TRACING
@@ -145,7 +146,12 @@ class MergeJob final {
           jsonDictionaryMerger.Add(s->GetDictionaryPath().string());
         }
 
+        // build the key filter of the merged segment in the same pass
+        KeyFilterBuilder key_filter;
+        jsonDictionaryMerger.SetKeyCallback([&key_filter](const std::string& key) { key_filter.Add(key); });
+
         jsonDictionaryMerger.Merge(payload_.output_filename_.string());
+        key_filter.WriteToFile(payload_.output_filename_.string() + ".kf");
         payload_.exit_code_ = 0;
       } catch (const std::exception& e) {
         TRACE("internal merge failed with: %s", e.what());
@@ -169,6 +175,9 @@ class MergeJob final {
     args.push_back("-o");
     args.push_back(payload_.output_filename_.string());
 
+    args.push_back("-f");
+    args.push_back(payload_.output_filename_.string() + ".kf");
+
     external_process_.reset(
         new boost::process::v2::process(*external_process_ctx, payload_.settings_.GetKeyviMergerBin(), args));
   }
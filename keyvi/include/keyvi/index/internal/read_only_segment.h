@@ -31,14 +31,14 @@
 #include <mutex>  //NOLINT
 #include <set>
 #include <string>
-#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include <boost/filesystem.hpp>
 
-#include <msgpack.hpp>
-
 #include "keyvi/dictionary/dictionary.h"
+#include "keyvi/index/internal/deleted_keys.h"
+#include "keyvi/index/internal/key_filter.h"
 
 // #define ENABLE_TRACING
 #include "keyvi/dictionary/util/trace.h"
@@ -49,7 +49,7 @@ namespace internal {
 
 class ReadOnlySegment {
  public:
-  using deleted_t = std::unordered_set<std::string>;
+  using deleted_t = internal::DeletedKeys;
   using deleted_ptr_t = std::shared_ptr<deleted_t>;
 
   explicit ReadOnlySegment(const boost::filesystem::path& path)
@@ -58,14 +58,20 @@ class ReadOnlySegment {
             dictionary::DictionaryProperties::FromFile(path.string()))),
         deleted_keys_path_(path),
         deleted_keys_during_merge_path_(path),
+        deleted_keys_delta_path_(path),
+        key_filter_path_(path),
         dictionary_filename_(path.filename().string()),
         dictionary_(),
+        key_filter_(),
         has_deleted_keys_(false),
         deleted_keys_(),
         last_modification_time_deleted_keys_(0),
-        last_modification_time_deleted_keys_during_merge_(0) {
+        last_modification_time_deleted_keys_during_merge_(0),
+        last_modification_time_deleted_keys_delta_(0) {
     deleted_keys_path_ += ".dk";
     deleted_keys_during_merge_path_ += ".dkm";
+    deleted_keys_delta_path_ += ".dkd";
+    key_filter_path_ += ".kf";
 
     LoadDictionary();
     LoadDeletedKeys();
@@ -77,6 +83,13 @@ class ReadOnlySegment {
 
   dictionary::dictionary_properties_t& GetDictionaryProperties() { return dictionary_properties_; }
 
+  /**
+   * Check the key filter of this segment, if it returns false the key is not in the dictionary.
+   *
+   * @param key_hash the hash of the key, see KeyFilter::Hash
+   */
+  bool MayContain(const uint64_t key_hash) const { return !key_filter_ || key_filter_->MayContain(key_hash); }
+
   bool HasDeletedKeys() { return has_deleted_keys_; }
 
   size_t DeletedKeysSize() const {
@@ -108,7 +121,12 @@ class ReadOnlySegment {
     return false;
   }
 
-  void ReloadDeletedKeys() { LoadDeletedKeys(); }
+  /**
+   * Reload the deleted keys if they have been modified.
+   *
+   * @param force reload even if the modification times are unchanged
+   */
+  void ReloadDeletedKeys(bool force = false) { LoadDeletedKeys(force); }
 
   const boost::filesystem::path& GetDictionaryPath() const { return dictionary_path_; }
 
@@ -116,6 +134,10 @@ class ReadOnlySegment {
 
   const boost::filesystem::path& GetDeletedKeysDuringMergePath() const { return deleted_keys_during_merge_path_; }
 
+  const boost::filesystem::path& GetDeletedKeysDeltaPath() const { return deleted_keys_delta_path_; }
+
+  const boost::filesystem::path& GetKeyFilterPath() const { return key_filter_path_; }
+
   const std::string& GetDictionaryFilename() const { return dictionary_filename_; }
 
  protected:
@@ -125,14 +147,20 @@ class ReadOnlySegment {
             dictionary::DictionaryProperties::FromFile(path.string()))),
         deleted_keys_path_(path),
         deleted_keys_during_merge_path_(path),
+        deleted_keys_delta_path_(path),
+        key_filter_path_(path),
         dictionary_filename_(path.filename().string()),
         dictionary_(),
+        key_filter_(),
         has_deleted_keys_(false),
         deleted_keys_(),
         last_modification_time_deleted_keys_(0),
-        last_modification_time_deleted_keys_during_merge_(0) {
+        last_modification_time_deleted_keys_during_merge_(0),
+        last_modification_time_deleted_keys_delta_(0) {
     deleted_keys_path_ += ".dk";
     deleted_keys_during_merge_path_ += ".dkm";
+    deleted_keys_delta_path_ += ".dkd";
+    key_filter_path_ += ".kf";
 
     if (load_dictionary) {
       LoadDictionary();
@@ -149,14 +177,20 @@ class ReadOnlySegment {
         dictionary_properties_(dictionary_properties),
         deleted_keys_path_(dictionary_path_),
         deleted_keys_during_merge_path_(dictionary_path_),
+        deleted_keys_delta_path_(dictionary_path_),
+        key_filter_path_(dictionary_path_),
         dictionary_filename_(dictionary_path_.filename().string()),
         dictionary_(),
+        key_filter_(),
         has_deleted_keys_(false),
         deleted_keys_(),
         last_modification_time_deleted_keys_(0),
-        last_modification_time_deleted_keys_during_merge_(0) {
+        last_modification_time_deleted_keys_during_merge_(0),
+        last_modification_time_deleted_keys_delta_(0) {
     deleted_keys_path_ += ".dk";
     deleted_keys_during_merge_path_ += ".dkm";
+    deleted_keys_delta_path_ += ".dkd";
+    key_filter_path_ += ".kf";
 
     if (load_dictionary) {
       LoadDictionary();
@@ -170,9 +204,21 @@ class ReadOnlySegment {
   void LoadDictionary() {
     // load dictionary
     dictionary_.reset(new dictionary::Dictionary(dictionary_path_.string()));
+
+    // segments without a filter, e.g. from older versions, are always searched
+    std::unique_ptr<KeyFilter> key_filter(new KeyFilter(key_filter_path_));
+    if (key_filter->IsValid()) {
+      key_filter_ = std::move(key_filter);
+    }
   }
 
-  void LoadDeletedKeys() {
+  /**
+   * Load the deleted keys if any of the files has been modified since the last load.
+   *
+   * @param force load the deleted keys even if the modification times did not change, the modification time has a
+   *              granularity of a second, so a writer must force the load after writing the files
+   */
+  void LoadDeletedKeys(bool force = false) {
     TRACE("load deleted keys");
 
     boost::system::error_code ec;
@@ -188,21 +234,22 @@ class ReadOnlySegment {
       last_write_dkm = last_modification_time_deleted_keys_during_merge_;
     }
 
+    std::time_t last_write_dkd = boost::filesystem::last_write_time(deleted_keys_delta_path_, ec);
+    // effectively ignore if file does not exist
+    if (ec) {
+      last_write_dkd = last_modification_time_deleted_keys_delta_;
+    }
+
     // if any list has changed, reload it
-    if (last_write_dk > last_modification_time_deleted_keys_ ||
-        last_write_dkm > last_modification_time_deleted_keys_during_merge_) {
+    if (force || last_write_dk > last_modification_time_deleted_keys_ ||
+        last_write_dkm > last_modification_time_deleted_keys_during_merge_ ||
+        last_write_dkd > last_modification_time_deleted_keys_delta_) {
       TRACE("found deleted keys");
 
-      deleted_ptr_t deleted_keys = std::make_shared<deleted_t>();
-      deleted_t deleted_keys_dk = LoadAndUnserializeDeletedKeys(deleted_keys_path_.string());
-      TRACE("Loaded deleted keys: %d", deleted_keys_dk.size());
-
-      deleted_keys->swap(deleted_keys_dk);
-      // deleted_keys->insert(deleted_keys_dk.begin(), deleted_keys_dk.end());
-      deleted_t deleted_keys_dkm = LoadAndUnserializeDeletedKeys(deleted_keys_during_merge_path_.string());
-      TRACE("Loaded deleted keys m: %d", deleted_keys_dkm.size());
-
-      deleted_keys->insert(deleted_keys_dkm.begin(), deleted_keys_dkm.end());
+      // the files are memory mapped, not parsed
+      deleted_ptr_t deleted_keys = std::make_shared<deleted_t>(
+          std::vector<boost::filesystem::path>{deleted_keys_path_, deleted_keys_delta_path_,
+                                               deleted_keys_during_merge_path_});
 
       // safe swap
       {
@@ -211,12 +258,13 @@ class ReadOnlySegment {
       }
       TRACE("Number of deleted keys: %d", deleted_keys_->size());
 
+      last_modification_time_deleted_keys_ = last_write_dk;
+      last_modification_time_deleted_keys_during_merge_ = last_write_dkm;
+      last_modification_time_deleted_keys_delta_ = last_write_dkd;
       has_deleted_keys_ = true;
     }
   }
 
-  const deleted_t& DeletedKeysDirect() const { return *deleted_keys_; }
-
  private:
   //! path of the underlying dictionary
   boost::filesystem::path dictionary_path_;
@@ -230,12 +278,21 @@ class ReadOnlySegment {
   //! deleted keys while segment gets merged with other segments
   boost::filesystem::path deleted_keys_during_merge_path_;
 
+  //! recently deleted keys, not yet compacted into the list of deleted keys
+  boost::filesystem::path deleted_keys_delta_path_;
+
+  //! filter over the keys of the dictionary
+  boost::filesystem::path key_filter_path_;
+
   //! just the filename part of the dictionary
   std::string dictionary_filename_;
 
   //! the dictionary itself
   dictionary::dictionary_t dictionary_;
 
+  //! the key filter, empty if the segment has none
+  std::unique_ptr<KeyFilter> key_filter_;
+
   //! quick and cheap check whether this segment has deletes (assuming that deletes are rare)
   std::atomic_bool has_deleted_keys_;
 
@@ -254,23 +311,8 @@ class ReadOnlySegment {
   //! last modification time for the deleted keys file during a merge operation
   std::time_t last_modification_time_deleted_keys_during_merge_;
 
-  inline static deleted_t LoadAndUnserializeDeletedKeys(const std::string& filename) {
-    TRACE("loading deleted keys file %s", filename.c_str());
-
-    deleted_t deleted_keys;
-    std::ifstream deleted_keys_stream(filename, std::ios::binary);
-    if (deleted_keys_stream.good()) {
-      std::string buffer;
-      deleted_keys_stream.seekg(0, std::ios::end);
-      buffer.resize(deleted_keys_stream.tellg());
-      deleted_keys_stream.seekg(0, std::ios::beg);
-      deleted_keys_stream.read(&buffer[0], buffer.size());
-      msgpack::unpacked unpacked_object;
-      msgpack::unpack(unpacked_object, buffer.data(), buffer.size());
-      unpacked_object.get().convert(deleted_keys);
-    }
-    return deleted_keys;
-  }
+  //! last modification time for the deleted keys delta file
+  std::time_t last_modification_time_deleted_keys_delta_;
 };
 
 typedef std::shared_ptr<ReadOnlySegment> read_only_segment_t;
@@ -23,14 +23,14 @@
 #include <mutex>  //NOLINT
 #include <set>
 #include <string>
-#include <unordered_set>
 #include <vector>
 
 #include <boost/filesystem.hpp>
 
-#include <msgpack.hpp>
-
 #include "keyvi/dictionary/dictionary.h"
+#include "keyvi/index/constants.h"
+#include "keyvi/index/internal/deleted_keys.h"
+#include "keyvi/index/internal/key_filter.h"
 #include "keyvi/index/internal/read_only_segment.h"
 
 // #define ENABLE_TRACING
@@ -46,6 +46,7 @@ class Segment final : public ReadOnlySegment {
  public:
   using deleted_t = ReadOnlySegment::deleted_t;
   using deleted_ptr_t = ReadOnlySegment::deleted_ptr_t;
+  using new_deleted_t = std::set<std::string>;
 
   explicit Segment(const boost::filesystem::path& path, bool no_deletes = false)
       : ReadOnlySegment(path, false, !no_deletes),
@@ -72,15 +73,23 @@ class Segment final : public ReadOnlySegment {
     deleted_keys_swap_filename_ += ".dk-swap";
 
     // move deletions that happened during merge into the list of deleted keys
+    std::vector<boost::filesystem::path> deleted_keys_files;
     for (const auto& p_segment : parent_segments) {
       deleted_keys_for_write_.insert(p_segment->deleted_keys_during_merge_for_write_.begin(),
                                      p_segment->deleted_keys_during_merge_for_write_.end());
+
+      boost::system::error_code ec;
+      if (boost::filesystem::is_regular_file(p_segment->GetDeletedKeysDuringMergePath(), ec)) {
+        deleted_keys_files.push_back(p_segment->GetDeletedKeysDuringMergePath());
+      }
     }
 
     // persist the current list of deleted keys
-    if (deleted_keys_for_write_.size()) {
-      new_delete_ = true;
-      Persist();
+    if (deleted_keys_for_write_.size() || deleted_keys_files.size()) {
+      internal::DeletedKeys::Write(deleted_keys_files, deleted_keys_for_write_, GetDeletedKeysPath(),
+                                   deleted_keys_swap_filename_);
+      deleted_keys_for_write_.clear();
+      LoadDeletedKeys(true);
     }
   }
 
@@ -94,14 +103,17 @@ class Segment final : public ReadOnlySegment {
     return ReadOnlySegment::GetDictionary();
   }
 
-  bool HasDeletedKeys() {
-    LazyLoadDeletedKeys();
-    return deleted_keys_for_write_.size() + deleted_keys_during_merge_for_write_.size() > 0;
+  bool MayContain(const uint64_t key_hash) {
+    LazyLoadDictionary();
+    return ReadOnlySegment::MayContain(key_hash);
   }
 
+  bool HasDeletedKeys() { return DeletedKeysSize() > 0; }
+
   size_t DeletedKeysSize() {
     LazyLoadDeletedKeys();
-    return deleted_keys_for_write_.size() + deleted_keys_during_merge_for_write_.size();
+    return ReadOnlySegment::DeletedKeysSize() + deleted_keys_for_write_.size() +
+           deleted_keys_during_merge_for_write_.size();
   }
 
   const deleted_ptr_t DeletedKeys() {
@@ -121,15 +133,26 @@ class Segment final : public ReadOnlySegment {
 
   void MergeFailed() {
     in_merge_ = false;
-    if (deleted_keys_during_merge_for_write_.size() > 0) {
+
+    boost::system::error_code ec;
+    const bool has_deleted_keys_during_merge_file =
+        boost::filesystem::is_regular_file(GetDeletedKeysDuringMergePath(), ec);
+
+    if (has_deleted_keys_during_merge_file || deleted_keys_during_merge_for_write_.size() > 0) {
       deleted_keys_for_write_.insert(deleted_keys_during_merge_for_write_.begin(),
                                      deleted_keys_during_merge_for_write_.end());
-
-      new_delete_ = true;
-      Persist();
       deleted_keys_during_merge_for_write_.clear();
-      // remove dkm file
+
+      // merge the deletes that happened during merge into the list of deleted keys
+      internal::DeletedKeys::Write({GetDeletedKeysPath(), GetDeletedKeysDeltaPath(), GetDeletedKeysDuringMergePath()},
+                                   deleted_keys_for_write_, GetDeletedKeysPath(), deleted_keys_swap_filename_);
+      deleted_keys_for_write_.clear();
+      new_delete_ = false;
+
+      // remove dkm and dkd file
       std::remove(GetDeletedKeysDuringMergePath().string().c_str());
+      std::remove(GetDeletedKeysDeltaPath().string().c_str());
+      LoadDeletedKeys(true);
     }
   }
 
@@ -145,10 +168,12 @@ class Segment final : public ReadOnlySegment {
     std::remove(GetDictionaryPath().string().c_str());
     std::remove(GetDeletedKeysDuringMergePath().string().c_str());
     std::remove(GetDeletedKeysPath().string().c_str());
+    std::remove(GetDeletedKeysDeltaPath().string().c_str());
+    std::remove(GetKeyFilterPath().string().c_str());
   }
 
   void DeleteKey(const std::string& key) {
-    if (!GetDictionary()->Contains(key)) {
+    if (!MayContain(KeyFilter::Hash(key)) || !GetDictionary()->Contains(key)) {
       return;
     }
 
@@ -171,21 +196,39 @@ class Segment final : public ReadOnlySegment {
       return false;
     }
     TRACE("persist deleted keys");
-    boost::filesystem::path deleted_keys_file = GetDictionaryPath();
 
-    // its ensured that before merge persist is called, so we have to persist only one or the other file
+    // its ensured that before merge persist is called, so we have to persist only one or the other file,
+    // new deletes are merged into the existing file
     if (in_merge_) {
-      SaveDeletedKeys(GetDeletedKeysDuringMergePath().string(), deleted_keys_during_merge_for_write_);
+      internal::DeletedKeys::Write({GetDeletedKeysDuringMergePath()}, deleted_keys_during_merge_for_write_,
+                                   GetDeletedKeysDuringMergePath(), deleted_keys_swap_filename_);
+      deleted_keys_during_merge_for_write_.clear();
     } else {
-      SaveDeletedKeys(GetDeletedKeysPath().string(), deleted_keys_for_write_);
+      // rewriting the list of deleted keys costs O(deleted keys), new deletes go into the small delta file instead,
+      // which gets compacted once it gets too big compared to the list
+      const size_t delta_size =
+          internal::DeletedKeys::Write({GetDeletedKeysDeltaPath()}, deleted_keys_for_write_, GetDeletedKeysDeltaPath(),
+                                       deleted_keys_swap_filename_);
+      deleted_keys_for_write_.clear();
+
+      if (delta_size * DELETED_KEYS_COMPACTION_RATIO > internal::DeletedKeys::NumberOfKeys(GetDeletedKeysPath())) {
+        TRACE("compact deleted keys");
+        internal::DeletedKeys::Write({GetDeletedKeysPath(), GetDeletedKeysDeltaPath()}, {}, GetDeletedKeysPath(),
+                                     deleted_keys_swap_filename_);
+        std::remove(GetDeletedKeysDeltaPath().string().c_str());
+      }
     }
+    new_delete_ = false;
+    LoadDeletedKeys(true);
 
     return true;
   }
 
  private:
-  deleted_t deleted_keys_for_write_;
-  deleted_t deleted_keys_during_merge_for_write_;
+  //! deletes not yet persisted
+  new_deleted_t deleted_keys_for_write_;
+  //! deletes not yet persisted, that happened while the segment gets merged
+  new_deleted_t deleted_keys_during_merge_for_write_;
   std::mutex lazy_load_mutex_;
   bool dictionary_loaded;
   bool deletes_loaded;
@@ -226,28 +269,10 @@ class Segment final : public ReadOnlySegment {
       std::lock_guard<std::mutex> lock(lazy_load_mutex_);
       if (!deletes_loaded) {
         LoadDeletedKeys();
-
-        // get a copy of the deleted keys for writing
-        if (ReadOnlySegment::HasDeletedKeys()) {
-          if (in_merge_) {
-            deleted_keys_during_merge_for_write_.insert(DeletedKeysDirect().begin(), DeletedKeysDirect().end());
-          } else {
-            deleted_keys_for_write_.insert(DeletedKeysDirect().begin(), DeletedKeysDirect().end());
-          }
-        }
         deletes_loaded = true;
       }
     }
   }
-
-  void SaveDeletedKeys(const std::string& filename, const deleted_t& deleted_keys) {
-    // write to swap file, than rename it
-    {
-      std::ofstream out_stream(deleted_keys_swap_filename_.string(), std::ios::binary);
-      msgpack::pack(out_stream, deleted_keys);
-    }
-    std::rename(deleted_keys_swap_filename_.string().c_str(), filename.c_str());
-  }
 };  // namespace internal
 
 typedef std::shared_ptr<Segment> segment_t;
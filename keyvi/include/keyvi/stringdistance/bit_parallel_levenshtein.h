@@ -0,0 +1,228 @@
+/* * keyvi - A key value store.
+ *
+ * Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * bit_parallel_levenshtein.h
+ */
+
+#ifndef KEYVI_STRINGDISTANCE_BIT_PARALLEL_LEVENSHTEIN_H_
+#define KEYVI_STRINGDISTANCE_BIT_PARALLEL_LEVENSHTEIN_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "utf8.h"
+
+// #define ENABLE_TRACING
+#include "keyvi/dictionary/util/trace.h"
+
+namespace keyvi {
+namespace stringdistance {
+
+// maximum number of codepoints of the input sequence, one bit per codepoint
+static const size_t BIT_PARALLEL_LEVENSHTEIN_MAX_LENGTH = 64;
+
+/**
+ * Damerau-Levenshtein (optimal string alignment) distance with the bit-vector algorithm of Myers, extended for
+ * transpositions by Hyyrö ("A Bit-Vector Algorithm for Computing Levenshtein and Damerau Edit Distances", 2003).
+ *
+ * A drop-in replacement for Levenshtein (NeedlemanWunsch<Damerau_Levenshtein>) for input sequences of up to
+ * BIT_PARALLEL_LEVENSHTEIN_MAX_LENGTH codepoints: instead of a row of the distance matrix every Put calculates the
+ * vertical differences of all cells at once. It keeps the same interface, intermediate scores greater than
+ * max_distance are reported as max_distance + 1 which is all a matcher can distinguish anyway.
+ */
+class BitParallelLevenshtein final {
+ public:
+  BitParallelLevenshtein(const std::vector<uint32_t>& input_sequence, size_t rows, int32_t max_distance)
+      : max_distance_(max_distance), input_sequence_(input_sequence) {
+    if (!Supports(input_sequence_.size())) {
+      throw std::invalid_argument("input sequence too long for bit parallel levenshtein");
+    }
+
+    length_ = input_sequence_.size();
+    length_mask_ = length_ == 64 ? ~0ULL : (1ULL << length_) - 1;
+    last_column_bit_ = length_ > 0 ? 1ULL << (length_ - 1) : 0;
+
+    std::fill(ascii_match_masks_, ascii_match_masks_ + 256, 0);
+    for (size_t i = 0; i < length_; ++i) {
+      const uint32_t codepoint = input_sequence_[i];
+      if (codepoint < 256) {
+        ascii_match_masks_[codepoint] |= 1ULL << i;
+        continue;
+      }
+
+      auto it = std::find_if(match_masks_.begin(), match_masks_.end(),
+                             [codepoint](const std::pair<uint32_t, uint64_t>& p) { return p.first == codepoint; });
+      if (it == match_masks_.end()) {
+        match_masks_.emplace_back(codepoint, 1ULL << i);
+      } else {
+        it->second |= 1ULL << i;
+      }
+    }
+
+    rows_.reserve(rows + 1);
+    compare_sequence_.reserve(rows);
+
+    // first row: distance to the empty candidate, every column adds 1
+    Row row;
+    row.vp = length_mask_;
+    row.score = static_cast<int32_t>(length_);
+    rows_.push_back(row);
+  }
+
+  BitParallelLevenshtein() = delete;
+  BitParallelLevenshtein& operator=(BitParallelLevenshtein const&) = delete;
+  BitParallelLevenshtein(const BitParallelLevenshtein& that) = delete;
+  BitParallelLevenshtein(BitParallelLevenshtein&& other) = default;
+
+  /**
+   * @return true if an input sequence of the given number of codepoints can be handled.
+   */
+  static bool Supports(size_t length) { return length <= BIT_PARALLEL_LEVENSHTEIN_MAX_LENGTH; }
+
+  int32_t Put(uint32_t codepoint, size_t position) {
+    const size_t row_index = position + 1;
+    TRACE("Calculating row: %ld", row_index);
+
+    if (rows_.size() <= row_index) {
+      rows_.resize(row_index + 1);
+      compare_sequence_.resize(row_index);
+    }
+
+    compare_sequence_[position] = codepoint;
+    last_put_position_ = position;
+    latest_calculated_row_ = row_index;
+
+    const Row& previous = rows_[row_index - 1];
+    Row& row = rows_[row_index];
+
+    if (length_ == 0) {
+      row.score = static_cast<int32_t>(row_index);
+      row.intermediate_score = std::min(row.score, max_distance_ + 1);
+      return row.intermediate_score;
+    }
+
+    const uint64_t match_mask = GetMatchMask(codepoint);
+
+    // diagonal zero: cells that have the same value as their upper left neighbor, via match, transposition or
+    // horizontal/vertical propagation
+    uint64_t d0 = (((~previous.d0) & match_mask) << 1) & previous.match_mask;
+    d0 |= (((match_mask & previous.vp) + previous.vp) ^ previous.vp) | match_mask | previous.vn;
+
+    uint64_t hp = previous.vn | ~(d0 | previous.vp);
+    uint64_t hn = previous.vp & d0;
+
+    row.score = previous.score + ((hp & last_column_bit_) ? 1 : 0) - ((hn & last_column_bit_) ? 1 : 0);
+
+    // the first column is the distance to the empty input, it increases with every row
+    hp = (hp << 1) | 1;
+    hn = hn << 1;
+
+    row.vp = (hn | ~(d0 | hp)) & length_mask_;
+    row.vn = hp & d0 & length_mask_;
+    row.d0 = d0;
+    row.match_mask = match_mask;
+    row.intermediate_score = CalculateIntermediateScore(row, row_index);
+
+    TRACE("intermediate score: %d score: %d", row.intermediate_score, row.score);
+    return row.intermediate_score;
+  }
+
+  int32_t GetScore() const { return rows_[latest_calculated_row_].score; }
+
+  std::string GetCandidate(size_t pos = 0) {
+    std::vector<unsigned char> utf8result;
+    utf8::utf32to8(compare_sequence_.begin() + pos, compare_sequence_.begin() + last_put_position_ + 1,
+                   back_inserter(utf8result));
+
+    return std::string(utf8result.begin(), utf8result.end());
+  }
+
+  const std::vector<uint32_t>& GetInputSequence() const { return input_sequence_; }
+
+ private:
+  struct Row {
+    uint64_t vp = 0;
+    uint64_t vn = 0;
+    uint64_t d0 = 0;
+    uint64_t match_mask = 0;
+    int32_t score = 0;
+    int32_t intermediate_score = 0;
+  };
+
+  int32_t max_distance_ = 0;
+  std::vector<uint32_t> input_sequence_;
+  size_t length_ = 0;
+  uint64_t length_mask_ = 0;
+  uint64_t last_column_bit_ = 0;
+  uint64_t ascii_match_masks_[256];
+  std::vector<std::pair<uint32_t, uint64_t>> match_masks_;
+  std::vector<Row> rows_;
+  std::vector<uint32_t> compare_sequence_;
+  size_t last_put_position_ = 0;
+  size_t latest_calculated_row_ = 0;
+
+  uint64_t GetMatchMask(uint32_t codepoint) const {
+    if (codepoint < 256) {
+      return ascii_match_masks_[codepoint];
+    }
+
+    for (const auto& p : match_masks_) {
+      if (p.first == codepoint) {
+        return p.second;
+      }
+    }
+    return 0;
+  }
+
+  /**
+   * The minimum of the row, cells outside of the diagonal corridor of width max_distance can not be smaller than
+   * max_distance + 1, so only those are evaluated (Ukkonen's cutoff).
+   */
+  int32_t CalculateIntermediateScore(const Row& row, size_t row_index) const {
+    const size_t max_distance = static_cast<size_t>(max_distance_);
+    const size_t left_column = row_index > max_distance ? row_index - max_distance : 0;
+    const size_t right_column = std::min(length_, row_index + max_distance);
+
+    if (left_column > right_column) {
+      return max_distance_ + 1;
+    }
+
+    // value of the rightmost cell in the corridor, bit i holds the difference between column i + 1 and column i
+    const uint64_t tail_mask = length_mask_ & ~((right_column == 64) ? ~0ULL : (1ULL << right_column) - 1);
+    int32_t value = row.score - __builtin_popcountll(row.vp & tail_mask) + __builtin_popcountll(row.vn & tail_mask);
+    int32_t minimum = value;
+
+    for (size_t column = right_column; column > left_column; --column) {
+      const uint64_t bit = 1ULL << (column - 1);
+      value -= (row.vp & bit) ? 1 : 0;
+      value += (row.vn & bit) ? 1 : 0;
+      minimum = std::min(minimum, value);
+    }
+
+    return std::min(minimum, max_distance_ + 1);
+  }
+};
+
+} /* namespace stringdistance */
+} /* namespace keyvi */
+
+#endif  // KEYVI_STRINGDISTANCE_BIT_PARALLEL_LEVENSHTEIN_H_
@@ -28,6 +28,7 @@
 
 #include <cstdio>
 #include <fstream>
+#include <set>
 #include <sstream>
 #include <string>
 #include <utility>
@@ -35,9 +36,8 @@
 
 #include <boost/filesystem.hpp>
 
-#include <msgpack.hpp>
-
 #include "keyvi/dictionary/fsa/automata.h"
+#include "keyvi/index/internal/deleted_keys.h"
 #include "keyvi/testing/compilation_utils.h"
 
 namespace keyvi {
@@ -58,14 +58,13 @@ class IndexMock final {
   ~IndexMock() { boost::filesystem::remove_all(mock_index_); }
 
   void AddSegment(std::vector<std::pair<std::string, std::string>>* input) {
-    boost::filesystem::path filename(mock_index_);
-    filename /= "kv-";
-    filename += std::to_string(kv_files_++);
-    filename += ".kv";
+    CompilationUtils::CompileJson(input, NextSegmentFileName());
 
-    std::string filename_str = filename.string();
+    WriteToc();
+  }
 
-    CompilationUtils::CompileJson(input, filename_str);
+  void AddSegment(std::vector<std::pair<std::string, uint32_t>>* input) {
+    CompilationUtils::CompileIntWithInnerWeights(input, NextSegmentFileName());
 
     WriteToc();
   }
@@ -80,11 +79,8 @@ class IndexMock final {
 
     boost::filesystem::path tmp_filename(filename);
     tmp_filename += "-swap";
-    {
-      std::ofstream out_stream(tmp_filename.string(), std::ios::binary);
-      msgpack::pack(out_stream, deleted_keys);
-    }
-    std::rename(tmp_filename.string().c_str(), filename.string().c_str());
+    index::internal::DeletedKeys::Write({}, std::set<std::string>(deleted_keys.begin(), deleted_keys.end()), filename,
+                                        tmp_filename);
   }
 
   std::string GetIndexFolder() const { return mock_index_.string(); }
@@ -93,6 +89,15 @@ class IndexMock final {
   boost::filesystem::path mock_index_;
   size_t kv_files_;
 
+  std::string NextSegmentFileName() {
+    boost::filesystem::path filename(mock_index_);
+    filename /= "kv-";
+    filename += std::to_string(kv_files_++);
+    filename += ".kv";
+
+    return filename.string();
+  }
+
   void WriteToc() {
     boost::filesystem::path toc_file(mock_index_);
     toc_file /= "index.toc";
@@ -0,0 +1,419 @@
+/* * keyvi - A key value store.
+ *
+ * Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * direct_output_stream.h
+ */
+
+#ifndef KEYVI_UTIL_DIRECT_OUTPUT_STREAM_H_
+#define KEYVI_UTIL_DIRECT_OUTPUT_STREAM_H_
+
+#if defined(_WIN32)
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>  // NOLINT
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>  // NOLINT
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include <boost/format.hpp>
+
+#include "keyvi/util/os_utils.h"
+
+// #define ENABLE_TRACING
+#include "keyvi/dictionary/util/trace.h"
+
+namespace keyvi {
+namespace util {
+
+#if defined(_WIN32)
+
+/**
+ * Fallback for platforms without pwrite, a plain file stream.
+ */
+class DirectOutputStream final : public std::ofstream {
+ public:
+  explicit DirectOutputStream(const std::string& filename) : std::ofstream(OsUtils::OpenOutFileStream(filename)) {}
+};
+
+#else
+
+/**
+ * A stream buffer that writes a file bypassing the page cache.
+ *
+ * Data is collected in aligned blocks, full blocks are written by a background thread using pwrite while the caller
+ * fills the next block. The file is opened with O_DIRECT if the file system supports it, otherwise written pages get
+ * dropped from the page cache after they hit the disk. Either way writing a large file does not evict pages of other
+ * processes, e.g. dictionaries served on the same host.
+ *
+ * Writes are asynchronous up to the number of blocks in flight, the caller blocks only if all of them are busy. Close
+ * waits until everything has been written to disk. Pages written this way are not cached, use it only for files that
+ * are not read back right away.
+ *
+ * The stream is write-only and sequential, seeking is not supported, tellp is.
+ */
+class DirectOutputStreamBuffer final : public std::streambuf {
+ public:
+  explicit DirectOutputStreamBuffer(const std::string& filename, size_t block_size = DEFAULT_BLOCK_SIZE,
+                                    size_t number_of_blocks = DEFAULT_NUMBER_OF_BLOCKS)
+      : filename_(filename), block_size_(std::max(ALIGNMENT, block_size - (block_size % ALIGNMENT))) {
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#if defined(O_DIRECT)
+    fd_ = open(filename.c_str(), flags | O_DIRECT, 0644);
+    direct_io_ = fd_ != -1;
+#endif
+    if (fd_ == -1) {
+      // e.g. tmpfs does not support O_DIRECT
+      fd_ = open(filename.c_str(), flags, 0644);
+    }
+
+    if (fd_ == -1) {
+      throw std::invalid_argument((boost::format("Failed to open stream for %1%") % filename).str());
+    }
+
+    for (size_t i = 0; i < std::max<size_t>(2, number_of_blocks); ++i) {
+      void* block = nullptr;
+      if (posix_memalign(&block, ALIGNMENT, block_size_) != 0) {
+        close(fd_);
+        FreeBlocks();
+        throw std::bad_alloc();
+      }
+      blocks_.push_back(static_cast<char*>(block));
+      free_blocks_.push_back(static_cast<char*>(block));
+    }
+
+    SetCurrentBlock(TakeFreeBlock());
+    writer_ = std::thread(&DirectOutputStreamBuffer::WriteBlocks, this);
+  }
+
+  ~DirectOutputStreamBuffer() {
+    try {
+      Close();
+    } catch (const std::exception&) {
+      // errors are only reported by an explicit Close
+    }
+    FreeBlocks();
+  }
+
+  DirectOutputStreamBuffer() = delete;
+  DirectOutputStreamBuffer& operator=(DirectOutputStreamBuffer const&) = delete;
+  DirectOutputStreamBuffer(const DirectOutputStreamBuffer& that) = delete;
+
+  /**
+   * Write outstanding data, wait for the writer and close the file.
+   *
+   * @throws std::runtime_error if any write failed
+   */
+  void Close() {
+    if (fd_ == -1) {
+      return;
+    }
+
+    const size_t tail = pptr() - pbase();
+    const size_t file_size = file_offset_ + tail;
+
+    if (tail > 0) {
+      // O_DIRECT requires aligned writes, pad the last block and truncate afterwards
+      const size_t padded_tail = direct_io_ ? ((tail + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT : tail;
+      std::memset(pbase() + tail, 0, padded_tail - tail);
+      SubmitBlock(pbase(), padded_tail);
+    } else {
+      ReturnBlock(pbase());
+    }
+    setp(nullptr, nullptr);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      done_ = true;
+    }
+    condition_.notify_all();
+    writer_.join();
+
+    if (error_ == 0 && ftruncate(fd_, static_cast<off_t>(file_size)) != 0) {
+      error_ = errno;
+    }
+
+    if (close(fd_) != 0 && error_ == 0) {
+      error_ = errno;
+    }
+    fd_ = -1;
+
+    if (error_ != 0) {
+      throw std::runtime_error(
+          (boost::format("Failed to write %1%: %2%") % filename_ % std::strerror(error_)).str());
+    }
+  }
+
+  /**
+   * Whether the file is written with O_DIRECT.
+   */
+  bool IsDirectIo() const { return direct_io_; }
+
+ protected:
+  int_type overflow(int_type c) override {
+    if (pbase() == nullptr || !FlushCurrentBlock()) {
+      return traits_type::eof();
+    }
+
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+  std::streamsize xsputn(const char* s, std::streamsize n) override {
+    std::streamsize written = 0;
+
+    while (written < n) {
+      if (pptr() == epptr() && traits_type::eq_int_type(overflow(traits_type::eof()), traits_type::eof())) {
+        break;
+      }
+
+      const size_t copy_size = std::min(static_cast<size_t>(n - written), static_cast<size_t>(epptr() - pptr()));
+      std::memcpy(pptr(), s + written, copy_size);
+      // pbump takes an int, a block is small enough
+      pbump(static_cast<int>(copy_size));
+      written += copy_size;
+    }
+
+    return written;
+  }
+
+  pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+    // only tellp is supported
+    if (off != 0 || dir != std::ios_base::cur || which != std::ios_base::out || pbase() == nullptr) {
+      return pos_type(off_type(-1));
+    }
+
+    return pos_type(static_cast<off_type>(file_offset_ + (pptr() - pbase())));
+  }
+
+ private:
+  static constexpr size_t ALIGNMENT = 4096;
+  static constexpr size_t DEFAULT_BLOCK_SIZE = 1024 * 1024;
+  static constexpr size_t DEFAULT_NUMBER_OF_BLOCKS = 4;
+
+  struct PendingWrite {
+    char* block;
+    size_t offset;
+    size_t length;
+  };
+
+  std::string filename_;
+  size_t block_size_;
+  int fd_ = -1;
+  // might get switched off by the writer thread
+  std::atomic_bool direct_io_{false};
+  size_t file_offset_ = 0;
+  std::vector<char*> blocks_;
+  std::vector<char*> free_blocks_;
+  std::deque<PendingWrite> pending_writes_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::thread writer_;
+  bool done_ = false;
+  int error_ = 0;
+
+  void SetCurrentBlock(char* block) { setp(block, block + block_size_); }
+
+  bool FlushCurrentBlock() {
+    const size_t length = pptr() - pbase();
+    SubmitBlock(pbase(), length);
+
+    char* block = TakeFreeBlock();
+    SetCurrentBlock(block);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    return error_ == 0;
+  }
+
+  void SubmitBlock(char* block, size_t length) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_writes_.push_back({block, file_offset_, length});
+    }
+    file_offset_ += length;
+    condition_.notify_all();
+  }
+
+  void ReturnBlock(char* block) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_blocks_.push_back(block);
+  }
+
+  char* TakeFreeBlock() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this] { return !free_blocks_.empty(); });
+    char* block = free_blocks_.back();
+    free_blocks_.pop_back();
+    return block;
+  }
+
+  void FreeBlocks() {
+    for (char* block : blocks_) {
+      free(block);
+    }
+    blocks_.clear();
+    free_blocks_.clear();
+  }
+
+  void WriteBlocks() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true) {
+      condition_.wait(lock, [this] { return done_ || !pending_writes_.empty(); });
+      if (pending_writes_.empty()) {
+        return;
+      }
+
+      PendingWrite pending_write = pending_writes_.front();
+      pending_writes_.pop_front();
+      const bool failed = error_ != 0;
+      lock.unlock();
+
+      // after an error the remaining blocks are only recycled
+      const int error = failed ? 0 : Write(pending_write);
+
+      lock.lock();
+      if (error != 0) {
+        error_ = error;
+      }
+      free_blocks_.push_back(pending_write.block);
+      condition_.notify_all();
+    }
+  }
+
+  int Write(const PendingWrite& pending_write) {
+    size_t written = 0;
+
+    while (written < pending_write.length) {
+      const ssize_t result = pwrite(fd_, pending_write.block + written, pending_write.length - written,
+                                    static_cast<off_t>(pending_write.offset + written));
+
+      if (result < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+#if defined(O_DIRECT)
+        // the file system accepted O_DIRECT on open but not for this write, continue without it
+        if (errno == EINVAL && direct_io_ && fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) & ~O_DIRECT) == 0) {
+          TRACE("disable O_DIRECT for %s", filename_.c_str());
+          direct_io_ = false;
+          continue;
+        }
+#endif
+        return errno;
+      }
+      written += static_cast<size_t>(result);
+    }
+
+    if (!direct_io_) {
+      DropFromPageCache(pending_write.offset, pending_write.length);
+    }
+
+    return 0;
+  }
+
+  void DropFromPageCache(size_t offset, size_t length) {
+#if defined(__linux__)
+    // pages must be written before they can be dropped, this blocks the writer thread only
+    sync_file_range(fd_, static_cast<off_t>(offset), static_cast<off_t>(length),
+                    SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+#endif
+#if defined(POSIX_FADV_DONTNEED)
+    posix_fadvise(fd_, static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_DONTNEED);
+#endif
+  }
+};
+
+/**
+ * An output file stream backed by DirectOutputStreamBuffer, a drop-in for the std::ofstream returned by
+ * OsUtils::OpenOutFileStream.
+ */
+class DirectOutputStream final : public std::ostream {
+ public:
+  explicit DirectOutputStream(const std::string& filename) : std::ostream(nullptr), buffer_(filename) {
+    rdbuf(&buffer_);
+  }
+
+  /**
+   * Flush and close the file, sets the badbit if writing failed.
+   */
+  void close() {
+    try {
+      buffer_.Close();
+    } catch (const std::runtime_error&) {
+      setstate(std::ios_base::badbit);
+    }
+  }
+
+  bool IsDirectIo() const { return buffer_.IsDirectIo(); }
+
+ private:
+  DirectOutputStreamBuffer buffer_;
+};
+
+#endif
+
+/**
+ * Write a file either using DirectOutputStream or a buffered std::ofstream.
+ *
+ * @param filename the file to write
+ * @param direct_io whether to bypass the page cache
+ * @param write function that writes into the given stream
+ * @throws std::runtime_error if writing or closing the file failed
+ */
+template <typename WriteFunctionT>
+inline void WriteOutputFile(const std::string& filename, const bool direct_io, WriteFunctionT write) {
+  bool failed = false;
+
+  if (direct_io) {
+    DirectOutputStream out_stream(filename);
+    write(out_stream);
+    out_stream.close();
+    failed = out_stream.bad() || out_stream.fail();
+  } else {
+    std::ofstream out_stream = OsUtils::OpenOutFileStream(filename);
+    write(out_stream);
+    out_stream.close();
+    failed = out_stream.bad() || out_stream.fail();
+  }
+
+  if (failed) {
+    throw std::runtime_error((boost::format("Failed to write %1%") % filename).str());
+  }
+}
+
+} /* namespace util */
+} /* namespace keyvi */
+
+#endif  // KEYVI_UTIL_DIRECT_OUTPUT_STREAM_H_
@@ -0,0 +1,275 @@
+/* * keyvi - A key value store.
+ *
+ * Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * float_vector_distance.h
+ */
+
+#ifndef KEYVI_UTIL_FLOAT_VECTOR_DISTANCE_H_
+#define KEYVI_UTIL_FLOAT_VECTOR_DISTANCE_H_
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "keyvi/dictionary/fsa/internal/intrinsics.h"
+
+namespace keyvi {
+namespace util {
+
+enum class float_vector_distance_t {
+  DOT_PRODUCT,
+  COSINE,
+  EUCLIDEAN,
+};
+
+/**
+ * Signature of a distance kernel, the vectors do not need to be aligned.
+ */
+typedef float (*float_vector_kernel_t)(const float* a, const float* b, size_t size);
+
+// load a float from a possibly unaligned address
+inline float LoadFloat(const float* p) {
+  float f;
+  std::memcpy(&f, p, sizeof(float));
+  return f;
+}
+
+/**
+ * Portable implementation, 4 independent sums so the compiler can pipeline.
+ */
+inline float DotProductGeneric(const float* a, const float* b, size_t size) {
+  float sum[4] = {0, 0, 0, 0};
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    for (size_t j = 0; j < 4; ++j) {
+      sum[j] += LoadFloat(a + i + j) * LoadFloat(b + i + j);
+    }
+  }
+  for (; i < size; ++i) {
+    sum[0] += LoadFloat(a + i) * LoadFloat(b + i);
+  }
+
+  return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+inline float SquaredEuclideanDistanceGeneric(const float* a, const float* b, size_t size) {
+  float sum[4] = {0, 0, 0, 0};
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    for (size_t j = 0; j < 4; ++j) {
+      const float d = LoadFloat(a + i + j) - LoadFloat(b + i + j);
+      sum[j] += d * d;
+    }
+  }
+  for (; i < size; ++i) {
+    const float d = LoadFloat(a + i) - LoadFloat(b + i);
+    sum[0] += d * d;
+  }
+
+  return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+#if defined(KEYVI_X86_DISPATCH)
+
+__attribute__((target("avx2,fma"))) inline float HorizontalSumAVX2(__m256 v) {
+  __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  __m128 shuffled = _mm_movehdup_ps(sum);
+  sum = _mm_add_ps(sum, shuffled);
+  shuffled = _mm_movehl_ps(shuffled, sum);
+  return _mm_cvtss_f32(_mm_add_ss(sum, shuffled));
+}
+
+/**
+ * AVX2 implementation, 16 floats per iteration using fused multiply-add.
+ */
+__attribute__((target("avx2,fma"))) inline float DotProductAVX2(const float* a, const float* b, size_t size) {
+  __m256 sum0 = _mm256_setzero_ps();
+  __m256 sum1 = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+    sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), sum1);
+  }
+  if (i + 8 <= size) {
+    sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+    i += 8;
+  }
+
+  float result = HorizontalSumAVX2(_mm256_add_ps(sum0, sum1));
+  for (; i < size; ++i) {
+    result += LoadFloat(a + i) * LoadFloat(b + i);
+  }
+  return result;
+}
+
+__attribute__((target("avx2,fma"))) inline float SquaredEuclideanDistanceAVX2(const float* a, const float* b,
+                                                                             size_t size) {
+  __m256 sum0 = _mm256_setzero_ps();
+  __m256 sum1 = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    const __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+    const __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+    sum0 = _mm256_fmadd_ps(d0, d0, sum0);
+    sum1 = _mm256_fmadd_ps(d1, d1, sum1);
+  }
+  if (i + 8 <= size) {
+    const __m256 d = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+    sum0 = _mm256_fmadd_ps(d, d, sum0);
+    i += 8;
+  }
+
+  float result = HorizontalSumAVX2(_mm256_add_ps(sum0, sum1));
+  for (; i < size; ++i) {
+    const float d = LoadFloat(a + i) - LoadFloat(b + i);
+    result += d * d;
+  }
+  return result;
+}
+
+/**
+ * Sum the 16 floats, the halves are added and summed with the AVX2 code.
+ *
+ * The vector goes through memory, with GCC 12 the intrinsics that extract the upper half warn about an uninitialized
+ * operand.
+ */
+__attribute__((target("avx512f,avx2,fma"))) inline float HorizontalSumAVX512(__m512 v) {
+  alignas(64) float lanes[16];
+  _mm512_store_ps(lanes, v);
+  return HorizontalSumAVX2(_mm256_add_ps(_mm256_load_ps(lanes), _mm256_load_ps(lanes + 8)));
+}
+
+/**
+ * AVX-512 implementation, 16 floats per iteration, the tail is handled with a masked load.
+ */
+__attribute__((target("avx512f,avx2,fma"))) inline float DotProductAVX512(const float* a, const float* b,
+                                                                         size_t size) {
+  __m512 sum = _mm512_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    sum = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), sum);
+  }
+  if (i < size) {
+    const __mmask16 mask = static_cast<__mmask16>((1U << (size - i)) - 1);
+    sum = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i), sum);
+  }
+
+  return HorizontalSumAVX512(sum);
+}
+
+__attribute__((target("avx512f,avx2,fma"))) inline float SquaredEuclideanDistanceAVX512(const float* a,
+                                                                                       const float* b, size_t size) {
+  __m512 sum = _mm512_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    const __m512 d = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+    sum = _mm512_fmadd_ps(d, d, sum);
+  }
+  if (i < size) {
+    const __mmask16 mask = static_cast<__mmask16>((1U << (size - i)) - 1);
+    const __m512 d = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i));
+    sum = _mm512_fmadd_ps(d, d, sum);
+  }
+
+  return HorizontalSumAVX512(sum);
+}
+
+#endif
+
+struct FloatVectorKernels {
+  float_vector_kernel_t dot_product;
+  float_vector_kernel_t squared_euclidean_distance;
+};
+
+/**
+ * Select the best kernels for the CPU we are running on.
+ */
+inline FloatVectorKernels SelectFloatVectorKernels() {
+#if defined(KEYVI_X86_DISPATCH)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return {&DotProductAVX512, &SquaredEuclideanDistanceAVX512};
+  }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return {&DotProductAVX2, &SquaredEuclideanDistanceAVX2};
+  }
+#endif
+  return {&DotProductGeneric, &SquaredEuclideanDistanceGeneric};
+}
+
+inline const FloatVectorKernels& GetFloatVectorKernels() {
+  static const FloatVectorKernels kernels = SelectFloatVectorKernels();
+  return kernels;
+}
+
+inline float FloatVectorDotProduct(const float* a, const float* b, size_t size) {
+  return GetFloatVectorKernels().dot_product(a, b, size);
+}
+
+inline float FloatVectorSquaredEuclideanDistance(const float* a, const float* b, size_t size) {
+  return GetFloatVectorKernels().squared_euclidean_distance(a, b, size);
+}
+
+/**
+ * Scores candidate vectors against a query vector, the norm of the query is calculated only once.
+ *
+ * The score is the dot product, the cosine similarity or the euclidean distance. GetRank turns the score into a
+ * value where higher is better for all distances.
+ */
+class FloatVectorScorer final {
+ public:
+  FloatVectorScorer(const std::vector<float>& query, float_vector_distance_t distance)
+      : query_(query), distance_(distance) {
+    query_norm_ = std::sqrt(FloatVectorDotProduct(query_.data(), query_.data(), query_.size()));
+  }
+
+  float Score(const float* candidate, size_t size) const {
+    if (size != query_.size()) {
+      throw std::invalid_argument("vector has " + std::to_string(size) + " dimensions, query has " +
+                                  std::to_string(query_.size()));
+    }
+
+    switch (distance_) {
+      case float_vector_distance_t::DOT_PRODUCT:
+        return FloatVectorDotProduct(query_.data(), candidate, size);
+      case float_vector_distance_t::COSINE: {
+        const float norm = std::sqrt(FloatVectorDotProduct(candidate, candidate, size)) * query_norm_;
+        return norm > 0 ? FloatVectorDotProduct(query_.data(), candidate, size) / norm : 0;
+      }
+      case float_vector_distance_t::EUCLIDEAN:
+        return std::sqrt(FloatVectorSquaredEuclideanDistance(query_.data(), candidate, size));
+    }
+
+    return 0;
+  }
+
+  float GetRank(float score) const { return distance_ == float_vector_distance_t::EUCLIDEAN ? -score : score; }
+
+ private:
+  std::vector<float> query_;
+  float_vector_distance_t distance_;
+  float query_norm_;
+};
+
+} /* namespace util */
+} /* namespace keyvi */
+
+#endif  // KEYVI_UTIL_FLOAT_VECTOR_DISTANCE_H_
@@ -26,6 +26,7 @@
 #define KEYVI_UTIL_JSON_VALUE_H_
 
 #include <string>
+#include <string_view>
 
 #include "keyvi/compression/compression_selector.h"
 #include "keyvi/util/msgpack_util.h"
@@ -40,14 +41,11 @@
 namespace keyvi {
 namespace util {
 
-/** Decompresses (if needed) and decodes a json value stored in a JsonValueStore. */
-inline std::string DecodeJsonValue(const std::string& encoded_value) {
-  compression::decompress_func_t decompressor = compression::decompressor_from_string(encoded_value);
-  std::string packed_string = decompressor(encoded_value);
-  TRACE("unpacking %s", packed_string.c_str());
+/** Decodes a msgpack'ed value into json. */
+inline std::string MsgPackToJson(std::string_view msgpacked_value) {
+  TRACE("unpacking %s", std::string(msgpacked_value).c_str());
 
-  msgpack::object_handle doc;
-  msgpack::unpack(doc, packed_string.data(), packed_string.size());
+  msgpack::object_handle doc = UnpackMsgPackView(msgpacked_value);
 
   rapidjson::StringBuffer buffer;
   rapidjson::Writer<rapidjson::StringBuffer, rapidjson::UTF8<>, rapidjson::UTF8<>, rapidjson::CrtAllocator,
@@ -57,6 +55,17 @@ inline std::string DecodeJsonValue(const std::string& encoded_value) {
   return buffer.GetString();
 }
 
+/** Decompresses (if needed) and decodes a json value stored in a JsonValueStore. */
+inline std::string DecodeJsonValue(const char* encoded_value, size_t encoded_size,
+                                   const compression::CompressionDictionaries* dictionaries = nullptr) {
+  std::string buffer;
+  return MsgPackToJson(compression::DecompressToView(encoded_value, encoded_size, &buffer, dictionaries));
+}
+
+inline std::string DecodeJsonValue(const std::string& encoded_value) {
+  return DecodeJsonValue(encoded_value.data(), encoded_value.size());
+}
+
 inline void EncodeJsonValue(std::function<void(compression::buffer_t*, const char*, size_t)> long_compress,
                             std::function<void(compression::buffer_t*, const char*, size_t)> short_compress,
                             msgpack::sbuffer* msgpack_buffer, compression::buffer_t* buffer,
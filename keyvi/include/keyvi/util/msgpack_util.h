@@ -26,6 +26,7 @@
 #define KEYVI_UTIL_MSGPACK_UTIL_H_
 #include <limits>
 #include <string>
+#include <string_view>
 
 #include "msgpack.hpp"
 #include "rapidjson/document.h"
@@ -173,6 +174,16 @@ inline std::string JsonStringToMsgPack(const std::string& raw_value, bool single
   return std::string(reinterpret_cast<char*>(msgpack_buffer.data()), msgpack_buffer.size());
 }
 
+/**
+ * Unpack msgpack without copying strings and binaries, they reference the packed data instead.
+ *
+ * The returned object is only valid as long as the packed data is.
+ */
+inline msgpack::object_handle UnpackMsgPackView(std::string_view msgpacked_value) {
+  return msgpack::unpack(msgpacked_value.data(), msgpacked_value.size(),
+                         [](msgpack::type::object_type, std::size_t, void*) { return true; });
+}
+
 template <typename T>
 inline std::string ValueToMsgPack(const T& value) {
   msgpack::sbuffer msgpack_buffer;
@@ -25,9 +25,11 @@
 #ifndef KEYVI_UTIL_SERIALIZATION_UTILS_H_
 #define KEYVI_UTIL_SERIALIZATION_UTILS_H_
 
+#include <algorithm>
 #include <cstddef>
 #include <iostream>
 #include <memory>
+#include <stdexcept>
 #include <string>
 
 #include <boost/lexical_cast.hpp>
@@ -43,6 +45,8 @@ namespace util {
 
 class SerializationUtils {
  public:
+  static const size_t COPY_BUFFER_SIZE = 64 * 1024;
+
   static void ReadLengthPrefixedJsonRecord(std::istream& stream, rapidjson::Document* record) {
     uint32_t header_size;
     stream.read(reinterpret_cast<char*>(&header_size), sizeof(int));
@@ -79,6 +83,25 @@ class SerializationUtils {
     return defaultValue;
   }
 
+  /**
+   * Copy size bytes from the current position of in_stream to out_stream, chunk by chunk.
+   *
+   * @throws std::runtime_error if in_stream ends early
+   */
+  static void CopyStream(std::istream& in_stream, std::ostream& out_stream, size_t size) {
+    char buffer[COPY_BUFFER_SIZE];
+
+    while (size > 0) {
+      const size_t chunk_size = std::min(size, sizeof(buffer));
+      in_stream.read(buffer, chunk_size);
+      if (static_cast<size_t>(in_stream.gcount()) != chunk_size) {
+        throw std::runtime_error("unexpected end of stream");
+      }
+      out_stream.write(buffer, chunk_size);
+      size -= chunk_size;
+    }
+  }
+
   static size_t GetOptionalSizeFromValueOrString(const rapidjson::Document& record, const char* key,
                                                  const size_t defaultValue) {
     if (record.HasMember(key)) {
@@ -23,12 +23,16 @@
  *      Author: hendrik
  */
 
+#include <random>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 
+#include "keyvi/compression/compression_selector.h"
 #include "keyvi/compression/predictive_compression.h"
+#include "keyvi/compression/predictive_compression_strategy.h"
 
 namespace keyvi {
 namespace compression {
@@ -69,6 +73,120 @@ BOOST_AUTO_TEST_CASE(CompressAndUncompress) {
   BOOST_CHECK_EQUAL(26, uncompressed.size());
 }
 
+BOOST_AUTO_TEST_CASE(TrailingPrediction) {
+  std::istringstream corpus(
+      "ht\x05"
+      "tp://");
+
+  auto compressor = PredictiveCompression(corpus);
+
+  // the last symbol is a prediction
+  const std::string input = "http://";
+  const std::string output = compressor.Compress(input);
+  BOOST_CHECK_EQUAL(1 + 2, output.size());
+  BOOST_CHECK_EQUAL(input, compressor.Uncompress(output));
+}
+
+BOOST_AUTO_TEST_CASE(Streaming) {
+  std::istringstream corpus(
+      "ht\x05"
+      "tp://"
+      "tt\x05"
+      "ps://"
+      "//\x04"
+      "www."
+      "w.\x07"
+      "example");
+
+  const PredictiveCompression compressor(corpus);
+  PredictiveCompression::Encoder encoder(compressor);
+  PredictiveCompression::Decoder decoder(compressor);
+  std::mt19937 generator(42);
+
+  for (const std::string& input : {std::string("https://www.example.com/http://www.example.org"), std::string("h"),
+                                   std::string("ht"), std::string("http://"), std::string()}) {
+    const std::string expected_output = compressor.Compress(input);
+
+    for (size_t round = 0; round < 20; ++round) {
+      // feed in random parts
+      std::string output;
+      size_t offset = 0;
+      while (offset < input.size()) {
+        const size_t part = std::uniform_int_distribution<size_t>(0, input.size() - offset)(generator);
+        encoder.Write(input.data() + offset, part, &output);
+        offset += part;
+      }
+      encoder.Finish(&output);
+      BOOST_CHECK_EQUAL(expected_output, output);
+
+      std::vector<char> uncompressed;
+      offset = 0;
+      while (offset < output.size()) {
+        const size_t part = std::uniform_int_distribution<size_t>(0, output.size() - offset)(generator);
+        decoder.Write(output.data() + offset, part, &uncompressed);
+        offset += part;
+      }
+      decoder.Finish(&uncompressed);
+      BOOST_CHECK_EQUAL(input, std::string(uncompressed.data(), uncompressed.size()));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WriteModel) {
+  // the last prediction is for a bigram with a null byte
+  std::istringstream corpus(std::string(
+      "ht\x05"
+      "tp://"
+      "//\x04"
+      "www."
+      "\0a\x01"
+      "b",
+      19));
+
+  const PredictiveCompression compressor(corpus);
+  const std::string model = PredictiveCompressionStrategy::SerializeModel(compressor);
+  // predictions for bigrams with null bytes are dropped
+  BOOST_CHECK_EQUAL(std::string("//\x04www.ht\x05tp://"), model);
+
+  std::istringstream model_stream(model);
+  const PredictiveCompression compressor2(model_stream);
+  const std::string input = "http://www.the-test.com";
+  BOOST_CHECK_EQUAL(compressor.Compress(input), compressor2.Compress(input));
+}
+
+BOOST_AUTO_TEST_CASE(PredictiveStrategy) {
+  std::istringstream corpus(
+      "ht\x05"
+      "tp://"
+      "//\x04"
+      "www.");
+
+  PredictiveCompressionStrategy strategy(std::make_shared<PredictiveCompression>(corpus));
+  CompressionStrategy* compression_strategy = &strategy;
+
+  const std::string input = "http://www.the-test.com";
+  const std::string compressed = compression_strategy->Compress(input);
+  BOOST_CHECK_EQUAL(PREDICTIVE_COMPRESSION, compressed[0]);
+  BOOST_CHECK(compressed.size() < input.size());
+  BOOST_CHECK_EQUAL(input, compression_strategy->Decompress(compressed));
+
+  // values only decompress with the model
+  std::string buffer;
+  BOOST_CHECK_THROW(DecompressToView(compressed.data(), compressed.size(), &buffer), std::invalid_argument);
+
+  CompressionDictionaries dictionaries;
+  dictionaries.Add(static_cast<char>(PREDICTIVE_COMPRESSION) + strategy.GetModel());
+  BOOST_CHECK_EQUAL(input, DecompressToView(compressed.data(), compressed.size(), &buffer, &dictionaries));
+
+  // a value store can only use one model
+  std::vector<std::string> models = {static_cast<char>(PREDICTIVE_COMPRESSION) + strategy.GetModel()};
+  CompressionDictionaries::AddUnique(models[0], &models);
+  BOOST_CHECK_EQUAL(1, models.size());
+  BOOST_CHECK_THROW(CompressionDictionaries::AddUnique(static_cast<char>(PREDICTIVE_COMPRESSION) + std::string("ab"),
+                                                       &models),
+                    std::invalid_argument);
+}
+
 BOOST_AUTO_TEST_CASE(CompressTooLongValue) {
   std::istringstream corpus(
       "ht\x05"
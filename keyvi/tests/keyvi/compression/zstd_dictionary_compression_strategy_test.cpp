@@ -0,0 +1,156 @@
+/* * keyvi - A key value store.
+ *
+ * Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * zstd_dictionary_compression_strategy_test.cpp
+ */
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "keyvi/compression/compression_dictionaries.h"
+#include "keyvi/compression/compression_selector.h"
+#include "keyvi/compression/zstd_dictionary_compression_strategy.h"
+
+namespace keyvi {
+namespace compression {
+
+BOOST_AUTO_TEST_SUITE(ZstdDictionaryCompressionStrategyTests)
+
+std::string TrainTestDictionary(const std::string& field) {
+  std::string samples;
+  std::vector<size_t> sample_sizes;
+  for (size_t i = 0; i < 2000; ++i) {
+    const std::string sample = "{\"" + field + "\":" + std::to_string(i) + ",\"description\":\"a sample of " + field +
+                               " number " + std::to_string(i * 31) + "\"}";
+    samples += sample;
+    sample_sizes.push_back(sample.size());
+  }
+
+  return TrainZstdDictionary(samples, sample_sizes, 4096);
+}
+
+std::string CompressWith(CompressionStrategy* compressor, const std::string& input) {
+  return compressor->Compress(input);
+}
+
+BOOST_AUTO_TEST_CASE(CompressAndDecompress) {
+  const std::string dictionary = TrainTestDictionary("identifier");
+  BOOST_REQUIRE(!dictionary.empty());
+  BOOST_CHECK(dictionary.size() <= 4096);
+
+  ZstdDictionaryCompressionStrategy compressor(dictionary);
+  ZstdDictionaryCompressionStrategy other_compressor(compressor);
+  const std::string input = "{\"identifier\":4242,\"description\":\"a sample of identifier number 131502\"}";
+
+  const std::string compressed = CompressWith(&compressor, input);
+  BOOST_CHECK_EQUAL(ZSTD_DICTIONARY_COMPRESSION, compressed[0]);
+  BOOST_CHECK(compressed.size() < input.size());
+  BOOST_CHECK_EQUAL(compressed, CompressWith(&other_compressor, input));
+  BOOST_CHECK_EQUAL(input, compressor.Decompress(compressed));
+
+  // the plain zstd frame of a short value is larger
+  std::unique_ptr<CompressionStrategy> zstd(compression_strategy("zstd"));
+  BOOST_CHECK(compressed.size() < zstd->Compress(input).size());
+}
+
+BOOST_AUTO_TEST_CASE(Decompressor) {
+  const std::string dictionary1 = TrainTestDictionary("identifier");
+  const std::string dictionary2 = TrainTestDictionary("key");
+  BOOST_REQUIRE(GetZstdDictionaryId(dictionary1) != GetZstdDictionaryId(dictionary2));
+
+  const std::string input1 = "{\"identifier\":1,\"description\":\"a sample of identifier number 31\"}";
+  const std::string input2 = "{\"key\":2,\"description\":\"a sample of key number 62\"}";
+  ZstdDictionaryCompressionStrategy compressor1(dictionary1);
+  ZstdDictionaryCompressionStrategy compressor2(dictionary2);
+  const std::string compressed1 = CompressWith(&compressor1, input1);
+  const std::string compressed2 = CompressWith(&compressor2, input2);
+
+  ZstdDictionaryDecompressor decompressor;
+  decompressor.Add(dictionary1.data(), dictionary1.size());
+
+  std::string buffer;
+  decompressor.Decompress(compressed1.data(), compressed1.size(), &buffer);
+  BOOST_CHECK_EQUAL(input1, buffer);
+  BOOST_CHECK_THROW(decompressor.Decompress(compressed2.data(), compressed2.size(), &buffer), std::invalid_argument);
+
+  decompressor.Add(dictionary2.data(), dictionary2.size());
+  BOOST_CHECK_EQUAL(2, decompressor.size());
+  decompressor.Decompress(compressed2.data(), compressed2.size(), &buffer);
+  BOOST_CHECK_EQUAL(input2, buffer);
+}
+
+BOOST_AUTO_TEST_CASE(PersistedDictionaries) {
+  const std::string dictionary1 = static_cast<char>(ZSTD_DICTIONARY_COMPRESSION) + TrainTestDictionary("identifier");
+  const std::string dictionary2 = static_cast<char>(ZSTD_DICTIONARY_COMPRESSION) + TrainTestDictionary("key");
+
+  std::vector<std::string> dictionaries;
+  CompressionDictionaries::AddUnique(dictionary1, &dictionaries);
+  CompressionDictionaries::AddUnique(dictionary2, &dictionaries);
+  CompressionDictionaries::AddUnique(dictionary1, &dictionaries);
+  BOOST_CHECK_EQUAL(2, dictionaries.size());
+
+  // same id, different content
+  std::string conflicting_dictionary = dictionary1;
+  conflicting_dictionary.back() ^= 1;
+  BOOST_CHECK_THROW(CompressionDictionaries::AddUnique(conflicting_dictionary, &dictionaries), std::invalid_argument);
+
+  const std::string packed_dictionaries = CompressionDictionaries::Pack(dictionaries);
+  const CompressionDictionaries compression_dictionaries(packed_dictionaries.data(), packed_dictionaries.size());
+
+  const std::string input = "{\"key\":2,\"description\":\"a sample of key number 62\"}";
+  ZstdDictionaryCompressionStrategy compressor(dictionary2.substr(1));
+  const std::string compressed = CompressWith(&compressor, input);
+
+  std::string buffer;
+  BOOST_CHECK_EQUAL(input, DecompressToView(compressed.data(), compressed.size(), &buffer, &compression_dictionaries));
+  BOOST_CHECK_THROW(DecompressToView(compressed.data(), compressed.size(), &buffer), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(CorruptedValue) {
+  const std::string dictionary = TrainTestDictionary("identifier");
+  const std::string input = "{\"identifier\":1,\"description\":\"a sample of identifier number 31\"}";
+  ZstdDictionaryCompressionStrategy compressor(dictionary);
+  const std::string compressed = CompressWith(&compressor, input);
+
+  ZstdDictionaryDecompressor decompressor;
+  decompressor.Add(dictionary.data(), dictionary.size());
+
+  // cut off the end of the frame
+  const std::string truncated = compressed.substr(0, compressed.size() - 4);
+  std::string buffer;
+  BOOST_CHECK_THROW(decompressor.Decompress(truncated.data(), truncated.size(), &buffer), std::runtime_error);
+  BOOST_CHECK_THROW(compressor.Decompress(truncated), std::runtime_error);
+
+  // not a zstd frame
+  const std::string garbage = static_cast<char>(ZSTD_DICTIONARY_COMPRESSION) + std::string("garbage");
+  BOOST_CHECK_THROW(compressor.Decompress(garbage), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(TooFewSamples) {
+  const std::string samples = "{\"a\":1}";
+  BOOST_CHECK(TrainZstdDictionary(samples, {samples.size()}, 4096).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}  // namespace compression
+}  // namespace keyvi
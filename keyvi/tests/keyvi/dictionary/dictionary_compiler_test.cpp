@@ -23,6 +23,8 @@
  *      Author: hendrik
  */
 
+#include <random>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -276,6 +278,76 @@ BOOST_AUTO_TEST_CASE(bigger_compile_parallel_1MB) {
   bigger_compile_test({{MEMORY_LIMIT_KEY, std::to_string(1024 * 1024)}, {PARALLEL_SORT_THRESHOLD_KEY, "1"}});
 }
 
+BOOST_AUTO_TEST_CASE(bigger_compile_threads_1MB_50k) {
+  bigger_compile_test({{MEMORY_LIMIT_KEY, std::to_string(1024 * 1024)}, {COMPILE_THREADS_KEY, "4"}}, 50000);
+}
+
+std::string compile_to_string(const keyvi::util::parameters_t& params, size_t keys, size_t* progress_calls) {
+  DictionaryCompiler<dictionary_type_t::INT_WITH_WEIGHTS> compiler(params);
+
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<uint32_t> distribution(0, 1000000);
+  for (size_t i = 0; i < keys; ++i) {
+    // produce duplicates across chunks
+    compiler.Add("key-" + std::to_string(distribution(generator) % (keys / 2)), distribution(generator));
+  }
+
+  compiler.Compile([](size_t, size_t, void* user_data) { ++*static_cast<size_t*>(user_data); }, progress_calls);
+
+  std::stringstream stream;
+  compiler.Write(stream);
+  return stream.str();
+}
+
+BOOST_AUTO_TEST_CASE(compile_threads_same_result) {
+  size_t progress_calls_single_threaded = 0;
+  const std::string single_threaded =
+      compile_to_string({{MEMORY_LIMIT_KEY, std::to_string(1024 * 1024)}}, 60000, &progress_calls_single_threaded);
+
+  for (const std::string threads : {"2", "4"}) {
+    size_t progress_calls = 0;
+    const std::string multi_threaded = compile_to_string(
+        {{MEMORY_LIMIT_KEY, std::to_string(1024 * 1024)}, {COMPILE_THREADS_KEY, threads}}, 60000, &progress_calls);
+
+    BOOST_CHECK(single_threaded == multi_threaded);
+    BOOST_CHECK_EQUAL(progress_calls_single_threaded, progress_calls);
+  }
+  BOOST_CHECK(progress_calls_single_threaded > 0);
+}
+
+std::string compile_json_to_string(const keyvi::util::parameters_t& params, size_t keys) {
+  DictionaryCompiler<dictionary_type_t::JSON> compiler(params);
+
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<uint32_t> distribution(0, 1000000);
+  for (size_t i = 0; i < keys; ++i) {
+    // produce duplicate values and values above the compression threshold
+    const uint32_t id = distribution(generator) % (keys / 4);
+    compiler.Add("key-" + std::to_string(distribution(generator)),
+                 "{\"id\":" + std::to_string(id) + ", \"text\":\"" + std::string(id % 50, 'x') + "\"}");
+  }
+
+  compiler.Compile();
+
+  std::stringstream stream;
+  compiler.Write(stream);
+  return stream.str();
+}
+
+BOOST_AUTO_TEST_CASE(value_store_threads_same_result) {
+  for (const std::string& memory_limit : {std::to_string(1024 * 1024), std::to_string(100 * 1024 * 1024)}) {
+    const std::string single_threaded =
+        compile_json_to_string({{MEMORY_LIMIT_KEY, memory_limit}, {COMPRESSION_KEY, "zlib"}}, 20000);
+
+    for (const std::string threads : {"2", "3"}) {
+      const std::string multi_threaded = compile_json_to_string(
+          {{MEMORY_LIMIT_KEY, memory_limit}, {COMPRESSION_KEY, "zlib"}, {VALUE_STORE_THREADS_KEY, threads}}, 20000);
+
+      BOOST_CHECK(single_threaded == multi_threaded);
+    }
+  }
+}
+
 BOOST_AUTO_TEST_CASE(float_dictionary) {
   DictionaryCompiler<dictionary_type_t::FLOAT_VECTOR> compiler(
       keyvi::util::parameters_t({{"memory_limit_mb", "10"}, {VECTOR_SIZE_KEY, "5"}}));
@@ -23,11 +23,15 @@
  *      Author: hendrik
  */
 
+#include <fstream>
+#include <map>
+#include <random>
 #include <unordered_set>
 
 #include <boost/test/unit_test.hpp>
 
 #include "keyvi/dictionary/dictionary.h"
+#include "keyvi/dictionary/dictionary_compiler.h"
 #include "keyvi/dictionary/dictionary_merger.h"
 #include "keyvi/dictionary/dictionary_types.h"
 #include "keyvi/dictionary/fsa/traverser_types.h"
@@ -47,7 +51,8 @@ BOOST_AUTO_TEST_CASE(MergeKeyOnlyDicts) {
   testing::TempDictionary dictionary2(&test_data2);
 
   keyvi::util::parameters_t merge_configurations[] = {{{"memory_limit_mb", "10"}},
-                                                      {{"memory_limit_mb", "10"}, {"merge_mode", "append"}}};
+                                                      {{"memory_limit_mb", "10"}, {"merge_mode", "append"}},
+                                                      {{"memory_limit_mb", "10"}, {"merge_mode", "structural"}}};
 
   for (const auto& params : merge_configurations) {
     DictionaryMerger<> merger(params);
@@ -84,6 +89,36 @@ BOOST_AUTO_TEST_CASE(MergeKeyOnlyDicts) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(MergeKeyCallback) {
+  std::vector<std::string> test_data = {"aaaa", "aabb", "aabc", "bbcd"};
+  testing::TempDictionary dictionary(&test_data);
+
+  std::vector<std::string> test_data2 = {"aabb", "aabbe", "cdddefgh"};
+  testing::TempDictionary dictionary2(&test_data2);
+
+  keyvi::util::parameters_t merge_configurations[] = {{{"memory_limit_mb", "10"}},
+                                                      {{"memory_limit_mb", "10"}, {"merge_mode", "append"}}};
+
+  for (const auto& params : merge_configurations) {
+    DictionaryMerger<> merger(params);
+    std::string filename("merged-dict-key-callback.kv");
+    merger.Add(dictionary.GetFileName());
+    merger.Add(dictionary2.GetFileName());
+
+    std::vector<std::string> keys;
+    merger.SetKeyCallback([&keys](const std::string& key) { keys.push_back(key); });
+    merger.Merge(filename);
+
+    std::vector<std::string> expected_keys = {"aaaa", "aabb", "aabbe", "aabc", "bbcd", "cdddefgh"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(expected_keys.begin(), expected_keys.end(), keys.begin(), keys.end());
+
+    std::remove(filename.c_str());
+  }
+
+  DictionaryMerger<> structural_merger({{"memory_limit_mb", "10"}, {"merge_mode", "structural"}});
+  BOOST_CHECK_THROW(structural_merger.SetKeyCallback([](const std::string& key) {}), merger_exception);
+}
+
 BOOST_AUTO_TEST_CASE(MergeIntegerDicts) {
   std::vector<std::pair<std::string, uint32_t>> test_data = {
       {"abc", 22}, {"abbc", 24}, {"abbcd", 444}, {"abcde", 200}, {"abdd", 180}, {"bba", 10},
@@ -290,7 +325,8 @@ BOOST_AUTO_TEST_CASE(MergeIntegerDictsAppendMerge) {
 
 BOOST_AUTO_TEST_CASE(MergeStringDicts) {
   keyvi::util::parameters_t merge_configurations[] = {{{"memory_limit_mb", "10"}},
-                                                      {{"memory_limit_mb", "10"}, {"merge_mode", "append"}}};
+                                                      {{"memory_limit_mb", "10"}, {"merge_mode", "append"}},
+                                                      {{"memory_limit_mb", "10"}, {"merge_mode", "structural"}}};
 
   for (const auto& params : merge_configurations) {
     std::vector<std::pair<std::string, std::string>> test_data = {
@@ -346,7 +382,8 @@ BOOST_AUTO_TEST_CASE(MergeStringDicts) {
 
 BOOST_AUTO_TEST_CASE(MergeJsonDicts) {
   keyvi::util::parameters_t merge_configurations[] = {{{"memory_limit_mb", "10"}},
-                                                      {{"memory_limit_mb", "10"}, {"merge_mode", "append"}}};
+                                                      {{"memory_limit_mb", "10"}, {"merge_mode", "append"}},
+                                                      {{"memory_limit_mb", "10"}, {"merge_mode", "structural"}}};
 
   for (const auto& params : merge_configurations) {
     std::vector<std::pair<std::string, std::string>> test_data = {
@@ -410,7 +447,8 @@ BOOST_AUTO_TEST_CASE(MergeJsonDicts) {
 
 BOOST_AUTO_TEST_CASE(MergeFloatVectorDicts, *boost::unit_test::tolerance(0.00001)) {
   keyvi::util::parameters_t merge_configurations[] = {{{"memory_limit_mb", "10"}},
-                                                      {{"memory_limit_mb", "10"}, {"merge_mode", "append"}}};
+                                                      {{"memory_limit_mb", "10"}, {"merge_mode", "append"}},
+                                                      {{"memory_limit_mb", "10"}, {"merge_mode", "structural"}}};
 
   for (const auto& params : merge_configurations) {
     std::vector<std::pair<std::string, std::vector<float>>> test_data = {
@@ -757,6 +795,61 @@ BOOST_AUTO_TEST_CASE(Delete) {
   std::remove(deleted_keys_file.string().c_str());
 }
 
+BOOST_AUTO_TEST_CASE(DeleteKeysAsDictionary) {
+  std::vector<std::pair<std::string, std::string>> test_data = {
+      {"abcd", "{g:5}"},
+      {"abde", "{r:1}"},
+      {"klm", "{k:2}"},
+      {"xyz", "{t:4}"},
+  };
+  testing::TempDictionary dictionary = testing::TempDictionary::makeTempDictionaryFromJson(&test_data);
+
+  boost::filesystem::path deleted_keys_file{dictionary.GetFileName()};
+  deleted_keys_file += ".dk";
+  boost::filesystem::path deleted_keys_delta_file{dictionary.GetFileName()};
+  deleted_keys_delta_file += ".dkd";
+  JsonDictionaryMerger merger;
+  {
+    KeyOnlyDictionaryGenerator deleted_keys;
+    deleted_keys.Add("abde");
+    deleted_keys.Add("xyz");
+    deleted_keys.CloseFeeding();
+    deleted_keys.WriteToFile(deleted_keys_file.string());
+  }
+
+  // recent deletes, not yet compacted, "xyz" is in both files
+  {
+    KeyOnlyDictionaryGenerator deleted_keys;
+    deleted_keys.Add("klm");
+    deleted_keys.Add("xyz");
+    deleted_keys.CloseFeeding();
+    deleted_keys.WriteToFile(deleted_keys_delta_file.string());
+  }
+
+  merger.Add(dictionary.GetFileName());
+
+  std::string filename("merge-delete-key-dictionary-dict.kv");
+  std::ofstream out_stream(filename, std::ios::binary);
+  merger.Merge();
+  merger.Write(out_stream);
+  out_stream.close();
+
+  fsa::automata_t fsa(new fsa::Automata(filename.c_str()));
+  dictionary_t d(new Dictionary(fsa));
+
+  BOOST_CHECK(d->Contains("abcd"));
+  BOOST_CHECK(!d->Contains("abde"));
+  BOOST_CHECK(!d->Contains("klm"));
+  BOOST_CHECK(!d->Contains("xyz"));
+
+  BOOST_CHECK_EQUAL(3, merger.GetStats().deleted_keys_);
+  BOOST_CHECK_EQUAL(1, merger.GetStats().number_of_keys_);
+
+  std::remove(filename.c_str());
+  std::remove(deleted_keys_file.string().c_str());
+  std::remove(deleted_keys_delta_file.string().c_str());
+}
+
 BOOST_AUTO_TEST_CASE(MultipleDeletes) {
   std::vector<std::pair<std::string, std::string>> test_data1 = {
       {"abcd", "{g:5}"},   {"abbc", "{t:4}"}, {"abbcd", "{u:3}"}, {"abbd", "{v:2}"},
@@ -829,6 +922,276 @@ BOOST_AUTO_TEST_CASE(MultipleDeletes) {
   std::remove(deleted_keys_file3.string().c_str());
 }
 
+BOOST_AUTO_TEST_CASE(StructuralMerge) {
+  std::mt19937 random_generator(42);
+  std::uniform_int_distribution<size_t> length_distribution(1, 12);
+  std::uniform_int_distribution<int> char_distribution('a', 'f');
+  std::uniform_int_distribution<uint32_t> weight_distribution(1, 1000);
+
+  auto create_test_data = [&](size_t number_of_keys) {
+    std::map<std::string, uint32_t> keys;
+    for (size_t i = 0; i < number_of_keys; ++i) {
+      std::string key;
+      for (size_t j = length_distribution(random_generator); j > 0; --j) {
+        key.push_back(static_cast<char>(char_distribution(random_generator)));
+      }
+      keys[key] = weight_distribution(random_generator);
+    }
+    return std::vector<std::pair<std::string, uint32_t>>(keys.begin(), keys.end());
+  };
+
+  auto write_deleted_keys = [](const std::string& filename, const std::unordered_set<std::string>& deleted_keys) {
+    std::ofstream out_stream(filename + ".dk", std::ios::binary);
+    msgpack::pack(out_stream, deleted_keys);
+  };
+
+  // a big base and small deltas
+  std::vector<std::pair<std::string, uint32_t>> test_data_base = create_test_data(20000);
+  std::vector<std::pair<std::string, uint32_t>> test_data_delta1 = create_test_data(300);
+  std::vector<std::pair<std::string, uint32_t>> test_data_delta2 = create_test_data(300);
+  testing::TempDictionary dictionary_base(&test_data_base);
+  testing::TempDictionary dictionary_delta1(&test_data_delta1);
+  testing::TempDictionary dictionary_delta2(&test_data_delta2);
+
+  std::unordered_set<std::string> keys_delta;
+  for (const auto& key_value : test_data_delta1) {
+    keys_delta.insert(key_value.first);
+  }
+  for (const auto& key_value : test_data_delta2) {
+    keys_delta.insert(key_value.first);
+  }
+
+  std::unordered_set<std::string> deleted_keys_base{"not-in-the-base"};
+  for (size_t i = 0; i < test_data_base.size(); i += 97) {
+    if (keys_delta.count(test_data_base[i].first) == 0) {
+      deleted_keys_base.insert(test_data_base[i].first);
+    }
+  }
+  write_deleted_keys(dictionary_base.GetFileName(), deleted_keys_base);
+
+  std::unordered_set<std::string> deleted_keys_delta2;
+  for (size_t i = 0; i < test_data_delta2.size(); i += 13) {
+    deleted_keys_delta2.insert(test_data_delta2[i].first);
+  }
+  write_deleted_keys(dictionary_delta2.GetFileName(), deleted_keys_delta2);
+
+  const std::string filename_complete("merged-dict-complete.kv");
+  const std::string filename_structural("merged-dict-structural.kv");
+
+  for (const auto& filename : {filename_complete, filename_structural}) {
+    keyvi::util::parameters_t params = {{"memory_limit_mb", "10"}};
+    if (filename == filename_structural) {
+      params[MERGE_MODE] = MERGE_STRUCTURAL;
+    }
+    CompletionDictionaryMerger merger(params);
+    merger.Add(dictionary_base.GetFileName());
+    merger.Add(dictionary_delta1.GetFileName());
+    merger.Add(dictionary_delta2.GetFileName());
+    merger.Merge(filename);
+  }
+
+  fsa::automata_t fsa_complete(new fsa::Automata(filename_complete));
+  fsa::automata_t fsa_structural(new fsa::Automata(filename_structural));
+  dictionary_t d_complete(new Dictionary(fsa_complete));
+  dictionary_t d_structural(new Dictionary(fsa_structural));
+
+  BOOST_CHECK_EQUAL(fsa_complete->GetNumberOfKeys(), fsa_structural->GetNumberOfKeys());
+  BOOST_CHECK(!d_structural->Contains("not-in-the-base"));
+
+  size_t number_of_keys = 0;
+  for (auto m : d_complete->GetAllItems()) {
+    const std::string key = m->GetMatchedString();
+    BOOST_CHECK_EQUAL(m->GetValueAsString(), d_structural->operator[](key)->GetValueAsString());
+
+    // inner weights must be the same along the path
+    uint64_t state_complete = fsa_complete->GetStartState();
+    uint64_t state_structural = fsa_structural->GetStartState();
+    for (const char c : key) {
+      state_complete = fsa_complete->TryWalkTransition(state_complete, c);
+      state_structural = fsa_structural->TryWalkTransition(state_structural, c);
+      BOOST_REQUIRE(state_structural != 0);
+      BOOST_CHECK_EQUAL(fsa_complete->GetInnerWeight(state_complete), fsa_structural->GetInnerWeight(state_structural));
+    }
+    ++number_of_keys;
+  }
+  BOOST_CHECK_EQUAL(number_of_keys, fsa_structural->GetNumberOfKeys());
+
+  size_t number_of_keys_structural = 0;
+  for (auto m : d_structural->GetAllItems()) {
+    BOOST_CHECK(d_complete->Contains(m->GetMatchedString()));
+    ++number_of_keys_structural;
+  }
+  BOOST_CHECK_EQUAL(number_of_keys, number_of_keys_structural);
+
+  std::remove(filename_complete.c_str());
+  std::remove(filename_structural.c_str());
+  std::remove((dictionary_base.GetFileName() + ".dk").c_str());
+  std::remove((dictionary_delta2.GetFileName() + ".dk").c_str());
+}
+
+BOOST_AUTO_TEST_CASE(StructuralMergeDeepWeights) {
+  // deep states have no inner weight, the weight of an untouched subtree must not be taken from its parent
+  const std::string prefix(INNER_WEIGHT_CUT_OFF_DEPTH + 5, 'a');
+  std::vector<std::pair<std::string, uint32_t>> test_data_base = {{prefix + "x", 1000}, {prefix + "y", 10}};
+  std::vector<std::pair<std::string, uint32_t>> test_data_delta = {{prefix + "x", 5}};
+  testing::TempDictionary dictionary_base(&test_data_base);
+  testing::TempDictionary dictionary_delta(&test_data_delta);
+
+  const std::string filename_complete("merged-dict-deep-complete.kv");
+  const std::string filename_structural("merged-dict-deep-structural.kv");
+
+  for (const auto& filename : {filename_complete, filename_structural}) {
+    keyvi::util::parameters_t params = {{"memory_limit_mb", "10"}};
+    if (filename == filename_structural) {
+      params[MERGE_MODE] = MERGE_STRUCTURAL;
+    }
+    CompletionDictionaryMerger merger(params);
+    merger.Add(dictionary_base.GetFileName());
+    merger.Add(dictionary_delta.GetFileName());
+    merger.Merge(filename);
+  }
+
+  fsa::automata_t fsa_complete(new fsa::Automata(filename_complete));
+  fsa::automata_t fsa_structural(new fsa::Automata(filename_structural));
+
+  uint64_t state_complete = fsa_complete->GetStartState();
+  uint64_t state_structural = fsa_structural->GetStartState();
+  BOOST_CHECK_EQUAL(10, fsa_structural->GetInnerWeight(state_structural));
+  for (const char c : prefix) {
+    BOOST_CHECK_EQUAL(fsa_complete->GetInnerWeight(state_complete), fsa_structural->GetInnerWeight(state_structural));
+    state_complete = fsa_complete->TryWalkTransition(state_complete, c);
+    state_structural = fsa_structural->TryWalkTransition(state_structural, c);
+    BOOST_REQUIRE(state_structural != 0);
+  }
+
+  std::remove(filename_complete.c_str());
+  std::remove(filename_structural.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(MergeJsonDictsWithCompressionDictionaries) {
+  keyvi::util::parameters_t merge_configurations[] = {{{"memory_limit_mb", "10"}},
+                                                      {{"memory_limit_mb", "10"}, {"merge_mode", "append"}},
+                                                      {{"memory_limit_mb", "10"}, {"merge_mode", "structural"}}};
+
+  // both inputs train their own dictionary on differently shaped values
+  std::vector<std::string> input_files;
+  std::map<std::string, std::string> expected;
+  for (const std::string field : {"identifier", "reference"}) {
+    JsonDictionaryCompilerSmallData compiler({{"memory_limit_mb", "10"},
+                                              {"compression", "zstd_dictionary"},
+                                              {"compression_dictionary_size", "4096"},
+                                              {"compression_dictionary_samples", "65536"}});
+    for (size_t i = 0; i < 3000; ++i) {
+      const std::string key = "key-" + std::to_string(i * (field == "identifier" ? 2 : 3));
+      const std::string value = "{\"" + field + "\":" + std::to_string(i) + ",\"label\":\"" + field + "-label-" +
+                                std::to_string(i * 17) + "\",\"flags\":[\"" + field + "\",\"merged\"]}";
+      compiler.Add(key, value);
+      expected[key] = value;
+    }
+    compiler.Compile();
+
+    input_files.push_back("merge-compression-dictionaries-" + field + ".kv");
+    compiler.WriteToFile(input_files.back());
+    BOOST_CHECK_EQUAL(4, Dictionary(input_files.back()).GetVersion());
+  }
+
+  for (const auto& params : merge_configurations) {
+    const std::string filename("merged-dict-compression-dictionaries.kv");
+    JsonDictionaryMerger merger(params);
+    for (const std::string& input_file : input_files) {
+      merger.Add(input_file);
+    }
+    merger.Merge(filename);
+
+    Dictionary d(filename);
+    BOOST_CHECK_EQUAL(4, d.GetVersion());
+    BOOST_CHECK_EQUAL(expected.size(), d.GetSize());
+    for (const auto& key_value : expected) {
+      BOOST_CHECK_EQUAL(key_value.second, d[key_value.first]->GetValueAsString());
+    }
+
+    // merge the merged dictionary again, the dictionaries are deduplicated
+    const std::string filename2("merged-dict-compression-dictionaries2.kv");
+    JsonDictionaryMerger merger2(params);
+    merger2.Add(input_files[0]);
+    merger2.Add(filename);
+    merger2.Merge(filename2);
+
+    Dictionary d2(filename2);
+    for (const auto& key_value : expected) {
+      BOOST_CHECK_EQUAL(key_value.second, d2[key_value.first]->GetValueAsString());
+    }
+
+    std::remove(filename.c_str());
+    std::remove(filename2.c_str());
+  }
+
+  for (const std::string& input_file : input_files) {
+    std::remove(input_file.c_str());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(MergeStringDictsWithPredictiveCompression) {
+  keyvi::util::parameters_t merge_configurations[] = {{{"memory_limit_mb", "10"}},
+                                                      {{"memory_limit_mb", "10"}, {"merge_mode", "append"}},
+                                                      {{"memory_limit_mb", "10"}, {"merge_mode", "structural"}}};
+
+  const std::string model_file("merge-predictive-compression.model");
+  {
+    std::ofstream model_stream(model_file, std::ios::binary);
+    model_stream << "ht\x05tp://" << "tt\x05ps://" << "//\x04www." << "w.\x07" << "example";
+  }
+
+  std::vector<std::string> input_files;
+  std::map<std::string, std::string> expected;
+  for (size_t input = 0; input < 2; ++input) {
+    StringDictionaryCompiler compiler(
+        {{"memory_limit_mb", "10"}, {"compression", "predictive"}, {"compression_model", model_file}});
+    for (size_t i = 0; i < 500; ++i) {
+      const std::string key = "key-" + std::to_string(i * (input + 2));
+      const std::string value = "https://www.example.com/" + std::to_string(input) + "/" + std::to_string(i);
+      compiler.Add(key, value);
+      expected[key] = value;
+    }
+    compiler.Compile();
+
+    input_files.push_back("merge-predictive-compression-" + std::to_string(input) + ".kv");
+    compiler.WriteToFile(input_files.back());
+    BOOST_CHECK_EQUAL(4, Dictionary(input_files.back()).GetVersion());
+  }
+
+  for (const auto& params : merge_configurations) {
+    const std::string filename("merged-dict-predictive-compression.kv");
+    StringDictionaryMerger merger(params);
+    for (const std::string& input_file : input_files) {
+      merger.Add(input_file);
+    }
+    merger.Merge(filename);
+
+    Dictionary d(filename);
+    BOOST_CHECK_EQUAL(4, d.GetVersion());
+    BOOST_CHECK_EQUAL(expected.size(), d.GetSize());
+    for (const auto& key_value : expected) {
+      BOOST_CHECK_EQUAL(key_value.second, d[key_value.first]->GetValueAsString());
+    }
+
+    std::remove(filename.c_str());
+  }
+
+  // values of uncompressed and compressed string dictionaries can not be mixed
+  std::vector<std::pair<std::string, std::string>> test_data = {{"abc", "a"}};
+  testing::TempDictionary dictionary(&test_data);
+  StringDictionaryMerger merger;
+  merger.Add(input_files[0]);
+  merger.Add(dictionary.GetFileName());
+  BOOST_CHECK_THROW(merger.Merge("merged-dict-predictive-compression-mixed.kv"), std::invalid_argument);
+
+  for (const std::string& input_file : input_files) {
+    std::remove(input_file.c_str());
+  }
+  std::remove(model_file.c_str());
+}
+
 BOOST_AUTO_TEST_CASE(WriteWithoutMerge) {
   JsonDictionaryMerger merger;
   const std::string filename("write-without-merger.kv");
@@ -23,6 +23,7 @@
  *      Author: hendrik
  */
 
+#include <algorithm>
 #include <string>
 #include <tuple>
 #include <vector>
@@ -91,6 +92,33 @@ BOOST_AUTO_TEST_CASE(DictGet) {
   BOOST_CHECK_EQUAL("22", std::get<std::string>(m->GetAttribute("weight")));
 }
 
+BOOST_AUTO_TEST_CASE(DictGetValueViews) {
+  std::vector<std::pair<std::string, std::string>> test_data = {
+      {"test", "value"},
+      {"other", "{\"a\":1}"},
+  };
+
+  const testing::TempDictionary dictionary(&test_data);
+  const dictionary_t d(new Dictionary(dictionary.GetFsa()));
+
+  std::string buffer;
+  auto m = (*d)["test"];
+  BOOST_CHECK_EQUAL("value", m->GetValueAsStringView(&buffer));
+  // string values are returned in place
+  BOOST_CHECK(buffer.empty());
+  BOOST_CHECK_EQUAL(m->GetMsgPackedValueAsString(), m->GetMsgPackedValueView(&buffer));
+
+  m = (*d)["other"];
+  BOOST_CHECK_EQUAL("{\"a\":1}", m->GetValueAsStringView(&buffer));
+  BOOST_CHECK_EQUAL(m->GetMsgPackedValueAsString(), m->GetMsgPackedValueView(&buffer));
+
+  // match without fsa, e.g. deserialized from the network
+  Match raw_match;
+  raw_match.SetRawValue(keyvi::util::EncodeJsonValue("{\"b\":2}"));
+  BOOST_CHECK_EQUAL(raw_match.GetMsgPackedValueAsString(), raw_match.GetMsgPackedValueView(&buffer));
+  BOOST_CHECK_EQUAL("{\"b\":2}", raw_match.GetValueAsStringView(&buffer));
+}
+
 BOOST_AUTO_TEST_CASE(DictLookup) {
   std::vector<std::pair<std::string, uint32_t>> test_data = {
       {"nude", 22},
@@ -304,6 +332,95 @@ BOOST_AUTO_TEST_CASE(DictContainsEmptyDict) {
   BOOST_CHECK_EQUAL(d->Contains("\x00"), false);  // NOLINT: testing NUL
 }
 
+BOOST_AUTO_TEST_CASE(DictBatchLookup) {
+  std::vector<std::pair<std::string, uint32_t>> test_data = {
+      {"test", 22}, {"otherkey", 24}, {"other", 444}, {"bar", 200}, {"", 1},
+  };
+
+  const testing::TempDictionary dictionary(&test_data);
+  const dictionary_t d(new Dictionary(dictionary.GetFsa()));
+
+  // more keys than the interleave width, to check windowing
+  std::vector<std::string> keys;
+  for (size_t i = 0; i < 5; ++i) {
+    keys.insert(keys.end(), {"test", "tes", "testx", "otherkey", "other", "oth", "bar", "baz", "", "\x00"});
+  }
+
+  auto contains = d->ContainsBatch(keys);
+  auto matches = d->GetBatch(keys);
+
+  BOOST_CHECK_EQUAL(keys.size(), contains.size());
+  BOOST_CHECK_EQUAL(keys.size(), matches.size());
+
+  for (size_t i = 0; i < keys.size(); ++i) {
+    BOOST_CHECK_EQUAL(d->Contains(keys[i]), contains[i]);
+    match_t expected = (*d)[keys[i]];
+    if (expected) {
+      BOOST_CHECK(matches[i]);
+      BOOST_CHECK_EQUAL(expected->GetMatchedString(), matches[i]->GetMatchedString());
+      BOOST_CHECK_EQUAL(expected->GetWeight(), matches[i]->GetWeight());
+    } else {
+      BOOST_CHECK(!matches[i]);
+    }
+  }
+
+  BOOST_CHECK(contains[0]);
+  BOOST_CHECK(!contains[1]);
+  BOOST_CHECK_EQUAL(444, matches[4]->GetWeight());
+
+  BOOST_CHECK_EQUAL(0, d->ContainsBatch({}).size());
+}
+
+BOOST_AUTO_TEST_CASE(DictBatchLookupEmptyDict) {
+  std::vector<std::pair<std::string, uint32_t>> test_data;
+  const testing::TempDictionary dictionary(&test_data);
+  const dictionary_t d(new Dictionary(dictionary.GetFsa()));
+
+  auto contains = d->ContainsBatch({"a", "b"});
+  BOOST_CHECK(!contains[0]);
+  BOOST_CHECK(!contains[1]);
+  BOOST_CHECK(!d->GetBatch({"a"})[0]);
+}
+
+BOOST_AUTO_TEST_CASE(DictMatcherRanges) {
+  std::vector<std::pair<std::string, uint32_t>> test_data = {
+      {"aaaa", 22}, {"aabc", 24}, {"aabd", 444}, {"abcd", 200}, {"bbcd", 10},
+  };
+  const testing::TempDictionary dictionary(&test_data);
+  const dictionary_t d(new Dictionary(dictionary.GetFsa()));
+
+  auto check_same_matches = [](MatchIterator::MatchIteratorPair erased, auto&& typed) {
+    std::vector<std::string> expected_matches;
+    for (const auto& m : erased) {
+      expected_matches.push_back(m->GetMatchedString());
+    }
+
+    size_t i = 0;
+    for (const auto& m : typed) {
+      BOOST_REQUIRE(i < expected_matches.size());
+      BOOST_CHECK_EQUAL(expected_matches[i++], m->GetMatchedString());
+    }
+    BOOST_CHECK_EQUAL(expected_matches.size(), i);
+  };
+
+  check_same_matches(d->GetNear("aabc", 2), d->GetNearRange("aabc", 2));
+  check_same_matches(d->GetNear("aabc", 2, true), d->GetNearRange("aabc", 2, true));
+  check_same_matches(d->GetFuzzy("aabc", 1, 1), d->GetFuzzyRange("aabc", 1, 1));
+  check_same_matches(d->GetPrefixCompletion("aa"), d->GetPrefixCompletionRange("aa"));
+  check_same_matches(d->GetPrefixCompletion(""), d->GetPrefixCompletionRange(""));
+  check_same_matches(d->GetPrefixCompletion("x"), d->GetPrefixCompletionRange("x"));
+  check_same_matches(d->GetMultiwordCompletion("aa"), d->GetMultiwordCompletionRange("aa"));
+
+  auto completions = d->GetPrefixCompletionRange("a");
+  completions.SetMinWeight(100);
+  std::vector<std::string> matches;
+  for (const auto& m : completions) {
+    matches.push_back(m->GetMatchedString());
+  }
+  BOOST_CHECK(std::find(matches.begin(), matches.end(), "aabd") != matches.end());
+  BOOST_CHECK(std::find(matches.begin(), matches.end(), "aaaa") == matches.end());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } /* namespace dictionary */
@@ -0,0 +1,141 @@
+//
+// keyvi - A key value store.
+//
+// Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/*
+ * entry_iterator_merger_test.cpp
+ */
+
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "keyvi/dictionary/fsa/entry_iterator_merger.h"
+#include "keyvi/testing/temp_dictionary.h"
+
+namespace keyvi {
+namespace dictionary {
+namespace fsa {
+
+BOOST_AUTO_TEST_SUITE(EntryIteratorMergerTests)
+
+BOOST_AUTO_TEST_CASE(simple) {
+  std::vector<std::pair<std::string, uint32_t>> test_data1 = {{"aaa", 1}, {"abc", 2}, {"b", 3}};
+  std::vector<std::pair<std::string, uint32_t>> test_data2 = {{"aa", 4}, {"abc", 5}, {"abcd", 6}};
+
+  testing::TempDictionary dictionary1(&test_data1, false);
+  testing::TempDictionary dictionary2(&test_data2, false);
+
+  EntryIteratorMerger merger;
+  merger.Add(EntryIterator(dictionary1.GetFsa()));
+  merger.Add(EntryIterator(dictionary2.GetFsa()));
+
+  std::vector<std::string> expected_keys = {"aa", "aaa", "abc", "abcd", "b"};
+  std::vector<size_t> expected_segments = {1, 0, 1, 1, 0};
+  std::vector<size_t> expected_dropped = {0, 0, 1, 0, 0};
+
+  std::string key;
+  size_t i = 0;
+  while (merger.Next(&key)) {
+    BOOST_REQUIRE(i < expected_keys.size());
+    BOOST_CHECK_EQUAL(expected_keys[i], key);
+    BOOST_CHECK_EQUAL(expected_segments[i], merger.GetSegmentIndex());
+    BOOST_CHECK_EQUAL(expected_dropped[i], merger.GetNumberOfDroppedEntries());
+    ++i;
+  }
+  BOOST_CHECK_EQUAL(expected_keys.size(), i);
+  BOOST_CHECK(!merger.Next(&key));
+}
+
+BOOST_AUTO_TEST_CASE(empty) {
+  EntryIteratorMerger merger;
+  std::string key;
+  BOOST_CHECK(!merger.Next(&key));
+
+  std::vector<std::pair<std::string, uint32_t>> test_data = {};
+  testing::TempDictionary dictionary(&test_data, false);
+  EntryIteratorMerger merger_empty_segment;
+  merger_empty_segment.Add(EntryIterator(dictionary.GetFsa()));
+  BOOST_CHECK(!merger_empty_segment.Next(&key));
+}
+
+BOOST_AUTO_TEST_CASE(random) {
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<size_t> length_distribution(1, 6);
+  // small alphabet for long common prefixes and many duplicates
+  std::uniform_int_distribution<int> char_distribution('a', 'd');
+
+  for (size_t number_of_segments : {1, 2, 3, 5, 8, 13}) {
+    std::vector<std::unique_ptr<testing::TempDictionary>> dictionaries;
+    // key -> segment, value, occurrences
+    std::map<std::string, std::tuple<size_t, uint32_t, size_t>> expected;
+
+    for (size_t segment = 0; segment < number_of_segments; ++segment) {
+      std::map<std::string, uint32_t> keys;
+      // every 4th segment is empty
+      const size_t number_of_keys = segment % 4 == 3 ? 0 : 500;
+      for (size_t i = 0; i < number_of_keys; ++i) {
+        std::string key;
+        for (size_t j = length_distribution(generator); j > 0; --j) {
+          key.push_back(static_cast<char>(char_distribution(generator)));
+        }
+        keys[key] = static_cast<uint32_t>(segment * 1000 + i);
+      }
+
+      std::vector<std::pair<std::string, uint32_t>> test_data(keys.begin(), keys.end());
+      for (const auto& key_value : test_data) {
+        auto& entry = expected[key_value.first];
+        std::get<2>(entry) += 1;
+        std::get<0>(entry) = segment;
+        std::get<1>(entry) = key_value.second;
+      }
+
+      dictionaries.emplace_back(new testing::TempDictionary(&test_data, false));
+    }
+
+    EntryIteratorMerger merger;
+    for (const auto& dictionary : dictionaries) {
+      merger.Add(EntryIterator(dictionary->GetFsa()));
+    }
+
+    std::string key;
+    auto expected_it = expected.begin();
+    while (merger.Next(&key)) {
+      BOOST_REQUIRE(expected_it != expected.end());
+      BOOST_CHECK_EQUAL(expected_it->first, key);
+      const size_t segment = merger.GetSegmentIndex();
+      BOOST_CHECK_EQUAL(std::get<0>(expected_it->second), segment);
+      BOOST_CHECK_EQUAL(std::get<1>(expected_it->second),
+                        std::stoul(dictionaries[segment]->GetFsa()->GetValueAsString(merger.GetValueId())));
+      BOOST_CHECK_EQUAL(std::get<2>(expected_it->second) - 1, merger.GetNumberOfDroppedEntries());
+      ++expected_it;
+    }
+    BOOST_CHECK(expected_it == expected.end());
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace fsa */
+} /* namespace dictionary */
+} /* namespace keyvi */
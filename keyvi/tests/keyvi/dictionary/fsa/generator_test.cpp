@@ -23,14 +23,20 @@
  *      Author: hendrik
  */
 
+#include <map>
+#include <random>
+#include <string>
+
 #include <boost/filesystem.hpp>
 #include <boost/test/unit_test.hpp>
 
+#include "keyvi/dictionary/dictionary_properties.h"
 #include "keyvi/dictionary/fsa/automata.h"
 #include "keyvi/dictionary/fsa/entry_iterator.h"
 #include "keyvi/dictionary/fsa/generator.h"
 #include "keyvi/dictionary/fsa/internal/int_value_store.h"
 #include "keyvi/dictionary/fsa/internal/sparse_array_persistence.h"
+#include "keyvi/dictionary/fsa/internal/swiss_minimization_cache.h"
 #include "keyvi/util/configuration.h"
 
 // #define ENABLE_TRACING
@@ -286,6 +292,213 @@ BOOST_AUTO_TEST_CASE(value_handle) {
   BOOST_CHECK(handle5 != handle6);
 }
 
+uint64_t WalkKey(const automata_t& f, const std::string& key) {
+  uint64_t state = f->GetStartState();
+  for (size_t i = 0; i < key.size() && state != 0; ++i) {
+    state = f->TryWalkTransition(state, key[i]);
+  }
+  return state;
+}
+
+automata_t CompileIntInnerWeights(const std::map<std::string, uint32_t>& key_values, size_t generator_threads,
+                                  const std::string& file_name) {
+  Generator<internal::SparseArrayPersistence<>, internal::IntInnerWeightsValueStore> g(keyvi::util::parameters_t(
+      {{"memory_limit_mb", "100"}, {GENERATOR_THREADS_KEY, std::to_string(generator_threads)}}));
+  for (const auto& key_value : key_values) {
+    g.Add(key_value.first, key_value.second);
+  }
+  g.CloseFeeding();
+  g.WriteToFile(file_name);
+
+  return automata_t(new Automata(file_name));
+}
+
+BOOST_AUTO_TEST_CASE(partitioned) {
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<int> length_distribution(1, 12);
+  std::uniform_int_distribution<int> char_distribution(0, 255);
+  std::uniform_int_distribution<uint32_t> weight_distribution(0, 100000);
+
+  std::map<std::string, uint32_t> key_values;
+  while (key_values.size() < 50000) {
+    std::string key;
+    for (int i = length_distribution(generator); i > 0; --i) {
+      // skew the distribution to get partitions of different sizes
+      const int c = char_distribution(generator);
+      key.push_back(static_cast<char>(c < 128 ? 'a' + c % 8 : c));
+    }
+    key_values.emplace(key, weight_distribution(generator));
+  }
+  key_values.emplace(std::string("\0", 1), 7);
+  key_values.emplace("z", 3);
+
+  automata_t sequential = CompileIntInnerWeights(key_values, 1, "testFilePartitionedReference");
+
+  for (size_t threads : {2, 4}) {
+    automata_t partitioned = CompileIntInnerWeights(key_values, threads, "testFilePartitioned");
+    BOOST_CHECK_EQUAL(key_values.size(), partitioned->GetNumberOfKeys());
+
+    EntryIterator it(partitioned);
+    EntryIterator end_it;
+    for (const auto& key_value : key_values) {
+      BOOST_REQUIRE(it != end_it);
+      BOOST_CHECK_EQUAL(key_value.first, it.GetKey());
+      BOOST_CHECK_EQUAL(key_value.second, it.GetValueId());
+      ++it;
+    }
+    BOOST_CHECK(it == end_it);
+
+    // suffixes shared across partitions get minimized, the automaton is as small as the sequential one
+    BOOST_CHECK_EQUAL(DictionaryProperties::FromFile("testFilePartitionedReference").GetNumberOfStates(),
+                      DictionaryProperties::FromFile("testFilePartitioned").GetNumberOfStates());
+
+    // weights of the root and the partition start states
+    BOOST_CHECK_EQUAL(sequential->GetInnerWeight(sequential->GetStartState()),
+                      partitioned->GetInnerWeight(partitioned->GetStartState()));
+    for (int c = 0; c < 256; ++c) {
+      const std::string first_byte(1, static_cast<char>(c));
+      const uint64_t state = WalkKey(partitioned, first_byte);
+      BOOST_CHECK_EQUAL(WalkKey(sequential, first_byte) != 0, state != 0);
+      if (state != 0) {
+        BOOST_CHECK_EQUAL(sequential->GetInnerWeight(WalkKey(sequential, first_byte)),
+                          partitioned->GetInnerWeight(state));
+      }
+    }
+
+    for (const auto& key_value : key_values) {
+      const uint64_t state = WalkKey(partitioned, key_value.first);
+      BOOST_REQUIRE(state != 0);
+      BOOST_CHECK(partitioned->IsFinalState(state));
+
+      // prefixes and extensions must behave the same
+      const std::string prefix = key_value.first.substr(0, key_value.first.size() - 1);
+      const uint64_t sequential_prefix_state = WalkKey(sequential, prefix);
+      const uint64_t partitioned_prefix_state = WalkKey(partitioned, prefix);
+      BOOST_REQUIRE(partitioned_prefix_state != 0);
+      BOOST_CHECK_EQUAL(sequential->IsFinalState(sequential_prefix_state),
+                        partitioned->IsFinalState(partitioned_prefix_state));
+      BOOST_CHECK_EQUAL(WalkKey(sequential, key_value.first + "q") != 0,
+                        WalkKey(partitioned, key_value.first + "q") != 0);
+    }
+  }
+
+  boost::filesystem::remove("testFilePartitionedReference");
+  boost::filesystem::remove("testFilePartitioned");
+}
+
+BOOST_AUTO_TEST_CASE(partitioned_small) {
+  Generator<internal::SparseArrayPersistence<>> g(
+      keyvi::util::parameters_t({{"memory_limit_mb", "10"}, {GENERATOR_THREADS_KEY, "3"}}));
+  g.Add("aaaa");
+  g.Add("aabb");
+  g.Add("b");
+  g.Add("bbcd");
+  g.Add("bbcd");
+  g.Add("cd");
+  g.CloseFeeding();
+  g.WriteToFile("testFilePartitionedSmall");
+
+  automata_t f(new Automata("testFilePartitionedSmall"));
+  EntryIterator it(f);
+  EntryIterator end_it;
+
+  for (const std::string key : {"aaaa", "aabb", "b", "bbcd", "cd"}) {
+    BOOST_REQUIRE(it != end_it);
+    BOOST_CHECK_EQUAL(key, it.GetKey());
+    ++it;
+  }
+  BOOST_CHECK(it == end_it);
+  BOOST_CHECK_EQUAL(0, f->TryWalkTransition(f->GetStartState(), 0));
+
+  Generator<internal::SparseArrayPersistence<>> empty_generator(
+      keyvi::util::parameters_t({{"memory_limit_mb", "10"}, {GENERATOR_THREADS_KEY, "3"}}));
+  empty_generator.CloseFeeding();
+  empty_generator.WriteToFile("testFilePartitionedSmall");
+
+  automata_t empty(new Automata("testFilePartitionedSmall"));
+  BOOST_CHECK_EQUAL(0, empty->GetNumberOfKeys());
+  BOOST_CHECK(EntryIterator(empty) == end_it);
+
+  boost::filesystem::remove("testFilePartitionedSmall");
+}
+
+BOOST_AUTO_TEST_CASE(partitioned_bounded_buffer) {
+  // a single partition larger than its buffer, feeding blocks until the partition compile consumed keys
+  std::map<std::string, uint32_t> key_values;
+  for (size_t i = 0; i < 100000; ++i) {
+    key_values.emplace("a" + std::to_string(i * 7919), static_cast<uint32_t>(i));
+  }
+  key_values.emplace("b", 1);
+
+  automata_t partitioned = CompileIntInnerWeights(key_values, 2, "testFilePartitionedBounded");
+  BOOST_CHECK_EQUAL(key_values.size(), partitioned->GetNumberOfKeys());
+
+  EntryIterator it(partitioned);
+  EntryIterator end_it;
+  for (const auto& key_value : key_values) {
+    BOOST_REQUIRE(it != end_it);
+    BOOST_CHECK_EQUAL(key_value.first, it.GetKey());
+    BOOST_CHECK_EQUAL(key_value.second, it.GetValueId());
+    ++it;
+  }
+  BOOST_CHECK(it == end_it);
+
+  boost::filesystem::remove("testFilePartitionedBounded");
+}
+
+BOOST_AUTO_TEST_CASE(swiss_minimization_cache) {
+  std::mt19937 generator(7);
+  std::uniform_int_distribution<int> length_distribution(1, 10);
+  std::uniform_int_distribution<int> char_distribution('a', 'k');
+
+  std::map<std::string, uint32_t> key_values;
+  while (key_values.size() < 20000) {
+    std::string key;
+    for (int i = length_distribution(generator); i > 0; --i) {
+      key.push_back(static_cast<char>(char_distribution(generator)));
+    }
+    key_values.emplace(key, key.size());
+  }
+
+  Generator<internal::SparseArrayPersistence<>, internal::IntInnerWeightsValueStore> reference(
+      keyvi::util::parameters_t({{"memory_limit_mb", "10"}}));
+  Generator<internal::SparseArrayPersistence<>, internal::IntInnerWeightsValueStore, uint32_t, int32_t,
+            internal::SwissMinimizationCache<internal::PackedState<>>>
+      g(keyvi::util::parameters_t({{"memory_limit_mb", "10"}}));
+
+  for (const auto& key_value : key_values) {
+    reference.Add(key_value.first, key_value.second);
+    g.Add(key_value.first, key_value.second);
+  }
+  reference.CloseFeeding();
+  g.CloseFeeding();
+
+  BOOST_CHECK(g.GetMinimizationHitRate() > 0.1);
+  BOOST_CHECK(reference.GetMinimizationHitRate() > 0.1);
+
+  g.WriteToFile("testFileSwissMinimization");
+  reference.WriteToFile("testFileSwissMinimizationReference");
+  automata_t f(new Automata("testFileSwissMinimization"));
+  automata_t f_reference(new Automata("testFileSwissMinimizationReference"));
+
+  // with plenty of memory both caches find the same equal states
+  BOOST_CHECK_EQUAL(DictionaryProperties::FromFile("testFileSwissMinimizationReference").GetNumberOfStates(),
+                    DictionaryProperties::FromFile("testFileSwissMinimization").GetNumberOfStates());
+
+  EntryIterator it(f);
+  EntryIterator end_it;
+  for (const auto& key_value : key_values) {
+    BOOST_REQUIRE(it != end_it);
+    BOOST_CHECK_EQUAL(key_value.first, it.GetKey());
+    BOOST_CHECK_EQUAL(key_value.second, it.GetValueId());
+    ++it;
+  }
+  BOOST_CHECK(it == end_it);
+
+  boost::filesystem::remove("testFileSwissMinimization");
+  boost::filesystem::remove("testFileSwissMinimizationReference");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } /* namespace fsa */
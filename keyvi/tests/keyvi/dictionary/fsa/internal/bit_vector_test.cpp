@@ -25,6 +25,8 @@
 
 #define BITVECTOR_UNIT_TEST
 
+#include <random>
+
 #include <boost/test/unit_test.hpp>
 
 #include "keyvi/dictionary/fsa/internal/bit_vector.h"
@@ -190,6 +192,62 @@ BOOST_AUTO_TEST_CASE(unsignedBitShiftConsistency) {
   BOOST_CHECK(g.Get(6));
 }
 
+BOOST_AUTO_TEST_CASE(minimumNumberOfShifts) {
+  std::mt19937_64 generator(42);
+  BitVector<64> f;
+
+  for (size_t i = 0; i < 20000; ++i) {
+    // mix dense and sparse words
+    uint64_t a = generator();
+    uint64_t b = generator();
+    if (i % 3 == 0) {
+      a |= generator() | generator();
+    }
+    if (i % 5 == 0) {
+      b &= generator() & generator();
+    }
+    if ((a & b) == 0) {
+      continue;
+    }
+
+    int expected = 0;
+    while (expected < 64 && ((a >> expected) & b) != 0) {
+      ++expected;
+    }
+
+    BOOST_CHECK_EQUAL(expected, f.GetMinimumNumberOfShifts(b, a));
+  }
+
+  BOOST_CHECK_EQUAL(64, f.GetMinimumNumberOfShifts(1, std::numeric_limits<uint64_t>::max()));
+  BOOST_CHECK_EQUAL(1, f.GetMinimumNumberOfShifts(uint64_t(1) << 63, std::numeric_limits<uint64_t>::max()));
+}
+
+BOOST_AUTO_TEST_CASE(disjointAndShiftThis) {
+  std::mt19937_64 generator(7);
+
+  for (size_t i = 0; i < 2000; ++i) {
+    BitVector<1024> occupied;
+    BitVector<261> state;
+    for (size_t j = 0; j < 700; ++j) {
+      occupied.Set(generator() % 1024);
+    }
+    for (size_t j = 0; j < 1 + generator() % 12; ++j) {
+      state.Set(generator() % 261);
+    }
+
+    const size_t start = generator() % 400;
+    const int shift = occupied.DisjointAndShiftThis(state, start);
+
+    // the shift must not skip a position where the state fits
+    for (int s = 0; s < shift; ++s) {
+      BOOST_CHECK(!occupied.Disjoint(state, start + s));
+    }
+    if (shift == 0) {
+      BOOST_CHECK(occupied.Disjoint(state, start));
+    }
+  }
+}
+
 BOOST_AUTO_TEST_CASE(nextZeroBit) {
   // 1010 0000
   BitVector<32> a;
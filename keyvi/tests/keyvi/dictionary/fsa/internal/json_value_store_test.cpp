@@ -24,6 +24,13 @@
 
 #include "keyvi/dictionary/fsa/internal/json_value_store.h"
 
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
 #include <boost/filesystem.hpp>
 #include <boost/interprocess/file_mapping.hpp>
 #include <boost/test/unit_test.hpp>
@@ -147,6 +154,214 @@ BOOST_AUTO_TEST_CASE(persistence) {
   std::remove(filename.c_str());
 }
 
+BOOST_AUTO_TEST_CASE(value_views) {
+  JsonValueStore json_value_store(keyvi::util::parameters_t{
+      {TEMPORARY_PATH_KEY, "/tmp"}, {"memory_limit_mb", "10"}, {COMPRESSION_KEY, "zlib"}});
+  bool no_minimization = false;
+  std::string value = "{\"";
+  value += std::string(60000, 'a');
+  value += "\":42}";
+
+  // long values get compressed, short ones not
+  uint64_t v = json_value_store.AddValue(value, &no_minimization);
+  uint64_t w = json_value_store.AddValue("{\"mytestvalue2\":23}", &no_minimization);
+
+  boost::filesystem::path temp_path = boost::filesystem::temp_directory_path();
+  temp_path /= boost::filesystem::unique_path("dictionary-unit-test-temp-dictionary-%%%%-%%%%-%%%%-%%%%");
+  std::string filename = temp_path.string();
+
+  std::ofstream out_stream(filename, std::ios::binary);
+  json_value_store.Write(out_stream);
+  out_stream.close();
+
+  std::ifstream in_stream(filename, std::ios::binary);
+  boost::interprocess::file_mapping file_mapping(filename.c_str(), boost::interprocess::read_only);
+  fsa::internal::ValueStoreProperties properties = fsa::internal::ValueStoreProperties::FromJson(in_stream);
+
+  {
+    JsonValueStoreReader reader(&file_mapping, properties, loading_strategy_types::lazy);
+
+    std::string buffer;
+    std::string_view view = reader.GetMsgPackedValueView(w, &buffer);
+    BOOST_CHECK(buffer.empty());
+    BOOST_CHECK_EQUAL(reader.GetMsgPackedValueAsString(w), view);
+    BOOST_CHECK_EQUAL("{\"mytestvalue2\":23}", keyvi::util::MsgPackToJson(view));
+
+    view = reader.GetMsgPackedValueView(v, &buffer);
+    BOOST_CHECK(!buffer.empty());
+    BOOST_CHECK(view.data() == buffer.data());
+    BOOST_CHECK_EQUAL(reader.GetMsgPackedValueAsString(v), view);
+    BOOST_CHECK_EQUAL(value, keyvi::util::MsgPackToJson(view));
+
+    // json requires conversion, the view points into the buffer
+    view = reader.GetValueAsStringView(w, &buffer);
+    BOOST_CHECK_EQUAL("{\"mytestvalue2\":23}", view);
+  }
+
+  std::remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(compression_dictionary) {
+  for (size_t threads : {1, 4}) {
+    JsonValueStore json_value_store(keyvi::util::parameters_t{{TEMPORARY_PATH_KEY, "/tmp"},
+                                                              {"memory_limit_mb", "10"},
+                                                              {COMPRESSION_KEY, "zstd_dictionary"},
+                                                              {COMPRESSION_DICTIONARY_SIZE_KEY, "4096"},
+                                                              {COMPRESSION_DICTIONARY_SAMPLES_KEY, "65536"}});
+    json_value_store.SetEncodingThreads(threads);
+
+    std::vector<std::string> values;
+    std::vector<uint64_t> value_ids;
+    for (size_t i = 0; i < 5000; ++i) {
+      values.push_back("{\"id\":" + std::to_string(i) + ",\"name\":\"product-" + std::to_string(i * 7) +
+                       "\",\"category\":\"category-" + std::to_string(i % 13) +
+                       "\",\"available\":true,\"tags\":[\"new\",\"sale\"]}");
+      bool no_minimization = false;
+      value_ids.push_back(json_value_store.AddValue(values.back(), &no_minimization));
+    }
+    json_value_store.CloseFeeding();
+    for (uint64_t& value_id : value_ids) {
+      bool no_minimization = false;
+      value_id = json_value_store.ResolveValue(value_id, &no_minimization);
+    }
+    BOOST_CHECK_EQUAL(4, json_value_store.GetFileVersionMin());
+
+    boost::filesystem::path temp_path = boost::filesystem::temp_directory_path();
+    temp_path /= boost::filesystem::unique_path("dictionary-unit-test-temp-dictionary-%%%%-%%%%-%%%%-%%%%");
+    std::string filename = temp_path.string();
+
+    std::ofstream out_stream(filename, std::ios::binary);
+    json_value_store.Write(out_stream);
+    out_stream.close();
+
+    std::ifstream in_stream(filename, std::ios::binary);
+    boost::interprocess::file_mapping file_mapping(filename.c_str(), boost::interprocess::read_only);
+    fsa::internal::ValueStoreProperties properties = fsa::internal::ValueStoreProperties::FromJson(in_stream);
+    BOOST_CHECK(properties.GetCompressionDictionariesSize() > 0);
+
+    {
+      JsonValueStoreReader reader(&file_mapping, properties, loading_strategy_types::lazy);
+
+      for (size_t i = 0; i < values.size(); ++i) {
+        BOOST_CHECK_EQUAL(values[i], reader.GetValueAsString(value_ids[i]));
+        std::string buffer;
+        BOOST_CHECK_EQUAL(reader.GetMsgPackedValueAsString(value_ids[i]),
+                          reader.GetMsgPackedValueView(value_ids[i], &buffer));
+      }
+
+      // values after sampling use the dictionary, raw values can be decoded without it
+      std::ifstream file_stream(filename, std::ios::binary);
+      const std::string file_content((std::istreambuf_iterator<char>(file_stream)), std::istreambuf_iterator<char>());
+      const std::string last_value =
+          keyvi::util::decodeVarIntString(file_content.data() + properties.GetOffset() + value_ids.back());
+      BOOST_CHECK_EQUAL(compression::ZSTD_DICTIONARY_COMPRESSION, last_value[0]);
+      BOOST_CHECK_THROW(keyvi::util::DecodeJsonValue(last_value), std::invalid_argument);
+      BOOST_CHECK_EQUAL(values.back(), keyvi::util::DecodeJsonValue(reader.GetRawValueAsString(value_ids.back())));
+    }
+
+    std::remove(filename.c_str());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(compression_dictionary_too_few_values) {
+  JsonValueStore json_value_store(keyvi::util::parameters_t{{TEMPORARY_PATH_KEY, "/tmp"},
+                                                            {"memory_limit_mb", "10"},
+                                                            {COMPRESSION_KEY, "zstd_dictionary"},
+                                                            {COMPRESSION_DICTIONARY_SIZE_KEY, "4096"},
+                                                            {COMPRESSION_DICTIONARY_SAMPLES_KEY, "65536"}});
+
+  // not enough samples for training, the values stay compressed with zstd only
+  std::vector<std::string> values;
+  std::vector<uint64_t> value_ids;
+  for (size_t i = 0; i < 10; ++i) {
+    values.push_back("{\"id\":" + std::to_string(i) + ",\"name\":\"product-" + std::to_string(i * 7) +
+                     "\",\"category\":\"category-" + std::to_string(i % 13) + "\"}");
+    bool no_minimization = false;
+    value_ids.push_back(json_value_store.AddValue(values.back(), &no_minimization));
+  }
+  json_value_store.CloseFeeding();
+  BOOST_CHECK_EQUAL(3, json_value_store.GetFileVersionMin());
+
+  boost::filesystem::path temp_path = boost::filesystem::temp_directory_path();
+  temp_path /= boost::filesystem::unique_path("dictionary-unit-test-temp-dictionary-%%%%-%%%%-%%%%-%%%%");
+  std::string filename = temp_path.string();
+
+  std::ofstream out_stream(filename, std::ios::binary);
+  json_value_store.Write(out_stream);
+  out_stream.close();
+
+  std::ifstream in_stream(filename, std::ios::binary);
+  boost::interprocess::file_mapping file_mapping(filename.c_str(), boost::interprocess::read_only);
+  fsa::internal::ValueStoreProperties properties = fsa::internal::ValueStoreProperties::FromJson(in_stream);
+  BOOST_CHECK_EQUAL(0, properties.GetCompressionDictionariesSize());
+
+  {
+    JsonValueStoreReader reader(&file_mapping, properties, loading_strategy_types::lazy);
+    for (size_t i = 0; i < values.size(); ++i) {
+      BOOST_CHECK_EQUAL(values[i], reader.GetValueAsString(value_ids[i]));
+    }
+  }
+
+  std::remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(predictive_compression) {
+  boost::filesystem::path temp_path = boost::filesystem::temp_directory_path();
+  temp_path /= boost::filesystem::unique_path("dictionary-unit-test-temp-dictionary-%%%%-%%%%-%%%%-%%%%");
+  const std::string filename = temp_path.string();
+  const std::string model_file = filename + ".model";
+  {
+    std::ofstream model_stream(model_file, std::ios::binary);
+    model_stream << "ht\x05tp://" << "tt\x05ps://" << "//\x04www." << "w.\x07" << "example";
+  }
+
+  for (size_t threads : {1, 4}) {
+    JsonValueStore json_value_store(keyvi::util::parameters_t{{TEMPORARY_PATH_KEY, "/tmp"},
+                                                              {"memory_limit_mb", "10"},
+                                                              {COMPRESSION_KEY, "predictive"},
+                                                              {COMPRESSION_MODEL_KEY, model_file},
+                                                              {COMPRESSION_THRESHOLD_KEY, "0"}});
+    json_value_store.SetEncodingThreads(threads);
+
+    std::vector<std::string> values;
+    std::vector<uint64_t> value_ids;
+    for (size_t i = 0; i < 3000; ++i) {
+      values.push_back("\"https://www.example.com/" + std::to_string(i) + "\"");
+      bool no_minimization = false;
+      value_ids.push_back(json_value_store.AddValue(values.back(), &no_minimization));
+    }
+    json_value_store.CloseFeeding();
+    for (uint64_t& value_id : value_ids) {
+      bool no_minimization = false;
+      value_id = json_value_store.ResolveValue(value_id, &no_minimization);
+    }
+    BOOST_CHECK_EQUAL(4, json_value_store.GetFileVersionMin());
+
+    std::ofstream out_stream(filename, std::ios::binary);
+    json_value_store.Write(out_stream);
+    out_stream.close();
+
+    std::ifstream in_stream(filename, std::ios::binary);
+    boost::interprocess::file_mapping file_mapping(filename.c_str(), boost::interprocess::read_only);
+    fsa::internal::ValueStoreProperties properties = fsa::internal::ValueStoreProperties::FromJson(in_stream);
+    BOOST_CHECK(properties.GetCompressionDictionariesSize() > 0);
+
+    {
+      JsonValueStoreReader reader(&file_mapping, properties, loading_strategy_types::lazy);
+
+      for (size_t i = 0; i < values.size(); ++i) {
+        BOOST_CHECK_EQUAL(values[i], reader.GetValueAsString(value_ids[i]));
+      }
+
+      // raw values can be decoded without the model
+      BOOST_CHECK_EQUAL(values.back(), keyvi::util::DecodeJsonValue(reader.GetRawValueAsString(value_ids.back())));
+    }
+
+    std::remove(filename.c_str());
+  }
+  std::remove(model_file.c_str());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } /* namespace internal */
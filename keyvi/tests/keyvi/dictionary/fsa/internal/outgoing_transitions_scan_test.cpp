@@ -0,0 +1,129 @@
+//
+// keyvi - A key value store.
+//
+// Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/*
+ * outgoing_transitions_scan_test.cpp
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "keyvi/dictionary/fsa/internal/outgoing_transitions_scan.h"
+
+namespace keyvi {
+namespace dictionary {
+namespace fsa {
+namespace internal {
+
+BOOST_AUTO_TEST_SUITE(OutgoingTransitionsScanTests)
+
+namespace {
+
+std::vector<unsigned char> RandomLabels(std::mt19937* generator, size_t size, size_t number_of_outgoing) {
+  std::uniform_int_distribution<int> byte_distribution(0, 255);
+  std::vector<unsigned char> labels(size);
+
+  for (size_t i = 0; i < size; ++i) {
+    // avoid accidental hits, those are set explicitly below
+    labels[i] = static_cast<unsigned char>(byte_distribution(*generator));
+    if (labels[i] == (i % 256)) {
+      labels[i] = static_cast<unsigned char>(labels[i] + 1);
+    }
+  }
+
+  for (size_t i = 0; i < number_of_outgoing; ++i) {
+    size_t label = byte_distribution(*generator);
+    labels[label] = static_cast<unsigned char>(label);
+  }
+
+  return labels;
+}
+
+void CheckKernel(outgoing_transitions_scan_t kernel, const unsigned char* labels) {
+  uint64_t expected[OUTGOING_TRANSITIONS_BITMASK_WORDS];
+  uint64_t actual[OUTGOING_TRANSITIONS_BITMASK_WORDS];
+
+  ScanOutgoingTransitionsGeneric(labels, expected);
+  kernel(labels, actual);
+
+  for (size_t i = 0; i < OUTGOING_TRANSITIONS_BITMASK_WORDS; ++i) {
+    BOOST_CHECK_EQUAL(expected[i], actual[i]);
+  }
+}
+
+std::vector<outgoing_transitions_scan_t> AvailableKernels() {
+  std::vector<outgoing_transitions_scan_t> kernels;
+  kernels.push_back(&ScanOutgoingTransitions);
+#if defined(KEYVI_X86_DISPATCH)
+  kernels.push_back(&ScanOutgoingTransitionsSSE2);
+  if (__builtin_cpu_supports("avx2")) {
+    kernels.push_back(&ScanOutgoingTransitionsAVX2);
+  }
+  if (__builtin_cpu_supports("avx512bw")) {
+    kernels.push_back(&ScanOutgoingTransitionsAVX512);
+  }
+#endif
+  return kernels;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(GenericKernel) {
+  std::vector<unsigned char> labels(256, 0);
+  labels[1] = 1;
+  labels[63] = 63;
+  labels[64] = 64;
+  labels[200] = 200;
+  labels[255] = 255;
+
+  uint64_t bitmask[OUTGOING_TRANSITIONS_BITMASK_WORDS];
+  ScanOutgoingTransitionsGeneric(labels.data(), bitmask);
+
+  // label 0 matches as labels[0] == 0
+  BOOST_CHECK_EQUAL(0x8000000000000003ULL, bitmask[0]);
+  BOOST_CHECK_EQUAL(0x1ULL, bitmask[1]);
+  BOOST_CHECK_EQUAL(0x0ULL, bitmask[2]);
+  BOOST_CHECK_EQUAL((1ULL << (200 - 192)) | (1ULL << 63), bitmask[3]);
+}
+
+BOOST_AUTO_TEST_CASE(AllKernelsAgree) {
+  std::mt19937 generator(42);
+
+  for (auto kernel : AvailableKernels()) {
+    for (size_t number_of_outgoing : {0, 1, 5, 40, 256}) {
+      // use an odd offset to check unaligned access
+      std::vector<unsigned char> buffer = RandomLabels(&generator, 256 + 3, 0);
+      std::vector<unsigned char> labels = RandomLabels(&generator, 256, number_of_outgoing);
+      std::copy(labels.begin(), labels.end(), buffer.begin() + 3);
+
+      CheckKernel(kernel, labels.data());
+      CheckKernel(kernel, buffer.data() + 3);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace internal */
+} /* namespace fsa */
+} /* namespace dictionary */
+} /* namespace keyvi */
@@ -23,6 +23,11 @@
  *      Author: hendrik
  */
 
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
 #include <boost/filesystem.hpp>
 #include <boost/test/unit_test.hpp>
 
@@ -52,6 +57,61 @@ BOOST_AUTO_TEST_CASE(minimization) {
   BOOST_CHECK_EQUAL(w, strings.AddValue("othervalue", &no_minimization));
 }
 
+BOOST_AUTO_TEST_CASE(predictive_compression) {
+  boost::filesystem::path temp_path = boost::filesystem::temp_directory_path();
+  temp_path /= boost::filesystem::unique_path("string-value-store-unit-test-%%%%-%%%%-%%%%-%%%%");
+  const std::string model_file = temp_path.string() + ".model";
+  const std::string filename = temp_path.string();
+  {
+    std::ofstream model_stream(model_file, std::ios::binary);
+    model_stream << "ht\x05tp://" << "tt\x05ps://" << "//\x04www." << "w.\x07" << "example";
+  }
+
+  BOOST_CHECK_THROW(StringValueStore(keyvi::util::parameters_t{{COMPRESSION_KEY, "predictive"}}),
+                    std::invalid_argument);
+
+  StringValueStore strings(keyvi::util::parameters_t{
+      {TEMPORARY_PATH_KEY, "/tmp"}, {COMPRESSION_KEY, "predictive"}, {COMPRESSION_MODEL_KEY, model_file}});
+
+  std::vector<std::string> values = {"https://www.example.com/", "http://www.example.org/index.html", "",
+                                     std::string("null\0byte", 9), "x"};
+  std::vector<uint64_t> value_ids;
+  size_t uncompressed_size = 0;
+  for (const std::string& value : values) {
+    bool no_minimization = false;
+    value_ids.push_back(strings.AddValue(value, &no_minimization));
+    uncompressed_size += value.size() + 1;
+  }
+  bool no_minimization = false;
+  BOOST_CHECK_EQUAL(value_ids[0], strings.AddValue(values[0], &no_minimization));
+  BOOST_CHECK(!no_minimization);
+  strings.CloseFeeding();
+  BOOST_CHECK_EQUAL(4, strings.GetFileVersionMin());
+
+  std::ofstream out_stream(filename, std::ios::binary);
+  strings.Write(out_stream);
+  out_stream.close();
+
+  std::ifstream in_stream(filename, std::ios::binary);
+  boost::interprocess::file_mapping file_mapping(filename.c_str(), boost::interprocess::read_only);
+  ValueStoreProperties properties = ValueStoreProperties::FromJson(in_stream);
+  BOOST_CHECK_EQUAL("predictive", properties.GetCompression());
+  BOOST_CHECK(properties.GetCompressionDictionariesSize() > 0);
+  BOOST_CHECK(properties.GetSize() < uncompressed_size);
+
+  {
+    StringValueStoreReader reader(&file_mapping, properties);
+    for (size_t i = 0; i < values.size(); ++i) {
+      BOOST_CHECK_EQUAL(values[i], reader.GetValueAsString(value_ids[i]));
+      std::string buffer;
+      BOOST_CHECK_EQUAL(values[i], reader.GetValueAsStringView(value_ids[i], &buffer));
+    }
+  }
+
+  std::remove(filename.c_str());
+  std::remove(model_file.c_str());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } /* namespace internal */
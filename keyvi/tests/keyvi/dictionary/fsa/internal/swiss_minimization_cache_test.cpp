@@ -0,0 +1,103 @@
+//
+// keyvi - A key value store.
+//
+// Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <boost/test/unit_test.hpp>
+
+#include "keyvi/dictionary/fsa/internal/packed_state.h"
+#include "keyvi/dictionary/fsa/internal/swiss_minimization_cache.h"
+
+namespace keyvi {
+namespace dictionary {
+namespace fsa {
+namespace internal {
+
+// The name of the suite must be a different name to your class
+BOOST_AUTO_TEST_SUITE(SwissMinimizationCacheTests)
+
+BOOST_AUTO_TEST_CASE(insert) {
+  SwissMinimizationCache<PackedState<>> cache(1024 * 1024);
+  PackedState<> p1 = {10, 25, 2};
+  cache.Add(p1);
+  PackedState<> p2 = {12, 25, 3};
+  cache.Add(p2);
+  PackedState<> p3 = {13, 26, 5};
+  cache.Add(p3);
+
+  BOOST_CHECK(cache.Get(p1) == p1);
+  BOOST_CHECK(cache.Get(p2) == p2);
+  BOOST_CHECK(cache.Get(p3) == p3);
+  BOOST_CHECK_EQUAL(3, cache.Size());
+
+  PackedState<> p4 = {15, 25, 6};
+  BOOST_CHECK(cache.Get(p4).IsEmpty());
+
+  BOOST_CHECK_EQUAL(4, cache.GetNumberOfLookups());
+  BOOST_CHECK_EQUAL(3, cache.GetNumberOfHits());
+  BOOST_CHECK_CLOSE(0.75, cache.GetHitRate(), 1e-6);
+
+  cache.Clear();
+  BOOST_CHECK(cache.Get(p1).IsEmpty());
+  BOOST_CHECK_EQUAL(0, cache.Size());
+}
+
+BOOST_AUTO_TEST_CASE(memory_limit) {
+  // memory for a single group: old entries get replaced
+  SwissMinimizationCache<PackedState<>> cache(100);
+  BOOST_CHECK(cache.GetMemoryUsage() < 1024);
+
+  for (uint32_t i = 1; i <= 100; ++i) {
+    cache.Add(PackedState<>(i, static_cast<int32_t>(i * 7), 1));
+  }
+
+  BOOST_CHECK_EQUAL(16, cache.Size());
+
+  // the latest entries are still in the cache, the first ones are gone
+  for (uint32_t i = 85; i <= 100; ++i) {
+    PackedState<> p(i, static_cast<int32_t>(i * 7), 1);
+    BOOST_CHECK(cache.Get(p) == p);
+  }
+
+  PackedState<> p1(1, 7, 1);
+  BOOST_CHECK(cache.Get(p1).IsEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(many_entries) {
+  SwissMinimizationCache<PackedState<>> cache(64 * 1024 * 1024);
+
+  for (uint32_t i = 1; i <= 500000; ++i) {
+    cache.Add(PackedState<>(i, static_cast<int32_t>(i * 2654435761U), 1));
+  }
+
+  size_t found = 0;
+  for (uint32_t i = 1; i <= 500000; ++i) {
+    PackedState<> p(i, static_cast<int32_t>(i * 2654435761U), 1);
+    if (cache.Get(p) == p) {
+      ++found;
+    }
+  }
+
+  BOOST_CHECK_EQUAL(500000, found);
+  BOOST_CHECK(cache.GetMemoryUsage() <= 64 * 1024 * 1024);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace internal */
+} /* namespace fsa */
+} /* namespace dictionary */
+} /* namespace keyvi */
@@ -0,0 +1,158 @@
+//
+// keyvi - A key value store.
+//
+// Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/*
+ * traversal_base_test.cpp
+ */
+
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "keyvi/dictionary/fsa/traversal/traversal_base.h"
+
+namespace keyvi {
+namespace dictionary {
+namespace fsa {
+namespace traversal {
+
+// transition type with a heap allocated container for the transitions of a state
+struct VectorTransition : public Transition {
+  VectorTransition(uint64_t s, unsigned char l) : Transition(s, l) {}
+};
+
+template <>
+struct TraversalPayload<VectorTransition> {
+  using transitions_t = std::vector<VectorTransition>;
+
+  TraversalPayload() : current_depth(0) {}
+
+  size_t current_depth;
+};
+
+BOOST_AUTO_TEST_SUITE(TraversalBaseTests)
+
+BOOST_AUTO_TEST_CASE(TransitionBufferFull) {
+  TransitionBuffer<Transition> buffer;
+  BOOST_CHECK(buffer.empty());
+
+  for (size_t i = 0; i < TRAVERSAL_STATE_MAX_TRANSITIONS; ++i) {
+    buffer.push_back(Transition(i, static_cast<unsigned char>(i)));
+  }
+
+  BOOST_CHECK_EQUAL(TRAVERSAL_STATE_MAX_TRANSITIONS, buffer.size());
+  BOOST_CHECK_EQUAL(255, buffer[255].state);
+
+  TransitionBuffer<Transition> copy(buffer);
+  BOOST_CHECK_EQUAL(TRAVERSAL_STATE_MAX_TRANSITIONS, copy.size());
+
+  size_t i = 0;
+  for (const auto& transition : copy) {
+    BOOST_CHECK_EQUAL(i++, transition.state);
+  }
+
+  BOOST_CHECK_THROW(buffer.push_back(Transition(0, 'a')), std::length_error);
+  BOOST_CHECK_EQUAL(TRAVERSAL_STATE_MAX_TRANSITIONS, buffer.size());
+
+  buffer.clear();
+  BOOST_CHECK_EQUAL(0, buffer.size());
+  BOOST_CHECK(buffer.begin() == buffer.end());
+}
+
+BOOST_AUTO_TEST_CASE(TraversalStackCopy) {
+  TraversalStack<> stack;
+  stack.GetStates().Add(1, 'a', &stack.traversal_stack_payload);
+  stack++;
+  stack.GetStates().Add(2, 'b', &stack.traversal_stack_payload);
+  stack.GetStates().Add(3, 'c', &stack.traversal_stack_payload);
+
+  TraversalStack<> copy(stack);
+  BOOST_CHECK_EQUAL(1, copy.GetDepth());
+  BOOST_CHECK_EQUAL(2, copy.GetStates().size());
+  BOOST_CHECK_EQUAL(2, copy.GetStates().GetNextState());
+  --copy;
+  BOOST_CHECK_EQUAL(1, copy.GetStates().GetNextState());
+
+  TraversalStack<> assigned;
+  assigned = stack;
+  BOOST_CHECK_EQUAL(1, assigned.GetDepth());
+  BOOST_CHECK_EQUAL('b', assigned.GetStates().GetNextTransition());
+
+  // go deeper than the initial depth
+  for (size_t i = 0; i < 2 * TRAVERSAL_STACK_INITIAL_DEPTH; ++i) {
+    stack++;
+    stack.GetStates().Add(i, 'x', &stack.traversal_stack_payload);
+  }
+
+  TraversalStack<> moved(std::move(stack));
+  BOOST_CHECK_EQUAL(2 * TRAVERSAL_STACK_INITIAL_DEPTH + 1, moved.GetDepth());
+  BOOST_CHECK_EQUAL(2 * TRAVERSAL_STACK_INITIAL_DEPTH - 1, moved.GetStates().GetNextState());
+}
+
+BOOST_AUTO_TEST_CASE(TraversalStateArenaReuse) {
+  const TraversalState<Transition>* states_address = nullptr;
+
+  {
+    TraversalStack<> stack;
+    stack.GetStates().Add(42, 'a', &stack.traversal_stack_payload);
+    states_address = stack.traversal_states.data();
+  }
+
+  // the states get re-used, but must be reset
+  TraversalStack<> stack;
+  BOOST_CHECK(states_address == stack.traversal_states.data());
+  BOOST_CHECK_EQUAL(0, stack.GetStates().size());
+  BOOST_CHECK_EQUAL(0, stack.GetStates().GetNextState());
+}
+
+BOOST_AUTO_TEST_CASE(TraversalStateArenaShrink) {
+  {
+    TraversalStack<> stack;
+    for (size_t i = 0; i < 4 * TRAVERSAL_STATE_ARENA_MAX_POOLED_DEPTH; ++i) {
+      stack++;
+    }
+    BOOST_CHECK(stack.traversal_states.size() > TRAVERSAL_STATE_ARENA_MAX_POOLED_DEPTH);
+  }
+
+  // the deep stack got shrunk before it was pooled
+  TraversalStack<> stack;
+  BOOST_CHECK_EQUAL(TRAVERSAL_STATE_ARENA_MAX_POOLED_DEPTH, stack.traversal_states.size());
+  BOOST_CHECK_EQUAL(TRAVERSAL_STATE_ARENA_MAX_POOLED_DEPTH, stack.traversal_states.capacity());
+}
+
+BOOST_AUTO_TEST_CASE(TraversalStackCustomTransitions) {
+  TraversalStack<VectorTransition> stack;
+  stack.GetStates().Add(1, 'a', &stack.traversal_stack_payload);
+  stack.GetStates().Add(2, 'b', &stack.traversal_stack_payload);
+  BOOST_CHECK_EQUAL(2, stack.GetStates().size());
+  BOOST_CHECK_EQUAL(1, stack.GetStates().GetNextState());
+  stack.GetStates()++;
+  BOOST_CHECK_EQUAL('b', stack.GetStates().GetNextTransition());
+
+  TraversalStack<VectorTransition> copy(stack);
+  BOOST_CHECK_EQUAL(2, copy.GetStates().GetNextState());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace traversal */
+} /* namespace fsa */
+} /* namespace dictionary */
+} /* namespace keyvi */
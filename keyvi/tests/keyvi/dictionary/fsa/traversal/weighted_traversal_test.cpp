@@ -58,6 +58,29 @@ BOOST_AUTO_TEST_CASE(PostProcessStableSortEqualWeights) {
   BOOST_CHECK_EQUAL(c, 123);
 }
 
+BOOST_AUTO_TEST_CASE(PostProcessStableSortManyTransitions) {
+  // enough transitions to exceed the insertion sort threshold, with partial and several merge passes
+  for (size_t number_of_transitions : {5, 32, 33, 64, 100, 200, 256}) {
+    TraversalStack<WeightedTransition> traversal_stack;
+
+    for (size_t i = 0; i < number_of_transitions; ++i) {
+      traversal_stack.traversal_states[0].Add(i, (i * 7) % 5, static_cast<unsigned char>(i),
+                                              &traversal_stack.traversal_stack_payload);
+    }
+
+    traversal_stack.traversal_states[0].PostProcess(&traversal_stack.traversal_stack_payload);
+    const auto& transitions = traversal_stack.traversal_states[0].traversal_state_payload.transitions;
+
+    BOOST_CHECK_EQUAL(number_of_transitions, transitions.size());
+    for (size_t i = 1; i < transitions.size(); ++i) {
+      BOOST_CHECK(transitions[i - 1].weight >= transitions[i].weight);
+      if (transitions[i - 1].weight == transitions[i].weight) {
+        BOOST_CHECK(transitions[i - 1].label < transitions[i].label);
+      }
+    }
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } /* namespace traversal*/
@@ -0,0 +1,163 @@
+//
+// keyvi - A key value store.
+//
+// Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/*
+ * match_pool_test.cpp
+ */
+
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "keyvi/dictionary/dictionary.h"
+#include "keyvi/dictionary/match_pool.h"
+#include "keyvi/testing/temp_dictionary.h"
+
+namespace keyvi {
+namespace dictionary {
+BOOST_AUTO_TEST_SUITE(MatchPoolTests)
+
+BOOST_AUTO_TEST_CASE(PrefixCompletionWithPool) {
+  std::vector<std::pair<std::string, uint32_t>> test_data = {
+      {"a very long key to avoid the small string optimization 1", 22},
+      {"a very long key to avoid the small string optimization 2", 24},
+      {"a very long key to avoid the small string optimization 3", 444},
+      {"bar", 200},
+  };
+
+  const testing::TempDictionary dictionary(&test_data);
+  const dictionary_t d(new Dictionary(dictionary.GetFsa()));
+
+  MatchPool pool;
+  std::vector<std::string> expected_matches;
+
+  {
+    MatchPool::Scope scope(&pool);
+    BOOST_CHECK(MatchPool::Current() == &pool);
+
+    for (auto m : d->GetPrefixCompletion("a very")) {
+      expected_matches.push_back(m->GetMatchedString());
+    }
+  }
+  BOOST_CHECK(MatchPool::Current() == nullptr);
+  BOOST_CHECK_EQUAL(3, expected_matches.size());
+  BOOST_CHECK(pool.GetNumberOfPooledMatches() > 0);
+
+  {
+    MatchPool::Scope scope(&pool);
+    size_t pooled_before = pool.GetNumberOfPooledMatches();
+    std::vector<match_t> matches;
+
+    for (auto m : d->GetPrefixCompletion("a very")) {
+      matches.push_back(m);
+    }
+
+    // all matches must come from the pool
+    BOOST_CHECK_EQUAL(pooled_before - matches.size(), pool.GetNumberOfPooledMatches());
+
+    BOOST_CHECK_EQUAL(expected_matches.size(), matches.size());
+    for (size_t i = 0; i < matches.size(); ++i) {
+      BOOST_CHECK_EQUAL(expected_matches[i], matches[i]->GetMatchedString());
+    }
+    BOOST_CHECK_EQUAL(22, matches[0]->GetWeight());
+    BOOST_CHECK_EQUAL("22", std::get<std::string>(matches[0]->GetAttribute("weight")));
+  }
+
+  // re-used match from a lookup
+  {
+    MatchPool::Scope scope(&pool);
+    match_t m = (*d)["bar"];
+    BOOST_CHECK_EQUAL("bar", m->GetMatchedString());
+    BOOST_CHECK_EQUAL(200, m->GetWeight());
+    BOOST_CHECK_EQUAL(0, m->GetScore());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(MatchOutlivesPool) {
+  match_t m;
+  {
+    MatchPool pool(2);
+    m = pool.Make(0, 3, "abc", 5);
+    std::vector<match_t> matches;
+    for (size_t i = 0; i < 10; ++i) {
+      matches.push_back(pool.Make(0, 3, "def"));
+    }
+    matches.clear();
+
+    // only 2 matches are kept
+    BOOST_CHECK_EQUAL(2, pool.GetNumberOfPooledMatches());
+  }
+
+  BOOST_CHECK_EQUAL("abc", m->GetMatchedString());
+  BOOST_CHECK_EQUAL(5, m->GetScore());
+  m.reset();
+}
+
+BOOST_AUTO_TEST_CASE(NestedScopes) {
+  MatchPool outer;
+  MatchPool inner;
+
+  {
+    MatchPool::Scope outer_scope(&outer);
+    {
+      MatchPool::Scope inner_scope(&inner);
+      BOOST_CHECK(MatchPool::Current() == &inner);
+      MakeMatch(0, 1, "a");
+    }
+    BOOST_CHECK(MatchPool::Current() == &outer);
+  }
+
+  BOOST_CHECK_EQUAL(0, outer.GetNumberOfPooledMatches());
+  BOOST_CHECK_EQUAL(1, inner.GetNumberOfPooledMatches());
+}
+
+BOOST_AUTO_TEST_CASE(ReleaseFromOtherThread) {
+  MatchPool pool(4);
+  std::vector<match_t> matches;
+  for (size_t i = 0; i < 3; ++i) {
+    matches.push_back(pool.Make(0, 3, "abc"));
+  }
+
+  // matches released and created by another thread go through the shared free list
+  std::thread other([&matches, &pool]() {
+    matches.clear();
+    match_t m = pool.Make(0, 3, "def");
+    BOOST_CHECK_EQUAL("def", m->GetMatchedString());
+  });
+  other.join();
+
+  BOOST_CHECK_EQUAL(3, pool.GetNumberOfPooledMatches());
+
+  // the owning thread picks them up again
+  for (size_t i = 0; i < 3; ++i) {
+    matches.push_back(pool.Make(0, 3, "ghi"));
+  }
+  BOOST_CHECK_EQUAL(0, pool.GetNumberOfPooledMatches());
+  BOOST_CHECK_EQUAL("ghi", matches[2]->GetMatchedString());
+
+  matches.clear();
+  BOOST_CHECK_EQUAL(3, pool.GetNumberOfPooledMatches());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace dictionary */
+} /* namespace keyvi */
@@ -36,13 +36,16 @@ namespace matching {
 
 BOOST_AUTO_TEST_SUITE(FuzzyMatchingTests)
 
-void test_fuzzy_matching(std::vector<std::pair<std::string, uint32_t>>* test_data, const std::string& query,
-                         size_t max_edit_distance, const std::vector<std::string> expected) {
+template <class DistanceMetricT>
+void test_fuzzy_matching_with_metric(std::vector<std::pair<std::string, uint32_t>>* test_data,
+                                     const std::string& query, size_t max_edit_distance,
+                                     const std::vector<std::string> expected) {
   testing::TempDictionary dictionary(test_data);
 
   // test using weights
-  auto matcher_weights = std::make_shared<matching::FuzzyMatching<>>(
-      matching::FuzzyMatching<>::FromSingleFsa<>(dictionary.GetFsa(), query, max_edit_distance));
+  using fuzzy_matcher_t = matching::FuzzyMatching<fsa::WeightedStateTraverser, DistanceMetricT>;
+  auto matcher_weights = std::make_shared<fuzzy_matcher_t>(
+      fuzzy_matcher_t::template FromSingleFsa<>(dictionary.GetFsa(), query, max_edit_distance));
 
   MatchIterator::MatchIteratorPair it = MatchIterator::MakeIteratorPair(
       [matcher_weights]() { return matcher_weights->NextMatch(); }, std::move(matcher_weights->FirstMatch()));
@@ -57,9 +60,10 @@ void test_fuzzy_matching(std::vector<std::pair<std::string, uint32_t>>* test_dat
   std::vector<std::string> expected_sorted = expected;
   std::sort(expected_sorted.begin(), expected_sorted.end());
 
-  auto matcher_no_weights = std::make_shared<matching::FuzzyMatching<fsa::StateTraverser<>>>(
-      matching::FuzzyMatching<fsa::StateTraverser<>>::FromSingleFsa<fsa::StateTraverser<>>(dictionary.GetFsa(), query,
-                                                                                           max_edit_distance));
+  using fuzzy_matcher_no_weights_t = matching::FuzzyMatching<fsa::StateTraverser<>, DistanceMetricT>;
+  auto matcher_no_weights = std::make_shared<fuzzy_matcher_no_weights_t>(
+      fuzzy_matcher_no_weights_t::template FromSingleFsa<fsa::StateTraverser<>>(dictionary.GetFsa(), query,
+                                                                                max_edit_distance));
   MatchIterator::MatchIteratorPair matcher_no_weights_it = MatchIterator::MakeIteratorPair(
       [matcher_no_weights]() { return matcher_no_weights->NextMatch(); }, std::move(matcher_no_weights->FirstMatch()));
 
@@ -92,9 +96,10 @@ void test_fuzzy_matching(std::vector<std::pair<std::string, uint32_t>>* test_dat
   testing::TempDictionary d3(&test_data_3);
   std::vector<fsa::automata_t> fsas = {d1.GetFsa(), d2.GetFsa(), d3.GetFsa()};
 
-  auto matcher_zipped = std::make_shared<matching::FuzzyMatching<fsa::ZipStateTraverser<fsa::WeightedStateTraverser>>>(
-      matching::FuzzyMatching<fsa::ZipStateTraverser<fsa::WeightedStateTraverser>>::FromMulipleFsas<
-          fsa::WeightedStateTraverser>(fsas, query, max_edit_distance));
+  using zip_fuzzy_matcher_t =
+      matching::FuzzyMatching<fsa::ZipStateTraverser<fsa::WeightedStateTraverser>, DistanceMetricT>;
+  auto matcher_zipped = std::make_shared<zip_fuzzy_matcher_t>(
+      zip_fuzzy_matcher_t::template FromMulipleFsas<fsa::WeightedStateTraverser>(fsas, query, max_edit_distance));
   MatchIterator::MatchIteratorPair matcher_zipped_it = MatchIterator::MakeIteratorPair(
       [matcher_zipped]() { return matcher_zipped->NextMatch(); }, std::move(matcher_zipped->FirstMatch()));
   expected_it = expected.begin();
@@ -104,10 +109,11 @@ void test_fuzzy_matching(std::vector<std::pair<std::string, uint32_t>>* test_dat
   }
   BOOST_CHECK(expected_it == expected.end());
 
-  auto matcher_zipped_no_weights =
-      std::make_shared<matching::FuzzyMatching<fsa::ZipStateTraverser<fsa::StateTraverser<>>>>(
-          matching::FuzzyMatching<fsa::ZipStateTraverser<fsa::StateTraverser<>>>::FromMulipleFsas<
-              fsa::StateTraverser<>>(fsas, query, max_edit_distance));
+  using zip_fuzzy_matcher_no_weights_t =
+      matching::FuzzyMatching<fsa::ZipStateTraverser<fsa::StateTraverser<>>, DistanceMetricT>;
+  auto matcher_zipped_no_weights = std::make_shared<zip_fuzzy_matcher_no_weights_t>(
+      zip_fuzzy_matcher_no_weights_t::template FromMulipleFsas<fsa::StateTraverser<>>(fsas, query,
+                                                                                        max_edit_distance));
   MatchIterator::MatchIteratorPair matcher_zipped_no_weights_it =
       MatchIterator::MakeIteratorPair([matcher_zipped_no_weights]() { return matcher_zipped_no_weights->NextMatch(); },
                                       std::move(matcher_zipped_no_weights->FirstMatch()));
@@ -119,6 +125,26 @@ void test_fuzzy_matching(std::vector<std::pair<std::string, uint32_t>>* test_dat
   BOOST_CHECK(expected_it == expected_sorted.end());
 }
 
+void test_fuzzy_matching(std::vector<std::pair<std::string, uint32_t>>* test_data, const std::string& query,
+                         size_t max_edit_distance, const std::vector<std::string> expected) {
+  test_fuzzy_matching_with_metric<stringdistance::Levenshtein>(test_data, query, max_edit_distance, expected);
+  test_fuzzy_matching_with_metric<stringdistance::BitParallelLevenshtein>(test_data, query, max_edit_distance,
+                                                                          expected);
+
+  // the dictionary api
+  testing::TempDictionary dictionary(test_data);
+  dictionary_t d(new Dictionary(dictionary.GetFsa()));
+
+  for (auto strategy : {fuzzy_strategy_t::NEEDLEMAN_WUNSCH, fuzzy_strategy_t::BIT_PARALLEL}) {
+    auto expected_it = expected.begin();
+    for (auto m : d->GetFuzzy(query, max_edit_distance, 2, strategy)) {
+      BOOST_REQUIRE(expected_it != expected.end());
+      BOOST_CHECK_EQUAL(*expected_it++, m->GetMatchedString());
+    }
+    BOOST_CHECK(expected_it == expected.end());
+  }
+}
+
 BOOST_AUTO_TEST_CASE(fuzzy_0) {
   std::vector<std::pair<std::string, uint32_t>> test_data = {
       {"türkei news", 23698},
@@ -0,0 +1,227 @@
+/* * keyvi - A key value store.
+ *
+ * Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "keyvi/dictionary/matching/nearest_neighbor_matching.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "keyvi/dictionary/dictionary.h"
+#include "keyvi/dictionary/dictionary_types.h"
+#include "keyvi/dictionary/match_iterator.h"
+#include "keyvi/dictionary/matching/prefix_completion_matching.h"
+#include "keyvi/testing/temp_dictionary.h"
+
+namespace keyvi {
+namespace dictionary {
+namespace matching {
+
+BOOST_AUTO_TEST_SUITE(NearestNeighborMatchingTests)
+
+using keyvi::util::float_vector_distance_t;
+
+std::vector<std::pair<std::string, std::vector<float>>> GenerateRandomVectors(size_t count, size_t dimensions,
+                                                                              std::mt19937* generator) {
+  std::uniform_int_distribution<int> length_distribution(1, 8);
+  std::uniform_int_distribution<int> char_distribution('a', 'f');
+  std::uniform_real_distribution<float> float_distribution(-1.0, 1.0);
+
+  std::map<std::string, std::vector<float>> unique_keys;
+  while (unique_keys.size() < count) {
+    std::string key;
+    for (int i = length_distribution(*generator); i > 0; --i) {
+      key.push_back(static_cast<char>(char_distribution(*generator)));
+    }
+    std::vector<float> vector(dimensions);
+    for (auto& f : vector) {
+      f = float_distribution(*generator);
+    }
+    unique_keys.emplace(key, vector);
+  }
+
+  return std::vector<std::pair<std::string, std::vector<float>>>(unique_keys.begin(), unique_keys.end());
+}
+
+// brute force reference: (rank, key) pairs, best first
+std::vector<std::pair<double, std::string>> BruteForce(
+    const std::vector<std::pair<std::string, std::vector<float>>>& input, const std::vector<float>& query, size_t k,
+    float_vector_distance_t distance) {
+  std::vector<std::pair<double, std::string>> expected;
+  for (const auto& entry : input) {
+    double dot = 0, candidate_norm = 0, query_norm = 0, squared_distance = 0;
+    for (size_t i = 0; i < query.size(); ++i) {
+      dot += static_cast<double>(query[i]) * entry.second[i];
+      candidate_norm += static_cast<double>(entry.second[i]) * entry.second[i];
+      query_norm += static_cast<double>(query[i]) * query[i];
+      squared_distance += (static_cast<double>(query[i]) - entry.second[i]) * (query[i] - entry.second[i]);
+    }
+    double rank = 0;
+    switch (distance) {
+      case float_vector_distance_t::DOT_PRODUCT:
+        rank = dot;
+        break;
+      case float_vector_distance_t::COSINE:
+        rank = dot / std::sqrt(candidate_norm * query_norm);
+        break;
+      case float_vector_distance_t::EUCLIDEAN:
+        rank = -std::sqrt(squared_distance);
+        break;
+    }
+    expected.emplace_back(rank, entry.first);
+  }
+
+  std::sort(expected.begin(), expected.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+  expected.resize(std::min(k, expected.size()));
+  return expected;
+}
+
+void CheckResults(const std::vector<std::pair<double, std::string>>& expected, NearestNeighborMatching&& matcher,
+                  float_vector_distance_t distance) {
+  MatcherRange<NearestNeighborMatching> range(std::move(matcher));
+  size_t i = 0;
+  for (const auto& m : range) {
+    BOOST_REQUIRE(i < expected.size());
+    const double rank = distance == float_vector_distance_t::EUCLIDEAN ? -m->GetScore() : m->GetScore();
+    BOOST_CHECK_SMALL(std::abs(expected[i].first - rank), 1e-4);
+    // keys can only differ if the scores are (almost) equal
+    if (expected[i].second != m->GetMatchedString()) {
+      BOOST_CHECK_SMALL(std::abs(expected[i].first - rank), 1e-5);
+    }
+    ++i;
+  }
+  BOOST_CHECK_EQUAL(expected.size(), i);
+}
+
+BOOST_AUTO_TEST_CASE(nearest_neighbors) {
+  std::vector<std::pair<std::string, std::vector<float>>> test_data = {
+      {"aa", {1.0, 0.0, 0.0}}, {"ab", {0.0, 1.0, 0.0}}, {"b", {0.7, 0.7, 0.0}}, {"ca", {-1.0, 0.0, 0.0}}};
+  testing::TempDictionary dictionary = testing::TempDictionary::makeTempDictionaryFromFloats(&test_data);
+
+  MatcherRange<NearestNeighborMatching> matcher(
+      NearestNeighborMatching::FromSingleFsa(dictionary.GetFsa(), {1.0, 0.1, 0.0}, 2));
+
+  std::vector<std::string> results;
+  for (const auto& m : matcher) {
+    results.push_back(m->GetMatchedString());
+    std::vector<float> buffer;
+    size_t dimensions;
+    m->GetFloatVector(&dimensions, &buffer);
+    BOOST_CHECK_EQUAL(3, dimensions);
+  }
+
+  const std::vector<std::string> expected = {"aa", "b"};
+  BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), results.begin(), results.end());
+
+  MatcherRange<NearestNeighborMatching> empty(
+      NearestNeighborMatching::FromSingleFsa(dictionary.GetFsa(), {1.0, 0.1, 0.0}, 0));
+  BOOST_CHECK(empty.begin() == empty.end());
+
+  BOOST_CHECK_THROW(NearestNeighborMatching::FromSingleFsa(dictionary.GetFsa(), {1.0, 0.1}, 2), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(nearest_neighbors_random) {
+  std::mt19937 generator(42);
+  auto test_data = GenerateRandomVectors(2000, 37, &generator);
+  auto input = test_data;
+  testing::TempDictionary dictionary = testing::TempDictionary::makeTempDictionaryFromFloats(&input);
+
+  std::uniform_real_distribution<float> float_distribution(-1.0, 1.0);
+  for (auto distance :
+       {float_vector_distance_t::DOT_PRODUCT, float_vector_distance_t::COSINE, float_vector_distance_t::EUCLIDEAN}) {
+    for (size_t threads : {1, 4}) {
+      for (size_t k : {1, 10, 3000}) {
+        std::vector<float> query(37);
+        for (auto& f : query) {
+          f = float_distribution(generator);
+        }
+        CheckResults(BruteForce(test_data, query, k, distance),
+                     NearestNeighborMatching::FromSingleFsa(dictionary.GetFsa(), query, k, distance, threads),
+                     distance);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(nearest_neighbors_compressed) {
+  std::mt19937 generator(7);
+  auto test_data = GenerateRandomVectors(200, 16, &generator);
+
+  DictionaryCompiler<dictionary_type_t::FLOAT_VECTOR> compiler(
+      keyvi::util::parameters_t({{"memory_limit_mb", "10"}, {VECTOR_SIZE_KEY, "16"}, {"compression", "zlib"}}));
+  for (const auto& entry : test_data) {
+    compiler.Add(entry.first, entry.second);
+  }
+  compiler.Compile();
+
+  boost::filesystem::path temp_path = boost::filesystem::temp_directory_path();
+  temp_path /= boost::filesystem::unique_path("dictionary-unit-test-nearest-neighbor-%%%%-%%%%-%%%%-%%%%");
+  const std::string file_name = temp_path.string();
+  compiler.WriteToFile(file_name);
+
+  {
+    Dictionary d(file_name);
+    std::vector<float> query(test_data[0].second);
+    auto expected = BruteForce(test_data, query, 5, float_vector_distance_t::EUCLIDEAN);
+
+    std::vector<std::string> results;
+    for (const auto& m : d.GetNearestNeighbors(query, 5, float_vector_distance_t::EUCLIDEAN, 2)) {
+      results.push_back(m->GetMatchedString());
+    }
+    BOOST_REQUIRE_EQUAL(5, results.size());
+    BOOST_CHECK_EQUAL(test_data[0].first, results[0]);
+    for (size_t i = 0; i < results.size(); ++i) {
+      BOOST_CHECK_EQUAL(expected[i].second, results[i]);
+    }
+  }
+
+  BOOST_CHECK(std::remove(file_name.c_str()) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(rerank_matches) {
+  std::mt19937 generator(11);
+  auto test_data = GenerateRandomVectors(500, 8, &generator);
+  auto input = test_data;
+  testing::TempDictionary dictionary = testing::TempDictionary::makeTempDictionaryFromFloats(&input);
+
+  std::vector<std::pair<std::string, std::vector<float>>> candidates;
+  std::copy_if(test_data.begin(), test_data.end(), std::back_inserter(candidates),
+               [](const auto& entry) { return entry.first.rfind("ab", 0) == 0; });
+  BOOST_REQUIRE(candidates.size() > 0);
+
+  std::vector<float> query(8, 0.5);
+  auto prefix_matches = MatcherRange<PrefixCompletionMatching<>>(
+      PrefixCompletionMatching<>::FromSingleFsa(dictionary.GetFsa(), "ab"));
+
+  CheckResults(BruteForce(candidates, query, 7, float_vector_distance_t::COSINE),
+               NearestNeighborMatching::FromMatches(prefix_matches, query, 7, float_vector_distance_t::COSINE),
+               float_vector_distance_t::COSINE);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace matching */
+} /* namespace dictionary */
+} /* namespace keyvi */
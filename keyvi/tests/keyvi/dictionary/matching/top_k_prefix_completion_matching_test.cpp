@@ -0,0 +1,199 @@
+/* * keyvi - A key value store.
+ *
+ * Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "keyvi/dictionary/matching/top_k_prefix_completion_matching.h"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "keyvi/dictionary/match_iterator.h"
+#include "keyvi/testing/temp_dictionary.h"
+
+namespace keyvi {
+namespace dictionary {
+namespace matching {
+
+BOOST_AUTO_TEST_SUITE(TopKPrefixCompletionMatchingTests)
+
+std::vector<std::pair<std::string, uint32_t>> GetTopK(const fsa::automata_t& fsa, const std::string& query, size_t k,
+                                                      uint32_t min_weight = 0) {
+  MatcherRange<TopKPrefixCompletionMatching> matcher(TopKPrefixCompletionMatching::FromSingleFsa(fsa, query, k));
+  matcher.SetMinWeight(min_weight);
+
+  std::vector<std::pair<std::string, uint32_t>> results;
+  for (const auto& m : matcher) {
+    results.emplace_back(m->GetMatchedString(), m->GetWeight());
+  }
+  return results;
+}
+
+BOOST_AUTO_TEST_CASE(top_k) {
+  std::vector<std::pair<std::string, uint32_t>> test_data = {
+      {"aa", 100},    {"aaaa", 1000}, {"aabb", 1001}, {"aabc", 1002},
+      {"aacd", 1030}, {"abcd", 10},   {"bbcd", 1040},
+  };
+  testing::TempDictionary dictionary(&test_data);
+
+  auto results = GetTopK(dictionary.GetFsa(), "aa", 3);
+  BOOST_REQUIRE_EQUAL(3, results.size());
+  BOOST_CHECK_EQUAL("aacd", results[0].first);
+  BOOST_CHECK_EQUAL(1030, results[0].second);
+  BOOST_CHECK_EQUAL("aabc", results[1].first);
+  BOOST_CHECK_EQUAL("aabb", results[2].first);
+
+  // the exact match is returned according to its weight
+  results = GetTopK(dictionary.GetFsa(), "aa", 10);
+  BOOST_REQUIRE_EQUAL(5, results.size());
+  BOOST_CHECK_EQUAL("aa", results[4].first);
+
+  results = GetTopK(dictionary.GetFsa(), "", 2);
+  BOOST_REQUIRE_EQUAL(2, results.size());
+  BOOST_CHECK_EQUAL("bbcd", results[0].first);
+  BOOST_CHECK_EQUAL("aacd", results[1].first);
+
+  results = GetTopK(dictionary.GetFsa(), "aa", 10, 1002);
+  BOOST_REQUIRE_EQUAL(2, results.size());
+  BOOST_CHECK_EQUAL("aacd", results[0].first);
+  BOOST_CHECK_EQUAL("aabc", results[1].first);
+
+  BOOST_CHECK_EQUAL(0, GetTopK(dictionary.GetFsa(), "aa", 0).size());
+  BOOST_CHECK_EQUAL(0, GetTopK(dictionary.GetFsa(), "c", 3).size());
+  BOOST_CHECK_EQUAL(1, GetTopK(dictionary.GetFsa(), "abcd", 3).size());
+}
+
+BOOST_AUTO_TEST_CASE(top_k_random) {
+  std::mt19937 generator(7);
+  std::uniform_int_distribution<size_t> length_distribution(1, 45);
+  std::uniform_int_distribution<int> char_distribution('a', 'd');
+  std::uniform_int_distribution<uint32_t> weight_distribution(1, 100000);
+
+  // long keys, to get below the depth inner weights are stored for
+  std::map<std::string, uint32_t> unique_keys;
+  for (size_t i = 0; i < 2000; ++i) {
+    std::string key;
+    const size_t length = length_distribution(generator);
+    for (size_t j = 0; j < length; ++j) {
+      key.push_back(static_cast<char>(char_distribution(generator)));
+    }
+    unique_keys.emplace(key, weight_distribution(generator));
+  }
+
+  std::vector<std::pair<std::string, uint32_t>> test_data(unique_keys.begin(), unique_keys.end());
+  testing::TempDictionary dictionary(&test_data);
+
+  for (const std::string query : {"", "a", "ab", "abc", "dddd", "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"}) {
+    std::vector<uint32_t> expected_weights;
+    for (const auto& entry : unique_keys) {
+      if (entry.first.compare(0, query.size(), query) == 0) {
+        expected_weights.push_back(entry.second);
+      }
+    }
+    std::sort(expected_weights.begin(), expected_weights.end(), std::greater<uint32_t>());
+
+    for (size_t k : {1, 5, 50}) {
+      auto results = GetTopK(dictionary.GetFsa(), query, k);
+      BOOST_REQUIRE_EQUAL(std::min(k, expected_weights.size()), results.size());
+
+      for (size_t i = 0; i < results.size(); ++i) {
+        BOOST_CHECK_EQUAL(expected_weights[i], results[i].second);
+        BOOST_CHECK_EQUAL(unique_keys[results[i].first], results[i].second);
+        BOOST_CHECK_EQUAL(0, results[i].first.compare(0, query.size(), query));
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(top_k_multiple_fsas) {
+  std::mt19937 generator(11);
+  std::uniform_int_distribution<size_t> length_distribution(1, 8);
+  std::uniform_int_distribution<int> char_distribution('a', 'c');
+  std::uniform_int_distribution<uint32_t> weight_distribution(1, 1000);
+
+  // the newest fsa wins for duplicate keys
+  std::map<std::string, uint32_t> merged_keys;
+  std::vector<std::unique_ptr<testing::TempDictionary>> dictionaries;
+  std::vector<fsa::automata_t> fsas;
+
+  for (size_t i = 0; i < 3; ++i) {
+    std::map<std::string, uint32_t> unique_keys;
+    for (size_t j = 0; j < 300; ++j) {
+      std::string key;
+      const size_t length = length_distribution(generator);
+      for (size_t l = 0; l < length; ++l) {
+        key.push_back(static_cast<char>(char_distribution(generator)));
+      }
+      unique_keys.emplace(key, weight_distribution(generator));
+    }
+
+    for (const auto& entry : unique_keys) {
+      merged_keys[entry.first] = entry.second;
+    }
+
+    std::vector<std::pair<std::string, uint32_t>> test_data(unique_keys.begin(), unique_keys.end());
+    dictionaries.emplace_back(new testing::TempDictionary(&test_data));
+    fsas.push_back(dictionaries.back()->GetFsa());
+  }
+
+  for (const std::string query : {"", "a", "bc", "cab"}) {
+    std::vector<uint32_t> expected_weights;
+    for (const auto& entry : merged_keys) {
+      if (entry.first.compare(0, query.size(), query) == 0) {
+        expected_weights.push_back(entry.second);
+      }
+    }
+    std::sort(expected_weights.begin(), expected_weights.end(), std::greater<uint32_t>());
+
+    for (size_t k : {1, 10, 1000}) {
+      MatcherRange<TopKPrefixCompletionMatching> matcher(TopKPrefixCompletionMatching::FromMulipleFsas(fsas, query, k));
+
+      size_t i = 0;
+      for (const auto& m : matcher) {
+        BOOST_REQUIRE(i < expected_weights.size());
+        BOOST_CHECK_EQUAL(expected_weights[i++], m->GetWeight());
+        BOOST_CHECK_EQUAL(merged_keys[m->GetMatchedString()], m->GetWeight());
+      }
+      BOOST_CHECK_EQUAL(std::min(k, expected_weights.size()), i);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(top_k_no_weights) {
+  std::vector<std::string> test_data = {"aa", "aab", "aabc", "aac", "b"};
+  testing::TempDictionary dictionary(&test_data);
+
+  auto results = GetTopK(dictionary.GetFsa(), "aa", 3);
+  BOOST_REQUIRE_EQUAL(3, results.size());
+
+  // without weights shorter keys come first
+  BOOST_CHECK_EQUAL("aa", results[0].first);
+  BOOST_CHECK_EQUAL("aab", results[1].first);
+  BOOST_CHECK_EQUAL("aac", results[2].first);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace matching */
+} /* namespace dictionary */
+} /* namespace keyvi */
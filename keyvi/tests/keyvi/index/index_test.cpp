@@ -25,6 +25,8 @@
 
 #include <chrono>  //NOLINT
 #include <cstdlib>
+#include <map>
+#include <string>
 #include <thread>  //NOLINT
 
 #include <boost/filesystem.hpp>
@@ -106,6 +108,10 @@ BOOST_AUTO_TEST_CASE(basic_writer_simple_merge_policy) {
   basic_writer_test({{KEYVIMERGER_BIN, get_keyvimerger_bin()}, {MERGE_POLICY, "simple"}});
 }
 
+BOOST_AUTO_TEST_CASE(basic_writer_writer_threads) {
+  basic_writer_test({{KEYVIMERGER_BIN, get_keyvimerger_bin()}, {INDEX_WRITER_THREADS, "4"}});
+}
+
 void basic_writer_bulk_test(const keyvi::util::parameters_t& params = keyvi::util::parameters_t()) {
   using boost::filesystem::temp_directory_path;
   using boost::filesystem::unique_path;
@@ -170,6 +176,10 @@ BOOST_AUTO_TEST_CASE(basic_writer_bulk_simple_merge_policy) {
   basic_writer_bulk_test({{KEYVIMERGER_BIN, get_keyvimerger_bin()}, {MERGE_POLICY, "simple"}});
 }
 
+BOOST_AUTO_TEST_CASE(basic_writer_bulk_writer_threads) {
+  basic_writer_bulk_test({{KEYVIMERGER_BIN, get_keyvimerger_bin()}, {INDEX_WRITER_THREADS, "4"}});
+}
+
 void bigger_feed_test(const keyvi::util::parameters_t& params = keyvi::util::parameters_t()) {
   using boost::filesystem::temp_directory_path;
   using boost::filesystem::unique_path;
@@ -215,6 +225,13 @@ BOOST_AUTO_TEST_CASE(bigger_feed_simple_merge_policy) {
                     {MERGE_POLICY, "simple"}});
 }
 
+BOOST_AUTO_TEST_CASE(bigger_feed_writer_threads) {
+  bigger_feed_test({{"refresh_interval", "100"},
+                    {KEYVIMERGER_BIN, get_keyvimerger_bin()},
+                    {"max_concurrent_merges", "2"},
+                    {INDEX_WRITER_THREADS, "4"}});
+}
+
 BOOST_AUTO_TEST_CASE(index_reopen) {
   using boost::filesystem::temp_directory_path;
   using boost::filesystem::unique_path;
@@ -371,6 +388,249 @@ BOOST_AUTO_TEST_CASE(index_delete_keys_simple_merge_policy) {
   index_with_deletes({{"refresh_interval", "100"}, {KEYVIMERGER_BIN, get_keyvimerger_bin()}, {MERGE_POLICY, "simple"}});
 }
 
+BOOST_AUTO_TEST_CASE(index_delete_keys_writer_threads) {
+  index_with_deletes(
+      {{"refresh_interval", "100"}, {KEYVIMERGER_BIN, get_keyvimerger_bin()}, {INDEX_WRITER_THREADS, "4"}});
+}
+
+BOOST_AUTO_TEST_CASE(writer_threads_last_write_wins) {
+  using boost::filesystem::temp_directory_path;
+  using boost::filesystem::unique_path;
+
+  auto tmp_path = temp_directory_path();
+  tmp_path /= unique_path("index-test-temp-index-%%%%-%%%%-%%%%-%%%%");
+  {
+    Index index(tmp_path.string(), {{"refresh_interval", "100"},
+                                    {KEYVIMERGER_BIN, get_keyvimerger_bin()},
+                                    {SEGMENT_COMPILE_KEY_THRESHOLD, "500"},
+                                    {INDEX_WRITER_THREADS, "4"}});
+
+    // overwrite and delete keys of all shards in rounds, segments get compiled in between
+    for (int round = 0; round < 5; ++round) {
+      for (int i = 0; i < 200; ++i) {
+        index.Set("k" + std::to_string(i), "{\"round\":" + std::to_string(round) + "}");
+      }
+      for (int i = round; i < 200; i += 7) {
+        index.Delete("k" + std::to_string(i));
+      }
+      if (round % 2 == 0) {
+        index.Flush(true);
+      }
+    }
+    index.Flush();
+
+    for (int i = 0; i < 200; ++i) {
+      const std::string key = "k" + std::to_string(i);
+      if (i >= 4 && (i - 4) % 7 == 0) {
+        BOOST_CHECK(!index.Contains(key));
+      } else {
+        BOOST_CHECK(index.Contains(key));
+        BOOST_CHECK_EQUAL("{\"round\":4}", index[key]->GetValueAsString());
+      }
+    }
+  }
+
+  boost::filesystem::remove_all(tmp_path);
+}
+
+// collect matches as key -> value
+std::map<std::string, std::string> collect_matches(const dictionary::MatchIterator::MatchIteratorPair& matches) {
+  std::map<std::string, std::string> result;
+  for (auto m : matches) {
+    BOOST_CHECK(result.count(m->GetMatchedString()) == 0);
+    result[m->GetMatchedString()] = m->GetValueAsString();
+  }
+  return result;
+}
+
+void memtable_test(const keyvi::util::parameters_t& params) {
+  using boost::filesystem::temp_directory_path;
+  using boost::filesystem::unique_path;
+
+  auto tmp_path = temp_directory_path();
+  tmp_path /= unique_path("index-test-temp-index-%%%%-%%%%-%%%%-%%%%");
+  {
+    Index index(tmp_path.string(), params);
+
+    index.Set("abc", "{\"id\":1}");
+    index.Set("abcd", "{\"id\":2}");
+    index.Set("abde", "{\"id\":3}");
+    index.Set("bcd", "{\"id\":4}");
+
+    // nothing compiled yet, reads are served from the memtables
+    BOOST_CHECK_EQUAL(0, unit_test::IndexFriend::GetSegments(&index)->size());
+    BOOST_CHECK(index.Contains("abc"));
+    BOOST_CHECK(!index.Contains("ab"));
+    BOOST_CHECK_EQUAL("{\"id\":2}", index["abcd"]->GetValueAsString());
+    BOOST_CHECK(!index["abcde"]);
+
+    std::map<std::string, std::string> near = collect_matches(index.GetNear("abcx", 2, false));
+    BOOST_CHECK_EQUAL(2, near.size());
+    BOOST_CHECK_EQUAL("{\"id\":1}", near["abc"]);
+    BOOST_CHECK_EQUAL("{\"id\":2}", near["abcd"]);
+    BOOST_CHECK_EQUAL(3, collect_matches(index.GetNear("abcx", 2, true)).size());
+
+    std::map<std::string, std::string> fuzzy = collect_matches(index.GetFuzzy("abce", 1, 2));
+    BOOST_CHECK_EQUAL(3, fuzzy.size());
+    BOOST_CHECK_EQUAL("{\"id\":3}", fuzzy["abde"]);
+
+    index.Delete("abcd");
+    BOOST_CHECK(!index.Contains("abcd"));
+    BOOST_CHECK(!index["abcd"]);
+    BOOST_CHECK_EQUAL(2, collect_matches(index.GetNear("abcx", 2, true)).size());
+
+    index.Flush();
+    BOOST_CHECK(unit_test::IndexFriend::GetSegments(&index)->size() > 0);
+    BOOST_CHECK(!index.Contains("abcd"));
+    BOOST_CHECK_EQUAL("{\"id\":3}", index["abde"]->GetValueAsString());
+
+    // newer writes shadow the segments
+    index.Set("abde", "{\"id\":5}");
+    index.Set("abcd", "{\"id\":6}");
+    index.Delete("abc");
+    BOOST_CHECK(!index.Contains("abc"));
+    BOOST_CHECK_EQUAL("{\"id\":5}", index["abde"]->GetValueAsString());
+
+    near = collect_matches(index.GetNear("abcx", 2, true));
+    BOOST_CHECK_EQUAL(2, near.size());
+    BOOST_CHECK_EQUAL("{\"id\":5}", near["abde"]);
+    BOOST_CHECK_EQUAL("{\"id\":6}", near["abcd"]);
+
+    fuzzy = collect_matches(index.GetFuzzy("abce", 1, 2));
+    BOOST_CHECK_EQUAL(2, fuzzy.size());
+    BOOST_CHECK_EQUAL("{\"id\":5}", fuzzy["abde"]);
+    BOOST_CHECK_EQUAL("{\"id\":6}", fuzzy["abcd"]);
+
+    index.Flush();
+    BOOST_CHECK(!index.Contains("abc"));
+    BOOST_CHECK_EQUAL("{\"id\":5}", index["abde"]->GetValueAsString());
+    near = collect_matches(index.GetNear("abcx", 2, true));
+    BOOST_CHECK_EQUAL(2, near.size());
+    BOOST_CHECK_EQUAL("{\"id\":6}", near["abcd"]);
+
+    // the best near match is in a segment, the memtable match with a shorter prefix is dropped
+    index.Set("abxy", "{\"id\":7}");
+    near = collect_matches(index.GetNear("abcx", 2, false));
+    BOOST_CHECK_EQUAL(1, near.size());
+    BOOST_CHECK_EQUAL("{\"id\":6}", near["abcd"]);
+
+    auto near_matches = index.GetNear("abcx", 2, true);
+    BOOST_REQUIRE(near_matches.begin() != near_matches.end());
+    BOOST_CHECK_EQUAL("abcd", (*near_matches.begin())->GetMatchedString());
+    BOOST_CHECK_EQUAL(3, collect_matches(index.GetNear("abcx", 2, true)).size());
+
+    // prefix completion returns the newest values and skips deleted keys
+    index.Set("abde", "{\"id\":8}");
+    index.Delete("abcd");
+    std::map<std::string, std::string> completions = collect_matches(index.GetPrefixCompletion("ab", 10));
+    BOOST_CHECK_EQUAL(2, completions.size());
+    BOOST_CHECK_EQUAL("{\"id\":7}", completions["abxy"]);
+    BOOST_CHECK_EQUAL("{\"id\":8}", completions["abde"]);
+    BOOST_CHECK_EQUAL(1, collect_matches(index.GetPrefixCompletion("ab", 1)).size());
+    BOOST_CHECK_EQUAL(1, collect_matches(index.GetPrefixCompletion("b", 10)).size());
+  }
+
+  boost::filesystem::remove_all(tmp_path);
+}
+
+BOOST_AUTO_TEST_CASE(memtable_read_your_writes) {
+  memtable_test({{"refresh_interval", "100000"}, {KEYVIMERGER_BIN, get_keyvimerger_bin()}});
+}
+
+BOOST_AUTO_TEST_CASE(memtable_read_your_writes_writer_threads) {
+  memtable_test(
+      {{"refresh_interval", "100000"}, {KEYVIMERGER_BIN, get_keyvimerger_bin()}, {INDEX_WRITER_THREADS, "3"}});
+}
+
+BOOST_AUTO_TEST_CASE(memtable_delete_across_refresh) {
+  using boost::filesystem::temp_directory_path;
+  using boost::filesystem::unique_path;
+
+  auto tmp_path = temp_directory_path();
+  tmp_path /= unique_path("index-test-temp-index-%%%%-%%%%-%%%%-%%%%");
+  {
+    Index index(tmp_path.string(), {{"refresh_interval", "50"}, {KEYVIMERGER_BIN, get_keyvimerger_bin()}});
+
+    index.Set("abc", "{\"id\":1}");
+    index.Set("abd", "{\"id\":2}");
+    index.Flush();
+    BOOST_CHECK(index.Contains("abc"));
+
+    // the key is in a segment, the delete must stay visible while scheduled compiles trim the memtable
+    index.Delete("abc");
+    const auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+    while (std::chrono::steady_clock::now() < end) {
+      BOOST_REQUIRE(!index.Contains("abc"));
+      BOOST_REQUIRE(!index["abc"]);
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    BOOST_CHECK(index.Contains("abd"));
+  }
+
+  boost::filesystem::remove_all(tmp_path);
+}
+
+void key_filter_test(const keyvi::util::parameters_t& params) {
+  using boost::filesystem::temp_directory_path;
+  using boost::filesystem::unique_path;
+
+  auto tmp_path = temp_directory_path();
+  tmp_path /= unique_path("index-test-temp-index-%%%%-%%%%-%%%%-%%%%");
+  {
+    Index index(tmp_path.string(), params);
+
+    for (int i = 0; i < 5; ++i) {
+      key_values_ptr_t input_data = std::make_shared<key_value_vector_t>();
+      for (int j = 0; j < 100; ++j) {
+        const std::string id = std::to_string(i * 100 + j);
+        input_data->push_back({"key" + id, "{\"id\":" + id + "}"});
+      }
+      index.MSet(input_data);
+      index.Flush();
+    }
+
+    // every segment is compiled with a filter
+    for (const auto& segment : *unit_test::IndexFriend::GetSegments(&index)) {
+      BOOST_CHECK(boost::filesystem::exists(segment->GetKeyFilterPath()));
+    }
+
+    index.ForceMerge();
+
+    // readers might still hold the segments before the merge for a short time
+    internal::segments_t segments = unit_test::IndexFriend::GetSegments(&index);
+    for (int retries = 0; segments->size() > 1 && retries < 1000; ++retries) {
+      segments.reset();
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      segments = unit_test::IndexFriend::GetSegments(&index);
+    }
+    BOOST_CHECK_EQUAL(1, segments->size());
+    BOOST_CHECK(boost::filesystem::exists((*segments)[0]->GetKeyFilterPath()));
+
+    for (int i = 0; i < 500; ++i) {
+      const std::string id = std::to_string(i);
+      BOOST_CHECK((*segments)[0]->MayContain(internal::KeyFilter::Hash("key" + id)));
+      BOOST_CHECK(index.Contains("key" + id));
+      BOOST_CHECK_EQUAL("{\"id\":" + id + "}", index["key" + id]->GetValueAsString());
+    }
+    BOOST_CHECK(!index.Contains("key500"));
+    BOOST_CHECK(!index["key500"]);
+
+    index.Delete("key42");
+    index.Flush();
+    BOOST_CHECK(!index.Contains("key42"));
+  }
+
+  boost::filesystem::remove_all(tmp_path);
+}
+
+BOOST_AUTO_TEST_CASE(key_filter) {
+  key_filter_test({{KEYVIMERGER_BIN, get_keyvimerger_bin()}});
+}
+
+BOOST_AUTO_TEST_CASE(key_filter_external_merge) {
+  key_filter_test({{KEYVIMERGER_BIN, get_keyvimerger_bin()}, {SEGMENT_EXTERNAL_MERGE_KEY_THRESHOLD, "0"}});
+}
+
 BOOST_AUTO_TEST_CASE(segment_invalidation) {
   using boost::filesystem::temp_directory_path;
   using boost::filesystem::unique_path;
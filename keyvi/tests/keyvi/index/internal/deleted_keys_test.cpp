@@ -0,0 +1,174 @@
+//
+// keyvi - A key value store.
+//
+// Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/*
+ * deleted_keys_test.cpp
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <msgpack.hpp>
+
+#include "keyvi/index/internal/deleted_keys.h"
+
+namespace keyvi {
+namespace index {
+namespace internal {
+
+BOOST_AUTO_TEST_SUITE(DeletedKeysTests)
+
+static boost::filesystem::path CreateTempPath() {
+  boost::filesystem::path filename = boost::filesystem::temp_directory_path();
+  filename /= boost::filesystem::unique_path("deleted-keys-test-%%%%-%%%%-%%%%-%%%%.dk");
+  return filename;
+}
+
+BOOST_AUTO_TEST_CASE(write_and_merge) {
+  boost::filesystem::path filename = CreateTempPath();
+  boost::filesystem::path swap_filename = filename;
+  swap_filename += "-swap";
+
+  DeletedKeys::Write({filename}, std::set<std::string>{"def", "abc"}, filename, swap_filename);
+
+  {
+    DeletedKeys deleted_keys({filename});
+    BOOST_CHECK_EQUAL(2, deleted_keys.size());
+    BOOST_CHECK_EQUAL(1, deleted_keys.count("abc"));
+    BOOST_CHECK_EQUAL(1, deleted_keys.count("def"));
+    BOOST_CHECK_EQUAL(0, deleted_keys.count("ab"));
+    BOOST_CHECK_EQUAL(0, deleted_keys.count("abcd"));
+  }
+
+  // merge new keys into the existing file, duplicates are removed
+  BOOST_CHECK_EQUAL(4, DeletedKeys::Write({filename}, std::set<std::string>{"abc", "bcd", "xyz"}, filename,
+                                          swap_filename));
+  BOOST_CHECK_EQUAL(4, DeletedKeys::NumberOfKeys(filename));
+  BOOST_CHECK_EQUAL(0, DeletedKeys::NumberOfKeys(CreateTempPath()));
+
+  {
+    DeletedKeys deleted_keys({filename});
+    BOOST_CHECK_EQUAL(4, deleted_keys.size());
+    BOOST_CHECK_EQUAL(1, deleted_keys.count("abc"));
+    BOOST_CHECK_EQUAL(1, deleted_keys.count("bcd"));
+    BOOST_CHECK_EQUAL(1, deleted_keys.count("def"));
+    BOOST_CHECK_EQUAL(1, deleted_keys.count("xyz"));
+  }
+
+  BOOST_CHECK(!boost::filesystem::exists(swap_filename));
+  std::remove(filename.string().c_str());
+}
+
+BOOST_AUTO_TEST_CASE(multiple_files) {
+  boost::filesystem::path filename = CreateTempPath();
+  boost::filesystem::path filename_dkm = CreateTempPath();
+  boost::filesystem::path swap_filename = filename;
+  swap_filename += "-swap";
+
+  DeletedKeys::Write({}, std::set<std::string>{"abc", "def"}, filename, swap_filename);
+  DeletedKeys::Write({}, std::set<std::string>{"ghi"}, filename_dkm, swap_filename);
+
+  {
+    // files that do not exist are ignored
+    DeletedKeys deleted_keys({filename, filename_dkm, CreateTempPath()});
+    BOOST_CHECK_EQUAL(3, deleted_keys.size());
+    BOOST_CHECK_EQUAL(1, deleted_keys.count("abc"));
+    BOOST_CHECK_EQUAL(1, deleted_keys.count("ghi"));
+    BOOST_CHECK_EQUAL(0, deleted_keys.count("xyz"));
+  }
+
+  DeletedKeys::Write({filename, filename_dkm}, std::set<std::string>{"xyz"}, filename, swap_filename);
+
+  {
+    DeletedKeys deleted_keys({filename});
+    BOOST_CHECK_EQUAL(4, deleted_keys.size());
+    BOOST_CHECK_EQUAL(1, deleted_keys.count("ghi"));
+    BOOST_CHECK_EQUAL(1, deleted_keys.count("xyz"));
+  }
+
+  std::remove(filename.string().c_str());
+  std::remove(filename_dkm.string().c_str());
+}
+
+BOOST_AUTO_TEST_CASE(empty) {
+  boost::filesystem::path filename = CreateTempPath();
+  boost::filesystem::path swap_filename = filename;
+  swap_filename += "-swap";
+
+  {
+    DeletedKeys deleted_keys({filename});
+    BOOST_CHECK_EQUAL(0, deleted_keys.size());
+    BOOST_CHECK_EQUAL(0, deleted_keys.count("abc"));
+  }
+
+  DeletedKeys::Write({}, std::set<std::string>(), filename, swap_filename);
+
+  {
+    DeletedKeys deleted_keys({filename});
+    BOOST_CHECK_EQUAL(0, deleted_keys.size());
+    BOOST_CHECK_EQUAL(0, deleted_keys.count(""));
+    BOOST_CHECK_EQUAL(0, deleted_keys.count("abc"));
+  }
+
+  std::remove(filename.string().c_str());
+}
+
+BOOST_AUTO_TEST_CASE(legacy_format) {
+  boost::filesystem::path filename = CreateTempPath();
+  boost::filesystem::path swap_filename = filename;
+  swap_filename += "-swap";
+
+  {
+    std::vector<std::string> keys{"xyz", "abc"};
+    std::ofstream out_stream(filename.string(), std::ios::binary);
+    msgpack::pack(out_stream, keys);
+  }
+
+  {
+    DeletedKeys deleted_keys({filename});
+    BOOST_CHECK_EQUAL(2, deleted_keys.size());
+    BOOST_CHECK_EQUAL(1, deleted_keys.count("abc"));
+    BOOST_CHECK_EQUAL(1, deleted_keys.count("xyz"));
+  }
+  BOOST_CHECK_EQUAL(2, DeletedKeys::NumberOfKeys(filename));
+
+  // the next write converts the file
+  DeletedKeys::Write({filename}, std::set<std::string>{"def"}, filename, swap_filename);
+
+  {
+    DeletedKeys deleted_keys({filename});
+    BOOST_CHECK_EQUAL(3, deleted_keys.size());
+    BOOST_CHECK_EQUAL(1, deleted_keys.count("abc"));
+    BOOST_CHECK_EQUAL(1, deleted_keys.count("def"));
+    BOOST_CHECK_EQUAL(1, deleted_keys.count("xyz"));
+  }
+
+  std::remove(filename.string().c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}  // namespace internal
+}  // namespace index
+}  // namespace keyvi
@@ -39,6 +39,14 @@ BOOST_AUTO_TEST_CASE(defaultkeyvimergerbin) {
   BOOST_CHECK_EQUAL(std::string("keyvimerger"), settings.GetKeyviMergerBin());
 }
 
+BOOST_AUTO_TEST_CASE(writerthreads) {
+  IndexSettings settings({});
+  BOOST_CHECK_EQUAL(1, settings.GetWriterThreads());
+
+  IndexSettings settings_with_threads(keyvi::util::parameters_t{{INDEX_WRITER_THREADS, "4"}});
+  BOOST_CHECK_EQUAL(4, settings_with_threads.GetWriterThreads());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } /* namespace internal */
@@ -0,0 +1,172 @@
+//
+// keyvi - A key value store.
+//
+// Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/*
+ * key_filter_test.cpp
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "keyvi/index/internal/key_filter.h"
+#include "keyvi/index/internal/read_only_segment.h"
+#include "keyvi/testing/temp_dictionary.h"
+
+namespace keyvi {
+namespace index {
+namespace internal {
+
+BOOST_AUTO_TEST_SUITE(KeyFilterTests)
+
+BOOST_AUTO_TEST_CASE(no_false_negatives) {
+  boost::filesystem::path filename = boost::filesystem::temp_directory_path();
+  filename /= boost::filesystem::unique_path("key-filter-test-%%%%-%%%%-%%%%-%%%%.kf");
+
+  KeyFilterBuilder builder;
+  for (size_t i = 0; i < 10000; ++i) {
+    builder.Add("key-" + std::to_string(i));
+  }
+  builder.WriteToFile(filename.string());
+
+  {
+    KeyFilter key_filter(filename);
+    BOOST_CHECK(key_filter.IsValid());
+
+    for (size_t i = 0; i < 10000; ++i) {
+      BOOST_CHECK(key_filter.MayContain(KeyFilter::Hash("key-" + std::to_string(i))));
+    }
+
+    size_t false_positives = 0;
+    for (size_t i = 10000; i < 110000; ++i) {
+      if (key_filter.MayContain(KeyFilter::Hash("key-" + std::to_string(i)))) {
+        ++false_positives;
+      }
+    }
+
+    // ~1% expected with 10 bits per key
+    BOOST_CHECK_LT(false_positives, 2000);
+  }
+
+  std::remove(filename.string().c_str());
+}
+
+BOOST_AUTO_TEST_CASE(empty_and_invalid) {
+  boost::filesystem::path filename = boost::filesystem::temp_directory_path();
+  filename /= boost::filesystem::unique_path("key-filter-test-%%%%-%%%%-%%%%-%%%%.kf");
+
+  BOOST_CHECK(!KeyFilter(filename).IsValid());
+
+  KeyFilterBuilder builder;
+  builder.WriteToFile(filename.string());
+  {
+    KeyFilter key_filter(filename);
+    BOOST_CHECK(key_filter.IsValid());
+    BOOST_CHECK(!key_filter.MayContain(KeyFilter::Hash("abc")));
+  }
+
+  {
+    std::ofstream out_stream(filename.string(), std::ios::binary | std::ios::app);
+    out_stream << "garbage";
+  }
+  BOOST_CHECK(!KeyFilter(filename).IsValid());
+
+  std::remove(filename.string().c_str());
+}
+
+BOOST_AUTO_TEST_CASE(little_endian_file) {
+  boost::filesystem::path filename = boost::filesystem::temp_directory_path();
+  filename /= boost::filesystem::unique_path("key-filter-test-%%%%-%%%%-%%%%-%%%%.kf");
+
+  KeyFilterBuilder builder;
+  builder.Add("abc");
+  builder.WriteToFile(filename.string());
+
+  // magic, version 1, reserved, 1 block, 1 key
+  std::ifstream in_stream(filename.string(), std::ios::binary);
+  std::vector<unsigned char> header(32);
+  in_stream.read(reinterpret_cast<char*>(header.data()), header.size());
+  const std::vector<unsigned char> expected = {'k', 'e', 'y', 'v', 'i', 'k', 'f', 0, 1, 0, 0, 0, 0, 0, 0, 0,
+                                               1,   0,   0,   0,   0,   0,   0,   0, 1, 0, 0, 0, 0, 0, 0, 0};
+  BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), header.begin(), header.end());
+
+  // the header is padded to 64 bytes, followed by 1 block
+  BOOST_CHECK_EQUAL(128, boost::filesystem::file_size(filename));
+
+  std::remove(filename.string().c_str());
+}
+
+BOOST_AUTO_TEST_CASE(write_failure) {
+  // writes to /dev/full fail with ENOSPC
+  if (!boost::filesystem::exists("/dev/full")) {
+    return;
+  }
+
+  KeyFilterBuilder builder;
+  for (size_t i = 0; i < 10000; ++i) {
+    builder.Add("key-" + std::to_string(i));
+  }
+  BOOST_CHECK_THROW(builder.WriteToFile("/dev/full"), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(hash_is_stable) {
+  // the hash is persisted, it must not change
+  BOOST_CHECK_EQUAL(3931153127174997758ULL, KeyFilter::Hash("abc"));
+  BOOST_CHECK_EQUAL(12747508378687748837ULL, KeyFilter::Hash("abcdefghij"));
+  BOOST_CHECK_NE(KeyFilter::Hash("abc"), KeyFilter::Hash("abd"));
+  BOOST_CHECK_NE(KeyFilter::Hash("abcdefgh"), KeyFilter::Hash("abcdefgh1"));
+}
+
+BOOST_AUTO_TEST_CASE(segment_with_filter) {
+  std::vector<std::pair<std::string, std::string>> test_data{
+      {"abc", "{a:1}"}, {"abbc", "{b:2}"}, {"cde", "{c:2}"}, {"fgh", "{g:6}"}, {"tyc", "{o:2}"}};
+  testing::TempDictionary dictionary = testing::TempDictionary::makeTempDictionaryFromJson(&test_data);
+
+  // no filter: every key might be in the segment
+  {
+    read_only_segment_t segment(new ReadOnlySegment(dictionary.GetFileName()));
+    BOOST_CHECK(segment->MayContain(KeyFilter::Hash("xyz")));
+  }
+
+  KeyFilterBuilder builder;
+  for (const auto& key_value : test_data) {
+    builder.Add(key_value.first);
+  }
+  builder.WriteToFile(dictionary.GetFileName() + ".kf");
+
+  {
+    read_only_segment_t segment(new ReadOnlySegment(dictionary.GetFileName()));
+    for (const auto& key_value : test_data) {
+      BOOST_CHECK(segment->MayContain(KeyFilter::Hash(key_value.first)));
+    }
+  }
+
+  std::remove((dictionary.GetFileName() + ".kf").c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}  // namespace internal
+}  // namespace index
+}  // namespace keyvi
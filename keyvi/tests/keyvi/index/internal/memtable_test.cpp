@@ -0,0 +1,110 @@
+//
+// keyvi - A key value store.
+//
+// Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/*
+ * memtable_test.cpp
+ */
+
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+#include "keyvi/index/internal/memtable.h"
+
+namespace keyvi {
+namespace index {
+namespace internal {
+
+BOOST_AUTO_TEST_SUITE(MemtableTests)
+
+BOOST_AUTO_TEST_CASE(get_and_delete) {
+  Memtable memtable;
+  dictionary::match_t match;
+  bool deleted = true;
+
+  BOOST_CHECK(!memtable.Get("abc", &match));
+  BOOST_CHECK(!memtable.Contains("abc", &deleted));
+
+  memtable.Add("abc", "{\"a\":1}", 1);
+  memtable.Add("abd", "{\"b\":2}", 2);
+  memtable.Add("abc", "{\"a\":3}", 3);
+  BOOST_CHECK_EQUAL(2, memtable.Size());
+
+  BOOST_CHECK(memtable.Get("abc", &match));
+  BOOST_CHECK(match);
+  BOOST_CHECK_EQUAL("abc", match->GetMatchedString());
+  BOOST_CHECK_EQUAL("{\"a\":3}", match->GetValueAsString());
+  BOOST_CHECK(memtable.Contains("abc", &deleted));
+  BOOST_CHECK(!deleted);
+
+  // deletes are kept as they hide older writes in the segments
+  memtable.Delete("abd", 4);
+  match.reset();
+  BOOST_CHECK(memtable.Get("abd", &match));
+  BOOST_CHECK(!match);
+  BOOST_CHECK(memtable.Contains("abd", &deleted));
+  BOOST_CHECK(deleted);
+  BOOST_CHECK_EQUAL(2, memtable.Size());
+}
+
+BOOST_AUTO_TEST_CASE(entries_with_prefix) {
+  Memtable memtable;
+
+  memtable.Add("bcd", "{}", 1);
+  memtable.Add("abd", "{}", 2);
+  memtable.Add("ab", "{}", 3);
+  memtable.Add("abc", "{}", 4);
+  memtable.Delete("abe", 5);
+  memtable.Add("a", "{}", 6);
+
+  Memtable::entries_t entries = memtable.GetEntriesWithPrefix("ab");
+  BOOST_CHECK_EQUAL(4, entries.size());
+  BOOST_CHECK_EQUAL("ab", entries[0].first);
+  BOOST_CHECK_EQUAL("abc", entries[1].first);
+  BOOST_CHECK_EQUAL("abd", entries[2].first);
+  BOOST_CHECK_EQUAL("abe", entries[3].first);
+  BOOST_CHECK(entries[3].second.deleted);
+
+  BOOST_CHECK_EQUAL(6, memtable.GetEntriesWithPrefix("").size());
+  BOOST_CHECK_EQUAL(0, memtable.GetEntriesWithPrefix("c").size());
+}
+
+BOOST_AUTO_TEST_CASE(trim) {
+  Memtable memtable;
+
+  memtable.Add("abc", "{\"a\":1}", 1);
+  memtable.Add("abd", "{\"b\":2}", 2);
+  memtable.Delete("abe", 3);
+  memtable.Add("abc", "{\"a\":4}", 4);
+
+  memtable.Trim(3);
+  BOOST_CHECK_EQUAL(1, memtable.Size());
+
+  dictionary::match_t match;
+  BOOST_CHECK(memtable.Get("abc", &match));
+  BOOST_CHECK_EQUAL("{\"a\":4}", match->GetValueAsString());
+
+  memtable.Trim(4);
+  BOOST_CHECK_EQUAL(0, memtable.Size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}  // namespace internal
+}  // namespace index
+}  // namespace keyvi
@@ -17,6 +17,7 @@
 //
 
 #include <cstdio>
+#include <ctime>
 
 #include <boost/test/unit_test.hpp>
 
@@ -75,11 +76,15 @@ BOOST_AUTO_TEST_CASE(deletedkeys_reload) {
   std::string filename{dictionary.GetFileName() + ".dk"};
   std::string filename_dkm{dictionary.GetFileName() + ".dkm"};
 
+  // the modification time has a granularity of a second, set it explicitly for every change
+  const std::time_t now = std::time(nullptr);
+
   std::vector<std::string> deleted_keys{"abc", "tyc"};
   {
     std::ofstream out_stream(filename, std::ios::binary);
     msgpack::pack(out_stream, deleted_keys);
   }
+  boost::filesystem::last_write_time(filename, now + 1);
 
   segment->ReloadDeletedKeys();
   BOOST_CHECK(segment->HasDeletedKeys());
@@ -93,6 +98,7 @@ BOOST_AUTO_TEST_CASE(deletedkeys_reload) {
     std::ofstream out_stream(filename, std::ios::binary);
     msgpack::pack(out_stream, deleted_keys_2);
   }
+  boost::filesystem::last_write_time(filename, now + 2);
   segment->ReloadDeletedKeys();
   BOOST_CHECK(segment->HasDeletedKeys());
   BOOST_CHECK(segment->DeletedKeys()->count("abc"));
@@ -105,6 +111,7 @@ BOOST_AUTO_TEST_CASE(deletedkeys_reload) {
     std::ofstream out_stream(filename_dkm, std::ios::binary);
     msgpack::pack(out_stream, deleted_keys_dkm);
   }
+  boost::filesystem::last_write_time(filename_dkm, now + 3);
   segment->ReloadDeletedKeys();
   BOOST_CHECK(segment->DeletedKeys()->count("abc"));
   BOOST_CHECK(segment->DeletedKeys()->count("tyc"));
@@ -117,6 +124,45 @@ BOOST_AUTO_TEST_CASE(deletedkeys_reload) {
   std::remove(filename.c_str());
 }
 
+BOOST_AUTO_TEST_CASE(deletedkeys_no_reload_if_unchanged) {
+  std::vector<std::pair<std::string, std::string>> test_data{{"abc", "{a:1}"}, {"cde", "{c:2}"}, {"tyc", "{o:2}"}};
+  testing::TempDictionary dictionary = testing::TempDictionary::makeTempDictionaryFromJson(&test_data);
+
+  std::string filename{dictionary.GetFileName() + ".dk"};
+  std::vector<std::string> deleted_keys{"abc"};
+  {
+    std::ofstream out_stream(filename, std::ios::binary);
+    msgpack::pack(out_stream, deleted_keys);
+  }
+  const std::time_t now = std::time(nullptr);
+  boost::filesystem::last_write_time(filename, now);
+
+  read_only_segment_t segment(new ReadOnlySegment(dictionary.GetFileName()));
+  BOOST_CHECK(segment->IsDeleted("abc"));
+
+  // a reload replaces the deleted keys, the segment would drop its reference
+  ReadOnlySegment::deleted_ptr_t deleted_keys_before = segment->DeletedKeys();
+  BOOST_CHECK_EQUAL(2, deleted_keys_before.use_count());
+
+  segment->ReloadDeletedKeys();
+  segment->ReloadDeletedKeys();
+  BOOST_CHECK_EQUAL(2, deleted_keys_before.use_count());
+
+  std::vector<std::string> deleted_keys_2{"abc", "cde"};
+  {
+    std::ofstream out_stream(filename, std::ios::binary);
+    msgpack::pack(out_stream, deleted_keys_2);
+  }
+  boost::filesystem::last_write_time(filename, now + 1);
+
+  segment->ReloadDeletedKeys();
+  BOOST_CHECK_EQUAL(1, deleted_keys_before.use_count());
+  deleted_keys_before.reset();
+  BOOST_CHECK(segment->IsDeleted("cde"));
+
+  std::remove(filename.c_str());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }  // namespace internal
@@ -16,13 +16,14 @@
 // limitations under the License.
 //
 
-#include <algorithm>
+#include <string>
+#include <vector>
 
 #include <boost/filesystem.hpp>
 #include <boost/test/unit_test.hpp>
 
-#include <msgpack.hpp>
-
+#include "keyvi/dictionary/fsa/automata.h"
+#include "keyvi/dictionary/fsa/entry_iterator.h"
 #include "keyvi/index/internal/segment.h"
 #include "keyvi/testing/temp_dictionary.h"
 
@@ -33,18 +34,14 @@ namespace internal {
 BOOST_AUTO_TEST_SUITE(SegmentTests)
 
 void LoadDeletedKeys(const std::string& filename, std::vector<std::string>* deleted_keys) {
-  std::ifstream deleted_keys_stream(filename, std::ios::binary);
-
-  BOOST_CHECK(deleted_keys_stream.good());
-
-  std::stringstream buffer;
-  buffer << deleted_keys_stream.rdbuf();
-
-  msgpack::object_handle unpacked_object;
-  msgpack::unpack(unpacked_object, buffer.str().data(), buffer.str().size());
-
-  unpacked_object.get().convert(*deleted_keys);
-  std::sort(deleted_keys->begin(), deleted_keys->end());
+  BOOST_CHECK(boost::filesystem::exists(filename));
+
+  deleted_keys->clear();
+  dictionary::fsa::EntryIterator end_it;
+  for (dictionary::fsa::EntryIterator it(dictionary::fsa::automata_t(new dictionary::fsa::Automata(filename)));
+       it != end_it; ++it) {
+    deleted_keys->push_back(it.GetKey());
+  }
 }
 
 BOOST_AUTO_TEST_CASE(deletekey) {
@@ -158,6 +155,74 @@ BOOST_AUTO_TEST_CASE(deletekeyDuringMerge) {
   BOOST_CHECK(!boost::filesystem::exists(dictionary.GetFileName() + ".dkm"));
 }
 
+BOOST_AUTO_TEST_CASE(deletekeyDelta) {
+  std::vector<std::pair<std::string, std::string>> test_data;
+  for (size_t i = 10; i < 30; ++i) {
+    test_data.emplace_back("key" + std::to_string(i), "{a:1}");
+  }
+  testing::TempDictionary dictionary = testing::TempDictionary::makeTempDictionaryFromJson(&test_data);
+  const std::string filename_dk = dictionary.GetFileName() + ".dk";
+  const std::string filename_dkd = dictionary.GetFileName() + ".dkd";
+
+  segment_t segment(new Segment(dictionary.GetFileName()));
+
+  // no list of deleted keys yet, the delta gets compacted right away
+  for (size_t i = 10; i < 20; ++i) {
+    segment->DeleteKey("key" + std::to_string(i));
+  }
+  segment->Persist();
+
+  std::vector<std::string> deleted_keys;
+  LoadDeletedKeys(filename_dk, &deleted_keys);
+  BOOST_CHECK_EQUAL(10, deleted_keys.size());
+  BOOST_CHECK(!boost::filesystem::exists(filename_dkd));
+
+  // a small delete only writes the delta file
+  segment->DeleteKey("key20");
+  segment->Persist();
+
+  LoadDeletedKeys(filename_dk, &deleted_keys);
+  BOOST_CHECK_EQUAL(10, deleted_keys.size());
+  LoadDeletedKeys(filename_dkd, &deleted_keys);
+  BOOST_CHECK_EQUAL(1, deleted_keys.size());
+  BOOST_CHECK_EQUAL("key20", deleted_keys[0]);
+  BOOST_CHECK(segment->IsDeleted("key20"));
+  BOOST_CHECK(segment->IsDeleted("key10"));
+  BOOST_CHECK(!segment->IsDeleted("key21"));
+
+  // the delta got too big compared to the list of deleted keys
+  segment->DeleteKey("key21");
+  segment->Persist();
+
+  LoadDeletedKeys(filename_dk, &deleted_keys);
+  BOOST_CHECK_EQUAL(12, deleted_keys.size());
+  BOOST_CHECK(!boost::filesystem::exists(filename_dkd));
+  BOOST_CHECK(segment->IsDeleted("key20"));
+  BOOST_CHECK(segment->IsDeleted("key21"));
+
+  // a merge failure compacts the delta as well
+  segment->DeleteKey("key22");
+  segment->Persist();
+  BOOST_CHECK(boost::filesystem::exists(filename_dkd));
+  segment->ElectedForMerge();
+  segment->DeleteKey("key23");
+  segment->MergeFailed();
+
+  LoadDeletedKeys(filename_dk, &deleted_keys);
+  BOOST_CHECK_EQUAL(14, deleted_keys.size());
+  BOOST_CHECK(!boost::filesystem::exists(filename_dkd));
+  BOOST_CHECK(segment->IsDeleted("key22"));
+  BOOST_CHECK(segment->IsDeleted("key23"));
+
+  segment->DeleteKey("key24");
+  segment->Persist();
+  BOOST_CHECK(boost::filesystem::exists(filename_dkd));
+
+  segment->RemoveFiles();
+  BOOST_CHECK(!boost::filesystem::exists(filename_dk));
+  BOOST_CHECK(!boost::filesystem::exists(filename_dkd));
+}
+
 BOOST_AUTO_TEST_CASE(deletekeyMerging) {
   std::vector<std::pair<std::string, std::string>> test_data_segment1 = {
       {"abc", "{a:1}"}, {"abbc", "{b:2}"}, {"cde", "{c:2}"}, {"fgh", "{g:6}"}, {"tyc", "{o:2}"}};
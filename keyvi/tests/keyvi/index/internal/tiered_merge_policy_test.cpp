@@ -44,7 +44,7 @@ class SegmentFriend {
   }
 
   static void SetDeletedKeys(segment_t segment, std::unordered_set<std::string> keys) {
-    segment->deleted_keys_for_write_ = keys;
+    segment->deleted_keys_for_write_ = Segment::new_deleted_t(keys.begin(), keys.end());
     if (keys.size() > 0) {
       segment->deletes_loaded = true;
     }
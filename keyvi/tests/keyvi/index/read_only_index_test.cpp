@@ -23,6 +23,7 @@
  *      Author: hendrik
  */
 #include <chrono>  //NOLINT
+#include <fstream>
 #include <string>
 #include <thread>  //NOLINT
 #include <vector>
@@ -152,18 +153,21 @@ BOOST_AUTO_TEST_CASE(indexwithdeletedkeys) {
 void testFuzzyMatching(ReadOnlyIndex* reader, const std::string& query, const size_t max_edit_distance,
                        const size_t minimum_exact_prefix, const std::vector<std::string>& expected_matches,
                        const std::vector<std::string>& expected_values) {
-  auto expected_matches_it = expected_matches.begin();
-  auto expected_values_it = expected_values.begin();
-
   BOOST_CHECK_EQUAL(expected_matches.size(), expected_values.size());
 
-  auto matcher = reader->GetFuzzy(query, max_edit_distance, minimum_exact_prefix);
-  for (auto m : matcher) {
-    BOOST_REQUIRE(expected_matches_it != expected_matches.end());
-    BOOST_CHECK_EQUAL(*expected_matches_it++, m->GetMatchedString());
-    BOOST_CHECK_EQUAL(*expected_values_it++, m->GetValueAsString());
+  for (auto strategy : {dictionary::matching::fuzzy_strategy_t::NEEDLEMAN_WUNSCH,
+                        dictionary::matching::fuzzy_strategy_t::BIT_PARALLEL}) {
+    auto expected_matches_it = expected_matches.begin();
+    auto expected_values_it = expected_values.begin();
+
+    auto matcher = reader->GetFuzzy(query, max_edit_distance, minimum_exact_prefix, strategy);
+    for (auto m : matcher) {
+      BOOST_REQUIRE(expected_matches_it != expected_matches.end());
+      BOOST_CHECK_EQUAL(*expected_matches_it++, m->GetMatchedString());
+      BOOST_CHECK_EQUAL(*expected_values_it++, m->GetValueAsString());
+    }
+    BOOST_CHECK(expected_matches_it == expected_matches.end());
   }
-  BOOST_CHECK(expected_matches_it == expected_matches.end());
 }
 
 BOOST_AUTO_TEST_CASE(fuzzyMatching) {
@@ -223,7 +227,8 @@ BOOST_AUTO_TEST_CASE(fuzzyMatchingExactPrefix) {
   index.AddSegment(&test_data);
   std::vector<std::pair<std::string, std::string>> test_data_2 = {{"apple", "{c:6}"}, {"cde", "{x:1}"}};
   index.AddSegment(&test_data_2);
-  ReadOnlyIndex reader_1(index.GetIndexFolder(), {{"refresh_interval", "400"}});
+  // the deleted key must not become visible before the next refresh
+  ReadOnlyIndex reader_1(index.GetIndexFolder(), {{"refresh_interval", "400"}, {"refresh_watch", "false"}});
 
   testFuzzyMatching(&reader_1, "app", 0, 1, {}, {});
   testFuzzyMatching(&reader_1, "ap", 1, 1, {"a"}, {"\"{a:1}\""});
@@ -300,6 +305,65 @@ BOOST_AUTO_TEST_CASE(nearMatching) {
                    {"\"pizzeria in Munich 4\"", "\"pizzeria in Munich 1\""});
 }
 
+void testPrefixCompletion(ReadOnlyIndex* reader, const std::string& query, const size_t top_n,
+                          const std::vector<std::string>& expected_matches,
+                          const std::vector<uint32_t>& expected_weights) {
+  BOOST_CHECK_EQUAL(expected_matches.size(), expected_weights.size());
+  auto expected_matches_it = expected_matches.begin();
+  auto expected_weights_it = expected_weights.begin();
+
+  auto matcher = reader->GetPrefixCompletion(query, top_n);
+  for (auto m : matcher) {
+    BOOST_REQUIRE(expected_matches_it != expected_matches.end());
+    BOOST_CHECK_EQUAL(*expected_matches_it++, m->GetMatchedString());
+    BOOST_CHECK_EQUAL(*expected_weights_it++, m->GetWeight());
+  }
+  BOOST_CHECK(expected_matches_it == expected_matches.end());
+}
+
+BOOST_AUTO_TEST_CASE(prefixCompletion) {
+  testing::IndexMock index;
+
+  std::vector<std::pair<std::string, uint32_t>> test_data = {
+      {"mozart", 10}, {"mozzarella", 500}, {"mozilla", 300}, {"mozambique", 80}, {"moon", 1000}};
+  index.AddSegment(&test_data);
+
+  std::vector<std::pair<std::string, uint32_t>> test_data_2 = {
+      {"mozart", 900}, {"mozzarella", 5}, {"mozaic", 200}, {"mosquito", 2000}};
+  index.AddSegment(&test_data_2);
+
+  ReadOnlyIndex reader_1(index.GetIndexFolder(), {{"refresh_interval", "400"}});
+
+  // duplicates are returned with the weight of the newest segment
+  testPrefixCompletion(&reader_1, "moz", 3, {"mozart", "mozilla", "mozaic"}, {900, 300, 200});
+  testPrefixCompletion(&reader_1, "moz", 10, {"mozart", "mozilla", "mozaic", "mozambique", "mozzarella"},
+                       {900, 300, 200, 80, 5});
+  testPrefixCompletion(&reader_1, "mo", 2, {"mosquito", "moon"}, {2000, 1000});
+  testPrefixCompletion(&reader_1, "mozz", 1, {"mozzarella"}, {5});
+  testPrefixCompletion(&reader_1, "x", 3, {}, {});
+  testPrefixCompletion(&reader_1, "moz", 0, {}, {});
+
+  index.AddDeletedKeys({"mozart", "mosquito"}, 1);
+  index.AddDeletedKeys({"mozilla"}, 0);
+
+  ReadOnlyIndex reader_2(index.GetIndexFolder(), {{"refresh_interval", "400"}});
+
+  // deleted keys do not count, the older version of a deleted key is not returned
+  testPrefixCompletion(&reader_2, "moz", 3, {"mozaic", "mozambique", "mozzarella"}, {200, 80, 5});
+  testPrefixCompletion(&reader_2, "mo", 2, {"moon", "mozaic"}, {1000, 200});
+
+  auto completer = reader_2.GetPrefixCompletion("mo", 10);
+  auto completer_it = completer.begin();
+  std::vector<std::string> matches;
+
+  while (completer_it != completer.end()) {
+    matches.push_back((*completer_it)->GetMatchedString());
+    completer_it.SetMinWeight(100);
+    completer_it++;
+  }
+  BOOST_CHECK_EQUAL(2, matches.size());
+}
+
 BOOST_AUTO_TEST_CASE(reloadRecoveryAfterMissingSegment) {
   testing::IndexMock index;
 
@@ -344,6 +408,106 @@ BOOST_AUTO_TEST_CASE(reloadRecoveryAfterMissingSegment) {
   BOOST_CHECK(reader.Contains("ghi"));
 }
 
+#if defined(__linux__)
+// publish the toc like the index does, by renaming a temporary file
+void ReplaceToc(const std::string& index_folder, const std::string& toc_content) {
+  boost::filesystem::path toc_file(index_folder);
+  toc_file /= "index.toc";
+  boost::filesystem::path toc_file_part(toc_file);
+  toc_file_part += ".part";
+  {
+    std::ofstream toc(toc_file_part.string());
+    toc << toc_content;
+  }
+  boost::filesystem::rename(toc_file_part, toc_file);
+}
+
+bool WaitUntilContains(ReadOnlyIndex* reader, const std::string& key, const bool expected) {
+  for (int i = 0; i < 200; ++i) {
+    if (reader->Contains(key) == expected) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return false;
+}
+
+BOOST_AUTO_TEST_CASE(refreshWatch) {
+  testing::IndexMock index;
+
+  std::vector<std::pair<std::string, std::string>> test_data = {
+      {"abc", "{a:1}"},
+      {"def", "{b:2}"},
+  };
+  index.AddSegment(&test_data);
+
+  // a long refresh interval, the reader has to pick up the changes by watching the directory
+  ReadOnlyIndex reader(index.GetIndexFolder(), {{"refresh_interval", "100000"}});
+  BOOST_CHECK(reader.Contains("abc"));
+
+  std::vector<std::pair<std::string, std::string>> test_data_2 = {
+      {"ghi", "{c:3}"},
+  };
+  index.AddSegment(&test_data_2);
+  ReplaceToc(index.GetIndexFolder(), R"({"files": ["kv-0.kv", "kv-1.kv"]})");
+
+  BOOST_CHECK(WaitUntilContains(&reader, "ghi", true));
+  BOOST_CHECK(reader.Contains("abc"));
+
+  // deleted keys get renamed into place as well
+  index.AddDeletedKeys({"abc"}, 0);
+  BOOST_CHECK(WaitUntilContains(&reader, "abc", false));
+  BOOST_CHECK(reader.Contains("def"));
+
+  // a second delete within the same second as the previous one
+  index.AddDeletedKeys({"abc", "def"}, 0);
+  BOOST_CHECK(WaitUntilContains(&reader, "def", false));
+
+  // a toc change within the same second as the previous one
+  std::vector<std::pair<std::string, std::string>> test_data_3 = {
+      {"jkl", "{d:4}"},
+  };
+  index.AddSegment(&test_data_3);
+  ReplaceToc(index.GetIndexFolder(), R"({"files": ["kv-0.kv", "kv-1.kv", "kv-2.kv"]})");
+
+  BOOST_CHECK(WaitUntilContains(&reader, "jkl", true));
+
+  // the mock writes the toc in place
+  std::vector<std::pair<std::string, std::string>> test_data_4 = {
+      {"mno", "{e:5}"},
+  };
+  index.AddSegment(&test_data_4);
+
+  BOOST_CHECK(WaitUntilContains(&reader, "mno", true));
+}
+
+BOOST_AUTO_TEST_CASE(refreshWatchDisabled) {
+  testing::IndexMock index;
+
+  std::vector<std::pair<std::string, std::string>> test_data = {
+      {"abc", "{a:1}"},
+  };
+  index.AddSegment(&test_data);
+
+  ReadOnlyIndex reader(index.GetIndexFolder(), {{"refresh_interval", "100000"}, {"refresh_watch", "false"}});
+  BOOST_CHECK(reader.Contains("abc"));
+
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+  std::vector<std::pair<std::string, std::string>> test_data_2 = {
+      {"def", "{b:2}"},
+  };
+  index.AddSegment(&test_data_2);
+  ReplaceToc(index.GetIndexFolder(), R"({"files": ["kv-0.kv", "kv-1.kv"]})");
+
+  // only polling, which is not due yet
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  BOOST_CHECK(!reader.Contains("def"));
+
+  reader.Reload();
+  BOOST_CHECK(reader.Contains("def"));
+}
+#endif
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } /* namespace index */
@@ -0,0 +1,153 @@
+//
+// keyvi - A key value store.
+//
+// Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/*
+ * bit_parallel_levenshtein_test.cpp
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "utf8.h"
+
+#include "keyvi/stringdistance/bit_parallel_levenshtein.h"
+#include "keyvi/stringdistance/levenshtein.h"
+
+namespace keyvi {
+namespace stringdistance {
+
+BOOST_AUTO_TEST_SUITE(BitParallelLevenshteinTests)
+
+std::vector<uint32_t> ToCodepoints(const std::string& input) {
+  std::vector<uint32_t> codepoints;
+  utf8::unchecked::utf8to32(input.begin(), input.end(), back_inserter(codepoints));
+  return codepoints;
+}
+
+BOOST_AUTO_TEST_CASE(approximate) {
+  BitParallelLevenshtein ls(ToCodepoints("text"), 20, 3);
+  std::vector<uint32_t> candidate = ToCodepoints("teller");
+  std::vector<int32_t> intermediate_scores = {0, 0, 1, 2, 3, 4};
+
+  for (size_t i = 0; i < candidate.size(); ++i) {
+    BOOST_CHECK_EQUAL(intermediate_scores[i], ls.Put(candidate[i], i));
+  }
+
+  BOOST_CHECK_EQUAL("teller", ls.GetCandidate());
+  BOOST_CHECK_EQUAL(4, ls.GetScore());
+}
+
+BOOST_AUTO_TEST_CASE(transposition) {
+  BitParallelLevenshtein ls(ToCodepoints("house"), 20, 2);
+  std::vector<uint32_t> candidate = ToCodepoints("huose");
+
+  for (size_t i = 0; i < candidate.size(); ++i) {
+    ls.Put(candidate[i], i);
+  }
+
+  BOOST_CHECK_EQUAL(1, ls.GetScore());
+
+  // backtrack and take a different path
+  ls.Put('o', 1);
+  ls.Put('u', 2);
+  ls.Put('s', 3);
+  ls.Put('e', 4);
+  BOOST_CHECK_EQUAL(0, ls.GetScore());
+  BOOST_CHECK_EQUAL("house", ls.GetCandidate());
+}
+
+BOOST_AUTO_TEST_CASE(non_ascii) {
+  BitParallelLevenshtein ls(ToCodepoints("あsだsっd"), 20, 2);
+  std::vector<uint32_t> candidate = ToCodepoints("あsだsdさ");
+
+  for (size_t i = 0; i < candidate.size(); ++i) {
+    ls.Put(candidate[i], i);
+  }
+
+  BOOST_CHECK_EQUAL(2, ls.GetScore());
+  BOOST_CHECK_EQUAL("あsだsdさ", ls.GetCandidate());
+}
+
+BOOST_AUTO_TEST_CASE(empty_input) {
+  BitParallelLevenshtein ls(std::vector<uint32_t>(), 20, 1);
+  BOOST_CHECK_EQUAL(0, ls.GetScore());
+  BOOST_CHECK_EQUAL(1, ls.Put('a', 0));
+  BOOST_CHECK_EQUAL(1, ls.GetScore());
+  BOOST_CHECK_EQUAL(2, ls.Put('b', 1));
+  BOOST_CHECK_EQUAL(2, ls.GetScore());
+}
+
+BOOST_AUTO_TEST_CASE(input_too_long) {
+  std::vector<uint32_t> input(BIT_PARALLEL_LEVENSHTEIN_MAX_LENGTH, 'a');
+  BitParallelLevenshtein ls(input, 20, 2);
+  ls.Put('a', 0);
+  BOOST_CHECK_EQUAL(BIT_PARALLEL_LEVENSHTEIN_MAX_LENGTH - 1, ls.GetScore());
+
+  input.push_back('a');
+  BOOST_CHECK_THROW(BitParallelLevenshtein(input, 20, 2), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(same_as_needleman_wunsch) {
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<uint32_t> alphabet(0, 3);
+  // note: an empty input is not compared, NeedlemanWunsch does not calculate the score in this case
+  std::uniform_int_distribution<size_t> length_distribution(1, 12);
+
+  // small alphabet, to get a lot of matches and transpositions, one codepoint outside of ascii
+  auto random_codepoint = [&]() {
+    const uint32_t c = alphabet(generator);
+    return c == 3 ? 0x3042 : 'a' + c;
+  };
+
+  for (int32_t max_distance = 0; max_distance < 4; ++max_distance) {
+    for (size_t i = 0; i < 500; ++i) {
+      std::vector<uint32_t> input(length_distribution(generator));
+      std::generate(input.begin(), input.end(), random_codepoint);
+
+      Levenshtein reference(input, 20, max_distance);
+      BitParallelLevenshtein bit_parallel(input, 20, max_distance);
+
+      // simulate a traversal, randomly go back to a lower depth
+      size_t position = 0;
+      for (size_t step = 0; step < 40; ++step) {
+        const uint32_t codepoint = random_codepoint();
+        const int32_t expected_intermediate = std::min(reference.Put(codepoint, position), max_distance + 1);
+        BOOST_CHECK_EQUAL(expected_intermediate, bit_parallel.Put(codepoint, position));
+
+        if (position < input.size() + max_distance) {
+          BOOST_CHECK_EQUAL(std::min(reference.GetScore(), max_distance + 1),
+                            std::min(bit_parallel.GetScore(), max_distance + 1));
+        }
+        BOOST_CHECK_EQUAL(reference.GetCandidate(), bit_parallel.GetCandidate());
+
+        position = std::uniform_int_distribution<size_t>(0, position + 1)(generator);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace stringdistance */
+} /* namespace keyvi */
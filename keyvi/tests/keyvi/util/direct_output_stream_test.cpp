@@ -0,0 +1,131 @@
+//
+// keyvi - A key value store.
+//
+// Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/*
+ * direct_output_stream_test.cpp
+ */
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "keyvi/util/direct_output_stream.h"
+
+namespace keyvi {
+namespace util {
+
+BOOST_AUTO_TEST_SUITE(DirectOutputStreamTests)
+
+namespace {
+std::string ReadFile(const boost::filesystem::path& filename) {
+  std::ifstream in_stream(filename.string(), std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in_stream), std::istreambuf_iterator<char>());
+}
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(writeAndReadBack) {
+  boost::filesystem::path filename(boost::filesystem::temp_directory_path());
+  filename /= boost::filesystem::unique_path("direct-output-stream-test-%%%%-%%%%-%%%%-%%%%");
+
+  for (size_t size : {0, 1, 4095, 4096, 4097, 100000, 3 * 1024 * 1024 + 17}) {
+    std::string expected;
+    for (size_t i = 0; i < size; ++i) {
+      expected.push_back(static_cast<char>((i * 31) % 251));
+    }
+
+    DirectOutputStream out_stream(filename.string());
+    // mix single characters and bulk writes
+    size_t i = 0;
+    for (; i < size && i < 10; ++i) {
+      out_stream.put(expected[i]);
+    }
+    out_stream.write(expected.data() + i, size - i);
+    BOOST_CHECK_EQUAL(size, static_cast<size_t>(out_stream.tellp()));
+    out_stream.close();
+    BOOST_CHECK(out_stream.good());
+
+    BOOST_CHECK_EQUAL(size, boost::filesystem::file_size(filename));
+    BOOST_CHECK(expected == ReadFile(filename));
+  }
+
+  boost::filesystem::remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE(smallBlocks) {
+  boost::filesystem::path filename(boost::filesystem::temp_directory_path());
+  filename /= boost::filesystem::unique_path("direct-output-stream-test-%%%%-%%%%-%%%%-%%%%");
+
+  std::string expected;
+  {
+    // 2 blocks of 4k, the writer thread has to recycle blocks all the time
+    DirectOutputStreamBuffer buffer(filename.string(), 4096, 2);
+    std::ostream out_stream(&buffer);
+
+    for (size_t i = 0; i < 5000; ++i) {
+      const std::string line = "line " + std::to_string(i) + "\n";
+      out_stream << line;
+      expected += line;
+    }
+    buffer.Close();
+  }
+
+  BOOST_CHECK(expected == ReadFile(filename));
+  boost::filesystem::remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE(writeOutputFile) {
+  boost::filesystem::path filename(boost::filesystem::temp_directory_path());
+  filename /= boost::filesystem::unique_path("direct-output-stream-test-%%%%-%%%%-%%%%-%%%%");
+
+  for (const bool direct_io : {false, true}) {
+    WriteOutputFile(filename.string(), direct_io, [](std::ostream& out_stream) { out_stream << "abc"; });
+    BOOST_CHECK_EQUAL("abc", ReadFile(filename));
+  }
+
+  boost::filesystem::remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE(writeOutputFileFailure) {
+  // writes to /dev/full fail with ENOSPC
+  if (!boost::filesystem::exists("/dev/full")) {
+    return;
+  }
+
+  for (const bool direct_io : {false, true}) {
+    BOOST_CHECK_THROW(WriteOutputFile("/dev/full", direct_io,
+                                      [](std::ostream& out_stream) { out_stream << std::string(10000, 'a'); }),
+                      std::runtime_error);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(openFailure) {
+  boost::filesystem::path filename(boost::filesystem::temp_directory_path());
+  filename /= boost::filesystem::unique_path("direct-output-stream-test-%%%%-%%%%-%%%%-%%%%");
+  filename /= "file";
+
+  BOOST_CHECK_THROW(DirectOutputStream out_stream(filename.string()), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace util */
+} /* namespace keyvi */
@@ -0,0 +1,111 @@
+/** keyvi - A key value store.
+ *
+ * Copyright 2026 Hendrik Muhs<hendrik.muhs@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "keyvi/util/float_vector_distance.h"
+
+namespace keyvi {
+namespace util {
+
+BOOST_AUTO_TEST_SUITE(FloatVectorDistanceTests)
+
+namespace {
+
+std::vector<FloatVectorKernels> AvailableKernels() {
+  std::vector<FloatVectorKernels> kernels;
+  kernels.push_back(GetFloatVectorKernels());
+  kernels.push_back({&DotProductGeneric, &SquaredEuclideanDistanceGeneric});
+#if defined(KEYVI_X86_DISPATCH)
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    kernels.push_back({&DotProductAVX2, &SquaredEuclideanDistanceAVX2});
+  }
+  if (__builtin_cpu_supports("avx512f")) {
+    kernels.push_back({&DotProductAVX512, &SquaredEuclideanDistanceAVX512});
+  }
+#endif
+  return kernels;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(AllKernelsAgree) {
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> distribution(-1.0, 1.0);
+
+  for (const auto& kernels : AvailableKernels()) {
+    for (size_t size = 0; size < 70; ++size) {
+      std::vector<float> a(size);
+      std::vector<float> b(size);
+      double expected_dot_product = 0;
+      double expected_squared_distance = 0;
+
+      for (size_t i = 0; i < size; ++i) {
+        a[i] = distribution(generator);
+        b[i] = distribution(generator);
+        expected_dot_product += static_cast<double>(a[i]) * b[i];
+        expected_squared_distance += (static_cast<double>(a[i]) - b[i]) * (static_cast<double>(a[i]) - b[i]);
+      }
+
+      BOOST_CHECK_SMALL(expected_dot_product - kernels.dot_product(a.data(), b.data(), size), 1e-4);
+      BOOST_CHECK_SMALL(expected_squared_distance - kernels.squared_euclidean_distance(a.data(), b.data(), size),
+                        1e-4);
+
+      // unaligned access
+      std::vector<char> buffer(size * sizeof(float) + 1);
+      if (size > 0) {
+        std::memcpy(buffer.data() + 1, a.data(), size * sizeof(float));
+      }
+      const float* unaligned = reinterpret_cast<const float*>(buffer.data() + 1);
+      BOOST_CHECK_SMALL(expected_dot_product - kernels.dot_product(unaligned, b.data(), size), 1e-4);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Scorer) {
+  std::vector<float> query = {1.0, 2.0, 2.0};
+  std::vector<float> parallel = {2.0, 4.0, 4.0};
+  std::vector<float> orthogonal = {2.0, -1.0, 0.0};
+
+  FloatVectorScorer dot_product(query, float_vector_distance_t::DOT_PRODUCT);
+  BOOST_CHECK_CLOSE(18.0, dot_product.Score(parallel.data(), 3), 1e-4);
+  BOOST_CHECK_SMALL(dot_product.Score(orthogonal.data(), 3), 1e-6f);
+
+  FloatVectorScorer cosine(query, float_vector_distance_t::COSINE);
+  BOOST_CHECK_CLOSE(1.0, cosine.Score(parallel.data(), 3), 1e-4);
+  BOOST_CHECK_SMALL(cosine.Score(orthogonal.data(), 3), 1e-6f);
+
+  std::vector<float> zero = {0.0, 0.0, 0.0};
+  BOOST_CHECK_EQUAL(0, cosine.Score(zero.data(), 3));
+
+  FloatVectorScorer euclidean(query, float_vector_distance_t::EUCLIDEAN);
+  BOOST_CHECK_CLOSE(3.0, euclidean.Score(parallel.data(), 3), 1e-4);
+  BOOST_CHECK_CLOSE(-3.0, euclidean.GetRank(euclidean.Score(parallel.data(), 3)), 1e-4);
+
+  BOOST_CHECK_THROW(euclidean.Score(parallel.data(), 2), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace util */
+} /* namespace keyvi */
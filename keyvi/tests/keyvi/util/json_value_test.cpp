@@ -54,6 +54,20 @@ BOOST_AUTO_TEST_CASE(EncodeDecodeTest) {
   BOOST_CHECK_EQUAL(input, output_single_precision_float);
 }
 
+BOOST_AUTO_TEST_CASE(UnpackMsgPackViewTest) {
+  std::string msgpacked_value = JsonStringToMsgPack("{\"hello\":\"world\",\"a\":[1,2]}");
+
+  msgpack::object_handle doc = UnpackMsgPackView(msgpacked_value);
+  const msgpack::object_kv& kv = doc.get().via.map.ptr[0];
+  BOOST_CHECK_EQUAL("hello", kv.key.as<std::string>());
+
+  // strings reference the packed data
+  BOOST_CHECK(kv.key.via.str.ptr >= msgpacked_value.data());
+  BOOST_CHECK(kv.key.via.str.ptr < msgpacked_value.data() + msgpacked_value.size());
+
+  BOOST_CHECK_EQUAL("{\"hello\":\"world\",\"a\":[1,2]}", MsgPackToJson(msgpacked_value));
+}
+
 BOOST_AUTO_TEST_CASE(EncodeDecodeFloats) {
   std::stringstream string_stream;
   string_stream << std::scientific;
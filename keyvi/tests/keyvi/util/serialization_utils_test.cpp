@@ -23,6 +23,8 @@
  *      Author: hendrik
  */
 
+#include <sstream>
+#include <stdexcept>
 #include <string>
 
 #include <boost/test/unit_test.hpp>
@@ -75,6 +77,23 @@ BOOST_AUTO_TEST_CASE(GetUint64FromValueOrStringTest) {
   BOOST_CHECK_THROW(SerializationUtils::GetUint64FromValueOrString(d, "uint64_not_there"), std::invalid_argument);
 }
 
+BOOST_AUTO_TEST_CASE(CopyStreamTest) {
+  // larger than the copy buffer, ends within a chunk
+  std::string data;
+  for (size_t i = 0; i < 3 * SerializationUtils::COPY_BUFFER_SIZE + 17; ++i) {
+    data.push_back(static_cast<char>(i % 251));
+  }
+
+  std::istringstream in_stream(data);
+  in_stream.seekg(5);
+  std::ostringstream out_stream;
+  SerializationUtils::CopyStream(in_stream, out_stream, data.size() - 10);
+  BOOST_CHECK(data.substr(5, data.size() - 10) == out_stream.str());
+
+  // not enough data left
+  BOOST_CHECK_THROW(SerializationUtils::CopyStream(in_stream, out_stream, 6), std::runtime_error);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } /* namespace util */
@@ -53,11 +53,9 @@ cdef extern from "keyvi/dictionary/dictionary.h" namespace "keyvi::dictionary":
         #  completer traverses the dictionary according to weights,
         #  otherwise byte-order.
         #  
-        #  Note, due to depth-first traversal the traverser
-        #  immediately yields results when it visits them. The results are
-        #  neither in order nor limited to n. It is up to the caller to resort
-        #  and truncate the lists of results.
-        #  Only the number of top completions is guaranteed.
+        #  Note, the completions are returned in descending order of
+        #  weight and limited to n. Older versions traversed depth-first,
+        #  returned the results unordered and possibly more than n.
 
         _MatchIteratorPair GetMultiwordCompletion (libcpp_utf8_string key) except + # wrap-as:complete_multiword
         # wrap-doc:
@@ -27,6 +27,8 @@ if __name__ == '__main__':
     argument_parser.add_argument('-i', '--input-file', action='append', default=[], dest='input_file')
     argument_parser.add_argument('-o', '--output-file', type=str)
     argument_parser.add_argument('-m', '--memory-limit', type=str, help='amount of main memory to use')
+    # accepted for compatibility with the native merger, segments without a key filter are always searched
+    argument_parser.add_argument('-f', '--key-filter', type=str, help='ignored, no key filter is written')
     argument_parser.add_argument('-p', '--parameter', action='append', default=[], dest='params',
                               type=lambda kv: kv.split("="),
                               help='An option; format is -p xxx=yyy')
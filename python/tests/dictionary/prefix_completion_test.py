@@ -35,9 +35,8 @@ def test_prefix_simple():
             "eric bxxxx",
         ]
 
-        # note: we are getting one more("eric"), because of dfs traversal
+        # the top 2 completions in descending order of weight
         assert [m.matched_string for m in d.complete_prefix("eric", 2)] == [
-            "eric",
             "eric ble",
             "eric bla",
         ]